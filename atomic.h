@@ -0,0 +1,161 @@
+#pragma once
+
+// Relaxed atomic operations that work when compiling as either C or C++
+
+#ifdef _WIN32
+#  include <windows.h>
+
+static inline uint64_t atomic_add_u64(volatile uint64_t *ptr, uint64_t value) {
+    return (uint64_t)InterlockedExchangeAdd64((volatile LONG64 *)ptr, (LONG64)value);
+}
+
+static inline uint64_t atomic_load_u64(volatile uint64_t *ptr) {
+    return (uint64_t)InterlockedCompareExchange64((volatile LONG64 *)ptr, 0, 0);
+}
+
+static inline void atomic_store_u64(volatile uint64_t *ptr, uint64_t value) {
+    InterlockedExchange64((volatile LONG64 *)ptr, (LONG64)value);
+}
+
+static inline uint64_t atomic_load_acquire_u64(volatile uint64_t *ptr) {
+    return (uint64_t)InterlockedCompareExchange64((volatile LONG64 *)ptr, 0, 0);
+}
+
+static inline void atomic_store_release_u64(volatile uint64_t *ptr, uint64_t value) {
+    InterlockedExchange64((volatile LONG64 *)ptr, (LONG64)value);
+}
+
+static inline bool atomic_cas_u64(volatile uint64_t *ptr, uint64_t expected, uint64_t desired) {
+    return (uint64_t)InterlockedCompareExchange64((volatile LONG64 *)ptr, (LONG64)desired, (LONG64)expected) ==
+           expected;
+}
+
+static inline int32_t atomic_increment_i32(volatile int32_t *ptr) {
+    return (int32_t)InterlockedIncrement((volatile LONG *)ptr);
+}
+
+static inline int32_t atomic_decrement_i32(volatile int32_t *ptr) {
+    return (int32_t)InterlockedDecrement((volatile LONG *)ptr);
+}
+
+static inline int32_t atomic_load_i32(volatile int32_t *ptr) {
+    // Aligned 32-bit reads are atomic, avoids taking ownership of the cache line when read from many threads
+    return *ptr;
+}
+
+static inline int32_t atomic_load_acquire_i32(volatile int32_t *ptr) {
+    return (int32_t)InterlockedCompareExchange((volatile LONG *)ptr, 0, 0);
+}
+
+static inline void atomic_store_release_i32(volatile int32_t *ptr, int32_t value) {
+    InterlockedExchange((volatile LONG *)ptr, (LONG)value);
+}
+
+static inline uint32_t atomic_load_acquire_u32(volatile uint32_t *ptr) {
+    return (uint32_t)InterlockedCompareExchange((volatile LONG *)ptr, 0, 0);
+}
+
+static inline bool atomic_cas_u32(volatile uint32_t *ptr, uint32_t expected, uint32_t desired) {
+    return (uint32_t)InterlockedCompareExchange((volatile LONG *)ptr, (LONG)desired, (LONG)expected) == expected;
+}
+
+static inline uint32_t atomic_or_u32(volatile uint32_t *ptr, uint32_t value) {
+    return (uint32_t)InterlockedOr((volatile LONG *)ptr, (LONG)value);
+}
+
+static inline uint32_t atomic_and_u32(volatile uint32_t *ptr, uint32_t value) {
+    return (uint32_t)InterlockedAnd((volatile LONG *)ptr, (LONG)value);
+}
+
+static inline void *atomic_load_acquire_ptr(void *volatile *ptr) {
+    return InterlockedCompareExchangePointer(ptr, NULL, NULL);
+}
+
+static inline void atomic_store_release_ptr(void *volatile *ptr, void *value) {
+    InterlockedExchangePointer(ptr, value);
+}
+
+static inline bool atomic_cas_ptr(void *volatile *ptr, void *expected, void *desired) {
+    return InterlockedCompareExchangePointer(ptr, desired, expected) == expected;
+}
+
+static inline void atomic_fence(void) {
+    MemoryBarrier();
+}
+#else
+static inline uint64_t atomic_add_u64(volatile uint64_t *ptr, uint64_t value) {
+    return __atomic_fetch_add(ptr, value, __ATOMIC_RELAXED);
+}
+
+static inline uint64_t atomic_load_u64(volatile uint64_t *ptr) {
+    return __atomic_load_n(ptr, __ATOMIC_RELAXED);
+}
+
+static inline void atomic_store_u64(volatile uint64_t *ptr, uint64_t value) {
+    __atomic_store_n(ptr, value, __ATOMIC_RELAXED);
+}
+
+static inline uint64_t atomic_load_acquire_u64(volatile uint64_t *ptr) {
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+static inline void atomic_store_release_u64(volatile uint64_t *ptr, uint64_t value) {
+    __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+}
+
+static inline bool atomic_cas_u64(volatile uint64_t *ptr, uint64_t expected, uint64_t desired) {
+    return __atomic_compare_exchange_n(ptr, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+}
+
+static inline int32_t atomic_increment_i32(volatile int32_t *ptr) {
+    return __atomic_add_fetch(ptr, 1, __ATOMIC_RELAXED);
+}
+
+static inline int32_t atomic_decrement_i32(volatile int32_t *ptr) {
+    return __atomic_sub_fetch(ptr, 1, __ATOMIC_ACQ_REL);
+}
+
+static inline int32_t atomic_load_i32(volatile int32_t *ptr) {
+    return __atomic_load_n(ptr, __ATOMIC_RELAXED);
+}
+
+static inline int32_t atomic_load_acquire_i32(volatile int32_t *ptr) {
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+static inline void atomic_store_release_i32(volatile int32_t *ptr, int32_t value) {
+    __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+}
+
+static inline uint32_t atomic_load_acquire_u32(volatile uint32_t *ptr) {
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+static inline bool atomic_cas_u32(volatile uint32_t *ptr, uint32_t expected, uint32_t desired) {
+    return __atomic_compare_exchange_n(ptr, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+static inline uint32_t atomic_or_u32(volatile uint32_t *ptr, uint32_t value) {
+    return __atomic_fetch_or(ptr, value, __ATOMIC_ACQ_REL);
+}
+
+static inline uint32_t atomic_and_u32(volatile uint32_t *ptr, uint32_t value) {
+    return __atomic_fetch_and(ptr, value, __ATOMIC_ACQ_REL);
+}
+
+static inline void *atomic_load_acquire_ptr(void *volatile *ptr) {
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+static inline void atomic_store_release_ptr(void *volatile *ptr, void *value) {
+    __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+}
+
+static inline bool atomic_cas_ptr(void *volatile *ptr, void *expected, void *desired) {
+    return __atomic_compare_exchange_n(ptr, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+static inline void atomic_fence(void) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+#endif
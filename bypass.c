@@ -0,0 +1,303 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#  include <winsock2.h>
+#  include <ws2tcpip.h>
+#  define strcasecmp _stricmp
+#else
+#  include <arpa/inet.h>
+#  include <strings.h>
+#  include <sys/socket.h>
+#endif
+
+#include "bypass.h"
+#include "util.h"
+
+typedef enum bypass_rule_type_e {
+    // Host wildcard pattern with optional port
+    BYPASS_RULE_HOST,
+    // IP address range in cidr notation
+    BYPASS_RULE_CIDR_IPV4,
+    BYPASS_RULE_CIDR_IPV6,
+    // <local> bypasses simple hostnames
+    BYPASS_RULE_LOCAL,
+    // <-loopback> allows localhost urls to go through proxy
+    BYPASS_RULE_LOOPBACK
+} bypass_rule_type_e;
+
+typedef struct bypass_rule_s {
+    bypass_rule_type_e type;
+    // Host pattern without port, stored in the same allocation as the rules
+    const char *pattern;
+    // Port to match, 0 when any port matches
+    uint16_t port;
+    // Network address and prefix length in bits for cidr rules
+    int32_t prefix;
+    uint8_t address[16];
+} bypass_rule_s;
+
+typedef struct bypass_s {
+    int32_t rule_count;
+    bypass_rule_s *rules;
+} bypass_s;
+
+static bool bypass_is_in_prefix(const uint8_t *address, const uint8_t *network, int32_t prefix) {
+    // Compare leading bytes of address
+    const int32_t check_bytes = prefix / 8;
+    if (check_bytes && memcmp(address, network, check_bytes) != 0)
+        return false;
+
+    // Check remaining bits of address
+    const int32_t check_bits = prefix % 8;
+    if (check_bits) {
+        const uint8_t mask = (uint8_t)(0xff << (8 - check_bits));
+        return (address[check_bytes] & mask) == (network[check_bytes] & mask);
+    }
+    return true;
+}
+
+// Parse the host and port of a url into a buffer without allocating
+static bool bypass_get_url_host(const char *url, char *host, size_t max_host) {
+    // Find the start of the host after the scheme
+    const char *host_start = strstr(url, "://");
+    if (host_start)
+        host_start += 3;
+    else
+        host_start = url;
+
+    // Find the end of the host
+    const char *host_end = strchr(host_start, '/');
+    if (!host_end)
+        host_end = host_start + strlen(host_start);
+
+    // Skip username and password
+    for (const char *at_start = host_start; at_start < host_end; at_start++) {
+        if (*at_start == '@')
+            host_start = at_start + 1;
+    }
+
+    const size_t host_len = (size_t)(host_end - host_start);
+    if (host_len >= max_host)
+        return false;
+    memcpy(host, host_start, host_len);
+    host[host_len] = 0;
+    return true;
+}
+
+// Infer default port from the url scheme
+static uint16_t bypass_get_url_default_port(const char *url) {
+    char scheme[16] = "http";
+    const char *scheme_end = strstr(url, "://");
+    if (scheme_end) {
+        const size_t scheme_len = (size_t)(scheme_end - url);
+        if (scheme_len >= sizeof(scheme))
+            return 0;
+        memcpy(scheme, url, scheme_len);
+        scheme[scheme_len] = 0;
+    }
+    return get_scheme_default_port(scheme);
+}
+
+// Convert host to binary address, returns address family or 0 if host is not an ip address
+static int32_t bypass_get_host_address(const char *host, uint8_t *address) {
+    char ip[HOST_MAX];
+
+    strncpy(ip, host, sizeof(ip) - 1);
+    ip[sizeof(ip) - 1] = 0;
+    strip_host_ipv6_brackets(ip);
+
+    if (inet_pton(AF_INET, ip, address) == 1)
+        return AF_INET;
+    if (inet_pton(AF_INET6, ip, address) == 1)
+        return AF_INET6;
+    return 0;
+}
+
+bool bypass_should_bypass(const void *ctx, const char *url) {
+    const bypass_s *bypass = (const bypass_s *)ctx;
+    char host[HOST_MAX];
+    uint8_t host_address[16];
+    int32_t host_family = -1;
+    bool should_bypass = false;
+
+    if (!url)
+        return true;
+
+    // Chromium documentation for proxy bypass rules:
+    // https://chromium.googlesource.com/chromium/src/+/HEAD/net/docs/proxy.md#Proxy-bypass-rules
+
+    // Parse host without port for url
+    if (!bypass_get_url_host(url, host, sizeof(host)))
+        return true;
+
+    // Strip and parse port from host
+    uint16_t host_port = strip_host_port(host, strlen(host), 0);
+
+    // Check for localhost address
+    const bool is_local = !strcmp(host, "127.0.0.1") || !strcmp(host, "[::1]") || !strcasecmp(host, "localhost");
+
+    // By default don't allow localhost urls to go through proxy
+    if (is_local)
+        should_bypass = true;
+
+    if (!bypass)
+        return should_bypass;
+
+    // Check for simple hostnames
+    const bool is_simple = strchr(host, '.') == NULL;
+
+    // Evaluate each bypass rule in order, later rules can override earlier ones
+    for (int32_t i = 0; i < bypass->rule_count; i++) {
+        const bypass_rule_s *rule = &bypass->rules[i];
+
+        switch (rule->type) {
+        case BYPASS_RULE_HOST:
+            // If the rule matches hostname of url then bypass proxy
+            if (!str_wildcard_match(host, rule->pattern, true))
+                break;
+            should_bypass = true;
+
+            // Check bypass rule port
+            if (rule->port) {
+                // Infer default host port from url scheme
+                if (!host_port)
+                    host_port = bypass_get_url_default_port(url);
+
+                // If the host port doesn't match the bypass rule port then don't bypass
+                if (rule->port != host_port)
+                    should_bypass = false;
+            }
+            break;
+        case BYPASS_RULE_CIDR_IPV4:
+        case BYPASS_RULE_CIDR_IPV6:
+            // Only convert host to an address when there is a cidr rule
+            if (host_family < 0)
+                host_family = bypass_get_host_address(host, host_address);
+
+            // If the host is an ip that matches cidr range then bypass proxy
+            if (host_family == (rule->type == BYPASS_RULE_CIDR_IPV4 ? AF_INET : AF_INET6) &&
+                bypass_is_in_prefix(host_address, rule->address, rule->prefix))
+                should_bypass = true;
+            break;
+        case BYPASS_RULE_LOCAL:
+            // Allow all simple hostnames to bypass proxy
+            if (is_simple)
+                should_bypass = true;
+            break;
+        case BYPASS_RULE_LOOPBACK:
+            // Allow localhost urls to go through proxy
+            if (is_local)
+                should_bypass = false;
+            break;
+        }
+    }
+
+    return should_bypass;
+}
+
+static bool bypass_parse_cidr(bypass_rule_s *rule, char *pattern) {
+    char *prefix = strchr(pattern, '/');
+    *prefix++ = 0;
+
+    // Convert cidr ip from text to binary
+    int32_t max_prefix = 0;
+    if (inet_pton(AF_INET, pattern, rule->address) == 1) {
+        rule->type = BYPASS_RULE_CIDR_IPV4;
+        max_prefix = 32;
+    } else if (inet_pton(AF_INET6, pattern, rule->address) == 1) {
+        rule->type = BYPASS_RULE_CIDR_IPV6;
+        max_prefix = 128;
+    } else {
+        return false;
+    }
+
+    // Parse cidr prefix
+    rule->prefix = atoi(prefix);
+    return rule->prefix >= 0 && rule->prefix <= max_prefix;
+}
+
+void *bypass_create(const char *bypass_list) {
+    if (!bypass_list)
+        return NULL;
+
+    // Allocate rules and patterns together so the bypass list is deleted with a single free
+    const size_t bypass_list_len = strlen(bypass_list);
+    const int32_t max_rules = str_count_chr(bypass_list, ',') + 1;
+    const size_t max_patterns = bypass_list_len + (size_t)max_rules * 2;
+    bypass_s *bypass =
+        (bypass_s *)calloc(1, sizeof(bypass_s) + max_rules * sizeof(bypass_rule_s) + max_patterns * sizeof(char));
+    if (!bypass)
+        return NULL;
+
+    bypass->rules = (bypass_rule_s *)(bypass + 1);
+    char *patterns = (char *)(bypass->rules + max_rules);
+
+    // Enumerate through each bypass expression in the bypass list
+    const char *bypass_list_end = bypass_list + bypass_list_len;
+    const char *rule_start = bypass_list;
+    const char *rule_end = NULL;
+
+    do {
+        // Ignore leading whitespace
+        while (*rule_start == ' ')
+            rule_start++;
+
+        // Rules can be separated by a comma
+        rule_end = strchr(rule_start, ',');
+        if (!rule_end)
+            rule_end = rule_start + strlen(rule_start);
+        size_t rule_len = (size_t)(rule_end - rule_start);
+        if (rule_len > HOST_MAX - 2)
+            rule_len = HOST_MAX - 2;
+
+        bypass_rule_s *rule = &bypass->rules[bypass->rule_count];
+        char *pattern = patterns;
+        memset(rule, 0, sizeof(bypass_rule_s));
+
+        // Copy wildcard to match subdomain rule
+        if (*rule_start == '.')
+            *patterns++ = '*';
+
+        // Copy rule to pattern buffer
+        memcpy(patterns, rule_start, rule_len);
+        patterns += rule_len;
+        *patterns++ = 0;
+
+        if (!*pattern) {
+            // Ignore empty rules
+        } else if (strchr(pattern, '/')) {
+            // Rules with an invalid cidr range never match
+            if (bypass_parse_cidr(rule, pattern))
+                bypass->rule_count++;
+        } else {
+            // Strip and parse port from bypass rule
+            rule->port = strip_host_port(pattern, strlen(pattern), 0);
+            rule->pattern = pattern;
+
+            if (strcasecmp(pattern, "<local>") == 0)
+                rule->type = BYPASS_RULE_LOCAL;
+            else if (strcasecmp(pattern, "<-loopback>") == 0)
+                rule->type = BYPASS_RULE_LOOPBACK;
+            else
+                rule->type = BYPASS_RULE_HOST;
+            bypass->rule_count++;
+        }
+
+        rule_start = rule_end + 1;
+    } while (rule_end < bypass_list_end);
+
+    return bypass;
+}
+
+bool bypass_delete(void **ctx) {
+    if (!ctx || !*ctx)
+        return false;
+    free(*ctx);
+    *ctx = NULL;
+    return true;
+}
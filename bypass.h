@@ -0,0 +1,18 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Evaluates whether or not the proxy should be bypassed for a given url using a compiled bypass list
+bool bypass_should_bypass(const void *ctx, const char *url);
+
+// Compile a comma separated proxy bypass list so that it can be evaluated without allocating
+void *bypass_create(const char *bypass_list);
+
+// Delete a compiled proxy bypass list
+bool bypass_delete(void **ctx);
+
+#ifdef __cplusplus
+}
+#endif
@@ -4,10 +4,20 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
+#ifndef _WIN32
+#  include <sched.h>
+#endif
+
+#define LOG_CATEGORY PROXYRES_LOG_CATEGORY_CONFIG
+
+#include "atomic.h"
+#include "bypass.h"
 #include "config.h"
 #include "config_i.h"
 #include "config_env.h"
+#include "event.h"
 #if defined(__APPLE__)
 #  include "config_mac.h"
 #elif defined(__linux__)
@@ -20,8 +30,45 @@
 #  include "config_win.h"
 #endif
 #include "log.h"
+#include "mutex.h"
+#include "util.h"
 #include "util_linux.h"
 
+// Schemes with proxies that are read into config snapshots
+static const char *proxy_config_snapshot_schemes[] = {"http", "https", "ftp", "socks", "ws", "wss"};
+
+#define PROXY_CONFIG_SNAPSHOT_SCHEME_COUNT \
+    (sizeof(proxy_config_snapshot_schemes) / sizeof(proxy_config_snapshot_schemes[0]))
+
+// Default maximum age in seconds before a snapshot is read again, for system configs that do not notify of changes
+#define PROXY_CONFIG_SNAPSHOT_MAX_AGE (1)
+
+// Proxy for a scheme that is not read into the snapshot up front
+typedef struct proxy_config_snapshot_proxy_s {
+    char *scheme;
+    char *proxy;
+    struct proxy_config_snapshot_proxy_s *next;
+} proxy_config_snapshot_proxy_s;
+
+typedef struct proxy_config_snapshot_s {
+    // Number of outstanding references including the global reference to the most recent snapshot
+    volatile int32_t ref_count;
+    // Config generation and time the snapshot was read
+    uint64_t generation;
+    time_t read_time;
+    bool auto_discover;
+    char *auto_config_url;
+    // Proxy override used for every scheme
+    char *proxy_override;
+    // System proxy for each scheme, NULL when not specified
+    char *proxies[PROXY_CONFIG_SNAPSHOT_SCHEME_COUNT];
+    // System proxies for other schemes, read when first requested
+    proxy_config_snapshot_proxy_s *volatile other_proxies;
+    char *bypass_list;
+    // Compiled bypass list
+    void *bypass;
+} proxy_config_snapshot_s;
+
 typedef struct g_proxy_config_s {
     // Library reference count
     int32_t ref_count;
@@ -32,10 +79,68 @@ typedef struct g_proxy_config_s {
     char *auto_config_url;
     char *proxy;
     char *bypass_list;
+    // Lock held while replacing the snapshot
+    void *mutex;
+    // Most recently read config snapshot, acquired without locking
+    proxy_config_swap_s snapshot;
+    // Maximum age in seconds before a snapshot is read again
+    int32_t snapshot_max_age;
+    // Whether a snapshot is being read, other callers wait for it instead of reading their own
+    bool is_reading;
+    void *read_complete;
 } g_proxy_config_s;
 
 g_proxy_config_s g_proxy_config;
 
+// Kept outside of g_proxy_config so it is never reset and cached decisions are not reused across reinitialization
+static volatile uint64_t g_proxy_config_generation;
+
+uint64_t proxy_config_get_generation(void) {
+    return atomic_load_acquire_u64(&g_proxy_config_generation);
+}
+
+void proxy_config_increment_generation(void) {
+    atomic_add_u64(&g_proxy_config_generation, 1);
+}
+
+void *proxy_config_swap_read_begin(proxy_config_swap_s *swap, uint32_t *epoch) {
+    for (;;) {
+        *epoch = atomic_load_acquire_u32(&swap->epoch) & 1;
+        atomic_increment_i32(&swap->readers[*epoch]);
+        // Reader must be counted before the data is loaded so that the writer can't miss it
+        atomic_fence();
+        if ((atomic_load_acquire_u32(&swap->epoch) & 1) == *epoch)
+            break;
+        // Epoch changed before the reader was counted, count it for the new epoch instead
+        atomic_decrement_i32(&swap->readers[*epoch]);
+    }
+    return atomic_load_acquire_ptr(&swap->data);
+}
+
+void proxy_config_swap_read_end(proxy_config_swap_s *swap, uint32_t epoch) {
+    atomic_decrement_i32(&swap->readers[epoch]);
+}
+
+void *proxy_config_swap_exchange(proxy_config_swap_s *swap, void *data) {
+    void *old_data = atomic_load_acquire_ptr(&swap->data);
+    atomic_store_release_ptr(&swap->data, data);
+
+    // Readers that begin after the epoch changes are only able to see the new data
+    const uint32_t epoch = atomic_load_acquire_u32(&swap->epoch);
+    atomic_cas_u32(&swap->epoch, epoch, epoch + 1);
+    atomic_fence();
+
+    // Wait for readers that may still be using the old data, which only hold it for a single lookup
+    while (atomic_load_acquire_i32(&swap->readers[epoch & 1]) != 0) {
+#ifdef _WIN32
+        SwitchToThread();
+#else
+        sched_yield();
+#endif
+    }
+    return old_data;
+}
+
 bool proxy_config_get_auto_discover(void) {
     if (g_proxy_config.auto_discover_disable)
         return false;
@@ -52,14 +157,18 @@ char *proxy_config_get_auto_config_url(void) {
     return g_proxy_config.proxy_config_i->get_auto_config_url();
 }
 
-char *proxy_config_get_proxy(const char *scheme) {
-    if (g_proxy_config.proxy)
-        return strdup(g_proxy_config.proxy);
+static char *proxy_config_get_system_proxy(const char *scheme) {
     if (!g_proxy_config.proxy_config_i)
         return NULL;
     return g_proxy_config.proxy_config_i->get_proxy(scheme);
 }
 
+char *proxy_config_get_proxy(const char *scheme) {
+    if (g_proxy_config.proxy)
+        return strdup(g_proxy_config.proxy);
+    return proxy_config_get_system_proxy(scheme);
+}
+
 char *proxy_config_get_bypass_list(void) {
     if (g_proxy_config.bypass_list)
         return strdup(g_proxy_config.bypass_list);
@@ -68,11 +177,206 @@ char *proxy_config_get_bypass_list(void) {
     return g_proxy_config.proxy_config_i->get_bypass_list();
 }
 
+static void proxy_config_snapshot_delete(proxy_config_snapshot_s *snapshot) {
+    free(snapshot->auto_config_url);
+    free(snapshot->proxy_override);
+    for (size_t i = 0; i < PROXY_CONFIG_SNAPSHOT_SCHEME_COUNT; i++)
+        free(snapshot->proxies[i]);
+    while (snapshot->other_proxies) {
+        proxy_config_snapshot_proxy_s *other_proxy = snapshot->other_proxies;
+        snapshot->other_proxies = other_proxy->next;
+        free(other_proxy->scheme);
+        free(other_proxy->proxy);
+        free(other_proxy);
+    }
+    free(snapshot->bypass_list);
+    bypass_delete(&snapshot->bypass);
+    free(snapshot);
+}
+
+static proxy_config_snapshot_s *proxy_config_snapshot_create(uint64_t generation) {
+    proxy_config_snapshot_s *snapshot = (proxy_config_snapshot_s *)calloc(1, sizeof(proxy_config_snapshot_s));
+    if (!snapshot)
+        return NULL;
+
+    snapshot->ref_count = 1;
+    snapshot->generation = generation;
+    snapshot->read_time = time(NULL);
+    snapshot->auto_discover = proxy_config_get_auto_discover();
+    snapshot->auto_config_url = proxy_config_get_auto_config_url();
+    // Proxy override applies to every scheme, so system proxies are only needed without it
+    if (g_proxy_config.proxy) {
+        snapshot->proxy_override = strdup(g_proxy_config.proxy);
+    } else {
+        for (size_t i = 0; i < PROXY_CONFIG_SNAPSHOT_SCHEME_COUNT; i++)
+            snapshot->proxies[i] = proxy_config_get_system_proxy(proxy_config_snapshot_schemes[i]);
+    }
+    snapshot->bypass_list = proxy_config_get_bypass_list();
+    snapshot->bypass = bypass_create(snapshot->bypass_list);
+    return snapshot;
+}
+
+static bool proxy_config_snapshot_is_current(const proxy_config_snapshot_s *snapshot, uint64_t generation,
+                                             time_t now) {
+    if (!snapshot || snapshot->generation != generation)
+        return false;
+    // System configs that don't notify of changes are read again once the snapshot is old
+    const proxy_config_i_s *proxy_config_i = g_proxy_config.proxy_config_i;
+    if (proxy_config_i && proxy_config_i->is_monitored && proxy_config_i->is_monitored())
+        return true;
+    return now - snapshot->read_time < g_proxy_config.snapshot_max_age;
+}
+
+// Reference the most recent snapshot if it is current, without locking
+static proxy_config_snapshot_s *proxy_config_snapshot_acquire_current(uint64_t generation, time_t now) {
+    uint32_t epoch = 0;
+
+    // Snapshot is referenced before the read ends so that it can't be released by the writer replacing it
+    proxy_config_snapshot_s *snapshot =
+        (proxy_config_snapshot_s *)proxy_config_swap_read_begin(&g_proxy_config.snapshot, &epoch);
+    if (proxy_config_snapshot_is_current(snapshot, generation, now))
+        atomic_increment_i32(&snapshot->ref_count);
+    else
+        snapshot = NULL;
+    proxy_config_swap_read_end(&g_proxy_config.snapshot, epoch);
+    return snapshot;
+}
+
+void *proxy_config_snapshot_acquire(void) {
+    proxy_config_snapshot_s *snapshot = NULL;
+
+    if (!g_proxy_config.mutex)
+        return NULL;
+
+    for (;;) {
+        const uint64_t generation = proxy_config_get_generation();
+        const time_t now = time(NULL);
+
+        snapshot = proxy_config_snapshot_acquire_current(generation, now);
+        if (snapshot)
+            return snapshot;
+
+        mutex_lock(g_proxy_config.mutex);
+        if (!g_proxy_config.is_reading) {
+            g_proxy_config.is_reading = true;
+            event_reset(g_proxy_config.read_complete);
+            mutex_unlock(g_proxy_config.mutex);
+            break;
+        }
+        mutex_unlock(g_proxy_config.mutex);
+
+        // Wait for the snapshot being read by another caller
+        event_wait(g_proxy_config.read_complete, -1);
+    }
+
+    // Read config without holding the lock because reading the system config can be slow
+    const uint64_t generation = proxy_config_get_generation();
+    snapshot = proxy_config_snapshot_create(generation);
+
+    // Keep the snapshot for other callers unless a newer one was stored in the meantime
+    proxy_config_snapshot_s *old_snapshot = NULL;
+    mutex_lock(g_proxy_config.mutex);
+    const proxy_config_snapshot_s *current = (const proxy_config_snapshot_s *)g_proxy_config.snapshot.data;
+    if (snapshot && (!current || current->generation <= generation)) {
+        atomic_increment_i32(&snapshot->ref_count);
+        old_snapshot = (proxy_config_snapshot_s *)proxy_config_swap_exchange(&g_proxy_config.snapshot, snapshot);
+    }
+    g_proxy_config.is_reading = false;
+    mutex_unlock(g_proxy_config.mutex);
+    event_set(g_proxy_config.read_complete);
+
+    proxy_config_snapshot_release((void **)&old_snapshot);
+    return snapshot;
+}
+
+bool proxy_config_snapshot_release(void **ctx) {
+    if (!ctx || !*ctx)
+        return false;
+    proxy_config_snapshot_s *snapshot = (proxy_config_snapshot_s *)*ctx;
+    if (atomic_decrement_i32(&snapshot->ref_count) == 0)
+        proxy_config_snapshot_delete(snapshot);
+    *ctx = NULL;
+    return true;
+}
+
+bool proxy_config_snapshot_get_auto_discover(const void *ctx) {
+    const proxy_config_snapshot_s *snapshot = (const proxy_config_snapshot_s *)ctx;
+    return snapshot && snapshot->auto_discover;
+}
+
+const char *proxy_config_snapshot_get_auto_config_url(const void *ctx) {
+    const proxy_config_snapshot_s *snapshot = (const proxy_config_snapshot_s *)ctx;
+    return snapshot ? snapshot->auto_config_url : NULL;
+}
+
+const char *proxy_config_snapshot_get_proxy(const void *ctx, const char *scheme) {
+    proxy_config_snapshot_s *snapshot = (proxy_config_snapshot_s *)ctx;
+    if (!snapshot || !scheme)
+        return NULL;
+    if (snapshot->proxy_override)
+        return snapshot->proxy_override;
+    for (size_t i = 0; i < PROXY_CONFIG_SNAPSHOT_SCHEME_COUNT; i++) {
+        if (strcmp(scheme, proxy_config_snapshot_schemes[i]) == 0)
+            return snapshot->proxies[i];
+    }
+
+    // Other schemes are read from the system config once and kept until the snapshot is deleted
+    proxy_config_snapshot_proxy_s *other_proxies =
+        (proxy_config_snapshot_proxy_s *)atomic_load_acquire_ptr((void *volatile *)&snapshot->other_proxies);
+    for (proxy_config_snapshot_proxy_s *other_proxy = other_proxies; other_proxy; other_proxy = other_proxy->next) {
+        if (strcmp(scheme, other_proxy->scheme) == 0)
+            return other_proxy->proxy;
+    }
+
+    proxy_config_snapshot_proxy_s *other_proxy =
+        (proxy_config_snapshot_proxy_s *)calloc(1, sizeof(proxy_config_snapshot_proxy_s));
+    if (!other_proxy)
+        return NULL;
+    other_proxy->scheme = strdup(scheme);
+    other_proxy->proxy = proxy_config_get_system_proxy(scheme);
+    if (!other_proxy->scheme) {
+        free(other_proxy->proxy);
+        free(other_proxy);
+        return NULL;
+    }
+
+    // Concurrent readers may add the same scheme twice, which only costs a duplicate entry
+    for (;;) {
+        other_proxy->next = other_proxies;
+        if (atomic_cas_ptr((void *volatile *)&snapshot->other_proxies, other_proxies, other_proxy))
+            break;
+        other_proxies =
+            (proxy_config_snapshot_proxy_s *)atomic_load_acquire_ptr((void *volatile *)&snapshot->other_proxies);
+    }
+    return other_proxy->proxy;
+}
+
+const char *proxy_config_snapshot_get_bypass_list(const void *ctx) {
+    const proxy_config_snapshot_s *snapshot = (const proxy_config_snapshot_s *)ctx;
+    return snapshot ? snapshot->bypass_list : NULL;
+}
+
+bool proxy_config_snapshot_should_bypass(const void *ctx, const char *url) {
+    const proxy_config_snapshot_s *snapshot = (const proxy_config_snapshot_s *)ctx;
+    return bypass_should_bypass(snapshot ? snapshot->bypass : NULL, url);
+}
+
+void proxy_config_snapshot_set_max_age(int32_t max_age_sec) {
+    g_proxy_config.snapshot_max_age = max_age_sec;
+}
+
+void proxy_config_refresh(void) {
+    if (g_proxy_config.proxy_config_i && g_proxy_config.proxy_config_i->refresh)
+        g_proxy_config.proxy_config_i->refresh();
+    proxy_config_increment_generation();
+}
+
 void proxy_config_set_auto_config_url_override(const char *auto_config_url) {
     if (g_proxy_config.auto_config_url)
         free(g_proxy_config.auto_config_url);
     g_proxy_config.auto_config_url = auto_config_url ? strdup(auto_config_url) : NULL;
     g_proxy_config.auto_discover_disable = auto_config_url != NULL;
+    proxy_config_increment_generation();
 }
 
 void proxy_config_set_proxy_override(const char *proxy) {
@@ -80,11 +384,13 @@ void proxy_config_set_proxy_override(const char *proxy) {
         free(g_proxy_config.proxy);
     g_proxy_config.proxy = proxy ? strdup(proxy) : NULL;
     g_proxy_config.auto_discover_disable = proxy != NULL;
+    proxy_config_increment_generation();
 }
 
 void proxy_config_set_bypass_list_override(const char *bypass_list) {
     free(g_proxy_config.bypass_list);
     g_proxy_config.bypass_list = bypass_list ? strdup(bypass_list) : NULL;
+    proxy_config_increment_generation();
 }
 
 bool proxy_config_global_init(void) {
@@ -118,8 +424,12 @@ bool proxy_config_global_init(void) {
         break;
     }
 
-    if (!g_proxy_config.proxy_config_i)
+    if (!g_proxy_config.proxy_config_i) {
+        // Environment variables are read directly when unable to initialize snapshot
+        if (!proxy_config_env_global_init())
+            LOG_WARN("Unable to read proxy environment variables\n");
         g_proxy_config.proxy_config_i = proxy_config_env_get_interface();
+    }
 #elif defined(_WIN32)
     if (proxy_config_win_global_init())
         g_proxy_config.proxy_config_i = proxy_config_win_get_interface();
@@ -128,6 +438,15 @@ bool proxy_config_global_init(void) {
         LOG_ERROR("No config interface found\n");
         return false;
     }
+    g_proxy_config.snapshot_max_age = PROXY_CONFIG_SNAPSHOT_MAX_AGE;
+    g_proxy_config.mutex = mutex_create();
+    g_proxy_config.read_complete = event_create();
+    if (!g_proxy_config.mutex || !g_proxy_config.read_complete) {
+        mutex_delete(&g_proxy_config.mutex);
+        event_delete(&g_proxy_config.read_complete);
+        g_proxy_config.proxy_config_i->global_cleanup();
+        return false;
+    }
     g_proxy_config.ref_count++;
     return true;
 }
@@ -139,6 +458,9 @@ bool proxy_config_global_cleanup(void) {
     free(g_proxy_config.auto_config_url);
     free(g_proxy_config.proxy);
     free(g_proxy_config.bypass_list);
+    proxy_config_snapshot_release((void **)&g_proxy_config.snapshot.data);
+    mutex_delete(&g_proxy_config.mutex);
+    event_delete(&g_proxy_config.read_complete);
 
     if (g_proxy_config.proxy_config_i)
         g_proxy_config.proxy_config_i->global_cleanup();
@@ -8,75 +8,74 @@
 #include "config.h"
 #include "config_i.h"
 #include "config_env.h"
+#include "mutex.h"
 #include "util.h"
 
+// Schemes with proxy environment variables that are read into the snapshot
+static const char *proxy_config_env_schemes[] = {"http", "https", "ftp", "socks", "ws", "wss"};
+
+#define PROXY_CONFIG_ENV_SCHEME_COUNT (sizeof(proxy_config_env_schemes) / sizeof(proxy_config_env_schemes[0]))
+
+typedef struct proxy_config_env_snapshot_s {
+    // Proxy for each scheme, NULL when not specified
+    char *proxies[PROXY_CONFIG_ENV_SCHEME_COUNT];
+    // Bypass list from no_proxy
+    char *bypass_list;
+} proxy_config_env_snapshot_s;
+
+typedef struct g_proxy_config_env_s {
+    // Serializes refreshes
+    void *mutex;
+    // Environment variables read at initialization or last refresh
+    proxy_config_swap_s snapshot;
+} g_proxy_config_env_s;
+
+g_proxy_config_env_s g_proxy_config_env;
+
 // Get the environment variable using all lowercase name and then all uppercase name
 // https://unix.stackexchange.com/questions/212894
 
-static char *get_proxy_env_var(const char *name, bool check_uppercase) {
-    // Check original lowercase environment variable name passed in
-    char *proxy = getenv(name);
+static const char *get_proxy_env_var(const char *name, bool check_uppercase) {
+    char upper_name[64];
 
-    if (proxy) {
-        if (*proxy)
-            return proxy;
-        free(proxy);
-    }
+    // Check original lowercase environment variable name passed in
+    const char *proxy = getenv(name);
+    if (proxy && *proxy)
+        return proxy;
 
     if (check_uppercase) {
-        // Allocate a copy of the environment variable name
-        char *upper_name = strdup(name);
-        if (!upper_name)
+        // Convert name to all uppercase
+        size_t name_len = strlen(name);
+        if (name_len >= sizeof(upper_name))
             return NULL;
-
-        // Convert string to all uppercase
-        for (size_t i = 0; i < strlen(upper_name); i++)
-            upper_name[i] = toupper(upper_name[i]);
+        for (size_t i = 0; i <= name_len; i++)
+            upper_name[i] = (char)toupper(name[i]);
 
         // Check uppercase environment variable name
         proxy = getenv(upper_name);
-        free(upper_name);
-        if (proxy && !*proxy) {
-            free(proxy);
-            proxy = NULL;
-        }
-        return proxy;
+        if (proxy && *proxy)
+            return proxy;
     }
     return NULL;
 }
 
-bool proxy_config_env_get_auto_discover(void) {
-    return false;
-}
-
-char *proxy_config_env_get_auto_config_url(void) {
-    return NULL;
-}
-
-char *proxy_config_env_get_proxy(const char *scheme) {
-    if (!scheme)
-        return NULL;
+static char *proxy_config_env_read_proxy(const char *scheme) {
+    char name[64];
 
     // Construct name of environment variable based on proxy scheme
-    size_t name_len = strlen(scheme) + 8;
-    char *name = (char *)malloc(name_len);
-    if (!name)
-        return NULL;
-    snprintf(name, name_len, "%s_proxy", scheme);
+    snprintf(name, sizeof(name), "%s_proxy", scheme);
 
     // Don't check HTTP_PROXY due to CGI environment variable creation
     // https://everything.curl.dev/usingcurl/proxies/env
     bool check_uppercase = strcmp(scheme, "http") != 0;
 
-    char *proxy = get_proxy_env_var(name, check_uppercase);
-    free(name);
+    const char *proxy = get_proxy_env_var(name, check_uppercase);
     if (!proxy)
         return NULL;
-
     return strdup(proxy);
 }
 
-char *proxy_config_env_get_bypass_list(void) {
+static char *proxy_config_env_read_bypass_list(void) {
     const char *no_proxy = get_proxy_env_var("no_proxy", true);
     if (!no_proxy)
         return NULL;
@@ -90,16 +89,118 @@ char *proxy_config_env_get_bypass_list(void) {
     return bypass_list;
 }
 
+static void proxy_config_env_snapshot_delete(proxy_config_env_snapshot_s *snapshot) {
+    if (!snapshot)
+        return;
+    for (size_t i = 0; i < PROXY_CONFIG_ENV_SCHEME_COUNT; i++)
+        free(snapshot->proxies[i]);
+    free(snapshot->bypass_list);
+    free(snapshot);
+}
+
+static int32_t proxy_config_env_find_scheme(const char *scheme) {
+    for (size_t i = 0; i < PROXY_CONFIG_ENV_SCHEME_COUNT; i++) {
+        if (strcmp(scheme, proxy_config_env_schemes[i]) == 0)
+            return (int32_t)i;
+    }
+    return -1;
+}
+
+bool proxy_config_env_get_auto_discover(void) {
+    return false;
+}
+
+char *proxy_config_env_get_auto_config_url(void) {
+    return NULL;
+}
+
+char *proxy_config_env_get_proxy(const char *scheme) {
+    uint32_t epoch = 0;
+    char *proxy = NULL;
+
+    if (!scheme)
+        return NULL;
+
+    // Read environment directly for schemes that are not in the snapshot or when not initialized
+    const int32_t index = proxy_config_env_find_scheme(scheme);
+    if (index < 0)
+        return proxy_config_env_read_proxy(scheme);
+
+    const proxy_config_env_snapshot_s *snapshot =
+        (const proxy_config_env_snapshot_s *)proxy_config_swap_read_begin(&g_proxy_config_env.snapshot, &epoch);
+    if (snapshot && snapshot->proxies[index])
+        proxy = strdup(snapshot->proxies[index]);
+    proxy_config_swap_read_end(&g_proxy_config_env.snapshot, epoch);
+    if (!snapshot)
+        return proxy_config_env_read_proxy(scheme);
+    return proxy;
+}
+
+char *proxy_config_env_get_bypass_list(void) {
+    uint32_t epoch = 0;
+    char *bypass_list = NULL;
+
+    const proxy_config_env_snapshot_s *snapshot =
+        (const proxy_config_env_snapshot_s *)proxy_config_swap_read_begin(&g_proxy_config_env.snapshot, &epoch);
+    if (snapshot && snapshot->bypass_list)
+        bypass_list = strdup(snapshot->bypass_list);
+    proxy_config_swap_read_end(&g_proxy_config_env.snapshot, epoch);
+    if (!snapshot)
+        return proxy_config_env_read_bypass_list();
+    return bypass_list;
+}
+
+bool proxy_config_env_refresh(void) {
+    if (!g_proxy_config_env.mutex)
+        return false;
+
+    proxy_config_env_snapshot_s *snapshot =
+        (proxy_config_env_snapshot_s *)calloc(1, sizeof(proxy_config_env_snapshot_s));
+    if (!snapshot)
+        return false;
+
+    for (size_t i = 0; i < PROXY_CONFIG_ENV_SCHEME_COUNT; i++)
+        snapshot->proxies[i] = proxy_config_env_read_proxy(proxy_config_env_schemes[i]);
+    snapshot->bypass_list = proxy_config_env_read_bypass_list();
+
+    // Publish the snapshot so readers see either the old or new environment in its entirety
+    mutex_lock(g_proxy_config_env.mutex);
+    proxy_config_env_snapshot_s *old_snapshot =
+        (proxy_config_env_snapshot_s *)proxy_config_swap_exchange(&g_proxy_config_env.snapshot, snapshot);
+    mutex_unlock(g_proxy_config_env.mutex);
+
+    proxy_config_env_snapshot_delete(old_snapshot);
+    return true;
+}
+
+bool proxy_config_env_is_monitored(void) {
+    // Environment variables are only read again when refreshed, which increments the config generation
+    return true;
+}
+
 bool proxy_config_env_global_init(void) {
+    g_proxy_config_env.mutex = mutex_create();
+    if (!g_proxy_config_env.mutex)
+        return false;
+    if (!proxy_config_env_refresh()) {
+        proxy_config_env_global_cleanup();
+        return false;
+    }
     return true;
 }
+
 bool proxy_config_env_global_cleanup(void) {
+    proxy_config_env_snapshot_delete((proxy_config_env_snapshot_s *)g_proxy_config_env.snapshot.data);
+    if (g_proxy_config_env.mutex)
+        mutex_delete(&g_proxy_config_env.mutex);
+    memset(&g_proxy_config_env, 0, sizeof(g_proxy_config_env));
     return true;
 }
 
 proxy_config_i_s *proxy_config_env_get_interface(void) {
     static proxy_config_i_s proxy_config_env_i = {
         proxy_config_env_get_auto_discover, proxy_config_env_get_auto_config_url, proxy_config_env_get_proxy,
-        proxy_config_env_get_bypass_list,   proxy_config_env_global_init,         proxy_config_env_global_cleanup};
+        proxy_config_env_get_bypass_list,   proxy_config_env_global_init,         proxy_config_env_global_cleanup,
+        proxy_config_env_refresh,           proxy_config_env_is_monitored};
     return &proxy_config_env_i;
 }
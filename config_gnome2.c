@@ -234,6 +234,7 @@ proxy_config_i_s *proxy_config_gnome2_get_interface(void) {
     static proxy_config_i_s proxy_config_gnome2_i = {
         proxy_config_gnome2_get_auto_discover, proxy_config_gnome2_get_auto_config_url,
         proxy_config_gnome2_get_proxy,         proxy_config_gnome2_get_bypass_list,
-        proxy_config_gnome2_global_init,       proxy_config_gnome2_global_cleanup};
+        proxy_config_gnome2_global_init,       proxy_config_gnome2_global_cleanup,
+        NULL,                                  NULL};
     return &proxy_config_gnome2_i;
 }
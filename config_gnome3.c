@@ -1,17 +1,53 @@
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <inttypes.h>
+#include <strings.h>
 
 #include <dlfcn.h>
+#include <pthread.h>
 #include <glib.h>
 #include <gio/gio.h>
 
+#define LOG_CATEGORY PROXYRES_LOG_CATEGORY_CONFIG
+
 #include "config.h"
 #include "config_i.h"
 #include "config_gnome3.h"
+#include "event.h"
+#include "log.h"
 #include "util.h"
 
+// Maximum time to wait for settings to be read during initialization
+#define PROXY_CONFIG_GNOME3_READY_TIMEOUT_MS (5000)
+
+typedef enum proxy_config_gnome3_mode_e {
+    PROXY_CONFIG_GNOME3_MODE_NONE,
+    PROXY_CONFIG_GNOME3_MODE_MANUAL,
+    PROXY_CONFIG_GNOME3_MODE_AUTO
+} proxy_config_gnome3_mode_e;
+
+// Schemes that have their own org.gnome.system.proxy.<scheme> schema
+static const char *proxy_config_gnome3_schemes[] = {"http", "https", "ftp", "socks"};
+
+#define PROXY_CONFIG_GNOME3_SCHEME_HTTP  (0)
+#define PROXY_CONFIG_GNOME3_SCHEME_HTTPS (1)
+#define PROXY_CONFIG_GNOME3_SCHEME_SOCKS (3)
+
+#define PROXY_CONFIG_GNOME3_SCHEME_COUNT (sizeof(proxy_config_gnome3_schemes) / sizeof(proxy_config_gnome3_schemes[0]))
+
+typedef struct proxy_config_gnome3_values_s {
+    proxy_config_gnome3_mode_e mode;
+    // Auto config url, NULL when not in auto mode or not specified
+    char *auto_config_url;
+    // Proxy host:port for each scheme, NULL when not in manual mode or not specified
+    char *proxies[PROXY_CONFIG_GNOME3_SCHEME_COUNT];
+    // Comma separated ignore-hosts, NULL when not in manual mode or empty
+    char *bypass_list;
+} proxy_config_gnome3_values_s;
+
 typedef struct g_proxy_config_gnome3_s {
     // GIO module handle
     void *gio_module;
@@ -22,79 +58,70 @@ typedef struct g_proxy_config_gnome3_s {
     gint (*g_settings_get_int)(GSettings *settings, const gchar *key);
     gchar **(*g_settings_get_strv)(GSettings *settings, const gchar *key);
     gboolean (*g_settings_get_boolean)(GSettings *settings, const gchar *key);
+    gulong (*g_signal_connect_data)(gpointer instance, const gchar *detailed_signal, GCallback c_handler,
+                                    gpointer data, GClosureNotify destroy_data, GConnectFlags connect_flags);
     // Glib module handle
     void *glib_module;
     // Glib memory functions
     void (*g_free)(gpointer mem);
     void (*g_strfreev)(gchar **str_array);
+    // Glib main loop functions
+    GMainContext *(*g_main_context_new)(void);
+    void (*g_main_context_push_thread_default)(GMainContext *context);
+    void (*g_main_context_pop_thread_default)(GMainContext *context);
+    void (*g_main_context_invoke)(GMainContext *context, GSourceFunc function, gpointer data);
+    void (*g_main_context_unref)(GMainContext *context);
+    GMainLoop *(*g_main_loop_new)(GMainContext *context, gboolean is_running);
+    void (*g_main_loop_run)(GMainLoop *loop);
+    void (*g_main_loop_quit)(GMainLoop *loop);
+    void (*g_main_loop_unref)(GMainLoop *loop);
+    // Settings objects, only used on the watch thread
+    GSettings *settings;
+    GSettings *scheme_settings[PROXY_CONFIG_GNOME3_SCHEME_COUNT];
+    // Main loop that dispatches settings change notifications
+    GMainContext *main_context;
+    GMainLoop *main_loop;
+    // Thread running the main loop
+    pthread_t watch_thread;
+    bool watch_thread_started;
+    // Signalled once the values have been read for the first time
+    void *ready;
+    // Most recently read values, only replaced on the watch thread
+    proxy_config_swap_s values;
 } g_proxy_config_gnome3_s;
 
 g_proxy_config_gnome3_s g_proxy_config_gnome3;
 
-static bool proxy_config_gnome3_is_mode(const char *mode) {
-    bool equal = false;
-
-    GSettings *settings = g_proxy_config_gnome3.g_settings_new("org.gnome.system.proxy");
-    if (!settings)
-        return false;
-
-    char *system_mode = g_proxy_config_gnome3.g_settings_get_string(settings, "mode");
-    if (system_mode) {
-        equal = strcmp(system_mode, mode) == 0;
-        g_proxy_config_gnome3.g_free(system_mode);
-    }
-    g_proxy_config_gnome3.g_object_unref(settings);
-    return equal;
+static void proxy_config_gnome3_values_delete(proxy_config_gnome3_values_s *values) {
+    if (!values)
+        return;
+    free(values->auto_config_url);
+    for (size_t i = 0; i < PROXY_CONFIG_GNOME3_SCHEME_COUNT; i++)
+        free(values->proxies[i]);
+    free(values->bypass_list);
+    free(values);
 }
 
-bool proxy_config_gnome3_get_auto_discover(void) {
-    return proxy_config_gnome3_is_mode("auto");
-}
-
-char *proxy_config_gnome3_get_auto_config_url(void) {
-    char *auto_config_url = NULL;
-
-    if (!proxy_config_gnome3_is_mode("auto"))
-        return NULL;
-    GSettings *settings = g_proxy_config_gnome3.g_settings_new("org.gnome.system.proxy");
-    if (!settings)
-        return NULL;
-    char *url = g_proxy_config_gnome3.g_settings_get_string(settings, "autoconfig-url");
-    if (url) {
-        if (*url)
-            auto_config_url = strdup(url);
-        g_proxy_config_gnome3.g_free(url);
+static int32_t proxy_config_gnome3_find_scheme(const char *scheme) {
+    // Scheme may be the start of a url
+    const size_t scheme_len = strcspn(scheme, ":");
+    for (size_t i = 0; i < PROXY_CONFIG_GNOME3_SCHEME_COUNT; i++) {
+        if (strlen(proxy_config_gnome3_schemes[i]) == scheme_len &&
+            strncasecmp(scheme, proxy_config_gnome3_schemes[i], scheme_len) == 0)
+            return (int32_t)i;
     }
-    g_proxy_config_gnome3.g_object_unref(settings);
-    return auto_config_url;
+    // WebSocket connections are made through the proxy for the matching http scheme
+    if (scheme_len == 2 && strncasecmp(scheme, "ws", 2) == 0)
+        return PROXY_CONFIG_GNOME3_SCHEME_HTTP;
+    if (scheme_len == 3 && strncasecmp(scheme, "wss", 3) == 0)
+        return PROXY_CONFIG_GNOME3_SCHEME_HTTPS;
+    // Any other protocol can only be tunneled through the socks proxy
+    return PROXY_CONFIG_GNOME3_SCHEME_SOCKS;
 }
 
-static bool proxy_config_gnome3_use_same_proxy(void) {
-    GSettings *settings = g_proxy_config_gnome3.g_settings_new("org.gnome.system.proxy");
-    if (!settings)
-        return false;
-
-    bool use_same_proxy = g_proxy_config_gnome3.g_settings_get_boolean(settings, "use-same-proxy");
-    g_proxy_config_gnome3.g_object_unref(settings);
-    return use_same_proxy;
-}
-
-char *proxy_config_gnome3_get_proxy(const char *scheme) {
-    char settings_path[128];
+static char *proxy_config_gnome3_read_proxy(GSettings *settings) {
     char *proxy = NULL;
 
-    if (!proxy_config_gnome3_is_mode("manual"))
-        return NULL;
-
-    if (proxy_config_gnome3_use_same_proxy())
-        strncpy(settings_path, "org.gnome.system.proxy.http", sizeof(settings_path));
-    else
-        snprintf(settings_path, sizeof(settings_path), "org.gnome.system.proxy.%s", scheme);
-
-    GSettings *settings = g_proxy_config_gnome3.g_settings_new(settings_path);
-    if (!settings)
-        return NULL;
-
     char *host = g_proxy_config_gnome3.g_settings_get_string(settings, "host");
     if (host && *host) {
         // Allocate space for host:port
@@ -107,52 +134,198 @@ char *proxy_config_gnome3_get_proxy(const char *scheme) {
             else
                 snprintf(proxy, max_proxy, "%s:%" PRIu32 "", host, port);
         }
-
-        g_proxy_config_gnome3.g_free(host);
     }
-    g_proxy_config_gnome3.g_object_unref(settings);
+    if (host)
+        g_proxy_config_gnome3.g_free(host);
     return proxy;
 }
 
-char *proxy_config_gnome3_get_bypass_list(void) {
+static char *proxy_config_gnome3_read_bypass_list(GSettings *settings) {
     char *bypass_list = NULL;
 
-    if (!proxy_config_gnome3_is_mode("manual"))
+    char **hosts = g_proxy_config_gnome3.g_settings_get_strv(settings, "ignore-hosts");
+    if (!hosts)
         return NULL;
 
-    GSettings *settings = g_proxy_config_gnome3.g_settings_new("org.gnome.system.proxy");
-    if (!settings)
+    size_t max_value = 0;
+
+    // Enumerate the list to get the size of the bypass list
+    for (int32_t i = 0; hosts[i] && *(hosts[i]); i++)
+        max_value += strlen(hosts[i]) + 2;
+
+    if (max_value > 0) {
+        // Allocate space for the bypass list
+        bypass_list = (char *)calloc(max_value, sizeof(char));
+        if (bypass_list) {
+            // Enumerate hosts and copy them to the bypass list
+            size_t bypass_list_len = 0;
+            for (int32_t i = 0; hosts[i] && *(hosts[i]); i++) {
+                snprintf(bypass_list + bypass_list_len, max_value - bypass_list_len, "%s,", hosts[i]);
+                bypass_list_len += strlen(bypass_list + bypass_list_len);
+            }
+
+            // Remove the last separator
+            str_trim_end(bypass_list, ',');
+        }
+    }
+
+    g_proxy_config_gnome3.g_strfreev(hosts);
+    return bypass_list;
+}
+
+// Must be called on the watch thread
+static proxy_config_gnome3_values_s *proxy_config_gnome3_read_values(void) {
+    GSettings *settings = g_proxy_config_gnome3.settings;
+    proxy_config_gnome3_values_s *values =
+        (proxy_config_gnome3_values_s *)calloc(1, sizeof(proxy_config_gnome3_values_s));
+    if (!values)
         return NULL;
 
-    char **hosts = g_proxy_config_gnome3.g_settings_get_strv(settings, "ignore-hosts");
-    if (hosts) {
-        size_t max_value = 0;
-
-        // Enumerate the list to get the size of the bypass list
-        for (int32_t i = 0; hosts[i] && *(hosts[i]); i++)
-            max_value += strlen(hosts[i]) + 2;
-
-        if (max_value > 0) {
-            // Allocate space for the bypass list
-            bypass_list = (char *)calloc(max_value, sizeof(char));
-            if (bypass_list) {
-                // Enumerate hosts and copy them to the bypass list
-                for (int32_t i = 0; hosts[i]; i++) {
-                    size_t bypass_list_len = strlen(bypass_list);
-                    snprintf(bypass_list + bypass_list_len, max_value - bypass_list_len, "%s,", hosts[i]);
-                }
-
-                // Remove the last separator
-                str_trim_end(bypass_list, ',');
-            }
+    char *mode = g_proxy_config_gnome3.g_settings_get_string(settings, "mode");
+    if (mode) {
+        if (strcmp(mode, "manual") == 0)
+            values->mode = PROXY_CONFIG_GNOME3_MODE_MANUAL;
+        else if (strcmp(mode, "auto") == 0)
+            values->mode = PROXY_CONFIG_GNOME3_MODE_AUTO;
+        g_proxy_config_gnome3.g_free(mode);
+    }
+
+    // Keys are read regardless of mode because change notifications are only
+    // emitted for keys that have been read at least once
+    char *url = g_proxy_config_gnome3.g_settings_get_string(settings, "autoconfig-url");
+    if (url) {
+        if (*url && values->mode == PROXY_CONFIG_GNOME3_MODE_AUTO)
+            values->auto_config_url = strdup(url);
+        g_proxy_config_gnome3.g_free(url);
+    }
+
+    const bool use_same_proxy = g_proxy_config_gnome3.g_settings_get_boolean(settings, "use-same-proxy");
+    char *bypass_list = proxy_config_gnome3_read_bypass_list(settings);
+    if (values->mode == PROXY_CONFIG_GNOME3_MODE_MANUAL)
+        values->bypass_list = bypass_list;
+    else
+        free(bypass_list);
+
+    for (size_t i = 0; i < PROXY_CONFIG_GNOME3_SCHEME_COUNT; i++) {
+        char *proxy = proxy_config_gnome3_read_proxy(g_proxy_config_gnome3.scheme_settings[i]);
+        if (values->mode == PROXY_CONFIG_GNOME3_MODE_MANUAL)
+            values->proxies[i] = proxy;
+        else
+            free(proxy);
+    }
+
+    // Proxy for http is used for all schemes when use-same-proxy is set
+    if (use_same_proxy) {
+        for (size_t i = 1; i < PROXY_CONFIG_GNOME3_SCHEME_COUNT; i++) {
+            free(values->proxies[i]);
+            values->proxies[i] = values->proxies[0] ? strdup(values->proxies[0]) : NULL;
         }
+    }
+    return values;
+}
+
+// Must be called on the watch thread
+static void proxy_config_gnome3_refresh(void) {
+    proxy_config_gnome3_values_s *values = proxy_config_gnome3_read_values();
+    if (!values)
+        return;
+    proxy_config_gnome3_values_delete(
+        (proxy_config_gnome3_values_s *)proxy_config_swap_exchange(&g_proxy_config_gnome3.values, values));
+}
+
+static void proxy_config_gnome3_changed(GSettings *settings, gchar *key, gpointer user_data) {
+    UNUSED(settings);
+    UNUSED(key);
+    UNUSED(user_data);
+    proxy_config_gnome3_refresh();
+    proxy_config_increment_generation();
+}
+
+static gboolean proxy_config_gnome3_quit(gpointer user_data) {
+    UNUSED(user_data);
+    g_proxy_config_gnome3.g_main_loop_quit(g_proxy_config_gnome3.main_loop);
+    return G_SOURCE_REMOVE;
+}
+
+static void *proxy_config_gnome3_watch(void *arg) {
+    char schema_id[128];
 
-        g_proxy_config_gnome3.g_strfreev(hosts);
+    UNUSED(arg);
+
+    // Settings emit change notifications on the thread-default main context they were created on
+    g_proxy_config_gnome3.g_main_context_push_thread_default(g_proxy_config_gnome3.main_context);
+
+    g_proxy_config_gnome3.settings = g_proxy_config_gnome3.g_settings_new("org.gnome.system.proxy");
+    g_proxy_config_gnome3.g_signal_connect_data(g_proxy_config_gnome3.settings, "changed",
+                                                G_CALLBACK(proxy_config_gnome3_changed), NULL, NULL,
+                                                (GConnectFlags)0);
+    for (size_t i = 0; i < PROXY_CONFIG_GNOME3_SCHEME_COUNT; i++) {
+        snprintf(schema_id, sizeof(schema_id), "org.gnome.system.proxy.%s", proxy_config_gnome3_schemes[i]);
+        g_proxy_config_gnome3.scheme_settings[i] = g_proxy_config_gnome3.g_settings_new(schema_id);
+        g_proxy_config_gnome3.g_signal_connect_data(g_proxy_config_gnome3.scheme_settings[i], "changed",
+                                                    G_CALLBACK(proxy_config_gnome3_changed), NULL, NULL,
+                                                    (GConnectFlags)0);
     }
-    g_proxy_config_gnome3.g_object_unref(settings);
+
+    proxy_config_gnome3_refresh();
+    // Settings may be read after initialization stopped waiting for them
+    proxy_config_increment_generation();
+    event_set(g_proxy_config_gnome3.ready);
+
+    g_proxy_config_gnome3.g_main_loop_run(g_proxy_config_gnome3.main_loop);
+
+    for (size_t i = 0; i < PROXY_CONFIG_GNOME3_SCHEME_COUNT; i++)
+        g_proxy_config_gnome3.g_object_unref(g_proxy_config_gnome3.scheme_settings[i]);
+    g_proxy_config_gnome3.g_object_unref(g_proxy_config_gnome3.settings);
+
+    g_proxy_config_gnome3.g_main_context_pop_thread_default(g_proxy_config_gnome3.main_context);
+    return NULL;
+}
+
+bool proxy_config_gnome3_get_auto_discover(void) {
+    uint32_t epoch = 0;
+    const proxy_config_gnome3_values_s *values =
+        (const proxy_config_gnome3_values_s *)proxy_config_swap_read_begin(&g_proxy_config_gnome3.values, &epoch);
+    const bool auto_discover = values && values->mode == PROXY_CONFIG_GNOME3_MODE_AUTO;
+    proxy_config_swap_read_end(&g_proxy_config_gnome3.values, epoch);
+    return auto_discover;
+}
+
+char *proxy_config_gnome3_get_auto_config_url(void) {
+    uint32_t epoch = 0;
+    const proxy_config_gnome3_values_s *values =
+        (const proxy_config_gnome3_values_s *)proxy_config_swap_read_begin(&g_proxy_config_gnome3.values, &epoch);
+    char *auto_config_url = values && values->auto_config_url ? strdup(values->auto_config_url) : NULL;
+    proxy_config_swap_read_end(&g_proxy_config_gnome3.values, epoch);
+    return auto_config_url;
+}
+
+char *proxy_config_gnome3_get_proxy(const char *scheme) {
+    uint32_t epoch = 0;
+    if (!scheme)
+        return NULL;
+    const int32_t index = proxy_config_gnome3_find_scheme(scheme);
+    const proxy_config_gnome3_values_s *values =
+        (const proxy_config_gnome3_values_s *)proxy_config_swap_read_begin(&g_proxy_config_gnome3.values, &epoch);
+    char *proxy = values && values->proxies[index] ? strdup(values->proxies[index]) : NULL;
+    proxy_config_swap_read_end(&g_proxy_config_gnome3.values, epoch);
+    return proxy;
+}
+
+char *proxy_config_gnome3_get_bypass_list(void) {
+    uint32_t epoch = 0;
+    const proxy_config_gnome3_values_s *values =
+        (const proxy_config_gnome3_values_s *)proxy_config_swap_read_begin(&g_proxy_config_gnome3.values, &epoch);
+    char *bypass_list = values && values->bypass_list ? strdup(values->bypass_list) : NULL;
+    proxy_config_swap_read_end(&g_proxy_config_gnome3.values, epoch);
     return bypass_list;
 }
 
+bool proxy_config_gnome3_is_monitored(void) {
+    // Settings are read again on the watch thread whenever they change
+    return true;
+}
+
 bool proxy_config_gnome3_global_init(void) {
     g_proxy_config_gnome3.glib_module = dlopen("libglib-2.0.so.0", RTLD_LAZY | RTLD_LOCAL);
     if (!g_proxy_config_gnome3.glib_module)
@@ -168,6 +341,42 @@ bool proxy_config_gnome3_global_init(void) {
     g_proxy_config_gnome3.g_strfreev = (void (*)(gchar **))dlsym(g_proxy_config_gnome3.glib_module, "g_strfreev");
     if (!g_proxy_config_gnome3.g_strfreev)
         goto gnome3_init_error;
+    g_proxy_config_gnome3.g_main_context_new =
+        (GMainContext * (*)(void)) dlsym(g_proxy_config_gnome3.glib_module, "g_main_context_new");
+    if (!g_proxy_config_gnome3.g_main_context_new)
+        goto gnome3_init_error;
+    g_proxy_config_gnome3.g_main_context_push_thread_default = (void (*)(GMainContext *))dlsym(
+        g_proxy_config_gnome3.glib_module, "g_main_context_push_thread_default");
+    if (!g_proxy_config_gnome3.g_main_context_push_thread_default)
+        goto gnome3_init_error;
+    g_proxy_config_gnome3.g_main_context_pop_thread_default =
+        (void (*)(GMainContext *))dlsym(g_proxy_config_gnome3.glib_module, "g_main_context_pop_thread_default");
+    if (!g_proxy_config_gnome3.g_main_context_pop_thread_default)
+        goto gnome3_init_error;
+    g_proxy_config_gnome3.g_main_context_invoke = (void (*)(GMainContext *, GSourceFunc, gpointer))dlsym(
+        g_proxy_config_gnome3.glib_module, "g_main_context_invoke");
+    if (!g_proxy_config_gnome3.g_main_context_invoke)
+        goto gnome3_init_error;
+    g_proxy_config_gnome3.g_main_context_unref =
+        (void (*)(GMainContext *))dlsym(g_proxy_config_gnome3.glib_module, "g_main_context_unref");
+    if (!g_proxy_config_gnome3.g_main_context_unref)
+        goto gnome3_init_error;
+    g_proxy_config_gnome3.g_main_loop_new =
+        (GMainLoop * (*)(GMainContext *, gboolean)) dlsym(g_proxy_config_gnome3.glib_module, "g_main_loop_new");
+    if (!g_proxy_config_gnome3.g_main_loop_new)
+        goto gnome3_init_error;
+    g_proxy_config_gnome3.g_main_loop_run =
+        (void (*)(GMainLoop *))dlsym(g_proxy_config_gnome3.glib_module, "g_main_loop_run");
+    if (!g_proxy_config_gnome3.g_main_loop_run)
+        goto gnome3_init_error;
+    g_proxy_config_gnome3.g_main_loop_quit =
+        (void (*)(GMainLoop *))dlsym(g_proxy_config_gnome3.glib_module, "g_main_loop_quit");
+    if (!g_proxy_config_gnome3.g_main_loop_quit)
+        goto gnome3_init_error;
+    g_proxy_config_gnome3.g_main_loop_unref =
+        (void (*)(GMainLoop *))dlsym(g_proxy_config_gnome3.glib_module, "g_main_loop_unref");
+    if (!g_proxy_config_gnome3.g_main_loop_unref)
+        goto gnome3_init_error;
 
     // GIO functions
     g_proxy_config_gnome3.g_object_unref =
@@ -194,6 +403,30 @@ bool proxy_config_gnome3_global_init(void) {
         (gboolean(*)(GSettings *, const gchar *))dlsym(g_proxy_config_gnome3.gio_module, "g_settings_get_boolean");
     if (!g_proxy_config_gnome3.g_settings_get_boolean)
         goto gnome3_init_error;
+    // GObject is a dependency of GIO so its symbols are found through the GIO module handle
+    g_proxy_config_gnome3.g_signal_connect_data =
+        (gulong(*)(gpointer, const gchar *, GCallback, gpointer, GClosureNotify, GConnectFlags))dlsym(
+            g_proxy_config_gnome3.gio_module, "g_signal_connect_data");
+    if (!g_proxy_config_gnome3.g_signal_connect_data)
+        goto gnome3_init_error;
+
+    // Read settings and listen for changes on a dedicated main loop thread
+    g_proxy_config_gnome3.ready = event_create();
+    if (!g_proxy_config_gnome3.ready)
+        goto gnome3_init_error;
+    g_proxy_config_gnome3.main_context = g_proxy_config_gnome3.g_main_context_new();
+    if (!g_proxy_config_gnome3.main_context)
+        goto gnome3_init_error;
+    g_proxy_config_gnome3.main_loop = g_proxy_config_gnome3.g_main_loop_new(g_proxy_config_gnome3.main_context, FALSE);
+    if (!g_proxy_config_gnome3.main_loop)
+        goto gnome3_init_error;
+    if (pthread_create(&g_proxy_config_gnome3.watch_thread, NULL, proxy_config_gnome3_watch, NULL) != 0)
+        goto gnome3_init_error;
+    g_proxy_config_gnome3.watch_thread_started = true;
+
+    // Settings backend may be unresponsive, in which case the settings are used once they have been read
+    if (!event_wait(g_proxy_config_gnome3.ready, PROXY_CONFIG_GNOME3_READY_TIMEOUT_MS))
+        LOG_WARN("Timed out waiting for GNOME proxy settings\n");
     return true;
 
 gnome3_init_error:
@@ -202,6 +435,19 @@ gnome3_init_error:
 }
 
 bool proxy_config_gnome3_global_cleanup(void) {
+    if (g_proxy_config_gnome3.watch_thread_started) {
+        // Quit from within the loop so the request is not lost if the loop has not started running
+        g_proxy_config_gnome3.g_main_context_invoke(g_proxy_config_gnome3.main_context, proxy_config_gnome3_quit,
+                                                    NULL);
+        pthread_join(g_proxy_config_gnome3.watch_thread, NULL);
+    }
+    if (g_proxy_config_gnome3.main_loop)
+        g_proxy_config_gnome3.g_main_loop_unref(g_proxy_config_gnome3.main_loop);
+    if (g_proxy_config_gnome3.main_context)
+        g_proxy_config_gnome3.g_main_context_unref(g_proxy_config_gnome3.main_context);
+    event_delete(&g_proxy_config_gnome3.ready);
+    proxy_config_gnome3_values_delete((proxy_config_gnome3_values_s *)g_proxy_config_gnome3.values.data);
+
     if (g_proxy_config_gnome3.gio_module)
         dlclose(g_proxy_config_gnome3.gio_module);
     if (g_proxy_config_gnome3.glib_module)
@@ -215,6 +461,7 @@ proxy_config_i_s *proxy_config_gnome3_get_interface(void) {
     static proxy_config_i_s proxy_config_gnome3_i = {
         proxy_config_gnome3_get_auto_discover, proxy_config_gnome3_get_auto_config_url,
         proxy_config_gnome3_get_proxy,         proxy_config_gnome3_get_bypass_list,
-        proxy_config_gnome3_global_init,       proxy_config_gnome3_global_cleanup};
+        proxy_config_gnome3_global_init,       proxy_config_gnome3_global_cleanup,
+        NULL,                                  proxy_config_gnome3_is_monitored};
     return &proxy_config_gnome3_i;
 }
@@ -1,5 +1,17 @@
 #pragma once
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Config data that is read without locking and replaced as a whole, old data is only freed once no reader uses it
+typedef struct proxy_config_swap_s {
+    void *volatile data;
+    // Readers are counted separately before and after each swap so that the writer doesn't wait for new readers
+    volatile uint32_t epoch;
+    volatile int32_t readers[2];
+} proxy_config_swap_s;
+
 typedef struct proxy_config_i_s {
     bool (*auto_discover)(void);
     char *(*get_auto_config_url)(void);
@@ -8,4 +20,31 @@ typedef struct proxy_config_i_s {
 
     bool (*global_init)(void);
     bool (*global_cleanup)(void);
+
+    // Optional, re-read configuration that is not monitored for changes
+    bool (*refresh)(void);
+    // Optional, whether every change to the configuration increments the config generation
+    bool (*is_monitored)(void);
 } proxy_config_i_s;
+
+// Notify that the user's proxy configuration has changed so cached decisions are invalidated
+void proxy_config_increment_generation(void);
+
+// Set the maximum age in seconds before a snapshot of a system config that does not notify of changes is read again
+void proxy_config_snapshot_set_max_age(int32_t max_age_sec);
+
+// Evaluates whether or not the proxy should be bypassed for a given url using the snapshot's bypass list
+bool proxy_config_snapshot_should_bypass(const void *ctx, const char *url);
+
+// Begin reading config data, the returned data remains valid until proxy_config_swap_read_end is called
+void *proxy_config_swap_read_begin(proxy_config_swap_s *swap, uint32_t *epoch);
+
+// End reading config data returned by proxy_config_swap_read_begin
+void proxy_config_swap_read_end(proxy_config_swap_s *swap, uint32_t epoch);
+
+// Publish new config data and return the old data once no reader uses it, writers must be serialized
+void *proxy_config_swap_exchange(proxy_config_swap_s *swap, void *data);
+
+#ifdef __cplusplus
+}
+#endif
@@ -5,47 +5,85 @@
 #include <string.h>
 #include <ctype.h>
 #include <limits.h>
+#include <errno.h>
 
 #include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
 #include <pwd.h>
 #include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+
+#define LOG_CATEGORY PROXYRES_LOG_CATEGORY_CONFIG
 
 #include "config.h"
 #include "config_i.h"
+#include "config_env.h"
 #include "config_kde.h"
+#include "log.h"
+#include "mutex.h"
 #include "util.h"
 #include "util_linux.h"
 
 typedef struct g_proxy_config_kde_s {
-    // User's ini config
-    char *config;
+    // Path to user's ini config
+    char config_path[PATH_MAX];
+    // User's ini config parsed into table
+    proxy_config_swap_s config;
+    // Serializes config table swaps
+    void *mutex;
+    // Config file change notification
+    int inotify_fd;
+    int stop_fd;
+    pthread_t watch_thread;
+    bool watch_thread_started;
 } g_proxy_config_kde_s;
 
 g_proxy_config_kde_s g_proxy_config_kde;
 
 enum proxy_type_enum { PROXY_TYPE_NONE, PROXY_TYPE_FIXED, PROXY_TYPE_PAC, PROXY_TYPE_WPAD, PROXY_TYPE_ENV };
 
-static bool check_proxy_type(uint32_t type) {
-    char *proxy_type = get_config_value(g_proxy_config_kde.config, "Proxy Settings", "ProxyType");
-    if (!proxy_type)
-        return false;
-    bool is_equal = strtoul(proxy_type, NULL, 0) == type;
-    free(proxy_type);
-    return is_equal;
+static char *get_config_value_dup(const char *key) {
+    uint32_t epoch = 0;
+    char *value = NULL;
+    void *config = proxy_config_swap_read_begin(&g_proxy_config_kde.config, &epoch);
+    const char *config_value = config_table_get_value(config, "Proxy Settings", key);
+    if (config_value)
+        value = strdup(config_value);
+    proxy_config_swap_read_end(&g_proxy_config_kde.config, epoch);
+    return value;
+}
+
+static uint32_t get_proxy_type(void) {
+    uint32_t epoch = 0;
+    uint32_t proxy_type = PROXY_TYPE_NONE;
+    void *config = proxy_config_swap_read_begin(&g_proxy_config_kde.config, &epoch);
+    const char *config_value = config_table_get_value(config, "Proxy Settings", "ProxyType");
+    if (config_value)
+        proxy_type = strtoul(config_value, NULL, 0);
+    proxy_config_swap_read_end(&g_proxy_config_kde.config, epoch);
+    return proxy_type;
 }
 
 bool proxy_config_kde_get_auto_discover(void) {
-    return check_proxy_type(PROXY_TYPE_WPAD);
+    return get_proxy_type() == PROXY_TYPE_WPAD;
 }
 
 char *proxy_config_kde_get_auto_config_url(void) {
-    if (!check_proxy_type(PROXY_TYPE_PAC))
+    if (get_proxy_type() != PROXY_TYPE_PAC)
         return NULL;
-    return get_config_value(g_proxy_config_kde.config, "Proxy Settings", "Proxy Config Script");
+    return get_config_value_dup("Proxy Config Script");
 }
 
 char *proxy_config_kde_get_proxy(const char *scheme) {
-    if (!scheme || !check_proxy_type(PROXY_TYPE_FIXED))
+    if (!scheme)
+        return NULL;
+
+    const uint32_t proxy_type = get_proxy_type();
+    if (proxy_type == PROXY_TYPE_ENV)
+        return proxy_config_env_get_proxy(scheme);
+    if (proxy_type != PROXY_TYPE_FIXED)
         return NULL;
 
     // Construct key name to search for in config
@@ -71,19 +109,129 @@ char *proxy_config_kde_get_proxy(const char *scheme) {
     // Append "Proxy" to the end of the key
     strncat(key, "Proxy", max_key - scheme_len - 1);
 
-    char *proxy = get_config_value(g_proxy_config_kde.config, "Proxy Settings", key);
+    char *proxy = get_config_value_dup(key);
     free(key);
     return proxy;
 }
 
 char *proxy_config_kde_get_bypass_list(void) {
-    return get_config_value(g_proxy_config_kde.config, "Proxy Settings", "NoProxyFor");
+    if (get_proxy_type() == PROXY_TYPE_ENV)
+        return proxy_config_env_get_bypass_list();
+    return get_config_value_dup("NoProxyFor");
+}
+
+static void *proxy_config_kde_read_config(void) {
+    void *config = NULL;
+    char *config_text = NULL;
+
+    // Open user config file
+    int fd = open(g_proxy_config_kde.config_path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return NULL;
+
+    // Create buffer to store config
+    off_t config_size = lseek(fd, 0, SEEK_END);
+    if (config_size < 0)
+        goto read_done;
+    config_text = (char *)calloc((size_t)config_size + 1, sizeof(char));
+    if (!config_text)
+        goto read_done;
+
+    // Read config file into buffer and parse it once
+    lseek(fd, 0, SEEK_SET);
+    if (read(fd, config_text, (size_t)config_size) == config_size)
+        config = config_table_create(config_text);
+
+read_done:
+    free(config_text);
+    close(fd);
+    return config;
+}
+
+static void proxy_config_kde_reload(void) {
+    void *config = proxy_config_kde_read_config();
+    if (!config) {
+        LOG_WARN("Unable to read KDE config %s\n", g_proxy_config_kde.config_path);
+        return;
+    }
+
+    // Swap config so readers see either the old or new config in its entirety
+    mutex_lock(g_proxy_config_kde.mutex);
+    void *old_config = proxy_config_swap_exchange(&g_proxy_config_kde.config, config);
+    mutex_unlock(g_proxy_config_kde.mutex);
+
+    config_table_delete(&old_config);
+    proxy_config_increment_generation();
+    LOG_INFO("Reloaded KDE config %s\n", g_proxy_config_kde.config_path);
+}
+
+static void *proxy_config_kde_watch(void *arg) {
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    struct pollfd fds[2] = {{g_proxy_config_kde.inotify_fd, POLLIN, 0}, {g_proxy_config_kde.stop_fd, POLLIN, 0}};
+
+    UNUSED(arg);
+
+    const char *config_name = strrchr(g_proxy_config_kde.config_path, '/') + 1;
+
+    for (;;) {
+        // Revents are not valid when interrupted by a signal
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (fds[1].revents)
+            break;
+        if (!fds[0].revents)
+            continue;
+
+        // KDE writes config to a temporary file and renames it, so watch the directory for the file name
+        bool changed = false;
+        ssize_t buffer_len = 0;
+        while ((buffer_len = read(g_proxy_config_kde.inotify_fd, buffer, sizeof(buffer))) > 0) {
+            for (char *eventp = buffer; eventp < buffer + buffer_len;) {
+                const struct inotify_event *event = (const struct inotify_event *)eventp;
+                eventp += sizeof(struct inotify_event) + event->len;
+                if (event->len && strcmp(event->name, config_name) == 0)
+                    changed = true;
+            }
+        }
+        if (changed)
+            proxy_config_kde_reload();
+    }
+    return NULL;
+}
+
+static bool proxy_config_kde_start_watch(void) {
+    char config_dir[PATH_MAX];
+
+    strncpy(config_dir, g_proxy_config_kde.config_path, sizeof(config_dir) - 1);
+    config_dir[sizeof(config_dir) - 1] = 0;
+    *strrchr(config_dir, '/') = 0;
+
+    g_proxy_config_kde.inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    g_proxy_config_kde.stop_fd = eventfd(0, EFD_CLOEXEC);
+    if (g_proxy_config_kde.inotify_fd < 0 || g_proxy_config_kde.stop_fd < 0)
+        return false;
+    // Files being created are still empty, the config is read once it is closed after writing or renamed into place
+    if (inotify_add_watch(g_proxy_config_kde.inotify_fd, config_dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+        return false;
+    if (pthread_create(&g_proxy_config_kde.watch_thread, NULL, proxy_config_kde_watch, NULL) != 0)
+        return false;
+    g_proxy_config_kde.watch_thread_started = true;
+    return true;
+}
+
+bool proxy_config_kde_is_monitored(void) {
+    return g_proxy_config_kde.watch_thread_started;
 }
 
 bool proxy_config_kde_global_init(void) {
     char user_home_path[PATH_MAX];
     char config_path[PATH_MAX];
-    int fd = 0;
+
+    g_proxy_config_kde.inotify_fd = -1;
+    g_proxy_config_kde.stop_fd = -1;
 
     // Get the user's home directory
     const char *home_env_var = getenv("KDEHOME");
@@ -121,40 +269,41 @@ bool proxy_config_kde_global_init(void) {
     if (access(config_path, F_OK) == -1)
         return false;
 
-    // Open user config file
-    fd = open(config_path, O_RDONLY);
-    if (fd == -1)
-        return false;
+    memcpy(g_proxy_config_kde.config_path, config_path, sizeof(config_path));
 
-    // Create buffer to store config
-    int config_size = lseek(fd, 0, SEEK_END);
-    g_proxy_config_kde.config = (char *)calloc(config_size + 1, sizeof(char));
-    if (!g_proxy_config_kde.config)
+    g_proxy_config_kde.mutex = mutex_create();
+    if (!g_proxy_config_kde.mutex)
         goto kde_init_error;
 
-    // Read config file into buffer
-    lseek(fd, 0, SEEK_SET);
-    if (read(fd, g_proxy_config_kde.config, config_size) != config_size)
+    g_proxy_config_kde.config.data = proxy_config_kde_read_config();
+    if (!g_proxy_config_kde.config.data)
         goto kde_init_error;
 
-    // Use proxy_config_env instead
-    if (check_proxy_type(PROXY_TYPE_ENV))
-        goto kde_init_error;
+    // Reload config when it is changed by the user, including when it stops using environment variables
+    if (!proxy_config_kde_start_watch())
+        LOG_WARN("Unable to watch KDE config %s for changes\n", g_proxy_config_kde.config_path);
 
-    goto kde_ini_cleanup;
+    return true;
 
 kde_init_error:
     proxy_config_kde_global_cleanup();
-
-kde_ini_cleanup:
-    if (fd)
-        close(fd);
-
-    return g_proxy_config_kde.config;
+    return false;
 }
 
 bool proxy_config_kde_global_cleanup(void) {
-    free(g_proxy_config_kde.config);
+    if (g_proxy_config_kde.watch_thread_started) {
+        const uint64_t stop = 1;
+        if (write(g_proxy_config_kde.stop_fd, &stop, sizeof(stop)) == sizeof(stop))
+            pthread_join(g_proxy_config_kde.watch_thread, NULL);
+    }
+    if (g_proxy_config_kde.inotify_fd >= 0)
+        close(g_proxy_config_kde.inotify_fd);
+    if (g_proxy_config_kde.stop_fd >= 0)
+        close(g_proxy_config_kde.stop_fd);
+
+    config_table_delete((void **)&g_proxy_config_kde.config.data);
+    if (g_proxy_config_kde.mutex)
+        mutex_delete(&g_proxy_config_kde.mutex);
 
     memset(&g_proxy_config_kde, 0, sizeof(g_proxy_config_kde));
     return true;
@@ -163,6 +312,7 @@ bool proxy_config_kde_global_cleanup(void) {
 proxy_config_i_s *proxy_config_kde_get_interface(void) {
     static proxy_config_i_s proxy_config_kde_i = {
         proxy_config_kde_get_auto_discover, proxy_config_kde_get_auto_config_url, proxy_config_kde_get_proxy,
-        proxy_config_kde_get_bypass_list,   proxy_config_kde_global_init,         proxy_config_kde_global_cleanup};
+        proxy_config_kde_get_bypass_list,   proxy_config_kde_global_init,         proxy_config_kde_global_cleanup,
+        NULL,                               proxy_config_kde_is_monitored};
     return &proxy_config_kde_i;
 }
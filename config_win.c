@@ -105,6 +105,7 @@ bool proxy_config_win_global_cleanup(void) {
 proxy_config_i_s *proxy_config_win_get_interface(void) {
     static proxy_config_i_s proxy_config_win_i = {
         proxy_config_win_get_auto_discover, proxy_config_win_get_auto_config_url, proxy_config_win_get_proxy,
-        proxy_config_win_get_bypass_list,   proxy_config_win_global_init,         proxy_config_win_global_cleanup};
+        proxy_config_win_get_bypass_list,   proxy_config_win_global_init,         proxy_config_win_global_cleanup,
+        NULL,                               NULL};
     return &proxy_config_win_i;
 }
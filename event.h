@@ -7,6 +7,9 @@ extern "C" {
 // Sets an event to signalled state.
 bool event_set(void *ctx);
 
+// Sets an event to non-signalled state so that it can be reused.
+bool event_reset(void *ctx);
+
 // Waits for an event to be signalled.
 bool event_wait(void *ctx, int32_t timeout_ms);
 
@@ -0,0 +1,125 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+#include "atomic.h"
+#include "event.h"
+#include "event_futex.h"
+
+static int32_t futex_wait_until(volatile uint32_t *addr, uint32_t value, const struct timespec *deadline) {
+    // Bitset wait takes an absolute CLOCK_MONOTONIC deadline so that wall clock changes don't affect timeouts
+    return (int32_t)syscall(SYS_futex, addr, FUTEX_WAIT_BITSET | FUTEX_PRIVATE_FLAG, value, deadline, NULL,
+                            FUTEX_BITSET_MATCH_ANY);
+}
+
+static int32_t futex_wake_all(volatile uint32_t *addr) {
+    return (int32_t)syscall(SYS_futex, addr, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, INT_MAX, NULL, NULL, 0);
+}
+
+void event_futex_init(event_futex_s *event, bool auto_reset) {
+    event->state = auto_reset ? EVENT_FUTEX_AUTO_RESET : 0;
+}
+
+bool event_futex_set(event_futex_s *event) {
+    if (!event)
+        return false;
+    // Publish the signal and take ownership of the waiters in a single step. A woken waiter may delete or reuse the
+    // event immediately, so the state must not be written again after the signal becomes visible.
+    uint32_t state = atomic_load_acquire_u32(&event->state);
+    while (!atomic_cas_u32(&event->state, state, (state | EVENT_FUTEX_SIGNALLED) & ~EVENT_FUTEX_WAITERS))
+        state = atomic_load_acquire_u32(&event->state);
+    // Only enter the kernel when there is someone to wake. Waking a private futex only hashes the address and never
+    // touches the memory, so it is safe even if a waiter has already released the event.
+    if (state & EVENT_FUTEX_WAITERS)
+        futex_wake_all(&event->state);
+    return true;
+}
+
+bool event_futex_reset(event_futex_s *event) {
+    if (!event)
+        return false;
+    atomic_and_u32(&event->state, ~EVENT_FUTEX_SIGNALLED);
+    return true;
+}
+
+bool event_futex_wait(event_futex_s *event, int32_t timeout_ms) {
+    struct timespec deadline = {0};
+    bool timed_out = false;
+
+    if (!event)
+        return false;
+
+    if (timeout_ms > 0) {
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (timeout_ms % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+    }
+
+    for (;;) {
+        uint32_t state = atomic_load_acquire_u32(&event->state);
+        if (state & EVENT_FUTEX_SIGNALLED) {
+            if (!(state & EVENT_FUTEX_AUTO_RESET))
+                return true;
+            // Only a single waiter consumes the signal of an auto-reset event
+            if (atomic_cas_u32(&event->state, state, state & ~EVENT_FUTEX_SIGNALLED))
+                return true;
+            continue;
+        }
+        if (timeout_ms == 0 || timed_out)
+            return false;
+
+        // Let the setter know that it needs to wake us
+        if (!(state & EVENT_FUTEX_WAITERS)) {
+            if (!atomic_cas_u32(&event->state, state, state | EVENT_FUTEX_WAITERS))
+                continue;
+            state |= EVENT_FUTEX_WAITERS;
+        }
+
+        // Wake ups can be spurious and the state may change before sleeping, so always check the state again
+        if (futex_wait_until(&event->state, state, timeout_ms < 0 ? NULL : &deadline) == -1 && errno == ETIMEDOUT)
+            timed_out = true;
+    }
+}
+
+bool event_set(void *ctx) {
+    return event_futex_set((event_futex_s *)ctx);
+}
+
+bool event_reset(void *ctx) {
+    return event_futex_reset((event_futex_s *)ctx);
+}
+
+bool event_wait(void *ctx, int32_t timeout_ms) {
+    return event_futex_wait((event_futex_s *)ctx, timeout_ms);
+}
+
+void *event_create(void) {
+    event_futex_s *event = (event_futex_s *)calloc(1, sizeof(event_futex_s));
+    if (!event)
+        return NULL;
+    event_futex_init(event, false);
+    return event;
+}
+
+bool event_delete(void **ctx) {
+    if (!ctx)
+        return false;
+    event_futex_s *event = (event_futex_s *)*ctx;
+    if (!event)
+        return false;
+    free(event);
+    *ctx = NULL;
+    return true;
+}
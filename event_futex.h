@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Event state flags
+#define EVENT_FUTEX_SIGNALLED  (0x1)
+#define EVENT_FUTEX_WAITERS    (0x2)
+#define EVENT_FUTEX_AUTO_RESET (0x4)
+
+// Event that fits in 4 bytes so that it can be embedded in other structures without being allocated.
+typedef struct event_futex_s {
+    volatile uint32_t state;
+} event_futex_s;
+
+// Initializes an event in non-signalled state. Auto-reset events return to non-signalled state
+// after releasing a single waiter.
+void event_futex_init(event_futex_s *event, bool auto_reset);
+
+// Sets an event to signalled state and wakes all waiters.
+bool event_futex_set(event_futex_s *event);
+
+// Sets an event to non-signalled state so that it can be reused.
+bool event_futex_reset(event_futex_s *event);
+
+// Waits for an event to be signalled. Negative timeout waits indefinitely.
+bool event_futex_wait(event_futex_s *event, int32_t timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
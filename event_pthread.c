@@ -2,6 +2,8 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <time.h>
 
 #include <pthread.h>
 
@@ -18,44 +20,88 @@ bool event_set(void *ctx) {
     if (!event)
         return false;
     pthread_mutex_lock(&event->mutex);
-    int32_t err = pthread_cond_signal(&event->cond);
-    if (err == 0)
-        event->signalled = true;
+    event->signalled = true;
+    int32_t err = pthread_cond_broadcast(&event->cond);
     pthread_mutex_unlock(&event->mutex);
     return err == 0;
 }
 
+bool event_reset(void *ctx) {
+    event_s *event = (event_s *)ctx;
+    if (!event)
+        return false;
+    pthread_mutex_lock(&event->mutex);
+    event->signalled = false;
+    pthread_mutex_unlock(&event->mutex);
+    return true;
+}
+
+static void get_monotonic_deadline(int32_t timeout_ms, struct timespec *deadline) {
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    deadline->tv_sec += timeout_ms / 1000;
+    deadline->tv_nsec += (timeout_ms % 1000) * 1000000;
+    if (deadline->tv_nsec >= 1000000000) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000;
+    }
+}
+
+static int32_t event_timedwait(event_s *event, const struct timespec *deadline) {
+#ifdef __APPLE__
+    // Condition variables can't use the monotonic clock, so wait for the time remaining until the deadline instead
+    struct timespec now, remaining;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    remaining.tv_sec = deadline->tv_sec - now.tv_sec;
+    remaining.tv_nsec = deadline->tv_nsec - now.tv_nsec;
+    if (remaining.tv_nsec < 0) {
+        remaining.tv_sec--;
+        remaining.tv_nsec += 1000000000;
+    }
+    if (remaining.tv_sec < 0)
+        return ETIMEDOUT;
+    return pthread_cond_timedwait_relative_np(&event->cond, &event->mutex, &remaining);
+#else
+    return pthread_cond_timedwait(&event->cond, &event->mutex, deadline);
+#endif
+}
+
 bool event_wait(void *ctx, int32_t timeout_ms) {
     event_s *event = (event_s *)ctx;
+    struct timespec deadline;
     int32_t err = 0;
 
     if (!event)
         return false;
 
+    // Use the monotonic clock so that wall clock changes don't affect timeouts
+    if (timeout_ms >= 0)
+        get_monotonic_deadline(timeout_ms, &deadline);
+
     pthread_mutex_lock(&event->mutex);
-    if (!event->signalled) {
-        if (timeout_ms < 0) {
+    // Wake ups can be spurious so keep waiting until the event is signalled or timed out
+    while (!event->signalled && err == 0) {
+        if (timeout_ms < 0)
             err = pthread_cond_wait(&event->cond, &event->mutex);
-        } else {
-            struct timespec ts;
-
-            ts.tv_sec = timeout_ms / 1000;
-            ts.tv_nsec = (timeout_ms % 1000) * 1000000;
-
-            err = pthread_cond_timedwait(&event->cond, &event->mutex, &ts);
-        }
-        if (err == 0)
-            event->signalled = true;
+        else
+            err = event_timedwait(event, &deadline);
     }
+    const bool signalled = event->signalled;
     pthread_mutex_unlock(&event->mutex);
-    return err == 0;
+    return signalled;
 }
 
 void *event_create(void) {
     event_s *event = (event_s *)calloc(1, sizeof(event_s));
     if (!event)
         return NULL;
-    if (pthread_cond_init(&event->cond, NULL)) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+#ifndef __APPLE__
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+#endif
+    const int32_t err = pthread_cond_init(&event->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    if (err) {
         free(event);
         return NULL;
     }
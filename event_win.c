@@ -27,6 +27,13 @@ bool event_set(void *ctx) {
     return true;
 }
 
+bool event_reset(void *ctx) {
+    event_s *event = (event_s *)ctx;
+    if (!event || !ResetEvent(event->handle))
+        return false;
+    return true;
+}
+
 void *event_create(void) {
     event_s *event = (event_s *)calloc(1, sizeof(event_s));
     if (!event)
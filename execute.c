@@ -3,8 +3,22 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <pthread.h>
+#endif
+
+#include "atomic.h"
 #include "execute.h"
+#include "execute_dns.h"
 #include "execute_i.h"
+#ifdef HAVE_EXECUTE_PROCESS
+#  include "execute_process.h"
+#endif
+#ifdef HAVE_QUICKJS
+#  include "execute_quickjs.h"
+#endif
 #ifdef _WIN32
 #  if WINAPI_FAMILY == WINAPI_FAMILY_DESKTOP_APP
 #    include "execute_wsh.h"
@@ -17,24 +31,333 @@
 #    include "execute_jscore.h"
 #  endif
 #endif
+#include "mutex.h"
+#include "script_store.h"
+#include "stats_record.h"
+#include "trace_record.h"
+#include "util.h"
 
 #ifdef __cplusplus
 #  define delete f_delete
 #endif
 
+#ifdef _MSC_VER
+#  define EXECUTE_THREAD_LOCAL __declspec(thread)
+#else
+#  define EXECUTE_THREAD_LOCAL __thread
+#endif
+
+#define EXECUTE_CACHE_BUCKETS      (256)
+// Keep an evaluated context for every script the script store can hold
+#define EXECUTE_CACHE_MAX_CONTEXTS SCRIPT_STORE_MAX_SCRIPTS
+
+typedef struct proxy_execute_cache_s {
+    // Hash and length of script evaluated by the context
+    uint64_t hash;
+    size_t script_len;
+    // Thread that created the context, script engines don't allow contexts to be used by other threads
+    uint64_t thread_id;
+    // Time it took to evaluate the script
+    uint64_t compile_time_us;
+    // Used to find the least recently used context
+    uint64_t last_used;
+    // Whether or not the context is currently running a script
+    bool in_use;
+    void *context;
+    // Next context in bucket
+    struct proxy_execute_cache_s *next;
+} proxy_execute_cache_s;
+
 typedef struct g_proxy_execute_s {
     // Library reference count
     int32_t ref_count;
     // Proxy execute interface
     proxy_execute_i_s *proxy_execute_i;
+    // Evaluated script context cache lock
+    void *cache_mutex;
+    uint64_t cache_clock;
+    // Number of contexts in the cache
+    int32_t cache_count;
+    // Evaluated script contexts by script hash and thread
+    proxy_execute_cache_s *cache[EXECUTE_CACHE_BUCKETS];
+    // Contexts evicted by other threads, deleted by the thread that created them on its next access or when it exits
+    proxy_execute_cache_s *stale;
+    // Notifies the cache when a thread that created contexts exits
+#ifdef _WIN32
+    DWORD thread_exit_index;
+#else
+    pthread_key_t thread_exit_key;
+#endif
+    bool has_thread_exit;
 } g_proxy_execute_s;
 
 g_proxy_execute_s g_proxy_execute;
 
+// Thread ids are not reset by global cleanup so that they stay unique for threads that outlive it
+static uint64_t proxy_execute_last_thread_id;
+static EXECUTE_THREAD_LOCAL uint64_t proxy_execute_thread_id;
+
+static uint64_t proxy_execute_get_thread_id(void) {
+    if (!proxy_execute_thread_id)
+        proxy_execute_thread_id = atomic_add_u64(&proxy_execute_last_thread_id, 1) + 1;
+    return proxy_execute_thread_id;
+}
+
+static proxy_execute_cache_s **proxy_execute_cache_find(uint64_t hash, size_t script_len, uint64_t thread_id) {
+    proxy_execute_cache_s **cachep = &g_proxy_execute.cache[(hash ^ thread_id) % EXECUTE_CACHE_BUCKETS];
+    while (*cachep) {
+        const proxy_execute_cache_s *cache = *cachep;
+        if (cache->hash == hash && cache->script_len == script_len && cache->thread_id == thread_id)
+            break;
+        cachep = &(*cachep)->next;
+    }
+    return cachep;
+}
+
+static void proxy_execute_cache_delete_list(proxy_execute_cache_s *cache) {
+    while (cache) {
+        proxy_execute_cache_s *next = cache->next;
+        g_proxy_execute.proxy_execute_i->context_delete(&cache->context);
+        free(cache);
+        cache = next;
+    }
+}
+
+// Must be called with lock held, returns the stale contexts created by the thread
+static proxy_execute_cache_s *proxy_execute_cache_take_stale(uint64_t thread_id) {
+    proxy_execute_cache_s *taken = NULL;
+    proxy_execute_cache_s **cachep = &g_proxy_execute.stale;
+    while (*cachep) {
+        proxy_execute_cache_s *cache = *cachep;
+        if (cache->thread_id == thread_id) {
+            *cachep = cache->next;
+            cache->next = taken;
+            taken = cache;
+        } else {
+            cachep = &cache->next;
+        }
+    }
+    return taken;
+}
+
+// Must be called with lock held, returns the context that was evicted if it was created by the thread
+static void *proxy_execute_cache_evict(uint64_t thread_id) {
+    proxy_execute_cache_s **oldestp = NULL;
+
+    // Contexts that are running a script can't be evicted
+    for (int32_t i = 0; i < EXECUTE_CACHE_BUCKETS; i++) {
+        for (proxy_execute_cache_s **cachep = &g_proxy_execute.cache[i]; *cachep; cachep = &(*cachep)->next) {
+            if (!(*cachep)->in_use && (!oldestp || (*cachep)->last_used < (*oldestp)->last_used))
+                oldestp = cachep;
+        }
+    }
+    if (!oldestp)
+        return NULL;
+
+    proxy_execute_cache_s *cache = *oldestp;
+    *oldestp = cache->next;
+    g_proxy_execute.cache_count--;
+
+    // Script engines don't allow contexts to be deleted by other threads either
+    if (cache->thread_id != thread_id) {
+        cache->next = g_proxy_execute.stale;
+        g_proxy_execute.stale = cache;
+        return NULL;
+    }
+
+    void *context = cache->context;
+    free(cache);
+    return context;
+}
+
+static proxy_execute_cache_s *proxy_execute_cache_acquire(uint64_t hash, size_t script_len) {
+    const uint64_t thread_id = proxy_execute_get_thread_id();
+
+    mutex_lock(g_proxy_execute.cache_mutex);
+    proxy_execute_cache_s *stale = proxy_execute_cache_take_stale(thread_id);
+    proxy_execute_cache_s *cache = *proxy_execute_cache_find(hash, script_len, thread_id);
+    if (cache) {
+        cache->last_used = ++g_proxy_execute.cache_clock;
+        cache->in_use = true;
+    }
+    mutex_unlock(g_proxy_execute.cache_mutex);
+
+    // Delete contexts evicted by other threads outside of the lock
+    proxy_execute_cache_delete_list(stale);
+    return cache;
+}
+
+// Deletes the contexts created by a thread that is exiting, on that thread
+#ifdef _WIN32
+static void NTAPI proxy_execute_cache_thread_exit(void *value) {
+#else
+static void proxy_execute_cache_thread_exit(void *value) {
+#endif
+    const uint64_t thread_id = (uint64_t)(uintptr_t)value;
+    if (!thread_id || !g_proxy_execute.cache_mutex)
+        return;
+
+    mutex_lock(g_proxy_execute.cache_mutex);
+    proxy_execute_cache_s *taken = proxy_execute_cache_take_stale(thread_id);
+    for (int32_t i = 0; i < EXECUTE_CACHE_BUCKETS; i++) {
+        proxy_execute_cache_s **cachep = &g_proxy_execute.cache[i];
+        while (*cachep) {
+            proxy_execute_cache_s *cache = *cachep;
+            if (cache->thread_id == thread_id) {
+                *cachep = cache->next;
+                g_proxy_execute.cache_count--;
+                cache->next = taken;
+                taken = cache;
+            } else {
+                cachep = &cache->next;
+            }
+        }
+    }
+    mutex_unlock(g_proxy_execute.cache_mutex);
+
+    proxy_execute_cache_delete_list(taken);
+}
+
+static proxy_execute_cache_s *proxy_execute_cache_insert(uint64_t hash, size_t script_len, uint64_t compile_time_us,
+                                                         void *context) {
+    void *evicted = NULL;
+
+    proxy_execute_cache_s *cache = (proxy_execute_cache_s *)calloc(1, sizeof(proxy_execute_cache_s));
+    if (!cache)
+        return NULL;
+    cache->hash = hash;
+    cache->script_len = script_len;
+    cache->thread_id = proxy_execute_get_thread_id();
+    cache->compile_time_us = compile_time_us;
+    cache->in_use = true;
+    cache->context = context;
+
+    // Contexts created by this thread are deleted by it when it exits
+    if (g_proxy_execute.has_thread_exit) {
+#ifdef _WIN32
+        FlsSetValue(g_proxy_execute.thread_exit_index, (void *)(uintptr_t)cache->thread_id);
+#else
+        pthread_setspecific(g_proxy_execute.thread_exit_key, (void *)(uintptr_t)cache->thread_id);
+#endif
+    }
+
+    mutex_lock(g_proxy_execute.cache_mutex);
+    if (g_proxy_execute.cache_count >= EXECUTE_CACHE_MAX_CONTEXTS)
+        evicted = proxy_execute_cache_evict(cache->thread_id);
+    cache->last_used = ++g_proxy_execute.cache_clock;
+    proxy_execute_cache_s **cachep = proxy_execute_cache_find(hash, script_len, cache->thread_id);
+    cache->next = *cachep;
+    *cachep = cache;
+    g_proxy_execute.cache_count++;
+    mutex_unlock(g_proxy_execute.cache_mutex);
+
+    // Delete context outside of the lock
+    if (evicted)
+        g_proxy_execute.proxy_execute_i->context_delete(&evicted);
+    return cache;
+}
+
+static void proxy_execute_cache_release(proxy_execute_cache_s *cache) {
+    mutex_lock(g_proxy_execute.cache_mutex);
+    cache->in_use = false;
+    mutex_unlock(g_proxy_execute.cache_mutex);
+}
+
+// Contexts of threads that have exited are already deleted, so only threads that are still running but no longer
+// using the library can have contexts left when it is cleaned up
+static void proxy_execute_cache_clear(void) {
+    for (int32_t i = 0; i < EXECUTE_CACHE_BUCKETS; i++) {
+        proxy_execute_cache_delete_list(g_proxy_execute.cache[i]);
+        g_proxy_execute.cache[i] = NULL;
+    }
+    proxy_execute_cache_delete_list(g_proxy_execute.stale);
+    g_proxy_execute.stale = NULL;
+    g_proxy_execute.cache_count = 0;
+}
+
+static bool proxy_execute_get_proxies_for_url_cached(void *ctx, const char *script, const char *url) {
+    const proxy_execute_i_s *proxy_execute_i = g_proxy_execute.proxy_execute_i;
+
+    // Identical scripts share contexts regardless of which url they were fetched from
+    const size_t script_len = strlen(script);
+    const uint64_t hash = hash_xxh64(script, script_len, 0);
+
+    proxy_execute_cache_s *cache = proxy_execute_cache_acquire(hash, script_len);
+    if (cache) {
+        stats_add(STATS_PAC_COMPILE_CACHE_HITS, 1);
+        stats_add(STATS_PAC_COMPILE_TIME_SAVED, cache->compile_time_us);
+    } else {
+        stats_add(STATS_PAC_COMPILE_CACHE_MISSES, 1);
+
+        const uint64_t start_us = stats_get_time_us();
+        void *context = proxy_execute_i->context_create(ctx, script);
+        if (!context)
+            return false;
+        const uint64_t compile_time_us = stats_get_time_us() - start_us;
+        stats_record_time(STATS_PAC_COMPILE_TIME, compile_time_us);
+
+        cache = proxy_execute_cache_insert(hash, script_len, compile_time_us, context);
+        if (!cache) {
+            // Run the script without caching the context
+            const bool is_ok = proxy_execute_i->context_get_proxies_for_url(ctx, context, url);
+            proxy_execute_i->context_delete(&context);
+            return is_ok;
+        }
+    }
+
+    const bool is_ok = proxy_execute_i->context_get_proxies_for_url(ctx, cache->context, url);
+    proxy_execute_cache_release(cache);
+    return is_ok;
+}
+
+static bool proxy_execute_run(void *ctx, const char *script, const char *url) {
+    const proxy_execute_i_s *proxy_execute_i = g_proxy_execute.proxy_execute_i;
+    if (script && proxy_execute_i->context_create && g_proxy_execute.cache_mutex)
+        return proxy_execute_get_proxies_for_url_cached(ctx, script, url);
+    return proxy_execute_i->get_proxies_for_url(ctx, script, url);
+}
+
+static bool proxy_execute_run_restartable(void *ctx, const char *script, const char *url) {
+    bool is_ok = false;
+
+    // Caller runs the script again itself once the host names it recorded have been resolved
+    if (execute_dns_get_current())
+        return proxy_execute_run(ctx, script, url);
+
+    // Resolve host names directly inside the script if they can't be recorded
+    void *dns = execute_dns_create();
+    if (!dns)
+        return proxy_execute_run(ctx, script, url);
+
+    for (int32_t restarts = 0;; restarts++) {
+        // Host names that have not been resolved yet are recorded rather than blocking the script, until the last
+        // attempt which resolves any remaining host names directly
+        execute_dns_set_nonblocking(dns, restarts < EXECUTE_DNS_MAX_RESTARTS);
+        execute_dns_set_current(dns);
+        is_ok = proxy_execute_run(ctx, script, url);
+        execute_dns_set_current(NULL);
+
+        // Results are only valid when the script did not look up any unresolved host names
+        if (!execute_dns_get_missing_count(dns))
+            break;
+
+        // Resolve recorded host names concurrently and run the script again with the answers
+        stats_add(STATS_PAC_DNS_RESTARTS, 1);
+        execute_dns_resolve_missing(dns);
+    }
+
+    execute_dns_delete(&dns);
+    return is_ok;
+}
+
 bool proxy_execute_get_proxies_for_url(void *ctx, const char *script, const char *url) {
     if (!g_proxy_execute.proxy_execute_i)
         return false;
-    return g_proxy_execute.proxy_execute_i->get_proxies_for_url(ctx, script, url);
+
+    trace_begin("proxy_execute_get_proxies_for_url");
+    const bool is_ok = proxy_execute_run_restartable(ctx, script, url);
+    trace_end("proxy_execute_get_proxies_for_url");
+    return is_ok;
 }
 
 const char *proxy_execute_get_list(void *ctx) {
@@ -61,29 +384,84 @@ bool proxy_execute_delete(void **ctx) {
     return g_proxy_execute.proxy_execute_i->delete(ctx);
 }
 
-bool proxy_execute_global_init(void) {
-    if (g_proxy_execute.ref_count > 0) {
-        g_proxy_execute.ref_count++;
-        return true;
-    }
-    memset(&g_proxy_execute, 0, sizeof(g_proxy_execute));
+// Initialize the script engine with the given name, or the first engine available if no name is given
+static proxy_execute_i_s *proxy_execute_init_engine(const char *name) {
+#ifdef HAVE_QUICKJS
+    if ((!name || strcmp(name, "quickjs") == 0) && proxy_execute_quickjs_global_init())
+        return proxy_execute_quickjs_get_interface();
+#endif
 #ifdef _WIN32
 #  if WINAPI_FAMILY == WINAPI_FAMILY_DESKTOP_APP
-    if (proxy_execute_wsh_global_init())
-        g_proxy_execute.proxy_execute_i = proxy_execute_wsh_get_interface();
+    if ((!name || strcmp(name, "wsh") == 0) && proxy_execute_wsh_global_init())
+        return proxy_execute_wsh_get_interface();
 #  endif
 #else
 #  ifdef HAVE_JSC
-    if (proxy_execute_jsc_global_init())
-        g_proxy_execute.proxy_execute_i = proxy_execute_jsc_get_interface();
+    if ((!name || strcmp(name, "jsc") == 0) && proxy_execute_jsc_global_init())
+        return proxy_execute_jsc_get_interface();
 #  endif
 #  ifdef HAVE_JSCORE
-    if (!g_proxy_execute.proxy_execute_i && proxy_execute_jscore_global_init())
-        g_proxy_execute.proxy_execute_i = proxy_execute_jscore_get_interface();
+    if ((!name || strcmp(name, "jscore") == 0) && proxy_execute_jscore_global_init())
+        return proxy_execute_jscore_get_interface();
 #  endif
 #endif
+    return NULL;
+}
+
+#ifdef HAVE_EXECUTE_PROCESS
+static int32_t proxy_execute_get_env_int(const char *name, int32_t default_value) {
+    const char *value = getenv(name);
+    if (!value || !*value)
+        return default_value;
+    return (int32_t)strtol(value, NULL, 0);
+}
+
+// Dispatch scripts to a pool of helper processes if requested, so that a misbehaving script can't take down
+// the calling process
+static proxy_execute_i_s *proxy_execute_init_process(proxy_execute_i_s *engine_i) {
+    const int32_t processes = proxy_execute_get_env_int("PROXYRES_EXECUTE_PROCESSES", 0);
+    if (processes <= 0)
+        return engine_i;
+    const int32_t max_evaluations =
+        proxy_execute_get_env_int("PROXYRES_EXECUTE_PROCESS_MAX_EVALUATIONS", EXECUTE_PROCESS_DEFAULT_MAX_EVALUATIONS);
+    const int32_t max_rss_mb =
+        proxy_execute_get_env_int("PROXYRES_EXECUTE_PROCESS_MAX_RSS_MB", EXECUTE_PROCESS_DEFAULT_MAX_RSS_MB);
+    if (!proxy_execute_process_init_ex(engine_i, processes, max_evaluations, max_rss_mb))
+        return engine_i;
+    return proxy_execute_process_get_interface();
+}
+#endif
+
+bool proxy_execute_global_init(void) {
+    if (g_proxy_execute.ref_count > 0) {
+        g_proxy_execute.ref_count++;
+        return true;
+    }
+    memset(&g_proxy_execute, 0, sizeof(g_proxy_execute));
+
+    // Use the script engine selected at run-time, otherwise the first engine available
+    const char *engine = getenv("PROXYRES_EXECUTE_ENGINE");
+    if (engine && *engine)
+        g_proxy_execute.proxy_execute_i = proxy_execute_init_engine(engine);
+    if (!g_proxy_execute.proxy_execute_i)
+        g_proxy_execute.proxy_execute_i = proxy_execute_init_engine(NULL);
     if (!g_proxy_execute.proxy_execute_i)
         return false;
+#ifdef HAVE_EXECUTE_PROCESS
+    g_proxy_execute.proxy_execute_i = proxy_execute_init_process(g_proxy_execute.proxy_execute_i);
+#endif
+    if (g_proxy_execute.proxy_execute_i->context_create) {
+        g_proxy_execute.cache_mutex = mutex_create();
+#ifdef _WIN32
+        g_proxy_execute.thread_exit_index = FlsAlloc(proxy_execute_cache_thread_exit);
+        g_proxy_execute.has_thread_exit = g_proxy_execute.thread_exit_index != FLS_OUT_OF_INDEXES;
+#else
+        g_proxy_execute.has_thread_exit =
+            pthread_key_create(&g_proxy_execute.thread_exit_key, proxy_execute_cache_thread_exit) == 0;
+#endif
+    }
+    // Host names are resolved inside the script if answers can't be shared between executions
+    execute_dns_global_init();
     g_proxy_execute.ref_count++;
     return true;
 }
@@ -91,6 +469,19 @@ bool proxy_execute_global_init(void) {
 bool proxy_execute_global_cleanup(void) {
     if (--g_proxy_execute.ref_count > 0)
         return true;
+    if (g_proxy_execute.cache_mutex) {
+        proxy_execute_cache_clear();
+        // Thread exit callbacks that run while freeing find the cache empty
+        if (g_proxy_execute.has_thread_exit) {
+#ifdef _WIN32
+            FlsFree(g_proxy_execute.thread_exit_index);
+#else
+            pthread_key_delete(g_proxy_execute.thread_exit_key);
+#endif
+        }
+        mutex_delete(&g_proxy_execute.cache_mutex);
+    }
+    execute_dns_global_cleanup();
     if (g_proxy_execute.proxy_execute_i)
         g_proxy_execute.proxy_execute_i->global_cleanup();
 
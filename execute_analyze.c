@@ -0,0 +1,431 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+
+#include "execute.h"
+#include "util.h"
+
+// Results of scripts that use the network configuration or DNS are only reused for a limited time
+#define EXECUTE_ANALYZE_NETWORK_MAX_TTL (60)
+// Time zone offsets are multiples of 15 minutes so local day boundaries always fall on one
+#define EXECUTE_ANALYZE_DAY_GRANULARITY (15 * 60)
+// Longest url prefix that only contains the scheme, "ws://" being the shortest scheme and separator
+#define EXECUTE_ANALYZE_MAX_SCHEME_PREFIX (5)
+
+typedef enum execute_token_type {
+    EXECUTE_TOKEN_END,
+    EXECUTE_TOKEN_IDENT,
+    EXECUTE_TOKEN_NUMBER,
+    EXECUTE_TOKEN_STRING,
+    EXECUTE_TOKEN_REGEXP,
+    // Template literal with embedded expressions
+    EXECUTE_TOKEN_TEMPLATE,
+    EXECUTE_TOKEN_PUNCT
+} execute_token_type;
+
+typedef struct execute_token_s {
+    execute_token_type type;
+    const char *start;
+    size_t len;
+} execute_token_s;
+
+typedef struct execute_lexer_s {
+    const char *pos;
+    // Previous token, used to tell regular expressions apart from division
+    execute_token_s prev;
+} execute_lexer_s;
+
+static bool execute_token_is(const execute_token_s *token, execute_token_type type, const char *str) {
+    if (token->type != type)
+        return false;
+    return strlen(str) == token->len && strncmp(token->start, str, token->len) == 0;
+}
+
+static bool execute_token_equals(const execute_token_s *token1, const execute_token_s *token2) {
+    return token1->type == token2->type && token1->len == token2->len &&
+           strncmp(token1->start, token2->start, token1->len) == 0;
+}
+
+static bool execute_token_is_any(const execute_token_s *token, const char **idents) {
+    for (int32_t i = 0; idents[i]; i++) {
+        if (execute_token_is(token, EXECUTE_TOKEN_IDENT, idents[i]))
+            return true;
+    }
+    return false;
+}
+
+static bool execute_lexer_regexp_allowed(const execute_lexer_s *lexer) {
+    static const char *keywords[] = {"return", "typeof", "case", "do", "else", "in", "instanceof", "new",
+                                     "void", "delete", "throw", NULL};
+    const execute_token_s *prev = &lexer->prev;
+    switch (prev->type) {
+    case EXECUTE_TOKEN_END:
+        return true;
+    case EXECUTE_TOKEN_IDENT:
+        return execute_token_is_any(prev, keywords);
+    case EXECUTE_TOKEN_PUNCT:
+        return *prev->start != ')' && *prev->start != ']';
+    default:
+        return false;
+    }
+}
+
+static void execute_lexer_skip_space(execute_lexer_s *lexer) {
+    const char *pos = lexer->pos;
+    while (*pos) {
+        if (isspace((unsigned char)*pos)) {
+            pos++;
+        } else if (pos[0] == '/' && pos[1] == '/') {
+            while (*pos && *pos != '\n')
+                pos++;
+        } else if (pos[0] == '/' && pos[1] == '*') {
+            const char *comment_end = strstr(pos + 2, "*/");
+            pos = comment_end ? comment_end + 2 : pos + strlen(pos);
+        } else {
+            break;
+        }
+    }
+    lexer->pos = pos;
+}
+
+static const char *execute_lexer_skip_quoted(const char *pos, char quote, bool *has_expressions) {
+    // Skip opening quote and find unescaped closing quote
+    for (pos++; *pos && *pos != quote; pos++) {
+        if (*pos == '\\' && pos[1])
+            pos++;
+        else if (has_expressions && pos[0] == '$' && pos[1] == '{')
+            *has_expressions = true;
+    }
+    return *pos ? pos + 1 : pos;
+}
+
+static const char *execute_lexer_skip_regexp(const char *pos) {
+    bool in_class = false;
+    for (pos++; *pos && *pos != '\n'; pos++) {
+        if (*pos == '\\' && pos[1])
+            pos++;
+        else if (*pos == '[')
+            in_class = true;
+        else if (*pos == ']')
+            in_class = false;
+        else if (*pos == '/' && !in_class)
+            break;
+    }
+    if (*pos == '/')
+        pos++;
+    // Skip flags
+    while (isalpha((unsigned char)*pos))
+        pos++;
+    return pos;
+}
+
+static void execute_lexer_next(execute_lexer_s *lexer, execute_token_s *token) {
+    execute_lexer_skip_space(lexer);
+
+    const char *pos = lexer->pos;
+    const char c = *pos;
+    bool has_expressions = false;
+
+    token->start = pos;
+    if (!c) {
+        token->type = EXECUTE_TOKEN_END;
+    } else if (isalpha((unsigned char)c) || c == '_' || c == '$') {
+        token->type = EXECUTE_TOKEN_IDENT;
+        while (isalnum((unsigned char)*pos) || *pos == '_' || *pos == '$')
+            pos++;
+    } else if (isdigit((unsigned char)c)) {
+        token->type = EXECUTE_TOKEN_NUMBER;
+        while (isalnum((unsigned char)*pos) || *pos == '.')
+            pos++;
+    } else if (c == '"' || c == '\'') {
+        token->type = EXECUTE_TOKEN_STRING;
+        pos = execute_lexer_skip_quoted(pos, c, NULL);
+    } else if (c == '`') {
+        pos = execute_lexer_skip_quoted(pos, c, &has_expressions);
+        token->type = has_expressions ? EXECUTE_TOKEN_TEMPLATE : EXECUTE_TOKEN_STRING;
+    } else if (c == '/' && execute_lexer_regexp_allowed(lexer)) {
+        token->type = EXECUTE_TOKEN_REGEXP;
+        pos = execute_lexer_skip_regexp(pos);
+    } else {
+        token->type = EXECUTE_TOKEN_PUNCT;
+        pos++;
+    }
+
+    token->len = (size_t)(pos - token->start);
+    lexer->pos = pos;
+    lexer->prev = *token;
+}
+
+// Check whether a string literal only matches the scheme of a url, for example "https:" or "http://"
+static bool execute_is_scheme_literal(const execute_token_s *token, bool is_pattern) {
+    if (token->type != EXECUTE_TOKEN_STRING || token->len < 3)
+        return false;
+
+    const char *str = token->start + 1;
+    const char *str_end = token->start + token->len - 1;
+    const char *scheme_start = str;
+    while (str < str_end && isalpha((unsigned char)*str))
+        str++;
+    if (str == scheme_start)
+        return false;
+
+    if (is_pattern) {
+        // Shell expression must match the scheme followed by anything
+        if (str < str_end && *str == ':')
+            str++;
+        if (str_end - str >= 2 && str[0] == '/' && str[1] == '/')
+            str += 2;
+        return str_end - str == 1 && *str == '*';
+    }
+
+    // Prefix must not extend past the separator after the scheme
+    if (str < str_end && *str == ':')
+        str++;
+    for (int32_t i = 0; i < 2 && str < str_end && *str == '/'; i++)
+        str++;
+    return str == str_end;
+}
+
+// Check for url.substring(0, 5) or url.startsWith("https:") which only depend on the scheme
+static bool execute_is_scheme_method(execute_lexer_s *lexer) {
+    static const char *substring_methods[] = {"substring", "substr", "slice", NULL};
+    execute_token_s token;
+
+    execute_lexer_next(lexer, &token);
+    if (!execute_token_is(&token, EXECUTE_TOKEN_PUNCT, "."))
+        return false;
+    execute_token_s method;
+    execute_lexer_next(lexer, &method);
+    execute_lexer_next(lexer, &token);
+    if (!execute_token_is(&token, EXECUTE_TOKEN_PUNCT, "("))
+        return false;
+
+    if (execute_token_is_any(&method, substring_methods)) {
+        execute_lexer_next(lexer, &token);
+        if (!execute_token_is(&token, EXECUTE_TOKEN_NUMBER, "0"))
+            return false;
+        execute_lexer_next(lexer, &token);
+        if (!execute_token_is(&token, EXECUTE_TOKEN_PUNCT, ","))
+            return false;
+        execute_lexer_next(lexer, &token);
+        if (token.type != EXECUTE_TOKEN_NUMBER || atoi(token.start) > EXECUTE_ANALYZE_MAX_SCHEME_PREFIX)
+            return false;
+    } else if (execute_token_is(&method, EXECUTE_TOKEN_IDENT, "startsWith")) {
+        execute_lexer_next(lexer, &token);
+        if (!execute_is_scheme_literal(&token, false))
+            return false;
+    } else {
+        return false;
+    }
+
+    execute_lexer_next(lexer, &token);
+    return execute_token_is(&token, EXECUTE_TOKEN_PUNCT, ")");
+}
+
+// Check for shExpMatch(url, "https:*") which only depends on the scheme
+static bool execute_is_scheme_match(execute_lexer_s *lexer, const execute_token_s *url_name) {
+    execute_token_s token;
+
+    execute_lexer_next(lexer, &token);
+    if (!execute_token_is(&token, EXECUTE_TOKEN_PUNCT, "("))
+        return false;
+    execute_lexer_next(lexer, &token);
+    if (!execute_token_equals(&token, url_name))
+        return false;
+    execute_lexer_next(lexer, &token);
+    if (!execute_token_is(&token, EXECUTE_TOKEN_PUNCT, ","))
+        return false;
+    execute_lexer_next(lexer, &token);
+    if (!execute_is_scheme_literal(&token, true))
+        return false;
+    execute_lexer_next(lexer, &token);
+    return execute_token_is(&token, EXECUTE_TOKEN_PUNCT, ")");
+}
+
+// Count the arguments of a function call to determine the precision of timeRange
+static int32_t execute_count_arguments(execute_lexer_s *lexer) {
+    execute_token_s token;
+    int32_t depth = 0;
+    int32_t arg_count = 0;
+
+    execute_lexer_next(lexer, &token);
+    if (!execute_token_is(&token, EXECUTE_TOKEN_PUNCT, "("))
+        return -1;
+    for (execute_lexer_next(lexer, &token); token.type != EXECUTE_TOKEN_END; execute_lexer_next(lexer, &token)) {
+        const bool is_punct = token.type == EXECUTE_TOKEN_PUNCT;
+        if (is_punct && strchr(")]}", *token.start) && depth-- == 0)
+            break;
+        if (!arg_count)
+            arg_count = 1;
+        if (is_punct && strchr("([{", *token.start))
+            depth++;
+        else if (depth == 0 && execute_token_is(&token, EXECUTE_TOKEN_PUNCT, ","))
+            arg_count++;
+    }
+    return arg_count;
+}
+
+// Find the name of the url parameter of FindProxyForURL
+static bool execute_find_url_name(const char *script, execute_token_s *url_name) {
+    execute_lexer_s lexer = {script, {EXECUTE_TOKEN_END, NULL, 0}};
+    execute_token_s token;
+
+    for (execute_lexer_next(&lexer, &token); token.type != EXECUTE_TOKEN_END; execute_lexer_next(&lexer, &token)) {
+        if (!execute_token_is(&token, EXECUTE_TOKEN_IDENT, "FindProxyForURL"))
+            continue;
+
+        // Supports function FindProxyForURL(url, host) and FindProxyForURL = function (url, host)
+        execute_lexer_s lookahead = lexer;
+        execute_lexer_next(&lookahead, &token);
+        if (execute_token_is(&token, EXECUTE_TOKEN_PUNCT, "="))
+            execute_lexer_next(&lookahead, &token);
+        if (execute_token_is(&token, EXECUTE_TOKEN_IDENT, "function"))
+            execute_lexer_next(&lookahead, &token);
+        if (!execute_token_is(&token, EXECUTE_TOKEN_PUNCT, "("))
+            continue;
+        execute_lexer_next(&lookahead, url_name);
+        if (url_name->type == EXECUTE_TOKEN_IDENT)
+            return true;
+    }
+    return false;
+}
+
+static void execute_set_time_granularity(proxy_execute_analysis_s *analysis, int32_t granularity) {
+    if (!analysis->time_granularity || granularity < analysis->time_granularity)
+        analysis->time_granularity = granularity;
+}
+
+bool proxy_execute_analyze_script(const char *script, proxy_execute_analysis_s *analysis) {
+    static const char *time_functions[] = {"dateRange", "weekdayRange", NULL};
+    static const char *my_ip_functions[] = {"myIpAddress", "myIpAddressEx", NULL};
+    static const char *dns_functions[] = {"dnsResolve", "dnsResolveEx", "isResolvable",
+                                          "isResolvableEx", "isInNet", "isInNetEx", NULL};
+    static const char *dynamic_functions[] = {"eval", "Function", "globalThis", NULL};
+    execute_token_s url_name = {EXECUTE_TOKEN_END, NULL, 0};
+    execute_token_s token;
+
+    if (!script || !analysis)
+        return false;
+
+    memset(analysis, 0, sizeof(proxy_execute_analysis_s));
+
+    // Assume the whole url is used if the url parameter can't be found
+    if (!execute_find_url_name(script, &url_name))
+        analysis->uses_url = true;
+
+    execute_lexer_s lexer = {script, {EXECUTE_TOKEN_END, NULL, 0}};
+    for (execute_lexer_next(&lexer, &token); token.type != EXECUTE_TOKEN_END; execute_lexer_next(&lexer, &token)) {
+        if (token.type == EXECUTE_TOKEN_TEMPLATE) {
+            // Expressions in template literals are not analyzed
+            analysis->uses_dynamic_code = true;
+            continue;
+        }
+        if (token.type != EXECUTE_TOKEN_IDENT)
+            continue;
+
+        // Ignore object properties with the same name as functions or parameters
+        const char *prev = token.start;
+        while (prev > script && isspace((unsigned char)prev[-1]))
+            prev--;
+        if (prev > script && prev[-1] == '.')
+            continue;
+
+        execute_lexer_s lookahead = lexer;
+        if (execute_token_is(&token, EXECUTE_TOKEN_IDENT, "function")) {
+            // Parameter declarations are not uses of the url
+            execute_lexer_next(&lookahead, &token);
+            if (token.type == EXECUTE_TOKEN_IDENT)
+                execute_lexer_next(&lookahead, &token);
+            while (token.type != EXECUTE_TOKEN_END && !execute_token_is(&token, EXECUTE_TOKEN_PUNCT, ")"))
+                execute_lexer_next(&lookahead, &token);
+            lexer = lookahead;
+        } else if (!analysis->uses_url && execute_token_equals(&token, &url_name)) {
+            if (execute_is_scheme_method(&lookahead))
+                analysis->uses_scheme = true;
+            else
+                analysis->uses_url = true;
+        } else if (execute_token_is(&token, EXECUTE_TOKEN_IDENT, "arguments")) {
+            analysis->uses_url = true;
+        } else if (!analysis->uses_url && execute_token_is(&token, EXECUTE_TOKEN_IDENT, "shExpMatch")) {
+            // Skip past the url argument so that it is not counted as using the whole url
+            if (execute_is_scheme_match(&lookahead, &url_name)) {
+                analysis->uses_scheme = true;
+                lexer = lookahead;
+            }
+        } else if (execute_token_is(&token, EXECUTE_TOKEN_IDENT, "Date")) {
+            analysis->uses_date = true;
+        } else if (execute_token_is(&token, EXECUTE_TOKEN_IDENT, "timeRange")) {
+            // timeRange(hour1, min1, sec1, hour2, min2, sec2) changes result every second
+            analysis->uses_time = true;
+            execute_set_time_granularity(analysis, execute_count_arguments(&lookahead) >= 5 ? 1 : 60);
+        } else if (execute_token_is_any(&token, time_functions)) {
+            analysis->uses_time = true;
+            execute_set_time_granularity(analysis, EXECUTE_ANALYZE_DAY_GRANULARITY);
+        } else if (execute_token_is_any(&token, my_ip_functions)) {
+            analysis->uses_my_ip_address = true;
+        } else if (execute_token_is_any(&token, dns_functions)) {
+            analysis->uses_dns_resolve = true;
+        } else if (execute_token_is_any(&token, dynamic_functions)) {
+            analysis->uses_dynamic_code = true;
+        } else if (execute_token_is(&token, EXECUTE_TOKEN_IDENT, "this")) {
+            // Global functions can be called by name using this["dnsResolve"]
+            execute_lexer_next(&lookahead, &token);
+            if (execute_token_is(&token, EXECUTE_TOKEN_PUNCT, "["))
+                analysis->uses_dynamic_code = true;
+        }
+    }
+
+    if (analysis->uses_url || analysis->uses_dynamic_code)
+        analysis->memo_key = PROXY_EXECUTE_MEMO_KEY_URL;
+    else if (analysis->uses_scheme)
+        analysis->memo_key = PROXY_EXECUTE_MEMO_KEY_SCHEME_HOST;
+    else
+        analysis->memo_key = PROXY_EXECUTE_MEMO_KEY_HOST;
+    return true;
+}
+
+char *proxy_execute_get_memo_url(const char *url, proxy_execute_memo_key memo_key) {
+    if (!url)
+        return NULL;
+    if (memo_key == PROXY_EXECUTE_MEMO_KEY_URL)
+        return strdup(url);
+
+    // Scheme is kept even if the script does not check it, since it is the default scheme of the proxies returned
+    char *scheme = get_url_scheme(url, "http");
+    char *host = get_url_host(url);
+    char *memo_url = NULL;
+    if (scheme && host) {
+        const size_t max_memo_url = strlen(scheme) + strlen(host) + 4;
+        memo_url = (char *)malloc(max_memo_url);
+        if (memo_url)
+            snprintf(memo_url, max_memo_url, "%s://%s", scheme, host);
+    }
+    free(scheme);
+    free(host);
+    return memo_url;
+}
+
+int32_t proxy_execute_get_memo_ttl(const proxy_execute_analysis_s *analysis, time_t now) {
+    int32_t ttl = -1;
+
+    // Results can't be reused when the script can read the current time or run arbitrary code
+    if (!analysis || analysis->uses_date || analysis->uses_dynamic_code)
+        return 0;
+
+    // Results may change whenever the network changes
+    if (analysis->uses_my_ip_address || analysis->uses_dns_resolve)
+        ttl = EXECUTE_ANALYZE_NETWORK_MAX_TTL;
+
+    // Results may change at the next time boundary used by the time functions
+    if (analysis->time_granularity > 0) {
+        const int32_t granularity = analysis->time_granularity;
+        const int32_t boundary_ttl = granularity - (int32_t)(now % granularity);
+        if (ttl < 0 || boundary_ttl < ttl)
+            ttl = boundary_ttl;
+    }
+    return ttl;
+}
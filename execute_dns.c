@@ -0,0 +1,481 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include "atomic.h"
+#include "event.h"
+#include "execute_dns.h"
+#include "mutex.h"
+#include "net_util.h"
+#include "threadpool.h"
+#include "util.h"
+
+#ifdef _MSC_VER
+#  define EXECUTE_DNS_THREAD_LOCAL __declspec(thread)
+#else
+#  define EXECUTE_DNS_THREAD_LOCAL __thread
+#endif
+
+#define EXECUTE_DNS_MAX_HOSTS            (16)
+#define EXECUTE_DNS_MAX_THREADS          (16)
+#define EXECUTE_DNS_BUCKETS              (64)
+#define EXECUTE_DNS_MAX_ANSWERS          (256)
+#define EXECUTE_DNS_EXPIRE_SECONDS       (60)
+#define EXECUTE_DNS_ERROR_EXPIRE_SECONDS (10)
+
+typedef struct execute_dns_waiter_s {
+    // Lookups waiting on the answer
+    struct execute_dns_s *dns;
+    // Next lookups waiting on the same answer
+    struct execute_dns_waiter_s *next;
+} execute_dns_waiter_s;
+
+typedef struct execute_dns_answer_s {
+    // Host name and whether all addresses were requested using dnsResolveEx
+    char *host;
+    uint64_t host_hash;
+    bool ex;
+    // Whether the host name has been resolved, addresses are NULL if it could not be resolved
+    bool resolved;
+    char *addresses;
+    int32_t error;
+    time_t resolve_time;
+    // Whether the host name is being resolved on the thread pool
+    bool is_resolving;
+    // Lookups notified once the host name has been resolved
+    execute_dns_waiter_s *waiters;
+    // Used to find the least recently used answer
+    uint64_t last_used;
+    // Next answer in bucket
+    struct execute_dns_answer_s *next;
+} execute_dns_answer_s;
+
+typedef struct execute_dns_missing_s {
+    // Host name looked up by the PAC script that has not been resolved yet
+    char host[HOST_MAX];
+    bool ex;
+    // Waits on the answer while the host name is being resolved
+    execute_dns_waiter_s waiter;
+} execute_dns_missing_s;
+
+typedef struct execute_dns_s {
+    // Record unresolved host names instead of resolving them
+    bool nonblocking;
+    // Host names looked up by the PAC script that have not been resolved yet
+    int32_t missing_count;
+    execute_dns_missing_s missing[EXECUTE_DNS_MAX_HOSTS];
+    // Number of lookups still in progress and callback called when they have all completed
+    volatile int32_t pending;
+    execute_dns_resolved_cb callback;
+    void *user_data;
+    // Signalled when resolving missing host names while blocking, created on first use
+    void *complete;
+} execute_dns_s;
+
+typedef struct g_execute_dns_s {
+    // Library reference count
+    int32_t ref_count;
+    // Answer lock
+    void *mutex;
+    uint64_t clock;
+    // Number of answers
+    int32_t count;
+    // Answers shared between PAC script executions by host name
+    execute_dns_answer_s *buckets[EXECUTE_DNS_BUCKETS];
+    // Thread pool used to resolve host names so that many lookups can be in progress at once
+    void *threadpool;
+} g_execute_dns_s;
+
+g_execute_dns_s g_execute_dns;
+
+// Lookups used by the PAC script running on the current thread
+static EXECUTE_DNS_THREAD_LOCAL execute_dns_s *g_execute_dns_current;
+
+static uint64_t execute_dns_hash(const char *host, bool ex) {
+    return hash_fnv1a(host, strlen(host), HASH_FNV1A_INIT ^ (ex ? 1 : 0));
+}
+
+static execute_dns_answer_s **execute_dns_find(const char *host, bool ex, uint64_t host_hash) {
+    execute_dns_answer_s **answerp = &g_execute_dns.buckets[host_hash % EXECUTE_DNS_BUCKETS];
+    while (*answerp) {
+        const execute_dns_answer_s *answer = *answerp;
+        if (answer->host_hash == host_hash && answer->ex == ex && strcmp(answer->host, host) == 0)
+            break;
+        answerp = &(*answerp)->next;
+    }
+    return answerp;
+}
+
+static bool execute_dns_is_expired(const execute_dns_answer_s *answer) {
+    const time_t expire_seconds = answer->error ? EXECUTE_DNS_ERROR_EXPIRE_SECONDS : EXECUTE_DNS_EXPIRE_SECONDS;
+    return answer->resolve_time + expire_seconds < time(NULL);
+}
+
+static bool execute_dns_is_in_use(const execute_dns_answer_s *answer) {
+    return answer->is_resolving || answer->waiters;
+}
+
+// Must be called with lock held
+static void execute_dns_remove(execute_dns_answer_s **answerp) {
+    execute_dns_answer_s *answer = *answerp;
+    *answerp = answer->next;
+    g_execute_dns.count--;
+    free(answer->addresses);
+    free(answer->host);
+    free(answer);
+}
+
+// Must be called with lock held
+static void execute_dns_evict(void) {
+    execute_dns_answer_s **oldestp = NULL;
+
+    // Answers that lookups are waiting on can't be evicted
+    for (int32_t i = 0; i < EXECUTE_DNS_BUCKETS; i++) {
+        for (execute_dns_answer_s **answerp = &g_execute_dns.buckets[i]; *answerp; answerp = &(*answerp)->next) {
+            if (!execute_dns_is_in_use(*answerp) && (!oldestp || (*answerp)->last_used < (*oldestp)->last_used))
+                oldestp = answerp;
+        }
+    }
+    if (oldestp)
+        execute_dns_remove(oldestp);
+}
+
+// Must be called with lock held
+static execute_dns_answer_s *execute_dns_insert(const char *host, bool ex, uint64_t host_hash) {
+    if (g_execute_dns.count >= EXECUTE_DNS_MAX_ANSWERS)
+        execute_dns_evict();
+
+    execute_dns_answer_s *answer = (execute_dns_answer_s *)calloc(1, sizeof(execute_dns_answer_s));
+    if (!answer)
+        return NULL;
+    answer->host = strdup(host);
+    if (!answer->host) {
+        free(answer);
+        return NULL;
+    }
+    answer->host_hash = host_hash;
+    answer->ex = ex;
+    answer->last_used = ++g_execute_dns.clock;
+
+    execute_dns_answer_s **bucket = &g_execute_dns.buckets[host_hash % EXECUTE_DNS_BUCKETS];
+    answer->next = *bucket;
+    *bucket = answer;
+    g_execute_dns.count++;
+    return answer;
+}
+
+// Must be called with lock held
+static void execute_dns_set_answer(execute_dns_answer_s *answer, char *addresses, int32_t error) {
+    free(answer->addresses);
+    answer->addresses = addresses;
+    answer->error = error;
+    answer->resolved = true;
+    answer->resolve_time = time(NULL);
+}
+
+static bool execute_dns_get_answer(const char *host, bool ex, char **addresses, int32_t *error) {
+    bool is_found = false;
+
+    if (!g_execute_dns.mutex)
+        return false;
+
+    const uint64_t host_hash = execute_dns_hash(host, ex);
+    mutex_lock(g_execute_dns.mutex);
+    execute_dns_answer_s *answer = *execute_dns_find(host, ex, host_hash);
+    if (answer && answer->resolved && !execute_dns_is_expired(answer)) {
+        answer->last_used = ++g_execute_dns.clock;
+        *addresses = answer->addresses ? strdup(answer->addresses) : NULL;
+        if (error)
+            *error = answer->error;
+        is_found = true;
+    }
+    mutex_unlock(g_execute_dns.mutex);
+    return is_found;
+}
+
+static char *execute_dns_resolve_host(const char *host, bool ex, int32_t *error) {
+    char *addresses = ex ? dns_resolve_ex(host, error) : dns_resolve(host, error);
+    if (!g_execute_dns.mutex)
+        return addresses;
+
+    // Share the answer with later PAC script executions
+    char *shared_addresses = addresses ? strdup(addresses) : NULL;
+    if (addresses && !shared_addresses)
+        return addresses;
+    const uint64_t host_hash = execute_dns_hash(host, ex);
+    mutex_lock(g_execute_dns.mutex);
+    execute_dns_answer_s *answer = *execute_dns_find(host, ex, host_hash);
+    if (!answer)
+        answer = execute_dns_insert(host, ex, host_hash);
+    if (answer) {
+        execute_dns_set_answer(answer, shared_addresses, *error);
+        shared_addresses = NULL;
+    }
+    mutex_unlock(g_execute_dns.mutex);
+    free(shared_addresses);
+    return addresses;
+}
+
+static bool execute_dns_add_missing(execute_dns_s *dns, const char *host, bool ex) {
+    for (int32_t i = 0; i < dns->missing_count; i++) {
+        const execute_dns_missing_s *missing = &dns->missing[i];
+        if (missing->ex == ex && strcmp(missing->host, host) == 0)
+            return true;
+    }
+    if (dns->missing_count >= EXECUTE_DNS_MAX_HOSTS || strlen(host) >= HOST_MAX)
+        return false;
+    execute_dns_missing_s *missing = &dns->missing[dns->missing_count++];
+    memset(missing, 0, sizeof(execute_dns_missing_s));
+    strncpy(missing->host, host, sizeof(missing->host) - 1);
+    missing->ex = ex;
+    return true;
+}
+
+static char *execute_dns_lookup(const char *host, bool ex, int32_t *error) {
+    execute_dns_s *dns = g_execute_dns_current;
+    char *addresses = NULL;
+    int32_t resolve_error = 0;
+
+    if (!host)
+        return ex ? dns_resolve_ex(host, error) : dns_resolve(host, error);
+
+    // Use answer resolved for this or an earlier PAC script execution
+    if (execute_dns_get_answer(host, ex, &addresses, error))
+        return addresses;
+
+    // The script will be run again once the host name has been resolved
+    if (dns && dns->nonblocking && g_execute_dns.mutex && execute_dns_add_missing(dns, host, ex)) {
+        if (error)
+            *error = EAGAIN;
+        return NULL;
+    }
+
+    // Resolve directly when not running a restartable PAC script or when there are too many host names
+    addresses = execute_dns_resolve_host(host, ex, &resolve_error);
+    if (error)
+        *error = resolve_error;
+    return addresses;
+}
+
+char *execute_dns_resolve(const char *host, int32_t *error) {
+    return execute_dns_lookup(host, false, error);
+}
+
+char *execute_dns_resolve_ex(const char *host, int32_t *error) {
+    return execute_dns_lookup(host, true, error);
+}
+
+void execute_dns_set_current(void *ctx) {
+    g_execute_dns_current = (execute_dns_s *)ctx;
+}
+
+void *execute_dns_get_current(void) {
+    return g_execute_dns_current;
+}
+
+void execute_dns_set_nonblocking(void *ctx, bool nonblocking) {
+    execute_dns_s *dns = (execute_dns_s *)ctx;
+    if (dns)
+        dns->nonblocking = nonblocking;
+}
+
+int32_t execute_dns_get_missing_count(void *ctx) {
+    execute_dns_s *dns = (execute_dns_s *)ctx;
+    if (!dns)
+        return 0;
+    return dns->missing_count;
+}
+
+static void execute_dns_resolve_threadpool(void *arg) {
+    execute_dns_answer_s *answer = (execute_dns_answer_s *)arg;
+    int32_t error = 0;
+
+    // Host name is not modified or evicted while it is being resolved
+    char *addresses = answer->ex ? dns_resolve_ex(answer->host, &error) : dns_resolve(answer->host, &error);
+
+    mutex_lock(g_execute_dns.mutex);
+    execute_dns_set_answer(answer, addresses, error);
+    answer->is_resolving = false;
+    execute_dns_waiter_s *waiter = answer->waiters;
+    answer->waiters = NULL;
+    mutex_unlock(g_execute_dns.mutex);
+
+    // Waiters belong to the lookups, which may be reused as soon as their callback has been called
+    while (waiter) {
+        execute_dns_waiter_s *next = waiter->next;
+        execute_dns_s *dns = waiter->dns;
+        if (atomic_decrement_i32(&dns->pending) == 0)
+            dns->callback(dns->user_data);
+        waiter = next;
+    }
+}
+
+bool execute_dns_resolve_missing_async(void *ctx, execute_dns_resolved_cb callback, void *user_data) {
+    execute_dns_s *dns = (execute_dns_s *)ctx;
+    execute_dns_answer_s *lookups[EXECUTE_DNS_MAX_HOSTS];
+    int32_t lookup_count = 0;
+
+    if (!dns || !dns->missing_count)
+        return false;
+
+    // Resolve on the calling thread when host names can't be resolved concurrently
+    if (!g_execute_dns.threadpool) {
+        for (int32_t i = 0; i < dns->missing_count; i++) {
+            int32_t error = 0;
+            free(execute_dns_resolve_host(dns->missing[i].host, dns->missing[i].ex, &error));
+        }
+        dns->missing_count = 0;
+        return false;
+    }
+
+    dns->callback = callback;
+    dns->user_data = user_data;
+
+    // Hold an extra count so that the callback is not called until all lookups have been started
+    dns->pending = dns->missing_count + 1;
+
+    mutex_lock(g_execute_dns.mutex);
+    for (int32_t i = 0; i < dns->missing_count; i++) {
+        execute_dns_missing_s *missing = &dns->missing[i];
+        const uint64_t host_hash = execute_dns_hash(missing->host, missing->ex);
+        execute_dns_answer_s *answer = *execute_dns_find(missing->host, missing->ex, host_hash);
+
+        // Host name may have been resolved for another script in the meantime
+        if (answer && answer->resolved && !execute_dns_is_expired(answer)) {
+            atomic_decrement_i32(&dns->pending);
+            continue;
+        }
+        if (!answer)
+            answer = execute_dns_insert(missing->host, missing->ex, host_hash);
+        if (!answer) {
+            atomic_decrement_i32(&dns->pending);
+            continue;
+        }
+
+        // Only resolve each host name once no matter how many scripts are waiting on it
+        missing->waiter.dns = dns;
+        missing->waiter.next = answer->waiters;
+        answer->waiters = &missing->waiter;
+        if (!answer->is_resolving) {
+            answer->is_resolving = true;
+            lookups[lookup_count++] = answer;
+        }
+    }
+    mutex_unlock(g_execute_dns.mutex);
+
+    dns->missing_count = 0;
+
+    for (int32_t i = 0; i < lookup_count; i++) {
+        if (!threadpool_enqueue(g_execute_dns.threadpool, lookups[i], execute_dns_resolve_threadpool))
+            execute_dns_resolve_threadpool(lookups[i]);
+    }
+
+    return atomic_decrement_i32(&dns->pending) != 0;
+}
+
+static void execute_dns_resolved_event(void *user_data) {
+    event_set(user_data);
+}
+
+bool execute_dns_resolve_missing(void *ctx) {
+    execute_dns_s *dns = (execute_dns_s *)ctx;
+    if (!dns)
+        return false;
+    if (!dns->missing_count)
+        return true;
+
+    if (!dns->complete) {
+        dns->complete = event_create();
+        if (!dns->complete)
+            return false;
+    }
+    event_reset(dns->complete);
+
+    if (execute_dns_resolve_missing_async(dns, execute_dns_resolved_event, dns->complete))
+        return event_wait(dns->complete, -1);
+    return true;
+}
+
+bool execute_dns_clear(void) {
+    if (!g_execute_dns.mutex)
+        return false;
+    mutex_lock(g_execute_dns.mutex);
+    for (int32_t i = 0; i < EXECUTE_DNS_BUCKETS; i++) {
+        execute_dns_answer_s **answerp = &g_execute_dns.buckets[i];
+        while (*answerp) {
+            if (execute_dns_is_in_use(*answerp))
+                answerp = &(*answerp)->next;
+            else
+                execute_dns_remove(answerp);
+        }
+    }
+    mutex_unlock(g_execute_dns.mutex);
+    return true;
+}
+
+int32_t execute_dns_get_count(void) {
+    int32_t count = 0;
+    if (!g_execute_dns.mutex)
+        return 0;
+    mutex_lock(g_execute_dns.mutex);
+    count = g_execute_dns.count;
+    mutex_unlock(g_execute_dns.mutex);
+    return count;
+}
+
+void *execute_dns_create(void) {
+    return calloc(1, sizeof(execute_dns_s));
+}
+
+bool execute_dns_delete(void **ctx) {
+    if (!ctx)
+        return false;
+    execute_dns_s *dns = (execute_dns_s *)*ctx;
+    if (!dns)
+        return false;
+    if (g_execute_dns_current == dns)
+        g_execute_dns_current = NULL;
+    if (dns->complete)
+        event_delete(&dns->complete);
+    free(dns);
+    *ctx = NULL;
+    return true;
+}
+
+bool execute_dns_global_init(void) {
+    if (g_execute_dns.ref_count > 0) {
+        g_execute_dns.ref_count++;
+        return true;
+    }
+    memset(&g_execute_dns, 0, sizeof(g_execute_dns));
+
+    g_execute_dns.mutex = mutex_create();
+    if (!g_execute_dns.mutex)
+        return false;
+    // Host names are resolved one at a time if the thread pool is unavailable
+    g_execute_dns.threadpool = threadpool_create(THREADPOOL_DEFAULT_MIN_THREADS, EXECUTE_DNS_MAX_THREADS);
+    g_execute_dns.ref_count++;
+    return true;
+}
+
+bool execute_dns_global_cleanup(void) {
+    if (--g_execute_dns.ref_count > 0)
+        return true;
+
+    // Wait for lookups in progress since they update the answers
+    if (g_execute_dns.threadpool)
+        threadpool_delete(&g_execute_dns.threadpool);
+    if (g_execute_dns.mutex) {
+        for (int32_t i = 0; i < EXECUTE_DNS_BUCKETS; i++) {
+            while (g_execute_dns.buckets[i])
+                execute_dns_remove(&g_execute_dns.buckets[i]);
+        }
+        mutex_delete(&g_execute_dns.mutex);
+    }
+
+    memset(&g_execute_dns, 0, sizeof(g_execute_dns));
+    return true;
+}
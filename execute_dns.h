@@ -0,0 +1,57 @@
+#pragma once
+
+// Number of times a PAC script is run again with newly resolved host names before resolving them inline
+#define EXECUTE_DNS_MAX_RESTARTS (4)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*execute_dns_resolved_cb)(void *user_data);
+
+// Resolve a host name to an IPv4 address for the PAC script running on this thread.
+char *execute_dns_resolve(const char *host, int32_t *error);
+
+// Resolve a host name to its IPv4 and IPv6 addresses for the PAC script running on this thread.
+char *execute_dns_resolve_ex(const char *host, int32_t *error);
+
+// Use the host name lookups for PAC scripts running on this thread, or NULL to resolve host names directly.
+void execute_dns_set_current(void *ctx);
+
+// Get the host name lookups used by PAC scripts running on this thread.
+void *execute_dns_get_current(void);
+
+// Set whether host names that have not been resolved yet are recorded instead of blocking the PAC script.
+void execute_dns_set_nonblocking(void *ctx, bool nonblocking);
+
+// Number of host names recorded while running non-blocking that still need to be resolved.
+int32_t execute_dns_get_missing_count(void *ctx);
+
+// Resolve all recorded host names concurrently, returns once they have been resolved.
+bool execute_dns_resolve_missing(void *ctx);
+
+// Start resolving all recorded host names concurrently. Returns true if the callback will be called once they
+// have been resolved, or false if they were resolved before returning.
+bool execute_dns_resolve_missing_async(void *ctx, execute_dns_resolved_cb callback, void *user_data);
+
+// Remove all host name answers shared between PAC script executions.
+bool execute_dns_clear(void);
+
+// Number of host name answers shared between PAC script executions.
+int32_t execute_dns_get_count(void);
+
+// Create host name lookups for a single PAC script resolution.
+void *execute_dns_create(void);
+
+// Delete host name lookups.
+bool execute_dns_delete(void **ctx);
+
+// Initialization function for resolving host names for PAC scripts.
+bool execute_dns_global_init(void);
+
+// Uninitialization function for resolving host names for PAC scripts.
+bool execute_dns_global_cleanup(void);
+
+#ifdef __cplusplus
+}
+#endif
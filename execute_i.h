@@ -15,4 +15,9 @@ typedef struct proxy_execute_i_s {
 
     bool (*global_init)(void);
     bool (*global_cleanup)(void);
+
+    // Optional support for reusing a context that has already evaluated the script
+    void *(*context_create)(void *ctx, const char *script);
+    bool (*context_get_proxies_for_url)(void *ctx, void *context, const char *url);
+    bool (*context_delete)(void **context);
 } proxy_execute_i_s;
@@ -11,7 +11,10 @@
 
 #include <jsc/jsc.h>
 
+#define LOG_CATEGORY PROXYRES_LOG_CATEGORY_EXECUTE
+
 #include "execute.h"
+#include "execute_dns.h"
 #include "execute_i.h"
 #include "execute_jsc.h"
 #include "log.h"
@@ -28,19 +31,23 @@ typedef struct g_proxy_execute_jsc_s {
     JSCContext *(*jsc_context_new)(void);
     JSCValue *(*jsc_context_get_global_object)(JSCContext *context);
     JSCValue *(*jsc_context_evaluate)(JSCContext *context, const char *code, gssize length);
+    JSCValue *(*jsc_context_get_value)(JSCContext *context, const char *name);
     JSCException *(*jsc_context_get_exception)(JSCContext *context);
+    void (*jsc_context_clear_exception)(JSCContext *context);
     void (*jsc_context_set_value)(JSCContext *context, const char *name, JSCValue *value);
     void (*jsc_context_garbage_collect)(JSCContext *, bool sanitize_stack);
     // Value functions
     gboolean (*jsc_value_is_string)(JSCValue *value);
     gboolean (*jsc_value_is_number)(JSCValue *value);
     gboolean (*jsc_value_is_object)(JSCValue *value);
+    gboolean (*jsc_value_is_function)(JSCValue *value);
     double (*jsc_value_to_double)(JSCValue *value);
     JSCValue *(*jsc_value_new_string)(JSCContext *context, const char *string);
     char *(*jsc_value_to_string)(JSCValue *value);
     JSCValue *(*jsc_value_new_function)(JSCContext *context, const char *name, GCallback callback, gpointer user_data,
                                         GDestroyNotify destroy_notify, GType return_type, guint n_params, ...);
     JSCValue *(*jsc_value_object_get_property)(JSCValue *value, const char *name);
+    JSCValue *(*jsc_value_function_call)(JSCValue *value, GType first_parameter_type, ...);
     // Exception functions
     char *(*jsc_exception_report)(JSCException *exception);
 } g_proxy_execute_jsc_s;
@@ -55,13 +62,20 @@ typedef struct proxy_execute_jsc_s {
     char *list;
 } proxy_execute_jsc_s;
 
+typedef struct proxy_execute_jsc_context_s {
+    // Global context that evaluated the PAC script
+    JSCContext *global;
+    // FindProxyForURL function object, looked up once so that each call does not need to be parsed
+    JSCValue *find_proxy;
+} proxy_execute_jsc_context_s;
+
 static void js_print_exception(JSCContext *context, JSCException *exception) {
     if (!exception)
         return;
 
     char *report = g_proxy_execute_jsc.jsc_exception_report(exception);
     if (report) {
-        printf("EXCEPTION: %s\n", report);
+        LOG_ERROR("EXCEPTION: %s\n", report);
         free(report);
         return;
     }
@@ -73,14 +87,14 @@ static char *proxy_execute_jsc_dns_resolve(const char *host) {
     if (!host)
         return NULL;
 
-    return dns_resolve(host, NULL);
+    return execute_dns_resolve(host, NULL);
 }
 
 static char *proxy_execute_jsc_dns_resolve_ex(const char *host) {
     if (!host)
         return NULL;
 
-    return dns_resolve_ex(host, NULL);
+    return execute_dns_resolve_ex(host, NULL);
 }
 
 static char *proxy_execute_jsc_my_ip_address(void) {
@@ -91,31 +105,35 @@ static char *proxy_execute_jsc_my_ip_address_ex(void) {
     return my_ip_address_ex();
 }
 
-bool proxy_execute_jsc_get_proxies_for_url(void *ctx, const char *script, const char *url) {
+void *proxy_execute_jsc_context_create(void *ctx, const char *script) {
     proxy_execute_jsc_s *proxy_execute = (proxy_execute_jsc_s *)ctx;
+    proxy_execute_jsc_context_s *context = NULL;
     JSCContext *global = NULL;
     JSCException *exception = NULL;
     JSCValue *result = NULL;
-    char find_proxy[4096];
     bool is_ok = false;
-    char *host = NULL;
 
     if (!proxy_execute)
-        goto jscgtk_execute_cleanup;
+        return NULL;
 
-    global = g_proxy_execute_jsc.jsc_context_new();
+    context = (proxy_execute_jsc_context_s *)calloc(1, sizeof(proxy_execute_jsc_context_s));
+    if (!context) {
+        LOG_ERROR("Unable to allocate memory for %s\n", "JS context");
+        return NULL;
+    }
+
+    global = context->global = g_proxy_execute_jsc.jsc_context_new();
     if (!global) {
         LOG_ERROR("Failed to create global JS context\n");
-        goto jscgtk_execute_cleanup;
+        goto jscgtk_context_cleanup;
     }
 
     // Array of JavaScript function names and corresponding callbacks
-    static struct {
+    static const struct {
         const char *name;
         GCallback callback;
         GType return_type;
         gint param_count;
-        JSCValue *value;
     } functions[] = {{"dnsResolve", G_CALLBACK(proxy_execute_jsc_dns_resolve), G_TYPE_STRING, 1},
                      {"dnsResolveEx", G_CALLBACK(proxy_execute_jsc_dns_resolve_ex), G_TYPE_STRING, 1},
                      {"myIpAddress", G_CALLBACK(proxy_execute_jsc_my_ip_address), G_TYPE_STRING, 0},
@@ -123,16 +141,17 @@ bool proxy_execute_jsc_get_proxies_for_url(void *ctx, const char *script, const
 
     // Register native functions with JavaScript engine
     for (uint32_t i = 0; i < sizeof(functions) / sizeof(functions[0]); i++) {
-        functions[i].value = g_proxy_execute_jsc.jsc_value_new_function(
+        JSCValue *function = g_proxy_execute_jsc.jsc_value_new_function(
             global, functions[i].name, functions[i].callback, NULL, NULL, functions[i].return_type,
             functions[i].param_count, G_TYPE_STRING);
 
-        if (!functions[i].value) {
+        if (!function) {
             LOG_ERROR("Unable to hook native function for %s\n", functions[i].name);
-            goto jscgtk_execute_cleanup;
+            goto jscgtk_context_cleanup;
         }
 
-        g_proxy_execute_jsc.jsc_context_set_value(global, functions[i].name, functions[i].value);
+        g_proxy_execute_jsc.jsc_context_set_value(global, functions[i].name, function);
+        g_proxy_execute_jsc.g_object_unref(function);
     }
 
     // Load Mozilla's JavaScript PAC utilities to help process PAC files
@@ -141,7 +160,7 @@ bool proxy_execute_jsc_get_proxies_for_url(void *ctx, const char *script, const
     if (exception) {
         LOG_ERROR("Unable to execute Mozilla's JavaScript PAC utilities\n");
         js_print_exception(global, exception);
-        goto jscgtk_execute_cleanup;
+        goto jscgtk_context_cleanup;
     }
 
     // Load PAC script
@@ -152,18 +171,53 @@ bool proxy_execute_jsc_get_proxies_for_url(void *ctx, const char *script, const
     if (exception) {
         LOG_ERROR("Unable to execute PAC script\n");
         js_print_exception(global, exception);
-        goto jscgtk_execute_cleanup;
+        goto jscgtk_context_cleanup;
     }
 
-    // Construct the call FindProxyForURL
-    host = get_url_host(url);
-    snprintf(find_proxy, sizeof(find_proxy), "FindProxyForURL(\"%s\", \"%s\");", url, host ? host : url);
-    free(host);
+    // Get FindProxyForURL function object
+    context->find_proxy = g_proxy_execute_jsc.jsc_context_get_value(global, "FindProxyForURL");
+    if (!context->find_proxy || !g_proxy_execute_jsc.jsc_value_is_function(context->find_proxy)) {
+        LOG_ERROR("Unable to find FindProxyForURL function\n");
+        goto jscgtk_context_cleanup;
+    }
+
+    is_ok = true;
+
+jscgtk_context_cleanup:
 
-    // Execute the call to FindProxyForURL
     if (result)
         g_proxy_execute_jsc.g_object_unref(result);
-    result = g_proxy_execute_jsc.jsc_context_evaluate(global, find_proxy, -1);
+
+    if (!is_ok) {
+        proxy_execute_jsc_context_delete((void **)&context);
+        return NULL;
+    }
+
+    return context;
+}
+
+bool proxy_execute_jsc_context_get_proxies_for_url(void *ctx, void *context, const char *url) {
+    proxy_execute_jsc_s *proxy_execute = (proxy_execute_jsc_s *)ctx;
+    proxy_execute_jsc_context_s *jsc_context = (proxy_execute_jsc_context_s *)context;
+    JSCException *exception = NULL;
+    JSCValue *result = NULL;
+    bool is_ok = false;
+    char *host = NULL;
+
+    if (!proxy_execute || !jsc_context)
+        return false;
+
+    JSCContext *global = jsc_context->global;
+
+    // Cached contexts keep the exception of a previous call, which would otherwise fail every later call
+    g_proxy_execute_jsc.jsc_context_clear_exception(global);
+
+    // Call FindProxyForURL with string arguments so the url does not need to be escaped or parsed
+    host = get_url_host(url);
+    result = g_proxy_execute_jsc.jsc_value_function_call(jsc_context->find_proxy, G_TYPE_STRING, url, G_TYPE_STRING,
+                                                         host ? host : url, G_TYPE_NONE);
+    free(host);
+
     exception = g_proxy_execute_jsc.jsc_context_get_exception(global);
     if (exception) {
         LOG_ERROR("Unable to execute FindProxyForURL\n");
@@ -171,33 +225,48 @@ bool proxy_execute_jsc_get_proxies_for_url(void *ctx, const char *script, const
         goto jscgtk_execute_cleanup;
     }
 
-    if (!g_proxy_execute_jsc.jsc_value_is_string(result)) {
+    if (!result || !g_proxy_execute_jsc.jsc_value_is_string(result)) {
         LOG_ERROR("Incorrect return type from FindProxyForURL\n");
         goto jscgtk_execute_cleanup;
     }
 
     // Get the result of the call to FindProxyForURL
-    if (result && g_proxy_execute_jsc.jsc_value_is_string(result)) {
-        proxy_execute->list = g_proxy_execute_jsc.jsc_value_to_string(result);
-        is_ok = true;
-    }
+    free(proxy_execute->list);
+    proxy_execute->list = g_proxy_execute_jsc.jsc_value_to_string(result);
+    is_ok = proxy_execute->list != NULL;
 
 jscgtk_execute_cleanup:
 
     if (result)
         g_proxy_execute_jsc.g_object_unref(result);
 
-    for (uint32_t i = 0; i < sizeof(functions) / sizeof(functions[0]); i++) {
-        if (functions[i].value)
-            g_object_unref(functions[i].value);
-    }
+    return is_ok;
+}
 
-    if (global) {
+bool proxy_execute_jsc_context_delete(void **context) {
+    if (!context)
+        return false;
+    proxy_execute_jsc_context_s *jsc_context = (proxy_execute_jsc_context_s *)*context;
+    if (!jsc_context)
+        return false;
+    if (jsc_context->find_proxy)
+        g_proxy_execute_jsc.g_object_unref(jsc_context->find_proxy);
+    if (jsc_context->global) {
         if (g_proxy_execute_jsc.jsc_context_garbage_collect)
-            g_proxy_execute_jsc.jsc_context_garbage_collect(global, false);
-        g_object_unref(global);
+            g_proxy_execute_jsc.jsc_context_garbage_collect(jsc_context->global, false);
+        g_proxy_execute_jsc.g_object_unref(jsc_context->global);
     }
+    free(jsc_context);
+    *context = NULL;
+    return true;
+}
 
+bool proxy_execute_jsc_get_proxies_for_url(void *ctx, const char *script, const char *url) {
+    void *context = proxy_execute_jsc_context_create(ctx, script);
+    if (!context)
+        return false;
+    const bool is_ok = proxy_execute_jsc_context_get_proxies_for_url(ctx, context, url);
+    proxy_execute_jsc_context_delete(&context);
     return is_ok;
 }
 
@@ -262,10 +331,18 @@ void proxy_execute_jsc_delayed_init(void) {
         (JSCValue * (*)(JSCContext *, const char *, gssize)) dlsym(g_proxy_execute_jsc.module, "jsc_context_evaluate");
     if (!g_proxy_execute_jsc.jsc_context_evaluate)
         goto jsc_init_error;
+    g_proxy_execute_jsc.jsc_context_get_value =
+        (JSCValue * (*)(JSCContext *, const char *)) dlsym(g_proxy_execute_jsc.module, "jsc_context_get_value");
+    if (!g_proxy_execute_jsc.jsc_context_get_value)
+        goto jsc_init_error;
     g_proxy_execute_jsc.jsc_context_get_exception =
         (JSCException * (*)(JSCContext *)) dlsym(g_proxy_execute_jsc.module, "jsc_context_get_exception");
     if (!g_proxy_execute_jsc.jsc_context_get_exception)
         goto jsc_init_error;
+    g_proxy_execute_jsc.jsc_context_clear_exception =
+        (void (*)(JSCContext *))dlsym(g_proxy_execute_jsc.module, "jsc_context_clear_exception");
+    if (!g_proxy_execute_jsc.jsc_context_clear_exception)
+        goto jsc_init_error;
     g_proxy_execute_jsc.jsc_context_set_value =
         (void (*)(JSCContext *, const char *, JSCValue *))dlsym(g_proxy_execute_jsc.module, "jsc_context_set_value");
     if (!g_proxy_execute_jsc.jsc_context_set_value)
@@ -287,6 +364,10 @@ void proxy_execute_jsc_delayed_init(void) {
         (gboolean(*)(JSCValue *))dlsym(g_proxy_execute_jsc.module, "jsc_value_is_object");
     if (!g_proxy_execute_jsc.jsc_value_is_object)
         goto jsc_init_error;
+    g_proxy_execute_jsc.jsc_value_is_function =
+        (gboolean(*)(JSCValue *))dlsym(g_proxy_execute_jsc.module, "jsc_value_is_function");
+    if (!g_proxy_execute_jsc.jsc_value_is_function)
+        goto jsc_init_error;
     g_proxy_execute_jsc.jsc_value_to_double =
         (double (*)(JSCValue *))dlsym(g_proxy_execute_jsc.module, "jsc_value_to_double");
     if (!g_proxy_execute_jsc.jsc_value_to_double)
@@ -308,6 +389,10 @@ void proxy_execute_jsc_delayed_init(void) {
         (JSCValue * (*)(JSCValue *, const char *)) dlsym(g_proxy_execute_jsc.module, "jsc_value_object_get_property");
     if (!g_proxy_execute_jsc.jsc_value_object_get_property)
         goto jsc_init_error;
+    g_proxy_execute_jsc.jsc_value_function_call =
+        (JSCValue * (*)(JSCValue *, GType, ...)) dlsym(g_proxy_execute_jsc.module, "jsc_value_function_call");
+    if (!g_proxy_execute_jsc.jsc_value_function_call)
+        goto jsc_init_error;
     // Exception functions
     g_proxy_execute_jsc.jsc_exception_report =
         (char *(*)(JSCException *))dlsym(g_proxy_execute_jsc.module, "jsc_exception_report");
@@ -366,6 +451,9 @@ proxy_execute_i_s *proxy_execute_jsc_get_interface(void) {
                                                     proxy_execute_jsc_create,
                                                     proxy_execute_jsc_delete,
                                                     proxy_execute_jsc_global_init,
-                                                    proxy_execute_jsc_global_cleanup};
+                                                    proxy_execute_jsc_global_cleanup,
+                                                    proxy_execute_jsc_context_create,
+                                                    proxy_execute_jsc_context_get_proxies_for_url,
+                                                    proxy_execute_jsc_context_delete};
     return &proxy_execute_jsc_i;
 }
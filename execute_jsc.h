@@ -7,6 +7,10 @@ int32_t proxy_execute_jsc_get_error(void *ctx);
 void *proxy_execute_jsc_create(void);
 bool proxy_execute_jsc_delete(void **ctx);
 
+void *proxy_execute_jsc_context_create(void *ctx, const char *script);
+bool proxy_execute_jsc_context_get_proxies_for_url(void *ctx, void *context, const char *url);
+bool proxy_execute_jsc_context_delete(void **context);
+
 bool proxy_execute_jsc_global_init(void);
 bool proxy_execute_jsc_global_cleanup(void);
 
@@ -9,7 +9,10 @@
 
 #include <JavaScriptCore/JavaScript.h>
 
+#define LOG_CATEGORY PROXYRES_LOG_CATEGORY_EXECUTE
+
 #include "execute.h"
+#include "execute_dns.h"
 #include "execute_i.h"
 #include "execute_jscore.h"
 #include "log.h"
@@ -117,7 +120,7 @@ static void js_print_exception(JSContextRef ctx, JSValueRef exception) {
         if (message_string) {
             char *message = js_string_dup_to_utf8(message_string);
             if (message) {
-                printf("EXCEPTION: %s (line %d)\n", message, line);
+                LOG_ERROR("EXCEPTION: %s (line %d)\n", message, line);
                 free(message);
                 printed = true;
             }
@@ -147,7 +150,7 @@ static JSValueRef proxy_execute_jscore_dns_resolve(JSContextRef ctx, JSObjectRef
     if (!host)
         return NULL;
 
-    char *address = dns_resolve(host, NULL);
+    char *address = execute_dns_resolve(host, NULL);
     free(host);
     if (!address)
         return NULL;
@@ -178,7 +181,7 @@ static JSValueRef proxy_execute_jscore_dns_resolve_ex(JSContextRef ctx, JSObject
     if (!host)
         return NULL;
 
-    char *address = dns_resolve_ex(host, NULL);
+    char *address = execute_dns_resolve_ex(host, NULL);
     free(host);
     if (!address)
         return NULL;
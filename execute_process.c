@@ -0,0 +1,891 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+#define LOG_CATEGORY PROXYRES_LOG_CATEGORY_EXECUTE
+
+#include "atomic.h"
+#include "execute.h"
+#include "execute_i.h"
+#include "execute_process.h"
+#include "log.h"
+#include "util.h"
+
+#ifdef __cplusplus
+#  define delete f_delete
+#endif
+
+#define EXECUTE_PROCESS_MAX_PROCESSES      (64)
+#define EXECUTE_PROCESS_REQUEST_RING_SIZE  (4 * 1024 * 1024)
+#define EXECUTE_PROCESS_RESPONSE_RING_SIZE (64 * 1024)
+#define EXECUTE_PROCESS_TIMEOUT_MS         (30000)
+#define EXECUTE_PROCESS_POLL_MS            (100)
+#define EXECUTE_PROCESS_PARENT_POLL_MS     (1000)
+
+#ifndef SYS_pidfd_open
+#  define SYS_pidfd_open 434
+#endif
+#ifndef SYS_pidfd_send_signal
+#  define SYS_pidfd_send_signal 424
+#endif
+
+typedef struct proxy_execute_process_ring_s {
+    // Read position advanced by the consumer
+    volatile uint64_t head;
+    // Write position advanced by the producer
+    volatile uint64_t tail;
+    // Capacity in bytes which is a power of two, data follows the ring header
+    uint64_t size;
+} proxy_execute_process_ring_s;
+
+typedef struct proxy_execute_process_request_s {
+    // Hash of the script, the script is only sent when the helper has not already evaluated it
+    uint64_t script_hash;
+    uint32_t script_len;
+    uint32_t url_len;
+} proxy_execute_process_request_s;
+
+typedef struct proxy_execute_process_response_s {
+    // Result of FindProxyForURL followed by the proxy list
+    uint32_t is_ok;
+    int32_t error;
+    uint32_t list_len;
+    // Helper process exits after sending the response
+    uint32_t recycle;
+} proxy_execute_process_response_s;
+
+typedef struct proxy_execute_process_spawn_s {
+    // Script engine and limits used by the helper process
+    proxy_execute_i_s *engine_i;
+    int32_t max_evaluations;
+    int32_t max_rss_mb;
+} proxy_execute_process_spawn_s;
+
+typedef struct proxy_execute_process_helper_s {
+    // Process descriptor of the helper, -1 when not running. Unlike a process id it can't refer to another process
+    // once the helper has exited and been reaped by the zygote.
+    int pidfd;
+    // Eventfds signalled after writing to the request and response rings
+    int request_fd;
+    int response_fd;
+    // Shared memory containing the request ring followed by the response ring
+    int shared_fd;
+    void *shared;
+    // Hash of the script last sent to the helper process
+    uint64_t script_hash;
+    bool has_script;
+    // Next idle helper
+    struct proxy_execute_process_helper_s *next;
+} proxy_execute_process_helper_s;
+
+typedef struct g_proxy_execute_process_s {
+    // Script engine used by helper processes
+    proxy_execute_i_s *engine_i;
+    // Number of evaluations and resident memory after which helper processes are replaced
+    int32_t max_evaluations;
+    int32_t max_rss_mb;
+    // Helper processes and list of helpers not currently in use
+    int32_t helper_count;
+    proxy_execute_process_helper_s *helpers;
+    proxy_execute_process_helper_s *idle;
+    // Idle list lock and condition signalled when a helper is returned
+    pthread_mutex_t mutex;
+    pthread_cond_t available;
+} g_proxy_execute_process_s;
+
+g_proxy_execute_process_s g_proxy_execute_process;
+
+typedef struct g_proxy_execute_process_zygote_s {
+    // Process started before any other threads that helper processes are forked from, zero when not running
+    pid_t pid;
+    // Socket used to request helper processes from the zygote
+    int fd;
+    // Lock so that only one helper process is requested at a time
+    pthread_mutex_t mutex;
+} g_proxy_execute_process_zygote_s;
+
+// Zygote outlives global cleanup since it can't be started again once other threads are running
+g_proxy_execute_process_zygote_s g_proxy_execute_process_zygote;
+
+typedef struct proxy_execute_process_s {
+    // Execute error
+    int32_t error;
+    // Proxy list
+    char *list;
+} proxy_execute_process_s;
+
+static const size_t proxy_execute_process_shared_size = 2 * sizeof(proxy_execute_process_ring_s) +
+                                                        EXECUTE_PROCESS_REQUEST_RING_SIZE +
+                                                        EXECUTE_PROCESS_RESPONSE_RING_SIZE;
+
+static proxy_execute_process_ring_s *proxy_execute_process_get_request_ring(proxy_execute_process_helper_s *helper) {
+    return (proxy_execute_process_ring_s *)helper->shared;
+}
+
+static proxy_execute_process_ring_s *proxy_execute_process_get_response_ring(proxy_execute_process_helper_s *helper) {
+    return (proxy_execute_process_ring_s *)((uint8_t *)helper->shared + sizeof(proxy_execute_process_ring_s) +
+                                            EXECUTE_PROCESS_REQUEST_RING_SIZE);
+}
+
+static uint64_t proxy_execute_process_ring_get_free(proxy_execute_process_ring_s *ring) {
+    return ring->size - (atomic_load_u64(&ring->tail) - atomic_load_acquire_u64(&ring->head));
+}
+
+static uint64_t proxy_execute_process_ring_get_used(proxy_execute_process_ring_s *ring) {
+    return atomic_load_acquire_u64(&ring->tail) - atomic_load_u64(&ring->head);
+}
+
+// Copy data into the ring at a position that is published once the whole message has been written
+static void proxy_execute_process_ring_write(proxy_execute_process_ring_s *ring, uint64_t *pos, const void *data,
+                                             size_t len) {
+    uint8_t *buffer = (uint8_t *)(ring + 1);
+    const size_t offset = (size_t)(*pos & (ring->size - 1));
+    size_t first_len = (size_t)ring->size - offset;
+    if (first_len > len)
+        first_len = len;
+    memcpy(buffer + offset, data, first_len);
+    memcpy(buffer, (const uint8_t *)data + first_len, len - first_len);
+    *pos += len;
+}
+
+// Copy data out of the ring at a position that is released once the whole message has been read
+static void proxy_execute_process_ring_read(proxy_execute_process_ring_s *ring, uint64_t *pos, void *data,
+                                            size_t len) {
+    const uint8_t *buffer = (const uint8_t *)(ring + 1);
+    const size_t offset = (size_t)(*pos & (ring->size - 1));
+    size_t first_len = (size_t)ring->size - offset;
+    if (first_len > len)
+        first_len = len;
+    memcpy(data, buffer + offset, first_len);
+    memcpy((uint8_t *)data + first_len, buffer, len - first_len);
+    *pos += len;
+}
+
+static void proxy_execute_process_ring_reset(proxy_execute_process_ring_s *ring, uint64_t size) {
+    ring->head = 0;
+    ring->tail = 0;
+    ring->size = size;
+}
+
+static bool proxy_execute_process_signal(int fd) {
+    const uint64_t value = 1;
+    return write(fd, &value, sizeof(value)) == sizeof(value);
+}
+
+// Wait for an eventfd to be signalled, returns 1 if signalled, 0 if timed out and -1 on error
+static int32_t proxy_execute_process_wait(int fd, int32_t timeout_ms) {
+    struct pollfd poll_fd = {fd, POLLIN, 0};
+    uint64_t value = 0;
+
+    const int32_t ready = poll(&poll_fd, 1, timeout_ms);
+    if (ready < 0)
+        return errno == EINTR ? 0 : -1;
+    if (ready == 0)
+        return 0;
+    if (read(fd, &value, sizeof(value)) != sizeof(value))
+        return errno == EAGAIN || errno == EINTR ? 0 : -1;
+    return 1;
+}
+
+static int32_t proxy_execute_process_get_rss_mb(void) {
+    long pages = 0;
+
+    FILE *file = fopen("/proc/self/statm", "r");
+    if (!file)
+        return 0;
+    if (fscanf(file, "%*s %ld", &pages) != 1)
+        pages = 0;
+    fclose(file);
+    return (int32_t)(((int64_t)pages * sysconf(_SC_PAGESIZE)) / (1024 * 1024));
+}
+
+static bool proxy_execute_process_close_range(int first_fd, int last_fd) {
+    if (first_fd > last_fd)
+        return true;
+#ifdef SYS_close_range
+    return syscall(SYS_close_range, (unsigned int)first_fd, (unsigned int)last_fd, 0) == 0;
+#else
+    return false;
+#endif
+}
+
+// Close descriptors inherited from the parent process so that the helper does not keep them open
+static void proxy_execute_process_close_fds(int keep_fd1, int keep_fd2) {
+    const int low_fd = keep_fd1 < keep_fd2 ? keep_fd1 : keep_fd2;
+    const int high_fd = keep_fd1 < keep_fd2 ? keep_fd2 : keep_fd1;
+
+    if (proxy_execute_process_close_range(STDERR_FILENO + 1, low_fd - 1) &&
+        proxy_execute_process_close_range(low_fd + 1, high_fd - 1) &&
+        proxy_execute_process_close_range(high_fd + 1, INT_MAX))
+        return;
+
+    // Only close descriptors that are open when the kernel can't close ranges of them
+    DIR *dir = opendir("/proc/self/fd");
+    if (!dir)
+        return;
+    const int dir_fd = dirfd(dir);
+    struct dirent *entry = NULL;
+    while ((entry = readdir(dir)) != NULL) {
+        const int fd = atoi(entry->d_name);
+        if (fd > STDERR_FILENO && fd != dir_fd && fd != keep_fd1 && fd != keep_fd2)
+            close(fd);
+    }
+    closedir(dir);
+}
+
+static bool proxy_execute_process_helper_evaluate(void *proxy_execute, void **context, const char *script,
+                                                  const char *url) {
+    const proxy_execute_i_s *engine_i = g_proxy_execute_process.engine_i;
+
+    if (!engine_i->context_create)
+        return engine_i->get_proxies_for_url(proxy_execute, script, url);
+
+    // Keep the evaluated script for subsequent requests
+    if (!*context)
+        *context = engine_i->context_create(proxy_execute, script);
+    if (!*context)
+        return false;
+    return engine_i->context_get_proxies_for_url(proxy_execute, *context, url);
+}
+
+// Main loop of the helper process which evaluates requests until it is recycled or the zygote goes away
+static void proxy_execute_process_helper_main(proxy_execute_process_helper_s *helper) {
+    const proxy_execute_i_s *engine_i = g_proxy_execute_process.engine_i;
+    proxy_execute_process_ring_s *request_ring = proxy_execute_process_get_request_ring(helper);
+    proxy_execute_process_ring_s *response_ring = proxy_execute_process_get_response_ring(helper);
+    proxy_execute_process_request_s request;
+    proxy_execute_process_response_s response;
+    const pid_t parent_pid = getppid();
+    void *context = NULL;
+    char *script = NULL;
+    char *url = NULL;
+    int32_t evaluations = 0;
+    uint64_t pos = 0;
+
+    void *proxy_execute = engine_i->create();
+    if (!proxy_execute)
+        return;
+
+    while (true) {
+        const int32_t ready = proxy_execute_process_wait(helper->request_fd, EXECUTE_PROCESS_PARENT_POLL_MS);
+        if (ready < 0 || getppid() != parent_pid)
+            break;
+        if (ready == 0 || proxy_execute_process_ring_get_used(request_ring) < sizeof(request))
+            continue;
+
+        memset(&response, 0, sizeof(response));
+
+        // Read request from the parent process
+        pos = request_ring->head;
+        proxy_execute_process_ring_read(request_ring, &pos, &request, sizeof(request));
+        if (request.script_len) {
+            if (context)
+                engine_i->context_delete(&context);
+            free(script);
+            script = (char *)malloc(request.script_len + 1);
+            if (script) {
+                proxy_execute_process_ring_read(request_ring, &pos, script, request.script_len);
+                script[request.script_len] = 0;
+            } else {
+                pos += request.script_len;
+            }
+        }
+        url = (char *)malloc(request.url_len + 1);
+        if (url) {
+            proxy_execute_process_ring_read(request_ring, &pos, url, request.url_len);
+            url[request.url_len] = 0;
+        }
+        atomic_store_release_u64(&request_ring->head, pos);
+
+        if (script && url) {
+            response.is_ok = proxy_execute_process_helper_evaluate(proxy_execute, &context, script, url);
+            response.error = response.is_ok ? 0 : engine_i->get_error(proxy_execute);
+        } else {
+            response.error = ENOMEM;
+        }
+        free(url);
+        url = NULL;
+
+        const char *list = response.is_ok ? engine_i->get_list(proxy_execute) : NULL;
+        if (list) {
+            const size_t list_len = strlen(list);
+            if (list_len > EXECUTE_PROCESS_RESPONSE_RING_SIZE - sizeof(response)) {
+                response.is_ok = false;
+                response.error = E2BIG;
+                list = NULL;
+            } else {
+                response.list_len = (uint32_t)list_len;
+            }
+        }
+
+        // Replace the helper once it has been used enough or has grown too large
+        evaluations++;
+        if (g_proxy_execute_process.max_evaluations > 0 && evaluations >= g_proxy_execute_process.max_evaluations)
+            response.recycle = true;
+        if (g_proxy_execute_process.max_rss_mb > 0 &&
+            proxy_execute_process_get_rss_mb() >= g_proxy_execute_process.max_rss_mb)
+            response.recycle = true;
+
+        // Write response to the parent process
+        pos = response_ring->tail;
+        proxy_execute_process_ring_write(response_ring, &pos, &response, sizeof(response));
+        if (list)
+            proxy_execute_process_ring_write(response_ring, &pos, list, response.list_len);
+        atomic_store_release_u64(&response_ring->tail, pos);
+        proxy_execute_process_signal(helper->response_fd);
+
+        if (response.recycle)
+            break;
+    }
+
+    if (context)
+        engine_i->context_delete(&context);
+    engine_i->delete(&proxy_execute);
+    free(script);
+}
+
+static void proxy_execute_process_stop(proxy_execute_process_helper_s *helper) {
+    if (helper->pidfd >= 0) {
+        // Helper is reaped by the zygote
+        syscall(SYS_pidfd_send_signal, helper->pidfd, SIGKILL, NULL, 0);
+        close(helper->pidfd);
+        helper->pidfd = -1;
+    }
+    if (helper->request_fd >= 0)
+        close(helper->request_fd);
+    if (helper->response_fd >= 0)
+        close(helper->response_fd);
+    helper->request_fd = helper->response_fd = -1;
+    helper->has_script = false;
+}
+
+// Runs in a process forked from the zygote, which has not initialized the script engine
+static void proxy_execute_process_helper_run(const proxy_execute_process_spawn_s *spawn, const int fds[3]) {
+    proxy_execute_process_helper_s helper;
+
+    memset(&helper, 0, sizeof(helper));
+    helper.pidfd = -1;
+    helper.request_fd = fds[1];
+    helper.response_fd = fds[2];
+    helper.shared = mmap(NULL, proxy_execute_process_shared_size, PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+    close(fds[0]);
+    if (helper.shared == MAP_FAILED)
+        return;
+    proxy_execute_process_close_fds(helper.request_fd, helper.response_fd);
+
+    g_proxy_execute_process.engine_i = spawn->engine_i;
+    g_proxy_execute_process.max_evaluations = spawn->max_evaluations;
+    g_proxy_execute_process.max_rss_mb = spawn->max_rss_mb;
+    if (!spawn->engine_i->global_init())
+        return;
+    proxy_execute_process_helper_main(&helper);
+    spawn->engine_i->global_cleanup();
+}
+
+// Send the process id of a helper or negative error back to the parent along with its process descriptor
+static bool proxy_execute_process_zygote_reply(int fd, int32_t pid, int pidfd) {
+    union {
+        char buffer[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct iovec iov = {&pid, sizeof(pid)};
+    struct msghdr msg;
+
+    memset(&control, 0, sizeof(control));
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    if (pidfd >= 0) {
+        msg.msg_control = control.buffer;
+        msg.msg_controllen = sizeof(control.buffer);
+
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &pidfd, sizeof(int));
+    }
+    return sendmsg(fd, &msg, MSG_NOSIGNAL) == sizeof(pid);
+}
+
+// Main loop of the zygote which forks a helper process for each request until the parent process goes away
+static void proxy_execute_process_zygote_main(int fd) {
+    proxy_execute_process_spawn_s spawn;
+    union {
+        char buffer[CMSG_SPACE(3 * sizeof(int))];
+        struct cmsghdr align;
+    } control;
+
+    // Helpers are reaped by the loop below even if the parent process ignores child exits
+    signal(SIGCHLD, SIG_DFL);
+    proxy_execute_process_close_fds(fd, fd);
+
+    while (true) {
+        struct pollfd pfd = {fd, POLLIN, 0};
+        struct iovec iov = {&spawn, sizeof(spawn)};
+        struct msghdr msg;
+        int fds[3] = {-1, -1, -1};
+        int32_t pid = -EINVAL;
+        int pidfd = -1;
+
+        // Helpers are reaped here rather than automatically so that a helper that exits immediately remains a
+        // zombie, and its process id can't be reused, until its process descriptor has been opened
+        while (waitpid(-1, NULL, WNOHANG) > 0) {
+        }
+        const int32_t ready = poll(&pfd, 1, EXECUTE_PROCESS_PARENT_POLL_MS);
+        if (ready == 0 || (ready < 0 && errno == EINTR))
+            continue;
+        if (ready < 0)
+            break;
+
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control.buffer;
+        msg.msg_controllen = sizeof(control.buffer);
+
+        const ssize_t len = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+        if (len < 0 && errno == EINTR)
+            continue;
+        if (len <= 0)
+            break;
+
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS &&
+            cmsg->cmsg_len == CMSG_LEN(sizeof(fds)))
+            memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+
+        if (len == sizeof(spawn) && fds[0] >= 0) {
+            pid = fork();
+            if (pid == 0) {
+                close(fd);
+                proxy_execute_process_helper_run(&spawn, fds);
+                _exit(0);
+            }
+            if (pid < 0) {
+                pid = -errno;
+            } else {
+                pidfd = (int)syscall(SYS_pidfd_open, pid, 0);
+                if (pidfd < 0) {
+                    kill(pid, SIGKILL);
+                    pid = -errno;
+                }
+            }
+        }
+
+        for (int32_t i = 0; i < 3; i++) {
+            if (fds[i] >= 0)
+                close(fds[i]);
+        }
+        const bool sent = proxy_execute_process_zygote_reply(fd, pid, pidfd);
+        if (pidfd >= 0)
+            close(pidfd);
+        if (!sent)
+            break;
+    }
+    _exit(0);
+}
+
+static int32_t proxy_execute_process_get_thread_count(void) {
+    int32_t thread_count = 0;
+
+    DIR *dir = opendir("/proc/self/task");
+    if (!dir)
+        return 0;
+    struct dirent *entry = NULL;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] != '.')
+            thread_count++;
+    }
+    closedir(dir);
+    return thread_count;
+}
+
+bool proxy_execute_process_zygote_init(void) {
+    int fds[2];
+
+    if (g_proxy_execute_process_zygote.pid > 0)
+        return true;
+
+    // Forking is only safe while no other thread can be holding a lock
+    if (proxy_execute_process_get_thread_count() > 1)
+        return false;
+
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) != 0)
+        return false;
+
+    const pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        proxy_execute_process_zygote_main(fds[1]);
+    }
+    close(fds[1]);
+    if (pid < 0) {
+        close(fds[0]);
+        return false;
+    }
+
+    g_proxy_execute_process_zygote.pid = pid;
+    g_proxy_execute_process_zygote.fd = fds[0];
+    pthread_mutex_init(&g_proxy_execute_process_zygote.mutex, NULL);
+    return true;
+}
+
+// Ask the zygote to fork a helper process, returns its process descriptor or negative error
+static int proxy_execute_process_zygote_fork(const proxy_execute_process_spawn_s *spawn, const int fds[3]) {
+    union {
+        char buffer[CMSG_SPACE(3 * sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct iovec iov = {(void *)spawn, sizeof(*spawn)};
+    struct msghdr msg;
+    int32_t pid = -ECHILD;
+    int pidfd = -1;
+
+    memset(&control, 0, sizeof(control));
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buffer;
+    msg.msg_controllen = sizeof(control.buffer);
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(3 * sizeof(int));
+    memcpy(CMSG_DATA(cmsg), fds, 3 * sizeof(int));
+
+    pthread_mutex_lock(&g_proxy_execute_process_zygote.mutex);
+    if (sendmsg(g_proxy_execute_process_zygote.fd, &msg, MSG_NOSIGNAL) == sizeof(*spawn)) {
+        // Process descriptor of the helper is passed back with its process id
+        memset(&control, 0, sizeof(control));
+        iov.iov_base = &pid;
+        iov.iov_len = sizeof(pid);
+        msg.msg_controllen = sizeof(control.buffer);
+        if (recvmsg(g_proxy_execute_process_zygote.fd, &msg, MSG_CMSG_CLOEXEC) != sizeof(pid))
+            pid = -ECHILD;
+        cmsg = CMSG_FIRSTHDR(&msg);
+        if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS &&
+            cmsg->cmsg_len == CMSG_LEN(sizeof(int)))
+            memcpy(&pidfd, CMSG_DATA(cmsg), sizeof(int));
+    }
+    pthread_mutex_unlock(&g_proxy_execute_process_zygote.mutex);
+
+    if (pid > 0 && pidfd < 0)
+        pid = -ECHILD;
+    if (pid <= 0) {
+        if (pidfd >= 0)
+            close(pidfd);
+        return pid < 0 ? pid : -ECHILD;
+    }
+    return pidfd;
+}
+
+static bool proxy_execute_process_spawn(proxy_execute_process_helper_s *helper) {
+    proxy_execute_process_spawn_s spawn;
+
+    proxy_execute_process_ring_reset(proxy_execute_process_get_request_ring(helper), EXECUTE_PROCESS_REQUEST_RING_SIZE);
+    proxy_execute_process_ring_reset(proxy_execute_process_get_response_ring(helper),
+                                     EXECUTE_PROCESS_RESPONSE_RING_SIZE);
+
+    helper->request_fd = eventfd(0, EFD_CLOEXEC);
+    helper->response_fd = eventfd(0, EFD_CLOEXEC);
+    if (helper->request_fd < 0 || helper->response_fd < 0) {
+        LOG_ERROR("Unable to create %s for helper process (%d)\n", "eventfd", errno);
+        proxy_execute_process_stop(helper);
+        return false;
+    }
+
+    // Helper is forked from the single-threaded zygote since forking this process could copy locks held by other
+    // threads
+    memset(&spawn, 0, sizeof(spawn));
+    spawn.engine_i = g_proxy_execute_process.engine_i;
+    spawn.max_evaluations = g_proxy_execute_process.max_evaluations;
+    spawn.max_rss_mb = g_proxy_execute_process.max_rss_mb;
+    const int fds[3] = {helper->shared_fd, helper->request_fd, helper->response_fd};
+    const int pidfd = proxy_execute_process_zygote_fork(&spawn, fds);
+    if (pidfd < 0) {
+        LOG_ERROR("Unable to create %s for helper process (%d)\n", "process", -pidfd);
+        proxy_execute_process_stop(helper);
+        return false;
+    }
+
+    helper->pidfd = pidfd;
+    return true;
+}
+
+static bool proxy_execute_process_is_running(proxy_execute_process_helper_s *helper) {
+    // Process descriptor becomes readable once the helper has exited
+    struct pollfd pfd = {helper->pidfd, POLLIN, 0};
+    return poll(&pfd, 1, 0) == 0;
+}
+
+static proxy_execute_process_helper_s *proxy_execute_process_checkout(void) {
+    pthread_mutex_lock(&g_proxy_execute_process.mutex);
+    while (!g_proxy_execute_process.idle)
+        pthread_cond_wait(&g_proxy_execute_process.available, &g_proxy_execute_process.mutex);
+    proxy_execute_process_helper_s *helper = g_proxy_execute_process.idle;
+    g_proxy_execute_process.idle = helper->next;
+    pthread_mutex_unlock(&g_proxy_execute_process.mutex);
+    return helper;
+}
+
+static void proxy_execute_process_checkin(proxy_execute_process_helper_s *helper) {
+    // Replace helpers that exited so that idle helpers are ready to evaluate immediately
+    if (helper->pidfd < 0)
+        proxy_execute_process_spawn(helper);
+
+    pthread_mutex_lock(&g_proxy_execute_process.mutex);
+    helper->next = g_proxy_execute_process.idle;
+    g_proxy_execute_process.idle = helper;
+    pthread_cond_signal(&g_proxy_execute_process.available);
+    pthread_mutex_unlock(&g_proxy_execute_process.mutex);
+}
+
+static bool proxy_execute_process_evaluate(proxy_execute_process_helper_s *helper,
+                                           proxy_execute_process_s *proxy_execute, const char *script,
+                                           const char *url) {
+    proxy_execute_process_request_s request;
+    proxy_execute_process_response_s response;
+    int32_t waited_ms = 0;
+    uint64_t pos = 0;
+
+    if (helper->pidfd < 0 && !proxy_execute_process_spawn(helper)) {
+        proxy_execute->error = ECHILD;
+        return false;
+    }
+
+    proxy_execute_process_ring_s *request_ring = proxy_execute_process_get_request_ring(helper);
+    proxy_execute_process_ring_s *response_ring = proxy_execute_process_get_response_ring(helper);
+
+    // Only send the script when the helper has not already evaluated it
+    const size_t script_len = strlen(script);
+    const uint64_t script_hash = hash_xxh64(script, script_len, 0);
+    const bool send_script = !helper->has_script || helper->script_hash != script_hash;
+
+    memset(&request, 0, sizeof(request));
+    request.script_hash = script_hash;
+    request.script_len = send_script ? (uint32_t)script_len : 0;
+    request.url_len = (uint32_t)strlen(url);
+
+    if (proxy_execute_process_ring_get_free(request_ring) < sizeof(request) + request.script_len + request.url_len) {
+        proxy_execute->error = E2BIG;
+        LOG_ERROR("Unable to send script to helper process (%" PRId32 ")\n", proxy_execute->error);
+        return false;
+    }
+
+    // Write request to the helper process
+    pos = request_ring->tail;
+    proxy_execute_process_ring_write(request_ring, &pos, &request, sizeof(request));
+    proxy_execute_process_ring_write(request_ring, &pos, script, request.script_len);
+    proxy_execute_process_ring_write(request_ring, &pos, url, request.url_len);
+    atomic_store_release_u64(&request_ring->tail, pos);
+    helper->script_hash = script_hash;
+    helper->has_script = true;
+    proxy_execute_process_signal(helper->request_fd);
+
+    // Wait for the response while checking that the helper has not crashed or stopped responding
+    while (true) {
+        const int32_t ready = proxy_execute_process_wait(helper->response_fd, EXECUTE_PROCESS_POLL_MS);
+        if (ready > 0 && proxy_execute_process_ring_get_used(response_ring) >= sizeof(response))
+            break;
+        if (ready < 0 || !proxy_execute_process_is_running(helper)) {
+            proxy_execute->error = ECHILD;
+            LOG_ERROR("Helper process exited while executing script (%" PRId32 ")\n", proxy_execute->error);
+            proxy_execute_process_stop(helper);
+            return false;
+        }
+        waited_ms += EXECUTE_PROCESS_POLL_MS;
+        if (waited_ms >= EXECUTE_PROCESS_TIMEOUT_MS) {
+            proxy_execute->error = ETIMEDOUT;
+            LOG_ERROR("Helper process timed out executing script (%" PRId32 ")\n", proxy_execute->error);
+            proxy_execute_process_stop(helper);
+            return false;
+        }
+    }
+
+    // Read response from the helper process
+    pos = response_ring->head;
+    proxy_execute_process_ring_read(response_ring, &pos, &response, sizeof(response));
+    if (response.list_len) {
+        proxy_execute->list = (char *)malloc(response.list_len + 1);
+        if (proxy_execute->list) {
+            proxy_execute_process_ring_read(response_ring, &pos, proxy_execute->list, response.list_len);
+            proxy_execute->list[response.list_len] = 0;
+        } else {
+            pos += response.list_len;
+            response.is_ok = false;
+            response.error = ENOMEM;
+        }
+    }
+    atomic_store_release_u64(&response_ring->head, pos);
+    proxy_execute->error = response.error;
+
+    // Helper exits after sending its last response
+    if (response.recycle)
+        proxy_execute_process_stop(helper);
+
+    return response.is_ok && proxy_execute->list;
+}
+
+bool proxy_execute_process_get_proxies_for_url(void *ctx, const char *script, const char *url) {
+    proxy_execute_process_s *proxy_execute = (proxy_execute_process_s *)ctx;
+    if (!proxy_execute || !script || !url)
+        return false;
+
+    free(proxy_execute->list);
+    proxy_execute->list = NULL;
+    proxy_execute->error = 0;
+
+    proxy_execute_process_helper_s *helper = proxy_execute_process_checkout();
+    const bool is_ok = proxy_execute_process_evaluate(helper, proxy_execute, script, url);
+    proxy_execute_process_checkin(helper);
+    return is_ok;
+}
+
+const char *proxy_execute_process_get_list(void *ctx) {
+    proxy_execute_process_s *proxy_execute = (proxy_execute_process_s *)ctx;
+    return proxy_execute->list;
+}
+
+int32_t proxy_execute_process_get_error(void *ctx) {
+    proxy_execute_process_s *proxy_execute = (proxy_execute_process_s *)ctx;
+    return proxy_execute->error;
+}
+
+void *proxy_execute_process_create(void) {
+    return calloc(1, sizeof(proxy_execute_process_s));
+}
+
+bool proxy_execute_process_delete(void **ctx) {
+    if (!ctx)
+        return false;
+    proxy_execute_process_s *proxy_execute = (proxy_execute_process_s *)*ctx;
+    if (!proxy_execute)
+        return false;
+    free(proxy_execute->list);
+    free(proxy_execute);
+    *ctx = NULL;
+    return true;
+}
+
+/*********************************************************************/
+
+static void proxy_execute_process_delete_helpers(void) {
+    for (int32_t i = 0; i < g_proxy_execute_process.helper_count; i++) {
+        proxy_execute_process_helper_s *helper = &g_proxy_execute_process.helpers[i];
+        proxy_execute_process_stop(helper);
+        if (helper->shared)
+            munmap(helper->shared, proxy_execute_process_shared_size);
+        if (helper->shared_fd >= 0)
+            close(helper->shared_fd);
+    }
+    free(g_proxy_execute_process.helpers);
+    pthread_mutex_destroy(&g_proxy_execute_process.mutex);
+    pthread_cond_destroy(&g_proxy_execute_process.available);
+    memset(&g_proxy_execute_process, 0, sizeof(g_proxy_execute_process));
+}
+
+bool proxy_execute_process_global_init(void) {
+    // Helper processes are started by proxy_execute_process_init_ex once the script engine is known
+    return g_proxy_execute_process.engine_i != NULL;
+}
+
+bool proxy_execute_process_init_ex(proxy_execute_i_s *engine_i, int32_t processes, int32_t max_evaluations,
+                                   int32_t max_rss_mb) {
+    if (!engine_i || processes <= 0)
+        return false;
+    if (processes > EXECUTE_PROCESS_MAX_PROCESSES)
+        processes = EXECUTE_PROCESS_MAX_PROCESSES;
+
+    g_proxy_execute_process.helpers =
+        (proxy_execute_process_helper_s *)calloc(processes, sizeof(proxy_execute_process_helper_s));
+    if (!g_proxy_execute_process.helpers)
+        return false;
+    for (int32_t i = 0; i < processes; i++)
+        g_proxy_execute_process.helpers[i].pidfd = g_proxy_execute_process.helpers[i].shared_fd = -1;
+
+    if (!proxy_execute_process_zygote_init()) {
+        LOG_ERROR("Unable to start zygote for helper processes, call proxyres_global_early_init before starting "
+                  "other threads\n");
+        free(g_proxy_execute_process.helpers);
+        g_proxy_execute_process.helpers = NULL;
+        return false;
+    }
+
+    g_proxy_execute_process.engine_i = engine_i;
+    g_proxy_execute_process.max_evaluations = max_evaluations;
+    g_proxy_execute_process.max_rss_mb = max_rss_mb;
+    g_proxy_execute_process.helper_count = processes;
+    pthread_mutex_init(&g_proxy_execute_process.mutex, NULL);
+    pthread_cond_init(&g_proxy_execute_process.available, NULL);
+
+    // Pre-fork helper processes so that the first evaluations don't wait for them to start
+    for (int32_t i = 0; i < processes; i++) {
+        proxy_execute_process_helper_s *helper = &g_proxy_execute_process.helpers[i];
+        helper->request_fd = helper->response_fd = -1;
+
+        // Shared memory is passed to the zygote as a descriptor since helpers are not forked from this process
+        helper->shared_fd = memfd_create("proxyres-execute", MFD_CLOEXEC);
+        if (helper->shared_fd >= 0 && ftruncate(helper->shared_fd, proxy_execute_process_shared_size) == 0)
+            helper->shared = mmap(NULL, proxy_execute_process_shared_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                                  helper->shared_fd, 0);
+        else
+            helper->shared = MAP_FAILED;
+        if (helper->shared == MAP_FAILED) {
+            helper->shared = NULL;
+            LOG_ERROR("Unable to create %s for helper process (%d)\n", "shared memory", errno);
+            proxy_execute_process_delete_helpers();
+            return false;
+        }
+        if (!proxy_execute_process_spawn(helper)) {
+            proxy_execute_process_delete_helpers();
+            return false;
+        }
+
+        helper->next = g_proxy_execute_process.idle;
+        g_proxy_execute_process.idle = helper;
+    }
+
+    LOG_INFO("Executing scripts in %" PRId32 " helper processes\n", processes);
+    return true;
+}
+
+bool proxy_execute_process_global_cleanup(void) {
+    proxy_execute_i_s *engine_i = g_proxy_execute_process.engine_i;
+    proxy_execute_process_delete_helpers();
+    if (engine_i)
+        engine_i->global_cleanup();
+    return true;
+}
+
+proxy_execute_i_s *proxy_execute_process_get_interface(void) {
+    static proxy_execute_i_s proxy_execute_process_i = {
+        proxy_execute_process_get_proxies_for_url,
+        proxy_execute_process_get_list,
+        proxy_execute_process_get_error,
+        proxy_execute_process_create,
+        proxy_execute_process_delete,
+        proxy_execute_process_global_init,
+        proxy_execute_process_global_cleanup,
+        NULL,  // Contexts are cached by each helper process
+        NULL,
+        NULL};
+    return &proxy_execute_process_i;
+}
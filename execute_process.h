@@ -0,0 +1,30 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define EXECUTE_PROCESS_DEFAULT_MAX_EVALUATIONS (1000)
+#define EXECUTE_PROCESS_DEFAULT_MAX_RSS_MB      (256)
+
+bool proxy_execute_process_get_proxies_for_url(void *ctx, const char *script, const char *url);
+const char *proxy_execute_process_get_list(void *ctx);
+int32_t proxy_execute_process_get_error(void *ctx);
+
+void *proxy_execute_process_create(void);
+bool proxy_execute_process_delete(void **ctx);
+
+// Start the process that helper processes are forked from. Must be called before any other threads are started,
+// see proxyres_global_early_init.
+bool proxy_execute_process_zygote_init(void);
+
+bool proxy_execute_process_global_init(void);
+bool proxy_execute_process_init_ex(proxy_execute_i_s *engine_i, int32_t processes, int32_t max_evaluations,
+                                   int32_t max_rss_mb);
+bool proxy_execute_process_global_cleanup(void);
+
+proxy_execute_i_s *proxy_execute_process_get_interface(void);
+
+#ifdef __cplusplus
+}
+#endif
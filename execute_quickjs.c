@@ -0,0 +1,379 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <quickjs.h>
+
+#define LOG_CATEGORY PROXYRES_LOG_CATEGORY_EXECUTE
+
+#include "execute.h"
+#include "execute_dns.h"
+#include "execute_i.h"
+#include "execute_quickjs.h"
+#include "log.h"
+#include "mozilla_js.h"
+#include "net_util.h"
+#include "util.h"
+
+typedef struct g_proxy_execute_quickjs_s {
+    // Mozilla's JavaScript PAC utilities compiled to bytecode once so contexts don't need to parse them
+    uint8_t *utils_bytecode;
+    size_t utils_bytecode_len;
+} g_proxy_execute_quickjs_s;
+
+g_proxy_execute_quickjs_s g_proxy_execute_quickjs;
+
+typedef struct proxy_execute_quickjs_s {
+    // Execute error
+    int32_t error;
+    // Proxy list
+    char *list;
+} proxy_execute_quickjs_s;
+
+typedef struct proxy_execute_quickjs_context_s {
+    // Runtime owned by the context, since a runtime can only be used by one thread at a time this lets contexts on
+    // different threads evaluate scripts in parallel
+    JSRuntime *runtime;
+    // Context that evaluated the PAC script
+    JSContext *context;
+    // FindProxyForURL function object
+    JSValue find_proxy;
+} proxy_execute_quickjs_context_s;
+
+static void js_print_exception(JSContext *context) {
+    JSValue exception = JS_GetException(context);
+    const char *message = JS_ToCString(context, exception);
+    if (message) {
+        LOG_ERROR("EXCEPTION: %s\n", message);
+        JS_FreeCString(context, message);
+    } else {
+        LOG_ERROR("Unable to print exception object\n");
+    }
+    JS_FreeValue(context, exception);
+}
+
+// Convert string returned from native function and free it
+static JSValue js_new_string_free(JSContext *context, char *string) {
+    if (!string)
+        return JS_NULL;
+    JSValue value = JS_NewString(context, string);
+    free(string);
+    return value;
+}
+
+static JSValue proxy_execute_quickjs_dns_resolve(JSContext *context, JSValueConst this_val, int argc,
+                                                 JSValueConst *argv) {
+    if (argc != 1 || !JS_IsString(argv[0]))
+        return JS_NULL;
+
+    const char *host = JS_ToCString(context, argv[0]);
+    if (!host)
+        return JS_NULL;
+
+    char *address = execute_dns_resolve(host, NULL);
+    JS_FreeCString(context, host);
+    return js_new_string_free(context, address);
+}
+
+static JSValue proxy_execute_quickjs_dns_resolve_ex(JSContext *context, JSValueConst this_val, int argc,
+                                                    JSValueConst *argv) {
+    if (argc != 1 || !JS_IsString(argv[0]))
+        return JS_NULL;
+
+    const char *host = JS_ToCString(context, argv[0]);
+    if (!host)
+        return JS_NULL;
+
+    char *addresses = execute_dns_resolve_ex(host, NULL);
+    JS_FreeCString(context, host);
+    return js_new_string_free(context, addresses);
+}
+
+static JSValue proxy_execute_quickjs_my_ip_address(JSContext *context, JSValueConst this_val, int argc,
+                                                   JSValueConst *argv) {
+    return js_new_string_free(context, my_ip_address());
+}
+
+static JSValue proxy_execute_quickjs_my_ip_address_ex(JSContext *context, JSValueConst this_val, int argc,
+                                                      JSValueConst *argv) {
+    return js_new_string_free(context, my_ip_address_ex());
+}
+
+static void proxy_execute_quickjs_context_free(proxy_execute_quickjs_context_s *quickjs_context) {
+    if (quickjs_context->context) {
+        JS_FreeValue(quickjs_context->context, quickjs_context->find_proxy);
+        JS_FreeContext(quickjs_context->context);
+    }
+    if (quickjs_context->runtime)
+        JS_FreeRuntime(quickjs_context->runtime);
+    free(quickjs_context);
+}
+
+void *proxy_execute_quickjs_context_create(void *ctx, const char *script) {
+    proxy_execute_quickjs_s *proxy_execute = (proxy_execute_quickjs_s *)ctx;
+    proxy_execute_quickjs_context_s *quickjs_context = NULL;
+    JSContext *context = NULL;
+    JSValue global = JS_UNDEFINED;
+    JSValue utils = JS_UNDEFINED;
+    JSValue result = JS_UNDEFINED;
+    bool is_ok = false;
+
+    if (!proxy_execute || !script)
+        return NULL;
+
+    quickjs_context = (proxy_execute_quickjs_context_s *)calloc(1, sizeof(proxy_execute_quickjs_context_s));
+    if (!quickjs_context) {
+        LOG_ERROR("Unable to allocate memory for %s\n", "JS context");
+        return NULL;
+    }
+    quickjs_context->find_proxy = JS_UNDEFINED;
+
+    quickjs_context->runtime = JS_NewRuntime();
+    if (quickjs_context->runtime)
+        context = quickjs_context->context = JS_NewContext(quickjs_context->runtime);
+    if (!context) {
+        LOG_ERROR("Failed to create global JS context\n");
+        goto quickjs_context_cleanup;
+    }
+
+    // Array of JavaScript function names and corresponding callbacks
+    static const struct {
+        const char *name;
+        JSCFunction *callback;
+        int param_count;
+    } functions[] = {{"dnsResolve", proxy_execute_quickjs_dns_resolve, 1},
+                     {"dnsResolveEx", proxy_execute_quickjs_dns_resolve_ex, 1},
+                     {"myIpAddress", proxy_execute_quickjs_my_ip_address, 0},
+                     {"myIpAddressEx", proxy_execute_quickjs_my_ip_address_ex, 0}};
+
+    // Register native functions with JavaScript engine
+    global = JS_GetGlobalObject(context);
+    for (uint32_t i = 0; i < sizeof(functions) / sizeof(functions[0]); i++) {
+        JSValue function =
+            JS_NewCFunction(context, functions[i].callback, functions[i].name, functions[i].param_count);
+        if (JS_SetPropertyStr(context, global, functions[i].name, function) < 0) {
+            LOG_ERROR("Unable to hook native function for %s\n", functions[i].name);
+            goto quickjs_context_cleanup;
+        }
+    }
+
+    // Load Mozilla's JavaScript PAC utilities from bytecode compiled during initialization
+    utils = JS_ReadObject(context, g_proxy_execute_quickjs.utils_bytecode, g_proxy_execute_quickjs.utils_bytecode_len,
+                          JS_READ_OBJ_BYTECODE);
+    if (!JS_IsException(utils))
+        result = JS_EvalFunction(context, utils);
+    if (JS_IsException(utils) || JS_IsException(result)) {
+        LOG_ERROR("Unable to execute Mozilla's JavaScript PAC utilities\n");
+        js_print_exception(context);
+        goto quickjs_context_cleanup;
+    }
+
+    // Load PAC script
+    JS_FreeValue(context, result);
+    result = JS_Eval(context, script, strlen(script), "pac.js", JS_EVAL_TYPE_GLOBAL);
+    if (JS_IsException(result)) {
+        LOG_ERROR("Unable to execute PAC script\n");
+        js_print_exception(context);
+        goto quickjs_context_cleanup;
+    }
+
+    // Get FindProxyForURL function object
+    quickjs_context->find_proxy = JS_GetPropertyStr(context, global, "FindProxyForURL");
+    if (!JS_IsFunction(context, quickjs_context->find_proxy)) {
+        LOG_ERROR("Unable to find FindProxyForURL function\n");
+        goto quickjs_context_cleanup;
+    }
+
+    is_ok = true;
+
+quickjs_context_cleanup:
+
+    if (context) {
+        JS_FreeValue(context, result);
+        JS_FreeValue(context, global);
+    }
+
+    if (!is_ok) {
+        proxy_execute_quickjs_context_free(quickjs_context);
+        quickjs_context = NULL;
+    }
+
+    return quickjs_context;
+}
+
+bool proxy_execute_quickjs_context_get_proxies_for_url(void *ctx, void *context, const char *url) {
+    proxy_execute_quickjs_s *proxy_execute = (proxy_execute_quickjs_s *)ctx;
+    proxy_execute_quickjs_context_s *quickjs_context = (proxy_execute_quickjs_context_s *)context;
+    JSValue args[2];
+    JSValue result = JS_UNDEFINED;
+    const char *list = NULL;
+    bool is_ok = false;
+    char *host = NULL;
+
+    if (!proxy_execute || !quickjs_context)
+        return false;
+
+    JSContext *js_context = quickjs_context->context;
+
+    // Stack limit is relative to the thread that last used the runtime
+    JS_UpdateStackTop(quickjs_context->runtime);
+
+    // Call FindProxyForURL with string arguments so the url does not need to be escaped or parsed
+    host = get_url_host(url);
+    args[0] = JS_NewString(js_context, url);
+    args[1] = JS_NewString(js_context, host ? host : url);
+    free(host);
+
+    result = JS_Call(js_context, quickjs_context->find_proxy, JS_UNDEFINED, 2, args);
+    JS_FreeValue(js_context, args[0]);
+    JS_FreeValue(js_context, args[1]);
+
+    if (JS_IsException(result)) {
+        LOG_ERROR("Unable to execute FindProxyForURL\n");
+        js_print_exception(js_context);
+        goto quickjs_execute_cleanup;
+    }
+
+    if (!JS_IsString(result)) {
+        LOG_ERROR("Incorrect return type from FindProxyForURL\n");
+        goto quickjs_execute_cleanup;
+    }
+
+    // Get the result of the call to FindProxyForURL
+    list = JS_ToCString(js_context, result);
+    free(proxy_execute->list);
+    proxy_execute->list = list ? strdup(list) : NULL;
+    is_ok = proxy_execute->list != NULL;
+
+quickjs_execute_cleanup:
+
+    if (list)
+        JS_FreeCString(js_context, list);
+    JS_FreeValue(js_context, result);
+    return is_ok;
+}
+
+bool proxy_execute_quickjs_context_delete(void **context) {
+    if (!context)
+        return false;
+    proxy_execute_quickjs_context_s *quickjs_context = (proxy_execute_quickjs_context_s *)*context;
+    if (!quickjs_context)
+        return false;
+    proxy_execute_quickjs_context_free(quickjs_context);
+    *context = NULL;
+    return true;
+}
+
+bool proxy_execute_quickjs_get_proxies_for_url(void *ctx, const char *script, const char *url) {
+    void *context = proxy_execute_quickjs_context_create(ctx, script);
+    if (!context)
+        return false;
+    const bool is_ok = proxy_execute_quickjs_context_get_proxies_for_url(ctx, context, url);
+    proxy_execute_quickjs_context_delete(&context);
+    return is_ok;
+}
+
+const char *proxy_execute_quickjs_get_list(void *ctx) {
+    proxy_execute_quickjs_s *proxy_execute = (proxy_execute_quickjs_s *)ctx;
+    return proxy_execute->list;
+}
+
+int32_t proxy_execute_quickjs_get_error(void *ctx) {
+    proxy_execute_quickjs_s *proxy_execute = (proxy_execute_quickjs_s *)ctx;
+    return proxy_execute->error;
+}
+
+void *proxy_execute_quickjs_create(void) {
+    if (!g_proxy_execute_quickjs.utils_bytecode)
+        return NULL;
+    proxy_execute_quickjs_s *proxy_execute = (proxy_execute_quickjs_s *)calloc(1, sizeof(proxy_execute_quickjs_s));
+    return proxy_execute;
+}
+
+bool proxy_execute_quickjs_delete(void **ctx) {
+    if (!ctx)
+        return false;
+    proxy_execute_quickjs_s *proxy_execute = (proxy_execute_quickjs_s *)*ctx;
+    if (!proxy_execute)
+        return false;
+    free(proxy_execute->list);
+    free(proxy_execute);
+    *ctx = NULL;
+    return true;
+}
+
+/*********************************************************************/
+
+bool proxy_execute_quickjs_global_init(void) {
+    JSRuntime *runtime = NULL;
+    JSContext *context = NULL;
+    JSValue utils = JS_UNDEFINED;
+    uint8_t *bytecode = NULL;
+    size_t bytecode_len = 0;
+
+    // Runtime is only needed to compile the utilities, each context creates its own
+    runtime = JS_NewRuntime();
+    if (runtime)
+        context = JS_NewContext(runtime);
+    if (!context) {
+        LOG_ERROR("Failed to create global JS context\n");
+        goto quickjs_init_cleanup;
+    }
+
+    // Compile Mozilla's JavaScript PAC utilities without running them
+    utils = JS_Eval(context, MOZILLA_PAC_JAVASCRIPT, sizeof(MOZILLA_PAC_JAVASCRIPT) - 1, "mozilla_js",
+                    JS_EVAL_TYPE_GLOBAL | JS_EVAL_FLAG_COMPILE_ONLY);
+    if (JS_IsException(utils)) {
+        LOG_ERROR("Unable to compile Mozilla's JavaScript PAC utilities\n");
+        js_print_exception(context);
+        goto quickjs_init_cleanup;
+    }
+
+    // Copy bytecode so that it can be loaded into each context
+    bytecode = JS_WriteObject(context, &bytecode_len, utils, JS_WRITE_OBJ_BYTECODE);
+    if (bytecode) {
+        g_proxy_execute_quickjs.utils_bytecode = (uint8_t *)malloc(bytecode_len);
+        if (g_proxy_execute_quickjs.utils_bytecode) {
+            memcpy(g_proxy_execute_quickjs.utils_bytecode, bytecode, bytecode_len);
+            g_proxy_execute_quickjs.utils_bytecode_len = bytecode_len;
+        }
+        js_free(context, bytecode);
+    }
+
+quickjs_init_cleanup:
+
+    if (context) {
+        JS_FreeValue(context, utils);
+        JS_FreeContext(context);
+    }
+    if (runtime)
+        JS_FreeRuntime(runtime);
+
+    if (!g_proxy_execute_quickjs.utils_bytecode) {
+        proxy_execute_quickjs_global_cleanup();
+        return false;
+    }
+    return true;
+}
+
+bool proxy_execute_quickjs_global_cleanup(void) {
+    free(g_proxy_execute_quickjs.utils_bytecode);
+    memset(&g_proxy_execute_quickjs, 0, sizeof(g_proxy_execute_quickjs));
+    return true;
+}
+
+proxy_execute_i_s *proxy_execute_quickjs_get_interface(void) {
+    static proxy_execute_i_s proxy_execute_quickjs_i = {proxy_execute_quickjs_get_proxies_for_url,
+                                                        proxy_execute_quickjs_get_list,
+                                                        proxy_execute_quickjs_get_error,
+                                                        proxy_execute_quickjs_create,
+                                                        proxy_execute_quickjs_delete,
+                                                        proxy_execute_quickjs_global_init,
+                                                        proxy_execute_quickjs_global_cleanup,
+                                                        proxy_execute_quickjs_context_create,
+                                                        proxy_execute_quickjs_context_get_proxies_for_url,
+                                                        proxy_execute_quickjs_context_delete};
+    return &proxy_execute_quickjs_i;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+bool proxy_execute_quickjs_get_proxies_for_url(void *ctx, const char *script, const char *url);
+const char *proxy_execute_quickjs_get_list(void *ctx);
+int32_t proxy_execute_quickjs_get_error(void *ctx);
+
+void *proxy_execute_quickjs_create(void);
+bool proxy_execute_quickjs_delete(void **ctx);
+
+void *proxy_execute_quickjs_context_create(void *ctx, const char *script);
+bool proxy_execute_quickjs_context_get_proxies_for_url(void *ctx, void *context, const char *url);
+bool proxy_execute_quickjs_context_delete(void **context);
+
+bool proxy_execute_quickjs_global_init(void);
+bool proxy_execute_quickjs_global_cleanup(void);
+
+proxy_execute_i_s *proxy_execute_quickjs_get_interface(void);
@@ -8,7 +8,10 @@
 #include <activdbg.h>
 #include <cguid.h>
 
+#define LOG_CATEGORY PROXYRES_LOG_CATEGORY_EXECUTE
+
 #include "execute.h"
+#include "execute_dns.h"
 #include "execute_i.h"
 #include "execute_wsh.h"
 #include "log.h"
@@ -115,9 +115,9 @@ static HRESULT STDMETHODCALLTYPE script_dispatch_invoke(IDispatch *dispatch, DIS
         char *ip = NULL;
 
         if (disp_id == SCRIPT_DISPATCH_DNS_RESOLVE_EX_ID)
-            ip = dns_resolve_ex(host_utf8, NULL);
+            ip = execute_dns_resolve_ex(host_utf8, NULL);
         else
-            ip = dns_resolve(host_utf8, NULL);
+            ip = execute_dns_resolve(host_utf8, NULL);
 
         free(host_utf8);
         if (!ip)
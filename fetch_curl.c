@@ -6,7 +6,10 @@
 #include <inttypes.h>
 #include <errno.h>
 
+#define LOG_CATEGORY PROXYRES_LOG_CATEGORY_FETCH
+
 #include "log.h"
+#include "trace_record.h"
 #include "util.h"
 
 #include "curl/curl.h"
@@ -66,7 +69,9 @@ char *fetch_get(const char *url, int32_t *error) {
     curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, fetch_write_script);
     curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, (void *)&script);
 
+    trace_begin("fetch_get");
     CURLcode res = curl_easy_perform(curl_handle);
+    trace_end("fetch_get");
     if (res != CURLE_OK) {
         free(script.buffer);
         script.buffer = NULL;
@@ -0,0 +1,151 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+
+#ifdef _WIN32
+#  define strncasecmp _strnicmp
+#else
+#  include <fcntl.h>
+#  include <strings.h>
+#  include <unistd.h>
+#  include <sys/stat.h>
+#endif
+
+#define LOG_CATEGORY PROXYRES_LOG_CATEGORY_FETCH
+
+#include "fetch_local.h"
+#include "log.h"
+#include "util.h"
+
+#define DATA_URL_PREFIX "data:"
+#define FILE_URL_PREFIX "file://"
+
+bool fetch_local_is_supported(const char *url) {
+    if (!url)
+        return false;
+    return strncasecmp(url, DATA_URL_PREFIX, sizeof(DATA_URL_PREFIX) - 1) == 0 ||
+           strncasecmp(url, FILE_URL_PREFIX, sizeof(FILE_URL_PREFIX) - 1) == 0;
+}
+
+char *fetch_local_get_path(const char *url) {
+    if (!url || strncasecmp(url, FILE_URL_PREFIX, sizeof(FILE_URL_PREFIX) - 1) != 0)
+        return NULL;
+
+    // Skip optional localhost authority
+    const char *path = url + sizeof(FILE_URL_PREFIX) - 1;
+    if (strncasecmp(path, "localhost/", 10) == 0)
+        path += 9;
+    if (*path != '/')
+        return NULL;
+#ifdef _WIN32
+    // Drive letter paths are specified as file:///C:/path
+    if (path[1] && path[2] == ':')
+        path++;
+#endif
+    return str_percent_decode(path, strlen(path));
+}
+
+static char *fetch_local_get_data(const char *url, int32_t *error) {
+    const char *media_type = url + sizeof(DATA_URL_PREFIX) - 1;
+    const char *data = strchr(media_type, ',');
+    char *script = NULL;
+
+    if (!data) {
+        *error = EINVAL;
+        return NULL;
+    }
+
+    // Check if the data is base64 encoded, otherwise it is percent-encoded
+    const size_t media_type_len = (size_t)(data - media_type);
+    const bool is_base64 = media_type_len >= 7 && strncasecmp(data - 7, ";base64", 7) == 0;
+    data++;
+
+    if (is_base64)
+        script = str_base64_decode(data, strlen(data), NULL);
+    else
+        script = str_percent_decode(data, strlen(data));
+    if (!script)
+        *error = is_base64 ? EINVAL : ENOMEM;
+    return script;
+}
+
+static char *fetch_local_get_file(const char *url, int32_t *error) {
+    char *script = NULL;
+
+    char *path = fetch_local_get_path(url);
+    if (!path) {
+        *error = EINVAL;
+        return NULL;
+    }
+
+#ifdef _WIN32
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        *error = errno;
+        goto file_done;
+    }
+    script = (char *)calloc(SCRIPT_MAX + 1, sizeof(char));
+    if (!script) {
+        *error = ENOMEM;
+    } else if (fread(script, 1, SCRIPT_MAX + 1, file) > SCRIPT_MAX) {
+        *error = EFBIG;
+        free(script);
+        script = NULL;
+    }
+    fclose(file);
+#else
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        *error = errno;
+        goto file_done;
+    }
+
+    // Read the file directly into a buffer sized using the file size so that it is only copied once
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        *error = errno;
+    } else if (st.st_size > SCRIPT_MAX) {
+        *error = EFBIG;
+    } else {
+        script = (char *)calloc((size_t)st.st_size + 1, sizeof(char));
+        if (!script)
+            *error = ENOMEM;
+        size_t script_len = 0;
+        while (script && script_len < (size_t)st.st_size) {
+            const ssize_t bytes_read = read(fd, script + script_len, (size_t)st.st_size - script_len);
+            if (bytes_read < 0 && errno == EINTR)
+                continue;
+            if (bytes_read < 0) {
+                *error = errno;
+                free(script);
+                script = NULL;
+            }
+            // File was truncated while it was being read
+            if (bytes_read <= 0)
+                break;
+            script_len += (size_t)bytes_read;
+        }
+    }
+    close(fd);
+#endif
+
+file_done:
+    if (!script)
+        LOG_ERROR("Unable to read proxy auto config file %s (%" PRId32 ")\n", path, *error);
+    free(path);
+    return script;
+}
+
+char *fetch_local_get(const char *url, int32_t *error) {
+    *error = 0;
+    if (strncasecmp(url, DATA_URL_PREFIX, sizeof(DATA_URL_PREFIX) - 1) == 0)
+        return fetch_local_get_data(url, error);
+    if (strncasecmp(url, FILE_URL_PREFIX, sizeof(FILE_URL_PREFIX) - 1) == 0)
+        return fetch_local_get_file(url, error);
+    *error = EINVAL;
+    return NULL;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Check whether the url can be read without a network request (data: and file:// urls)
+bool fetch_local_is_supported(const char *url);
+
+// Get the file system path for a file:// url
+char *fetch_local_get_path(const char *url);
+
+// Reads a PAC script from a data: or file:// url
+char *fetch_local_get(const char *url, int32_t *error);
+
+#ifdef __cplusplus
+}
+#endif
@@ -25,7 +25,10 @@
 #  define closesocket close
 #endif
 
+#define LOG_CATEGORY PROXYRES_LOG_CATEGORY_FETCH
+
 #include "log.h"
+#include "trace_record.h"
 #include "util.h"
 
 // Fetch proxy auto configuration using HTTP only
@@ -41,6 +44,8 @@ char *fetch_get(const char *url, int32_t *error) {
     if (!url)
         return NULL;
 
+    trace_begin("fetch_get");
+
     // Check to make sure we are only using http:// urls
     if (strstr(url, "https://")) {
         err = ENOTSUP;
@@ -185,6 +190,8 @@ download_cleanup:
     if (error)
         *error = err;
 
+    trace_end("fetch_get");
+
     if (err != 0) {
         free(body);
         return NULL;
@@ -19,6 +19,30 @@ char *proxy_config_get_proxy(const char *scheme);
 // Read the proxy bypass list configured on the user's system.
 char *proxy_config_get_bypass_list(void);
 
+// Get a counter that is incremented whenever the user's proxy configuration changes.
+uint64_t proxy_config_get_generation(void);
+
+// Re-read proxy configuration that is not monitored for changes, such as environment variables.
+void proxy_config_refresh(void);
+
+// Acquire a reference to an immutable snapshot of the user's proxy configuration.
+void *proxy_config_snapshot_acquire(void);
+
+// Release a reference to a proxy configuration snapshot.
+bool proxy_config_snapshot_release(void **ctx);
+
+// Get whether WPAD is enabled in the snapshot.
+bool proxy_config_snapshot_get_auto_discover(const void *ctx);
+
+// Get the proxy auto config (PAC) url in the snapshot, valid until the snapshot is released.
+const char *proxy_config_snapshot_get_auto_config_url(const void *ctx);
+
+// Get the proxy in the snapshot for a given URL scheme, valid until the snapshot is released.
+const char *proxy_config_snapshot_get_proxy(const void *ctx, const char *scheme);
+
+// Get the proxy bypass list in the snapshot, valid until the snapshot is released.
+const char *proxy_config_snapshot_get_bypass_list(const void *ctx);
+
 // Override the user's configured proxy auto configuration (PAC) url.
 void proxy_config_set_auto_config_url_override(const char *auto_config_url);
 
@@ -2,14 +2,56 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <time.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+typedef enum proxy_execute_memo_key {
+    // Results only depend on the host of the url
+    PROXY_EXECUTE_MEMO_KEY_HOST,
+    // Results only depend on the scheme and host of the url
+    PROXY_EXECUTE_MEMO_KEY_SCHEME_HOST,
+    // Results depend on the full url
+    PROXY_EXECUTE_MEMO_KEY_URL
+} proxy_execute_memo_key;
+
+typedef struct proxy_execute_analysis_s {
+    // Script reads the url parameter of FindProxyForURL beyond its scheme
+    bool uses_url;
+    // Script checks the scheme of the url
+    bool uses_scheme;
+    // Script calls timeRange, dateRange or weekdayRange
+    bool uses_time;
+    // Script reads the current time using Date
+    bool uses_date;
+    // Script calls myIpAddress or myIpAddressEx
+    bool uses_my_ip_address;
+    // Script calls functions that resolve host names such as dnsResolve and isInNet
+    bool uses_dns_resolve;
+    // Script evaluates code or calls functions in ways that can't be analyzed
+    bool uses_dynamic_code;
+    // Smallest time boundary in seconds used by the time functions, 0 if not used
+    int32_t time_granularity;
+    // Parts of the url that results can be memoized by
+    proxy_execute_memo_key memo_key;
+} proxy_execute_analysis_s;
+
 // Executes a PAC script for a particular URL.
 bool proxy_execute_get_proxies_for_url(void *ctx, const char *script, const char *url);
 
+// Analyzes what the results of a PAC script depend on to determine how results can be memoized.
+bool proxy_execute_analyze_script(const char *script, proxy_execute_analysis_s *analysis);
+
+// Get the parts of the url that results depend on so that urls which only differ in parts the script does not
+// inspect share results. Caller must free the string returned.
+char *proxy_execute_get_memo_url(const char *url, proxy_execute_memo_key memo_key);
+
+// Maximum number of seconds a result evaluated at the given time can be reused, 0 if results can't be reused and
+// -1 if results do not expire.
+int32_t proxy_execute_get_memo_ttl(const proxy_execute_analysis_s *analysis, time_t now);
+
 // Get the list of proxies returned by the call to `FindProxyForURL`.
 const char *proxy_execute_get_list(void *ctx);
 
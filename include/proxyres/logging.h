@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum proxyres_log_level {
+    PROXYRES_LOG_LEVEL_NONE,
+    PROXYRES_LOG_LEVEL_ERROR,
+    PROXYRES_LOG_LEVEL_WARN,
+    PROXYRES_LOG_LEVEL_INFO,
+    PROXYRES_LOG_LEVEL_DEBUG
+} proxyres_log_level;
+
+typedef enum proxyres_log_category {
+    PROXYRES_LOG_CATEGORY_GENERAL,
+    PROXYRES_LOG_CATEGORY_CONFIG,
+    PROXYRES_LOG_CATEGORY_EXECUTE,
+    PROXYRES_LOG_CATEGORY_FETCH,
+    PROXYRES_LOG_CATEGORY_RESOLVER,
+    PROXYRES_LOG_CATEGORY_THREADPOOL,
+    PROXYRES_LOG_CATEGORY_WPAD,
+    PROXYRES_LOG_CATEGORY_COUNT,
+    PROXYRES_LOG_CATEGORY_ALL = -1
+} proxyres_log_category;
+
+// Callback to receive log messages. Message does not contain a trailing newline.
+typedef void (*proxyres_log_cb)(void *user_data, int32_t level, int32_t category, const char *message);
+
+// Route log messages to a callback instead of stdout. Pass NULL to restore the default sink.
+void proxyres_log_set_callback(proxyres_log_cb callback, void *user_data);
+
+// Set the maximum level of messages logged for a category or PROXYRES_LOG_CATEGORY_ALL.
+void proxyres_log_set_level(int32_t category, int32_t level);
+
+// Set the maximum number of messages logged per second for each category. Zero disables rate limiting.
+void proxyres_log_set_rate_limit(int32_t messages_per_sec);
+
+// Get the name of a log level.
+const char *proxyres_log_get_level_name(int32_t level);
+
+// Get the name of a log category.
+const char *proxyres_log_get_category_name(int32_t category);
+
+#ifdef __cplusplus
+}
+#endif
@@ -6,11 +6,19 @@
 #include "config.h"
 #include "resolver.h"
 #include "execute.h"
+#include "logging.h"
+#include "stats.h"
+#include "trace.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// Prepare state that can only be set up while the process has a single thread, such as the process that helper
+// processes for executing scripts are forked from. Optional, but when used it must be called at the start of main
+// before any threads are created, including by other libraries.
+bool proxyres_global_early_init(void);
+
 // Initialize proxy resolution library
 bool proxyres_global_init(void);
 
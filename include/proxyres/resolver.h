@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #define MAX_PROXY_URL 256
 
@@ -10,9 +11,40 @@
 extern "C" {
 #endif
 
+typedef enum proxy_resolver_fast_status {
+    // Proxy list was written to the buffer
+    PROXY_RESOLVER_FAST_OK,
+    // Proxy auto-config or WPAD is required, use proxy_resolver_get_proxies_for_url instead
+    PROXY_RESOLVER_FAST_NEEDS_ASYNC,
+    // Buffer is not large enough to hold the proxy list
+    PROXY_RESOLVER_FAST_BUFFER_TOO_SMALL,
+    // Invalid arguments or the library is not initialized
+    PROXY_RESOLVER_FAST_ERROR
+} proxy_resolver_fast_status;
+
+typedef struct proxy_resolver_options_s {
+    // Use the system config for any setting that is not specified
+    bool use_system_config;
+    // Discover proxy auto-config url using WPAD
+    bool auto_discover;
+    // Proxy auto-config url
+    const char *auto_config_url;
+    // Proxy auto-config script, evaluated instead of fetching auto_config_url
+    const char *script;
+    // Proxy host and port used for all urls
+    const char *proxy;
+    // Comma separated list of hosts that bypass the proxy
+    const char *bypass_list;
+} proxy_resolver_options_s;
+
 // Asynchronously resolves the proxies for a given URL based on the user's proxy configuration.
 bool proxy_resolver_get_proxies_for_url(void *ctx, const char *url);
 
+// Synchronously resolves the proxies for a given URL into the buffer when the decision does not require evaluating a
+// proxy auto-config script. Does not modify the resolver instance so it can be called from multiple threads.
+proxy_resolver_fast_status proxy_resolver_try_get_proxies_fast(void *ctx, const char *url, char *buffer,
+                                                               size_t buffer_len);
+
 // Gets the list of proxies that have been resolved.
 const char *proxy_resolver_get_list(void *ctx);
 
@@ -31,9 +63,30 @@ bool proxy_resolver_cancel(void *ctx);
 // Create a proxy resolver instance.
 void *proxy_resolver_create(void);
 
-// Deletes a proxy resolver instance.
+// Create a proxy resolver instance with its own configuration. The options are copied into an immutable config
+// snapshot so the resolver can be used in parallel with other resolvers that have different settings.
+void *proxy_resolver_create_ex(const proxy_resolver_options_s *options);
+
+// Deletes a proxy resolver instance. Instances may be reset and kept for reuse by the next create call.
 bool proxy_resolver_delete(void **ctx);
 
+// Sets the proxy auto-config url used by a resolver instance instead of the system config. PAC scripts are
+// shared between resolver instances using the same url. Must not be called while a resolution is pending.
+bool proxy_resolver_set_auto_config_url(void *ctx, const char *auto_config_url);
+
+// Sets the proxy used by a resolver instance instead of the system config. Must not be called while a
+// resolution is pending.
+bool proxy_resolver_set_proxy(void *ctx, const char *proxy);
+
+// Sets the bypass list used with the resolver instance's proxy instead of the system config. Must not be called
+// while a resolution is pending.
+bool proxy_resolver_set_bypass_list(void *ctx, const char *bypass_list);
+
+// Persist the WPAD discovered url and PAC script to disk so they can be used immediately by the next process
+// on the same network. The cache directory defaults to the user's cache directory when NULL. Must be called
+// before proxy_resolver_global_init.
+bool proxy_resolver_set_disk_cache(bool enabled, const char *cache_dir);
+
 // Initialization function for proxy resolution.
 bool proxy_resolver_global_init(void);
 
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Number of log2 buckets in each histogram. Bucket N counts samples less than 2^N microseconds,
+// with the last bucket counting all remaining samples.
+#define PROXYRES_STATS_HISTOGRAM_BUCKETS 24
+// Number of distinct error codes tracked. Additional error codes are counted in errors_other.
+#define PROXYRES_STATS_MAX_ERRORS 16
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct proxyres_histogram_s {
+    // Number of samples recorded
+    uint64_t count;
+    // Sum of all samples in microseconds
+    uint64_t sum_us;
+    // Number of samples in each log2 microsecond bucket
+    uint64_t buckets[PROXYRES_STATS_HISTOGRAM_BUCKETS];
+} proxyres_histogram_s;
+
+typedef struct proxyres_error_count_s {
+    int32_t code;
+    uint64_t count;
+} proxyres_error_count_s;
+
+typedef struct proxyres_stats_s {
+    // Time jobs spent waiting in the thread pool queue
+    proxyres_histogram_s threadpool_queue_wait;
+    // Time spent discovering the PAC url using WPAD
+    proxyres_histogram_s wpad_dhcp_time;
+    proxyres_histogram_s wpad_dns_time;
+    // Time spent downloading PAC scripts and number of bytes downloaded
+    proxyres_histogram_s pac_fetch_time;
+    uint64_t pac_fetch_bytes;
+    // Time spent executing PAC scripts
+    proxyres_histogram_s pac_execute_time;
+    // Time spent evaluating PAC scripts into contexts that can be reused
+    proxyres_histogram_s pac_compile_time;
+    // Number of times an evaluated PAC script context was reused and the evaluation time saved
+    uint64_t pac_compile_cache_hits;
+    uint64_t pac_compile_cache_misses;
+    uint64_t pac_compile_time_saved_us;
+    // Time spent in dnsResolve and dnsResolveEx callbacks
+    proxyres_histogram_s dns_resolve_time;
+    // Number of times a PAC script was run again after resolving the host names it looked up
+    uint64_t pac_dns_restarts;
+    // Number of times the cached WPAD url or PAC script was used
+    uint64_t cache_hits;
+    uint64_t cache_misses;
+    // Number of resolutions completed by an identical resolution already in progress
+    uint64_t coalesced_requests;
+    // Number of resolutions completed by the result of an identical resolution that can still be reused
+    uint64_t memoized_requests;
+    // Number of resolver instances reused from previously deleted instances
+    uint64_t resolver_reuses;
+    // Number of resolution errors by error code
+    proxyres_error_count_s errors[PROXYRES_STATS_MAX_ERRORS];
+    uint64_t errors_other;
+} proxyres_stats_s;
+
+// Get a snapshot of the proxy resolution statistics.
+bool proxyres_get_stats(proxyres_stats_s *stats);
+
+// Reset all proxy resolution statistics to zero.
+void proxyres_reset_stats(void);
+
+// Format statistics using the Prometheus text exposition format. Caller must free the string returned.
+char *proxyres_stats_to_prometheus(const proxyres_stats_s *stats);
+
+#ifdef __cplusplus
+}
+#endif
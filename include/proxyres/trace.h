@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Callback invoked when a span begins or ends. Spans belonging to the same proxy resolution share a request id, which
+// is zero for work not associated with a resolution. Time is monotonic in microseconds.
+typedef void (*proxyres_trace_span_cb)(void *user_data, uint64_t request_id, const char *name, uint64_t time_us);
+
+// Set callbacks to invoke when spans begin and end. Pass NULL to disable.
+void proxyres_trace_set_callbacks(proxyres_trace_span_cb begin_span, proxyres_trace_span_cb end_span,
+                                  void *user_data);
+
+// Start writing spans to a file using the Chrome trace event JSON format.
+bool proxyres_trace_start_json(const char *path);
+
+// Stop writing spans and close the trace file.
+bool proxyres_trace_stop_json(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,354 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <time.h>
+#endif
+
+#include "atomic.h"
+#include "event.h"
+#include "log.h"
+#include "logging.h"
+#include "mutex.h"
+#include "stats_record.h"
+#include "threadpool.h"
+
+#define LOG_RING_SIZE          (256)
+#define LOG_MESSAGE_MAX        (512)
+#define LOG_DEFAULT_RATE_LIMIT (100)
+
+typedef struct log_slot_s {
+    // Sequence number used to hand off slot between producers and consumer
+    uint64_t sequence;
+    int32_t level;
+    int32_t category;
+    char message[LOG_MESSAGE_MAX];
+} log_slot_s;
+
+typedef struct log_category_s {
+    // Rate limiting window start in seconds
+    uint64_t window;
+    // Number of messages logged in current window
+    uint64_t count;
+    // Number of messages dropped since last report
+    uint64_t suppressed;
+} log_category_s;
+
+typedef struct g_log_s {
+    // Whether or not messages are queued to the background thread
+    uint64_t running;
+    // Signal background thread to stop
+    uint64_t stop;
+    // Thread that writes queued messages to the sink
+    void *threadpool;
+    // Signalled when messages are queued so that the background thread only wakes when there is work
+    void *queued;
+    // Sink lock
+    void *mutex;
+    // User sink callback
+    proxyres_log_cb callback;
+    void *user_data;
+    // Maximum messages per second for each category, zero when unlimited
+    uint64_t rate_limit;
+    // Per category settings and counters
+    log_category_s categories[PROXYRES_LOG_CATEGORY_COUNT];
+    // Number of messages dropped because the ring was full
+    uint64_t dropped;
+    // Ring buffer positions
+    uint64_t head;
+    uint64_t tail;
+    log_slot_s ring[LOG_RING_SIZE];
+} g_log_s;
+
+g_log_s g_log = {0, 0, NULL, NULL, NULL, NULL, NULL, LOG_DEFAULT_RATE_LIMIT, {{0, 0, 0}}, 0, 0, 0, {{0, 0, 0, {0}}}};
+
+volatile int32_t g_log_level[PROXYRES_LOG_CATEGORY_COUNT];
+
+static void log_sleep(int32_t timeout_ms) {
+#ifdef _WIN32
+    Sleep(timeout_ms);
+#else
+    struct timespec ts = {timeout_ms / 1000, (timeout_ms % 1000) * 1000000L};
+    nanosleep(&ts, NULL);
+#endif
+}
+
+static void log_write(int32_t level, int32_t category, const char *message) {
+    if (g_log.mutex)
+        mutex_lock(g_log.mutex);
+
+    if (g_log.callback)
+        g_log.callback(g_log.user_data, level, category, message);
+    else
+        printf("%s - %s\n", proxyres_log_get_level_name(level), message);
+
+    if (g_log.mutex)
+        mutex_unlock(g_log.mutex);
+}
+
+static bool log_enqueue(int32_t level, int32_t category, const char *message) {
+    uint64_t pos = atomic_load_u64(&g_log.tail);
+
+    while (true) {
+        log_slot_s *slot = &g_log.ring[pos & (LOG_RING_SIZE - 1)];
+        const uint64_t sequence = atomic_load_acquire_u64(&slot->sequence);
+        const int64_t diff = (int64_t)(sequence - pos);
+
+        if (diff == 0) {
+            // Slot is free, try to claim it
+            if (atomic_cas_u64(&g_log.tail, pos, pos + 1)) {
+                slot->level = level;
+                slot->category = category;
+                strncpy(slot->message, message, sizeof(slot->message) - 1);
+                slot->message[sizeof(slot->message) - 1] = 0;
+                atomic_store_release_u64(&slot->sequence, pos + 1);
+                event_set(g_log.queued);
+                return true;
+            }
+            pos = atomic_load_u64(&g_log.tail);
+        } else if (diff < 0) {
+            // Ring is full, never block the caller
+            atomic_add_u64(&g_log.dropped, 1);
+            event_set(g_log.queued);
+            return false;
+        } else {
+            // Another producer claimed the slot first
+            pos = atomic_load_u64(&g_log.tail);
+        }
+    }
+}
+
+static int32_t log_drain(void) {
+    int32_t count = 0;
+
+    while (true) {
+        const uint64_t pos = g_log.head;
+        log_slot_s *slot = &g_log.ring[pos & (LOG_RING_SIZE - 1)];
+
+        if (atomic_load_acquire_u64(&slot->sequence) != pos + 1)
+            break;
+
+        log_write(slot->level, slot->category, slot->message);
+
+        // Release slot back to producers for the next lap around the ring
+        atomic_store_release_u64(&slot->sequence, pos + LOG_RING_SIZE);
+        atomic_store_release_u64(&g_log.head, pos + 1);
+        count++;
+    }
+
+    const uint64_t dropped = atomic_load_u64(&g_log.dropped);
+    if (dropped) {
+        char message[LOG_MESSAGE_MAX];
+        atomic_add_u64(&g_log.dropped, (uint64_t)0 - dropped);
+        snprintf(message, sizeof(message), "Dropped %llu log messages", (unsigned long long)dropped);
+        log_write(PROXYRES_LOG_LEVEL_WARN, PROXYRES_LOG_CATEGORY_GENERAL, message);
+    }
+
+    return count;
+}
+
+static void log_drain_thread(void *arg) {
+    (void)arg;
+
+    while (!atomic_load_u64(&g_log.stop)) {
+        // Reset before draining so that messages queued after the ring is found empty still wake the thread
+        event_reset(g_log.queued);
+        if (!log_drain())
+            event_wait(g_log.queued, -1);
+    }
+
+    log_drain();
+}
+
+static bool log_check_rate_limit(int32_t category, uint64_t *suppressed) {
+    const uint64_t rate_limit = atomic_load_u64(&g_log.rate_limit);
+    log_category_s *log_category = &g_log.categories[category];
+
+    *suppressed = 0;
+    if (!rate_limit)
+        return true;
+
+    // Start a new window each second and report how many messages were suppressed
+    const uint64_t now = stats_get_time_us() / 1000000;
+    const uint64_t window = atomic_load_u64(&log_category->window);
+    if (window != now && atomic_cas_u64(&log_category->window, window, now)) {
+        *suppressed = atomic_load_u64(&log_category->suppressed);
+        atomic_add_u64(&log_category->suppressed, (uint64_t)0 - *suppressed);
+        atomic_store_u64(&log_category->count, 0);
+    }
+
+    if (atomic_add_u64(&log_category->count, 1) < rate_limit)
+        return true;
+
+    atomic_add_u64(&log_category->suppressed, 1);
+    return false;
+}
+
+void log_printf(int32_t level, int32_t category, const char *fmt, ...) {
+    char message[LOG_MESSAGE_MAX];
+    uint64_t suppressed = 0;
+    va_list args;
+
+    if (level <= PROXYRES_LOG_LEVEL_NONE || !log_is_enabled(level, category))
+        return;
+    if (category < 0 || category >= PROXYRES_LOG_CATEGORY_COUNT)
+        category = PROXYRES_LOG_CATEGORY_GENERAL;
+
+    const bool allowed = log_check_rate_limit(category, &suppressed);
+    const bool running = atomic_load_acquire_u64(&g_log.running) != 0;
+
+    if (suppressed) {
+        snprintf(message, sizeof(message), "Suppressed %llu %s log messages", (unsigned long long)suppressed,
+                 proxyres_log_get_category_name(category));
+        if (!running || !log_enqueue(PROXYRES_LOG_LEVEL_WARN, category, message))
+            log_write(PROXYRES_LOG_LEVEL_WARN, category, message);
+    }
+
+    if (!allowed)
+        return;
+
+    va_start(args, fmt);
+    vsnprintf(message, sizeof(message), fmt, args);
+    va_end(args);
+
+    // Sink receives messages without trailing newline
+    size_t message_len = strlen(message);
+    while (message_len > 0 && (message[message_len - 1] == '\n' || message[message_len - 1] == '\r'))
+        message[--message_len] = 0;
+
+    if (running)
+        log_enqueue(level, category, message);
+    else
+        log_write(level, category, message);
+}
+
+void log_flush(void) {
+    // Wait for the background thread to catch up with the producers
+    while (atomic_load_acquire_u64(&g_log.running) &&
+           atomic_load_acquire_u64(&g_log.head) != atomic_load_u64(&g_log.tail)) {
+        log_sleep(1);
+    }
+}
+
+void proxyres_log_set_callback(proxyres_log_cb callback, void *user_data) {
+    if (g_log.mutex)
+        mutex_lock(g_log.mutex);
+
+    g_log.callback = callback;
+    g_log.user_data = user_data;
+
+    if (g_log.mutex)
+        mutex_unlock(g_log.mutex);
+}
+
+void proxyres_log_set_level(int32_t category, int32_t level) {
+    if (level < PROXYRES_LOG_LEVEL_NONE)
+        level = PROXYRES_LOG_LEVEL_NONE;
+    if (level > PROXYRES_LOG_LEVEL_DEBUG)
+        level = PROXYRES_LOG_LEVEL_DEBUG;
+
+    if (category == PROXYRES_LOG_CATEGORY_ALL) {
+        for (int32_t i = 0; i < PROXYRES_LOG_CATEGORY_COUNT; i++)
+            atomic_store_release_i32(&g_log_level[i], level + 1);
+    } else if (category >= 0 && category < PROXYRES_LOG_CATEGORY_COUNT) {
+        atomic_store_release_i32(&g_log_level[category], level + 1);
+    }
+}
+
+void proxyres_log_set_rate_limit(int32_t messages_per_sec) {
+    atomic_store_u64(&g_log.rate_limit, messages_per_sec > 0 ? (uint64_t)messages_per_sec : 0);
+
+    // Start counting again using the new limit
+    for (int32_t i = 0; i < PROXYRES_LOG_CATEGORY_COUNT; i++)
+        atomic_store_u64(&g_log.categories[i].count, 0);
+}
+
+void log_reset_defaults(void) {
+    proxyres_log_set_callback(NULL, NULL);
+    for (int32_t i = 0; i < PROXYRES_LOG_CATEGORY_COUNT; i++)
+        atomic_store_release_i32(&g_log_level[i], 0);
+    proxyres_log_set_rate_limit(LOG_DEFAULT_RATE_LIMIT);
+}
+
+const char *proxyres_log_get_level_name(int32_t level) {
+    switch (level) {
+    case PROXYRES_LOG_LEVEL_ERROR:
+        return "ERROR";
+    case PROXYRES_LOG_LEVEL_WARN:
+        return "WARNING";
+    case PROXYRES_LOG_LEVEL_INFO:
+        return "INFO";
+    case PROXYRES_LOG_LEVEL_DEBUG:
+        return "DEBUG";
+    }
+    return "NONE";
+}
+
+const char *proxyres_log_get_category_name(int32_t category) {
+    switch (category) {
+    case PROXYRES_LOG_CATEGORY_GENERAL:
+        return "general";
+    case PROXYRES_LOG_CATEGORY_CONFIG:
+        return "config";
+    case PROXYRES_LOG_CATEGORY_EXECUTE:
+        return "execute";
+    case PROXYRES_LOG_CATEGORY_FETCH:
+        return "fetch";
+    case PROXYRES_LOG_CATEGORY_RESOLVER:
+        return "resolver";
+    case PROXYRES_LOG_CATEGORY_THREADPOOL:
+        return "threadpool";
+    case PROXYRES_LOG_CATEGORY_WPAD:
+        return "wpad";
+    }
+    return "unknown";
+}
+
+bool log_global_init(void) {
+    if (atomic_load_u64(&g_log.running))
+        return true;
+
+    for (uint64_t i = 0; i < LOG_RING_SIZE; i++)
+        atomic_store_u64(&g_log.ring[i].sequence, g_log.head + i);
+    atomic_store_u64(&g_log.tail, g_log.head);
+    atomic_store_u64(&g_log.stop, 0);
+
+    g_log.mutex = mutex_create();
+    g_log.queued = event_create();
+    if (!g_log.mutex || !g_log.queued) {
+        log_global_cleanup();
+        return false;
+    }
+
+    // Dedicated thread so that writing to the sink never delays resolver jobs
+    g_log.threadpool = threadpool_create(1, 1);
+    if (!g_log.threadpool || !threadpool_enqueue(g_log.threadpool, NULL, log_drain_thread)) {
+        log_global_cleanup();
+        return false;
+    }
+
+    atomic_store_release_u64(&g_log.running, 1);
+    return true;
+}
+
+bool log_global_cleanup(void) {
+    // New messages are written synchronously from now on
+    atomic_store_release_u64(&g_log.running, 0);
+    atomic_store_u64(&g_log.stop, 1);
+
+    if (g_log.threadpool) {
+        event_set(g_log.queued);
+        threadpool_delete(&g_log.threadpool);
+    }
+
+    if (g_log.queued)
+        event_delete(&g_log.queued);
+    mutex_delete(&g_log.mutex);
+    return true;
+}
@@ -1,15 +1,67 @@
 #pragma once
 
-#define LOG_ERROR(fmt, ...) \
-  { printf("ERROR - "), printf(fmt, ##__VA_ARGS__); }
-#define LOG_WARN(fmt, ...) \
-  { printf("WARNING - "), printf(fmt, ##__VA_ARGS__); }
+#include "atomic.h"
+#include "logging.h"
+
+// Source files can define LOG_CATEGORY before including this header
+#ifndef LOG_CATEGORY
+#  define LOG_CATEGORY PROXYRES_LOG_CATEGORY_GENERAL
+#endif
+
 #ifdef _DEBUG
-#  define LOG_INFO(fmt, ...) \
-    { printf("INFO - "), printf(fmt, ##__VA_ARGS__); }
-#  define LOG_DEBUG(fmt, ...) \
-    { printf("DEBUG - "), printf(fmt, ##__VA_ARGS__); }
+#  define LOG_DEFAULT_LEVEL PROXYRES_LOG_LEVEL_DEBUG
 #else
-#  define LOG_INFO(fmt, ...)
-#  define LOG_DEBUG(fmt, ...)
+#  define LOG_DEFAULT_LEVEL PROXYRES_LOG_LEVEL_WARN
+#endif
+
+// Level is checked before the message arguments are evaluated so that disabled messages are nearly free
+#define LOG_PRINTF(level, fmt, ...)                                  \
+    do {                                                             \
+        if (log_is_enabled(level, LOG_CATEGORY))                     \
+            log_printf(level, LOG_CATEGORY, fmt, ##__VA_ARGS__);     \
+    } while (0)
+
+#define LOG_ERROR(fmt, ...) LOG_PRINTF(PROXYRES_LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#define LOG_WARN(fmt, ...)  LOG_PRINTF(PROXYRES_LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#define LOG_INFO(fmt, ...)  LOG_PRINTF(PROXYRES_LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#define LOG_DEBUG(fmt, ...) LOG_PRINTF(PROXYRES_LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Maximum level logged for each category plus one, zero when using default
+extern volatile int32_t g_log_level[PROXYRES_LOG_CATEGORY_COUNT];
+
+// Check whether messages are logged for a level and category
+static inline bool log_is_enabled(int32_t level, int32_t category) {
+    if (category < 0 || category >= PROXYRES_LOG_CATEGORY_COUNT)
+        category = PROXYRES_LOG_CATEGORY_GENERAL;
+
+    const int32_t max_level = atomic_load_i32(&g_log_level[category]);
+    if (!max_level)
+        return level <= LOG_DEFAULT_LEVEL;
+    return level < max_level;
+}
+
+// Format and queue a log message
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((format(printf, 3, 4)))
+#endif
+void log_printf(int32_t level, int32_t category, const char *fmt, ...);
+
+// Wait for queued log messages to be written
+void log_flush(void);
+
+// Restore default sink, levels and rate limit
+void log_reset_defaults(void);
+
+// Start background thread that writes queued log messages
+bool log_global_init(void);
+
+// Write any queued log messages and stop background thread
+bool log_global_cleanup(void);
+
+#ifdef __cplusplus
+}
 #endif
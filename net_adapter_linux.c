@@ -18,6 +18,8 @@
 #endif
 #include <sys/ioctl.h>
 
+#define LOG_CATEGORY PROXYRES_LOG_CATEGORY_WPAD
+
 #include "log.h"
 #include "net_adapter.h"
 #include "util.h"
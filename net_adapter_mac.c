@@ -16,6 +16,8 @@
 #include <net/if_dl.h>
 #include <sys/sysctl.h>
 
+#define LOG_CATEGORY PROXYRES_LOG_CATEGORY_WPAD
+
 #include "log.h"
 #include "net_adapter.h"
 #include "util.h"
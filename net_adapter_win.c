@@ -10,6 +10,8 @@
 #include <iptypes.h>
 #include <iphlpapi.h>
 
+#define LOG_CATEGORY PROXYRES_LOG_CATEGORY_WPAD
+
 #include "log.h"
 #include "net_adapter.h"
 #include "util.h"
@@ -19,6 +19,8 @@
 
 #include "net_adapter.h"
 #include "net_util.h"
+#include "stats_record.h"
+#include "trace_record.h"
 #include "util.h"
 
 typedef struct address_list {
@@ -127,7 +129,9 @@ static char *dns_resolve_filter(const char *host, int32_t family, uint8_t max_ad
     hints.ai_family = family;
     hints.ai_socktype = SOCK_STREAM;
 
+    const uint64_t start_us = stats_get_time_us();
     err = getaddrinfo(host, NULL, &hints, &address_info);
+    stats_record_since(STATS_DNS_RESOLVE_TIME, start_us);
     if (err != 0)
         goto dns_resolve_error;
 
@@ -195,12 +199,18 @@ dns_resolve_error:
 
 // Resolve a host name to it an IPv4 address
 char *dns_resolve(const char *host, int32_t *error) {
-    return dns_resolve_filter(host, AF_INET, 1, error);
+    trace_begin("dns_resolve");
+    char *addresses = dns_resolve_filter(host, AF_INET, 1, error);
+    trace_end("dns_resolve");
+    return addresses;
 }
 
 // Resolve a host name to its addresses
 char *dns_resolve_ex(const char *host, int32_t *error) {
-    return dns_resolve_filter(host, AF_UNSPEC, UINT8_MAX, error);
+    trace_begin("dns_resolve_ex");
+    char *addresses = dns_resolve_filter(host, AF_UNSPEC, UINT8_MAX, error);
+    trace_end("dns_resolve_ex");
+    return addresses;
 }
 
 #if _WIN32_WINNT < _WIN32_WINNT_VISTA
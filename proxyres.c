@@ -5,12 +5,30 @@
 #include "config.h"
 #ifdef PROXYRES_EXECUTE
 #  include "execute.h"
+#  ifdef HAVE_EXECUTE_PROCESS
+#    include "execute_i.h"
+#    include "execute_process.h"
+#  endif
 #endif
 #include "log.h"
 #include "proxyres.h"
 #include "resolver.h"
+#include "trace_record.h"
+
+bool proxyres_global_early_init(void) {
+#ifdef HAVE_EXECUTE_PROCESS
+    // Helper processes can only be forked safely from a process without other threads
+    if (!proxy_execute_process_zygote_init())
+        return false;
+#endif
+    return true;
+}
 
 bool proxyres_global_init(void) {
+    if (!log_global_init())
+        LOG_WARN("Failed to initialize logging\n");
+    if (!trace_global_init())
+        LOG_WARN("Failed to initialize tracing\n");
     if (!proxy_config_global_init())
         LOG_WARN("Failed to initialize proxy config\n");
 #ifdef PROXYRES_EXECUTE
@@ -28,5 +46,7 @@ bool proxyres_global_cleanup(void) {
     proxy_execute_global_cleanup();
 #endif
     proxy_config_global_cleanup();
+    trace_global_cleanup();
+    log_global_cleanup();
     return true;
 }
@@ -6,21 +6,32 @@
 #include <inttypes.h>
 
 #include <errno.h>
+#include <time.h>
 #ifdef _WIN32
 #  include <windows.h>
 #  include <winsock2.h>
 #endif
 
+#define LOG_CATEGORY PROXYRES_LOG_CATEGORY_RESOLVER
+
+#include "atomic.h"
+#include "bypass.h"
 #include "config.h"
+#include "config_i.h"
+#include "event.h"
 #include "log.h"
+#include "mutex.h"
 #include "resolver.h"
+#include "resolver_config.h"
 #include "resolver_i.h"
 #if defined(__APPLE__)
 #  include "resolver_mac.h"
 #elif defined(__linux__)
+#  include "resolver_daemon.h"
 #  include "resolver_gnome3.h"
 #  ifdef PROXYRES_EXECUTE
 #    include "resolver_posix.h"
+#    include "wpad_cache.h"
 #  endif
 #elif defined(_WIN32)
 #  if WINAPI_FAMILY == WINAPI_FAMILY_DESKTOP_APP
@@ -30,13 +41,77 @@
 #    include "resolver_winrt.h"
 #  endif
 #endif
+#ifdef PROXYRES_EXECUTE
+#  include "script_store.h"
+#endif
+#include "stats_record.h"
 #include "threadpool.h"
+#include "trace_record.h"
 #include "util.h"
 
 #ifdef __cplusplus
 #  define delete f_delete
 #endif
 
+#define PROXY_RESOLVER_POOL_SIZE      (64)
+#define PROXY_RESOLVER_FLIGHT_BUCKETS (64)
+#define PROXY_RESOLVER_MEMO_BUCKETS   (256)
+#define PROXY_RESOLVER_MEMO_MAX       (1024)
+
+struct proxy_resolver_s;
+
+// How the proxy list is determined for a resolver instance, derived whenever its config is replaced
+typedef enum proxy_resolver_route_e {
+    // Proxy auto-config must be evaluated
+    PROXY_RESOLVER_ROUTE_EXECUTE,
+    // Proxy specified for the instance with its own bypass list
+    PROXY_RESOLVER_ROUTE_PROXY,
+    // Proxy specified for the instance with the system bypass list
+    PROXY_RESOLVER_ROUTE_PROXY_SYSTEM_BYPASS,
+    // Direct connection since there is nothing to evaluate
+    PROXY_RESOLVER_ROUTE_DIRECT,
+    // System config, unless it requires proxy auto-config to be evaluated
+    PROXY_RESOLVER_ROUTE_SYSTEM
+} proxy_resolver_route_e;
+
+typedef struct proxy_resolver_flight_s {
+    // Url being resolved
+    char *url;
+    // Parts of the url that the result depends on
+    char *key;
+    uint64_t key_hash;
+    // Config snapshot used for the resolution, NULL to use system config
+    proxy_resolver_config_s *config;
+    // What the result depends on, results are only memoized if the script was analyzed
+    proxy_execute_analysis_s analysis;
+    bool is_analyzed;
+    // Time the resolution started and generations of the system config and cached script at that time
+    time_t start_time;
+    uint64_t config_generation;
+    uint64_t script_generation;
+    // Resolver instances completed with the result
+    struct proxy_resolver_s *waiters;
+    // Next flight in bucket
+    struct proxy_resolver_flight_s *next;
+} proxy_resolver_flight_s;
+
+typedef struct proxy_resolver_memo_s {
+    // Parts of the url that the result depends on
+    char *key;
+    uint64_t key_hash;
+    // Config snapshot used for the resolution, NULL to use system config
+    proxy_resolver_config_s *config;
+    // Proxy list returned by the script
+    char *list;
+    // Time the result can no longer be reused, 0 if it does not expire
+    time_t expires;
+    // Generations of the system config and cached script the result was evaluated with
+    uint64_t config_generation;
+    uint64_t script_generation;
+    // Next memo in bucket
+    struct proxy_resolver_memo_s *next;
+} proxy_resolver_memo_s;
+
 typedef struct g_proxy_resolver_s {
     // Library reference count
     int32_t ref_count;
@@ -44,6 +119,18 @@ typedef struct g_proxy_resolver_s {
     const proxy_resolver_i_s *proxy_resolver_i;
     // Thread pool
     void *threadpool;
+    // Deleted resolver instances kept for reuse, each slot is claimed with compare and swap
+    void *volatile pool[PROXY_RESOLVER_POOL_SIZE];
+    // Lock for resolutions in progress
+    void *flight_mutex;
+    // Resolutions in progress by url
+    proxy_resolver_flight_s *flights[PROXY_RESOLVER_FLIGHT_BUCKETS];
+    // Results of completed resolutions by url, protected by the flight lock
+    proxy_resolver_memo_s *memos[PROXY_RESOLVER_MEMO_BUCKETS];
+    int32_t memo_count;
+    // Number of resolutions still being evaluated and event signalled when there are none
+    int32_t flight_count;
+    void *flights_done;
 } g_proxy_resolver_s;
 
 g_proxy_resolver_s g_proxy_resolver;
@@ -57,6 +144,18 @@ typedef struct proxy_resolver_s {
     char *list;
     // Next proxy pointer
     const char *listp;
+    // Immutable config snapshot, NULL to use system config
+    proxy_resolver_config_s *config;
+    // How the proxy list is determined for the config
+    proxy_resolver_route_e route;
+    // Resolution was handed off to the underlying resolver
+    bool pending;
+    // Identical resolution in progress that this instance is waiting on
+    proxy_resolver_flight_s *flight;
+    // Next instance waiting on the same resolution
+    struct proxy_resolver_s *next_waiter;
+    // Resolution that this internal instance is evaluating for its waiters
+    proxy_resolver_flight_s *evaluating;
 } proxy_resolver_s;
 
 static void proxy_resolver_get_proxies_for_url_threadpool(void *arg) {
@@ -66,80 +165,557 @@ static void proxy_resolver_get_proxies_for_url_threadpool(void *arg) {
     g_proxy_resolver.proxy_resolver_i->get_proxies_for_url(proxy_resolver->base, proxy_resolver->url);
 }
 
-static bool proxy_resolver_get_proxies_for_url_from_system_config(void *ctx, const char *url) {
-    proxy_resolver_s *proxy_resolver = (proxy_resolver_s *)ctx;
-    char *auto_config_url = NULL;
-    char *proxy = NULL;
-    char *scheme = NULL;
+static proxy_resolver_s *proxy_resolver_pool_pop(void) {
+    for (int32_t i = 0; i < PROXY_RESOLVER_POOL_SIZE; i++) {
+        void *proxy_resolver = atomic_load_acquire_ptr(&g_proxy_resolver.pool[i]);
+        if (proxy_resolver && atomic_cas_ptr(&g_proxy_resolver.pool[i], proxy_resolver, NULL))
+            return (proxy_resolver_s *)proxy_resolver;
+    }
+    return NULL;
+}
+
+static bool proxy_resolver_pool_push(proxy_resolver_s *proxy_resolver) {
+    const proxy_resolver_i_s *proxy_resolver_i = g_proxy_resolver.proxy_resolver_i;
+
+    // Only reuse instances that can be reset and are not still resolving
+    if (!proxy_resolver_i->reset)
+        return false;
+    if (proxy_resolver->pending && !proxy_resolver_i->wait(proxy_resolver->base, 0))
+        return false;
+    if (proxy_resolver_i->set_config && !proxy_resolver_i->set_config(proxy_resolver->base, NULL))
+        return false;
+    if (!proxy_resolver_i->reset(proxy_resolver->base))
+        return false;
+    proxy_resolver->pending = false;
+
+    for (int32_t i = 0; i < PROXY_RESOLVER_POOL_SIZE; i++) {
+        if (atomic_cas_ptr(&g_proxy_resolver.pool[i], NULL, proxy_resolver))
+            return true;
+    }
+    return false;
+}
+
+static proxy_resolver_route_e proxy_resolver_get_route(const proxy_resolver_config_s *config) {
+    if (config && config->proxy) {
+        if (config->bypass_list || !config->use_system_config)
+            return PROXY_RESOLVER_ROUTE_PROXY;
+        return PROXY_RESOLVER_ROUTE_PROXY_SYSTEM_BYPASS;
+    }
+    if (proxy_resolver_config_needs_execute(config))
+        return PROXY_RESOLVER_ROUTE_EXECUTE;
+    if (config && !config->use_system_config)
+        return PROXY_RESOLVER_ROUTE_DIRECT;
+    if (g_proxy_resolver.proxy_resolver_i->uses_system_config)
+        return PROXY_RESOLVER_ROUTE_EXECUTE;
+    return PROXY_RESOLVER_ROUTE_SYSTEM;
+}
+
+static proxy_resolver_s *proxy_resolver_alloc(void) {
+    // Reuse previously deleted instance to avoid creating the underlying resolver again
+    proxy_resolver_s *proxy_resolver = proxy_resolver_pool_pop();
+    if (proxy_resolver) {
+        stats_add(STATS_RESOLVER_REUSES, 1);
+    } else {
+        proxy_resolver = (proxy_resolver_s *)calloc(1, sizeof(proxy_resolver_s));
+        if (!proxy_resolver)
+            return NULL;
+        proxy_resolver->base = g_proxy_resolver.proxy_resolver_i->create();
+        if (!proxy_resolver->base) {
+            free(proxy_resolver);
+            return NULL;
+        }
+    }
+    proxy_resolver->route = proxy_resolver_get_route(NULL);
+    return proxy_resolver;
+}
+
+static void proxy_resolver_free(proxy_resolver_s *proxy_resolver) {
+    free(proxy_resolver->url);
+    proxy_resolver->url = NULL;
+    free(proxy_resolver->list);
+    proxy_resolver->list = NULL;
+    proxy_resolver->listp = NULL;
+    proxy_resolver_config_release(&proxy_resolver->config);
+    if (!proxy_resolver_pool_push(proxy_resolver)) {
+        g_proxy_resolver.proxy_resolver_i->delete(&proxy_resolver->base);
+        free(proxy_resolver);
+    }
+}
 
-    // Skip if auto-config url evaluation is required for proxy resolution
-    auto_config_url = proxy_config_get_auto_config_url();
-    if (auto_config_url)
-        goto config_done;
+static void proxy_resolver_pool_clear(void) {
+    proxy_resolver_s *proxy_resolver = NULL;
+    while ((proxy_resolver = proxy_resolver_pool_pop()) != NULL) {
+        g_proxy_resolver.proxy_resolver_i->delete(&proxy_resolver->base);
+        free(proxy_resolver);
+    }
+}
+
+// Get what the result of the script used for the config depends on and the generation of the cached script, false
+// if the script is not known until it is evaluated
+static bool proxy_resolver_flight_get_analysis(const proxy_resolver_config_s *config,
+                                               proxy_execute_analysis_s *analysis, uint64_t *script_generation) {
+    bool is_analyzed = false;
+
+    *script_generation = 0;
+    if (config && config->script) {
+        if (config->is_analyzed)
+            *analysis = config->analysis;
+        return config->is_analyzed;
+    }
+#ifdef PROXYRES_EXECUTE
+    if (config && config->auto_config_url)
+        return script_store_get_analysis(config->auto_config_url, analysis, script_generation);
+
+    // Script discovered using WPAD is not known until it is evaluated
+    if ((config && config->auto_discover) || !proxy_resolver_config_uses_system_config(config))
+        return false;
+
+    void *system_config = proxy_config_snapshot_acquire();
+    if (system_config && !proxy_config_snapshot_get_auto_discover(system_config)) {
+        const char *auto_config_url = proxy_config_snapshot_get_auto_config_url(system_config);
+        if (auto_config_url)
+            is_analyzed = script_store_get_analysis(auto_config_url, analysis, script_generation);
+    }
+    proxy_config_snapshot_release(&system_config);
+#endif
+    return is_analyzed;
+}
+
+// Resolutions of urls that only differ in parts the script does not inspect share a result
+static char *proxy_resolver_flight_get_key(const char *url, proxy_execute_memo_key memo_key) {
+#ifdef PROXYRES_EXECUTE
+    return proxy_execute_get_memo_url(url, memo_key);
+#else
+    UNUSED(memo_key);
+    return strdup(url);
+#endif
+}
+
+static uint64_t proxy_resolver_flight_hash(const proxy_resolver_config_s *config, const char *key) {
+    // Only resolutions using identical settings are identical
+    return hash_fnv1a(key, strlen(key), proxy_resolver_config_get_hash(config) ^ HASH_FNV1A_INIT);
+}
+
+// Must be called with lock held
+static proxy_resolver_flight_s **proxy_resolver_flight_find(const proxy_resolver_config_s *config, const char *key,
+                                                            uint64_t key_hash) {
+    proxy_resolver_flight_s **flightp = &g_proxy_resolver.flights[key_hash % PROXY_RESOLVER_FLIGHT_BUCKETS];
+    while (*flightp) {
+        if ((*flightp)->key_hash == key_hash && strcmp((*flightp)->key, key) == 0 &&
+            proxy_resolver_config_equals((*flightp)->config, config))
+            break;
+        flightp = &(*flightp)->next;
+    }
+    return flightp;
+}
+
+// Must be called with lock held
+static proxy_resolver_memo_s **proxy_resolver_memo_find(const proxy_resolver_config_s *config, const char *key,
+                                                        uint64_t key_hash) {
+    proxy_resolver_memo_s **memop = &g_proxy_resolver.memos[key_hash % PROXY_RESOLVER_MEMO_BUCKETS];
+    while (*memop) {
+        if ((*memop)->key_hash == key_hash && strcmp((*memop)->key, key) == 0 &&
+            proxy_resolver_config_equals((*memop)->config, config))
+            break;
+        memop = &(*memop)->next;
+    }
+    return memop;
+}
+
+static bool proxy_resolver_memo_is_valid(const proxy_resolver_memo_s *memo, time_t now, uint64_t config_generation,
+                                         uint64_t script_generation) {
+    if (memo->expires && memo->expires <= now)
+        return false;
+    return memo->config_generation == config_generation && memo->script_generation == script_generation;
+}
+
+// Must be called with lock held
+static void proxy_resolver_memo_remove(proxy_resolver_memo_s **memop) {
+    proxy_resolver_memo_s *memo = *memop;
+    *memop = memo->next;
+    g_proxy_resolver.memo_count--;
+    proxy_resolver_config_release(&memo->config);
+    free(memo->list);
+    free(memo->key);
+    free(memo);
+}
+
+// Must be called with lock held, removes expired results and results of previous system configs
+static void proxy_resolver_memo_prune(time_t now) {
+    const uint64_t config_generation = proxy_config_get_generation();
+    for (int32_t i = 0; i < PROXY_RESOLVER_MEMO_BUCKETS; i++) {
+        proxy_resolver_memo_s **memop = &g_proxy_resolver.memos[i];
+        while (*memop) {
+            if (!proxy_resolver_memo_is_valid(*memop, now, config_generation, (*memop)->script_generation))
+                proxy_resolver_memo_remove(memop);
+            else
+                memop = &(*memop)->next;
+        }
+    }
+}
+
+// Must be called with lock held
+static void proxy_resolver_memo_clear(void) {
+    for (int32_t i = 0; i < PROXY_RESOLVER_MEMO_BUCKETS; i++) {
+        while (g_proxy_resolver.memos[i])
+            proxy_resolver_memo_remove(&g_proxy_resolver.memos[i]);
+    }
+}
+
+// Must be called with lock held, remembers the result until the script could return a different result
+static void proxy_resolver_memo_insert(const proxy_resolver_flight_s *flight, const char *list) {
+    if (!flight->is_analyzed || !list)
+        return;
+
+#ifdef PROXYRES_EXECUTE
+    const int32_t ttl = proxy_execute_get_memo_ttl(&flight->analysis, flight->start_time);
+#else
+    const int32_t ttl = 0;
+#endif
+    if (ttl == 0)
+        return;
+
+    proxy_resolver_memo_s **memop = proxy_resolver_memo_find(flight->config, flight->key, flight->key_hash);
+    if (*memop)
+        proxy_resolver_memo_remove(memop);
+    if (g_proxy_resolver.memo_count >= PROXY_RESOLVER_MEMO_MAX) {
+        proxy_resolver_memo_prune(time(NULL));
+        // Results of scripts that were fetched again are only known to be stale once looked up, start over instead
+        if (g_proxy_resolver.memo_count >= PROXY_RESOLVER_MEMO_MAX)
+            proxy_resolver_memo_clear();
+    }
+
+    proxy_resolver_memo_s *memo = (proxy_resolver_memo_s *)calloc(1, sizeof(proxy_resolver_memo_s));
+    if (!memo)
+        return;
+    memo->key = strdup(flight->key);
+    memo->list = strdup(list);
+    if (!memo->key || !memo->list) {
+        free(memo->key);
+        free(memo->list);
+        free(memo);
+        return;
+    }
+    memo->key_hash = flight->key_hash;
+    memo->config = proxy_resolver_config_acquire(flight->config);
+    memo->expires = ttl < 0 ? 0 : flight->start_time + ttl;
+    memo->config_generation = flight->config_generation;
+    memo->script_generation = flight->script_generation;
+
+    memop = &g_proxy_resolver.memos[flight->key_hash % PROXY_RESOLVER_MEMO_BUCKETS];
+    memo->next = *memop;
+    *memop = memo;
+    g_proxy_resolver.memo_count++;
+}
+
+static void proxy_resolver_flight_complete(proxy_resolver_flight_s *flight, const char *list, int32_t error) {
+    mutex_lock(g_proxy_resolver.flight_mutex);
+
+    // Remove flight so that new resolutions for the url start another evaluation
+    proxy_resolver_flight_s **flightp = proxy_resolver_flight_find(flight->config, flight->key, flight->key_hash);
+    if (*flightp == flight)
+        *flightp = flight->next;
+
+    // New resolutions for the url use the result instead of evaluating the script again
+    if (!error)
+        proxy_resolver_memo_insert(flight, list);
+
+    // Complete waiters while locked so that they can't be deleted until they have their result
+    proxy_resolver_s *waiter = flight->waiters;
+    while (waiter) {
+        proxy_resolver_s *next_waiter = waiter->next_waiter;
+        waiter->flight = NULL;
+        waiter->next_waiter = NULL;
+        g_proxy_resolver.proxy_resolver_i->set_result(waiter->base, list, error);
+        waiter = next_waiter;
+    }
+
+    mutex_unlock(g_proxy_resolver.flight_mutex);
+
+    proxy_resolver_config_release(&flight->config);
+    free(flight->key);
+    free(flight->url);
+    free(flight);
+}
+
+static void proxy_resolver_flight_end(void) {
+    mutex_lock(g_proxy_resolver.flight_mutex);
+    if (--g_proxy_resolver.flight_count == 0)
+        event_set(g_proxy_resolver.flights_done);
+    mutex_unlock(g_proxy_resolver.flight_mutex);
+}
+
+static void proxy_resolver_flight_evaluated(void *user_data) {
+    proxy_resolver_s *proxy_resolver = (proxy_resolver_s *)user_data;
+    const proxy_resolver_i_s *proxy_resolver_i = g_proxy_resolver.proxy_resolver_i;
+    proxy_resolver_flight_s *flight = proxy_resolver->evaluating;
+
+    proxy_resolver->evaluating = NULL;
+    proxy_resolver_flight_complete(flight, proxy_resolver_i->get_list(proxy_resolver->base),
+                                   proxy_resolver_i->get_error(proxy_resolver->base));
+    proxy_resolver_free(proxy_resolver);
+    proxy_resolver_flight_end();
+}
+
+static void proxy_resolver_flight_threadpool(void *arg) {
+    proxy_resolver_flight_s *flight = (proxy_resolver_flight_s *)arg;
+    const proxy_resolver_i_s *proxy_resolver_i = g_proxy_resolver.proxy_resolver_i;
+
+    // Evaluate using a separate instance since any of the waiters may be deleted once completed
+    proxy_resolver_s *proxy_resolver = proxy_resolver_alloc();
+    if (!proxy_resolver || (flight->config && !proxy_resolver_i->set_config(proxy_resolver->base, flight->config))) {
+        proxy_resolver_flight_complete(flight, NULL, ENOMEM);
+        if (proxy_resolver)
+            proxy_resolver_free(proxy_resolver);
+        proxy_resolver_flight_end();
+        return;
+    }
+    proxy_resolver->evaluating = flight;
+
+    // Evaluation may finish on another thread so that this one is free while the script waits on host names
+    if (proxy_resolver_i->get_proxies_for_url_async &&
+        proxy_resolver_i->get_proxies_for_url_async(proxy_resolver->base, flight->url,
+                                                    proxy_resolver_flight_evaluated, proxy_resolver))
+        return;
+
+    proxy_resolver_i->get_proxies_for_url(proxy_resolver->base, flight->url);
+    proxy_resolver_flight_evaluated(proxy_resolver);
+}
+
+static bool proxy_resolver_flight_join(proxy_resolver_s *proxy_resolver, const char *url) {
+    proxy_resolver_flight_s *flight = NULL;
+    proxy_execute_analysis_s analysis;
+    uint64_t script_generation = 0;
+
+    // Key is determined before locking since it may need to look at the cached script, generations are read first so
+    // that results are never associated with a newer config or script than they were evaluated with
+    const time_t start_time = time(NULL);
+    const uint64_t config_generation = proxy_config_get_generation();
+    const bool is_analyzed = proxy_resolver_flight_get_analysis(proxy_resolver->config, &analysis, &script_generation);
+    char *key = proxy_resolver_flight_get_key(url, is_analyzed ? analysis.memo_key : PROXY_EXECUTE_MEMO_KEY_URL);
+    if (!key) {
+        LOG_ERROR("Unable to allocate memory for %s (%" PRId32 ")\n", "flight key", (int32_t)ENOMEM);
+        return false;
+    }
+    const uint64_t key_hash = proxy_resolver_flight_hash(proxy_resolver->config, key);
+
+    mutex_lock(g_proxy_resolver.flight_mutex);
+
+    // Use result of identical resolution that completed recently if the script would return the same result
+    if (is_analyzed) {
+        proxy_resolver_memo_s **memop = proxy_resolver_memo_find(proxy_resolver->config, key, key_hash);
+        if (*memop && proxy_resolver_memo_is_valid(*memop, start_time, config_generation, script_generation)) {
+            g_proxy_resolver.proxy_resolver_i->set_result(proxy_resolver->base, (*memop)->list, 0);
+            mutex_unlock(g_proxy_resolver.flight_mutex);
+            free(key);
+            stats_add(STATS_MEMOIZED_REQUESTS, 1);
+            return true;
+        }
+        if (*memop)
+            proxy_resolver_memo_remove(memop);
+    }
+
+    // Wait on identical resolution that is already in progress
+    proxy_resolver_flight_s **flightp = proxy_resolver_flight_find(proxy_resolver->config, key, key_hash);
+    if (*flightp) {
+        proxy_resolver->flight = *flightp;
+        proxy_resolver->next_waiter = (*flightp)->waiters;
+        (*flightp)->waiters = proxy_resolver;
+        mutex_unlock(g_proxy_resolver.flight_mutex);
+        free(key);
+        stats_add(STATS_COALESCED_REQUESTS, 1);
+        return true;
+    }
+
+    flight = (proxy_resolver_flight_s *)calloc(1, sizeof(proxy_resolver_flight_s));
+    if (flight)
+        flight->url = strdup(url);
+    if (!flight || !flight->url) {
+        mutex_unlock(g_proxy_resolver.flight_mutex);
+        LOG_ERROR("Unable to allocate memory for %s (%" PRId32 ")\n", "flight", (int32_t)ENOMEM);
+        free(flight);
+        free(key);
+        return false;
+    }
+    flight->key = key;
+    flight->key_hash = key_hash;
+    flight->config = proxy_resolver_config_acquire(proxy_resolver->config);
+    if (is_analyzed)
+        flight->analysis = analysis;
+    flight->is_analyzed = is_analyzed;
+    flight->start_time = start_time;
+    flight->config_generation = config_generation;
+    flight->script_generation = script_generation;
+    flight->waiters = proxy_resolver;
+    proxy_resolver->flight = flight;
+    *flightp = flight;
+    if (g_proxy_resolver.flight_count++ == 0)
+        event_reset(g_proxy_resolver.flights_done);
+
+    mutex_unlock(g_proxy_resolver.flight_mutex);
+
+    if (!threadpool_enqueue(g_proxy_resolver.threadpool, flight, proxy_resolver_flight_threadpool)) {
+        // Waiters that joined in the meantime are completed with an error
+        proxy_resolver_flight_complete(flight, NULL, ENOMEM);
+        proxy_resolver_flight_end();
+        return false;
+    }
+    return true;
+}
+
+static void proxy_resolver_flight_leave(proxy_resolver_s *proxy_resolver) {
+    if (!g_proxy_resolver.flight_mutex)
+        return;
+    mutex_lock(g_proxy_resolver.flight_mutex);
+    if (proxy_resolver->flight) {
+        proxy_resolver_s **waiterp = &proxy_resolver->flight->waiters;
+        while (*waiterp && *waiterp != proxy_resolver)
+            waiterp = &(*waiterp)->next_waiter;
+        if (*waiterp)
+            *waiterp = proxy_resolver->next_waiter;
+        proxy_resolver->flight = NULL;
+        proxy_resolver->next_waiter = NULL;
+    }
+    mutex_unlock(g_proxy_resolver.flight_mutex);
+}
+
+static size_t proxy_resolver_print_list_for_proxy(const char *url, const char *proxy, const char *scheme,
+                                                  bool should_bypass, char *list, size_t max_list) {
+    // Check if we need to bypass the proxy for the url
+    if (should_bypass) {
+        // Bypass the proxy for the url
+        LOG_INFO("Bypassing proxy for %s\n", url);
+        return (size_t)snprintf(list, max_list, "direct://");
+    }
+
+    // Construct proxy list url using scheme associated with proxy's port if available,
+    // otherwise continue to use scheme associated with the url.
+    const uint16_t proxy_port = get_host_port(proxy, strlen(proxy), 0);
+    const char *proxy_scheme = proxy_port ? get_port_scheme(proxy_port, scheme) : scheme;
+
+    // Use proxy from settings
+    return get_url_from_host_buffer(proxy_scheme, proxy, list, max_list);
+}
+
+// Determine proxy list from instance or system config if it does not require evaluating a PAC script
+static proxy_resolver_fast_status proxy_resolver_print_list_from_config(proxy_resolver_s *proxy_resolver,
+                                                                        const char *url, char *list, size_t max_list,
+                                                                        size_t *list_len) {
+    const proxy_resolver_config_s *config = proxy_resolver->config;
+    proxy_resolver_fast_status status = PROXY_RESOLVER_FAST_NEEDS_ASYNC;
+    void *system_config = NULL;
+    char scheme[16] = "http";
+
+    if (proxy_resolver->route == PROXY_RESOLVER_ROUTE_EXECUTE)
+        return PROXY_RESOLVER_FAST_NEEDS_ASYNC;
 
     // Use scheme associated with the URL when determining proxy
-    scheme = get_url_scheme(url, "http");
-    if (!scheme) {
-        LOG_ERROR("Unable to allocate memory for scheme\n");
-        goto config_done;
-    }
-
-    // Check if manually configured proxy is specified in system config
-    proxy = proxy_config_get_proxy(scheme);
-    if (proxy) {
-        // Check if we need to bypass the proxy for the url
-        char *bypass_list = proxy_config_get_bypass_list();
-        bool should_bypass = should_bypass_proxy(url, bypass_list);
-        if (should_bypass) {
-            // Bypass the proxy for the url
-            LOG_INFO("Bypassing proxy for %s (%s)\n", url, bypass_list ? bypass_list : "null");
-            proxy_resolver->list = strdup("direct://");
-        } else {
-            // Construct proxy list url using scheme associated with proxy's port if available,
-            // otherwise continue to use scheme associated with the url.
-            const uint16_t proxy_port = get_host_port(proxy, strlen(proxy), 0);
-            const char *proxy_scheme = proxy_port ? get_port_scheme(proxy_port, scheme) : scheme;
-
-            // Use proxy from settings
-            proxy_resolver->list = get_url_from_host(proxy_scheme, proxy);
+    const char *scheme_end = strstr(url, "://");
+    if (scheme_end && (size_t)(scheme_end - url) < sizeof(scheme)) {
+        memcpy(scheme, url, (size_t)(scheme_end - url));
+        scheme[scheme_end - url] = 0;
+    }
+
+    switch (proxy_resolver->route) {
+    case PROXY_RESOLVER_ROUTE_PROXY:
+        // Use proxy specified for this resolver instance
+        *list_len = proxy_resolver_print_list_for_proxy(url, config->proxy, scheme,
+                                                        bypass_should_bypass(config->bypass, url), list, max_list);
+        status = PROXY_RESOLVER_FAST_OK;
+        break;
+    case PROXY_RESOLVER_ROUTE_PROXY_SYSTEM_BYPASS:
+        system_config = proxy_config_snapshot_acquire();
+        *list_len = proxy_resolver_print_list_for_proxy(
+            url, config->proxy, scheme, proxy_config_snapshot_should_bypass(system_config, url), list, max_list);
+        status = PROXY_RESOLVER_FAST_OK;
+        break;
+    case PROXY_RESOLVER_ROUTE_DIRECT:
+        // Use DIRECT connection since there is nothing to evaluate
+        *list_len = (size_t)snprintf(list, max_list, "direct://");
+        status = PROXY_RESOLVER_FAST_OK;
+        break;
+    case PROXY_RESOLVER_ROUTE_SYSTEM:
+        // Config strings are borrowed from the snapshot so they are not copied for each url
+        system_config = proxy_config_snapshot_acquire();
+
+        // Skip if auto-config url evaluation is required for proxy resolution
+        if (system_config && !proxy_config_snapshot_get_auto_config_url(system_config)) {
+            // Check if manually configured proxy is specified in system config
+            const char *proxy = proxy_config_snapshot_get_proxy(system_config, scheme);
+            if (proxy) {
+                const bool should_bypass = proxy_config_snapshot_should_bypass(system_config, url);
+                *list_len = proxy_resolver_print_list_for_proxy(url, proxy, scheme, should_bypass, list, max_list);
+                status = PROXY_RESOLVER_FAST_OK;
+            } else if (!proxy_config_snapshot_get_auto_discover(system_config)) {
+                // Use DIRECT connection since proxy auto-discovery is not necessary
+                *list_len = (size_t)snprintf(list, max_list, "direct://");
+                status = PROXY_RESOLVER_FAST_OK;
+            }
         }
-        free(bypass_list);
-    } else if (!proxy_config_get_auto_discover()) {
-        // Use DIRECT connection since proxy auto-discovery is not necessary
-        proxy_resolver->list = strdup("direct://");
+        break;
+    case PROXY_RESOLVER_ROUTE_EXECUTE:
+        break;
     }
 
-config_done:
+    proxy_config_snapshot_release(&system_config);
+
+    if (status == PROXY_RESOLVER_FAST_OK && *list_len >= max_list)
+        status = PROXY_RESOLVER_FAST_BUFFER_TOO_SMALL;
+    return status;
+}
+
+static bool proxy_resolver_get_proxies_for_url_from_config(proxy_resolver_s *proxy_resolver, const char *url) {
+    char list[MAX_PROXY_URL];
+    size_t list_len = 0;
 
-    free(scheme);
-    free(proxy);
-    free(auto_config_url);
+    proxy_resolver_fast_status status =
+        proxy_resolver_print_list_from_config(proxy_resolver, url, list, sizeof(list), &list_len);
+    if (status == PROXY_RESOLVER_FAST_OK) {
+        proxy_resolver->list = strdup(list);
+        return proxy_resolver->list != NULL;
+    }
 
+    // Allocate space for proxy lists that are larger than the stack buffer
+    while (status == PROXY_RESOLVER_FAST_BUFFER_TOO_SMALL) {
+        const size_t max_list = list_len + 1;
+        free(proxy_resolver->list);
+        proxy_resolver->list = (char *)malloc(max_list);
+        if (!proxy_resolver->list)
+            return false;
+        status = proxy_resolver_print_list_from_config(proxy_resolver, url, proxy_resolver->list, max_list, &list_len);
+    }
+    if (status != PROXY_RESOLVER_FAST_OK) {
+        free(proxy_resolver->list);
+        proxy_resolver->list = NULL;
+    }
     return proxy_resolver->list != NULL;
 }
 
-bool proxy_resolver_get_proxies_for_url(void *ctx, const char *url) {
+static bool proxy_resolver_start(void *ctx, const char *url) {
     proxy_resolver_s *proxy_resolver = (proxy_resolver_s *)ctx;
-    if (!proxy_resolver || !g_proxy_resolver.proxy_resolver_i)
-        return false;
 
     proxy_resolver->listp = NULL;
+    proxy_resolver->pending = false;
     free(proxy_resolver->list);
     proxy_resolver->list = NULL;
 
-    // Check if OS resolver already takes into account system configuration
-    if (!g_proxy_resolver.proxy_resolver_i->uses_system_config) {
-        // Check if auto-discovery is necessary
-        if (proxy_resolver_get_proxies_for_url_from_system_config(ctx, url)) {
-            // Use system proxy configuration if no auto-discovery mechanism is necessary
-            return true;
-        }
-    }
+    // Use instance or system proxy configuration if no auto-discovery mechanism is necessary
+    if (proxy_resolver_get_proxies_for_url_from_config(proxy_resolver, url))
+        return true;
+
+    // Clear result of previous resolution so that waiting does not complete early
+    if (g_proxy_resolver.proxy_resolver_i->reset)
+        g_proxy_resolver.proxy_resolver_i->reset(proxy_resolver->base);
+    proxy_resolver->pending = true;
 
     // Discover proxy auto-config asynchronously if supported, otherwise spool to thread pool
     if (g_proxy_resolver.proxy_resolver_i->is_async)
         return g_proxy_resolver.proxy_resolver_i->get_proxies_for_url(proxy_resolver->base, url);
 
+    // Coalesce identical resolutions into a single evaluation if results can be shared between instances
+    if (g_proxy_resolver.proxy_resolver_i->set_result)
+        return proxy_resolver_flight_join(proxy_resolver, url);
+
     free(proxy_resolver->url);
     proxy_resolver->url = strdup(url);
 
@@ -147,6 +723,32 @@ bool proxy_resolver_get_proxies_for_url(void *ctx, const char *url) {
                               proxy_resolver_get_proxies_for_url_threadpool);
 }
 
+proxy_resolver_fast_status proxy_resolver_try_get_proxies_fast(void *ctx, const char *url, char *buffer,
+                                                               size_t buffer_len) {
+    proxy_resolver_s *proxy_resolver = (proxy_resolver_s *)ctx;
+    size_t list_len = 0;
+    if (!proxy_resolver || !g_proxy_resolver.proxy_resolver_i || !url || !buffer || !buffer_len)
+        return PROXY_RESOLVER_FAST_ERROR;
+    return proxy_resolver_print_list_from_config(proxy_resolver, url, buffer, buffer_len, &list_len);
+}
+
+bool proxy_resolver_get_proxies_for_url(void *ctx, const char *url) {
+    proxy_resolver_s *proxy_resolver = (proxy_resolver_s *)ctx;
+    if (!proxy_resolver || !g_proxy_resolver.proxy_resolver_i)
+        return false;
+
+    // Assign request id that is carried along with any jobs queued for this resolution
+    const uint64_t parent_request_id = trace_get_request_id();
+    trace_set_request_id(trace_create_request_id());
+
+    trace_begin("proxy_resolver_get_proxies_for_url");
+    const bool is_ok = proxy_resolver_start(ctx, url);
+    trace_end("proxy_resolver_get_proxies_for_url");
+
+    trace_set_request_id(parent_request_id);
+    return is_ok;
+}
+
 const char *proxy_resolver_get_list(void *ctx) {
     proxy_resolver_s *proxy_resolver = (proxy_resolver_s *)ctx;
     if (!proxy_resolver || !g_proxy_resolver.proxy_resolver_i)
@@ -206,14 +808,42 @@ bool proxy_resolver_cancel(void *ctx) {
 }
 
 void *proxy_resolver_create(void) {
+    return proxy_resolver_create_ex(NULL);
+}
+
+static bool proxy_resolver_set_config(proxy_resolver_s *proxy_resolver, proxy_resolver_config_s *config) {
+    const proxy_resolver_i_s *proxy_resolver_i = g_proxy_resolver.proxy_resolver_i;
+
+    // Proxy auto-config options must be handled by the underlying resolver
+    if (proxy_resolver_config_needs_execute(config) && !proxy_resolver_i->set_config) {
+        LOG_ERROR("Proxy auto config per resolver instance not supported\n");
+        return false;
+    }
+    if (proxy_resolver_i->set_config && !proxy_resolver_i->set_config(proxy_resolver->base, config))
+        return false;
+
+    proxy_resolver_config_release(&proxy_resolver->config);
+    proxy_resolver->config = proxy_resolver_config_acquire(config);
+    proxy_resolver->route = proxy_resolver_get_route(proxy_resolver->config);
+    return true;
+}
+
+static bool proxy_resolver_set_options(proxy_resolver_s *proxy_resolver, const proxy_resolver_options_s *options) {
+    // Config snapshots are immutable so they are replaced rather than modified
+    proxy_resolver_config_s *config = proxy_resolver_config_create(options);
+    const bool is_ok = config && proxy_resolver_set_config(proxy_resolver, config);
+    proxy_resolver_config_release(&config);
+    return is_ok;
+}
+
+void *proxy_resolver_create_ex(const proxy_resolver_options_s *options) {
     if (!g_proxy_resolver.proxy_resolver_i)
         return NULL;
-    proxy_resolver_s *proxy_resolver = (proxy_resolver_s *)calloc(1, sizeof(proxy_resolver_s));
+    proxy_resolver_s *proxy_resolver = proxy_resolver_alloc();
     if (!proxy_resolver)
         return NULL;
-    proxy_resolver->base = g_proxy_resolver.proxy_resolver_i->create();
-    if (!proxy_resolver->base) {
-        free(proxy_resolver);
+    if (options && !proxy_resolver_set_options(proxy_resolver, options)) {
+        proxy_resolver_delete((void **)&proxy_resolver);
         return NULL;
     }
     return proxy_resolver;
@@ -225,14 +855,52 @@ bool proxy_resolver_delete(void **ctx) {
     if (!ctx || !*ctx)
         return false;
     proxy_resolver_s *proxy_resolver = (proxy_resolver_s *)*ctx;
-    free(proxy_resolver->url);
-    free(proxy_resolver->list);
-    g_proxy_resolver.proxy_resolver_i->delete(&proxy_resolver->base);
-    free(proxy_resolver);
+    // Stop waiting on identical resolution in progress
+    proxy_resolver_flight_leave(proxy_resolver);
+    proxy_resolver_free(proxy_resolver);
     *ctx = NULL;
     return true;
 }
 
+bool proxy_resolver_set_auto_config_url(void *ctx, const char *auto_config_url) {
+    proxy_resolver_s *proxy_resolver = (proxy_resolver_s *)ctx;
+    proxy_resolver_options_s options;
+    if (!proxy_resolver || !g_proxy_resolver.proxy_resolver_i)
+        return false;
+    proxy_resolver_config_get_options(proxy_resolver->config, &options);
+    options.auto_config_url = auto_config_url;
+    return proxy_resolver_set_options(proxy_resolver, &options);
+}
+
+bool proxy_resolver_set_proxy(void *ctx, const char *proxy) {
+    proxy_resolver_s *proxy_resolver = (proxy_resolver_s *)ctx;
+    proxy_resolver_options_s options;
+    if (!proxy_resolver || !g_proxy_resolver.proxy_resolver_i)
+        return false;
+    proxy_resolver_config_get_options(proxy_resolver->config, &options);
+    options.proxy = proxy;
+    return proxy_resolver_set_options(proxy_resolver, &options);
+}
+
+bool proxy_resolver_set_bypass_list(void *ctx, const char *bypass_list) {
+    proxy_resolver_s *proxy_resolver = (proxy_resolver_s *)ctx;
+    proxy_resolver_options_s options;
+    if (!proxy_resolver || !g_proxy_resolver.proxy_resolver_i)
+        return false;
+    proxy_resolver_config_get_options(proxy_resolver->config, &options);
+    options.bypass_list = bypass_list;
+    return proxy_resolver_set_options(proxy_resolver, &options);
+}
+
+bool proxy_resolver_set_disk_cache(bool enabled, const char *cache_dir) {
+#if defined(__linux__) && defined(PROXYRES_EXECUTE)
+    return wpad_cache_set_dir(enabled, cache_dir);
+#else
+    UNUSED(cache_dir);
+    return !enabled;
+#endif
+}
+
 bool proxy_resolver_global_init(void) {
     if (g_proxy_resolver.ref_count > 0) {
         g_proxy_resolver.ref_count++;
@@ -253,6 +921,9 @@ bool proxy_resolver_global_init(void) {
     if (proxy_resolver_mac_global_init())
         g_proxy_resolver.proxy_resolver_i = proxy_resolver_mac_get_interface();
 #elif defined(__linux__)
+    // Share caches and PAC contexts with other processes if the resolver daemon is running
+    if (proxy_resolver_daemon_global_init())
+        g_proxy_resolver.proxy_resolver_i = proxy_resolver_daemon_get_interface();
     /* Does not work for manually specified proxy auto-config urls
     if (proxy_resolver_gnome3_global_init())
         g_proxy_resolver.proxy_resolver_i = proxy_resolver_gnome3_get_interface();*/
@@ -283,6 +954,14 @@ bool proxy_resolver_global_init(void) {
         return true;
     }
 
+    g_proxy_resolver.flight_mutex = mutex_create();
+    g_proxy_resolver.flights_done = event_create();
+    if (!g_proxy_resolver.flight_mutex || !g_proxy_resolver.flights_done) {
+        LOG_ERROR("Failed to create resolver lock\n");
+        proxy_resolver_global_cleanup();
+        return false;
+    }
+
     // Create thread pool to handle proxy resolution requests asynchronously
     g_proxy_resolver.threadpool = threadpool_create(THREADPOOL_DEFAULT_MIN_THREADS, THREADPOOL_DEFAULT_MAX_THREADS);
     if (!g_proxy_resolver.threadpool) {
@@ -310,11 +989,29 @@ bool proxy_resolver_global_cleanup(void) {
     if (--g_proxy_resolver.ref_count > 0)
         return true;
 
+    // Resolutions waiting on host names are not in the thread pool queue until they have been resolved
+    if (g_proxy_resolver.flight_mutex) {
+        mutex_lock(g_proxy_resolver.flight_mutex);
+        while (g_proxy_resolver.flight_count > 0) {
+            mutex_unlock(g_proxy_resolver.flight_mutex);
+            event_wait(g_proxy_resolver.flights_done, -1);
+            mutex_lock(g_proxy_resolver.flight_mutex);
+        }
+        proxy_resolver_memo_clear();
+        mutex_unlock(g_proxy_resolver.flight_mutex);
+    }
+
     if (g_proxy_resolver.threadpool)
         threadpool_delete(&g_proxy_resolver.threadpool);
 
-    if (g_proxy_resolver.proxy_resolver_i)
+    if (g_proxy_resolver.proxy_resolver_i) {
+        proxy_resolver_pool_clear();
         g_proxy_resolver.proxy_resolver_i->global_cleanup();
+    }
+    if (g_proxy_resolver.flight_mutex)
+        mutex_delete(&g_proxy_resolver.flight_mutex);
+    if (g_proxy_resolver.flights_done)
+        event_delete(&g_proxy_resolver.flights_done);
 
     memset(&g_proxy_resolver, 0, sizeof(g_proxy_resolver));
 
@@ -0,0 +1,141 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "atomic.h"
+#include "bypass.h"
+#include "resolver.h"
+#include "resolver_config.h"
+#include "util.h"
+
+bool proxy_resolver_config_needs_execute(const proxy_resolver_config_s *config) {
+    if (!config)
+        return false;
+    return config->script || config->auto_config_url || config->auto_discover;
+}
+
+bool proxy_resolver_config_uses_system_config(const proxy_resolver_config_s *config) {
+    return !config || config->use_system_config;
+}
+
+static bool proxy_resolver_config_string_equals(const char *string1, const char *string2) {
+    if (!string1 || !string2)
+        return string1 == string2;
+    return strcmp(string1, string2) == 0;
+}
+
+bool proxy_resolver_config_equals(const proxy_resolver_config_s *config1, const proxy_resolver_config_s *config2) {
+    if (config1 == config2)
+        return true;
+    if (!config1 || !config2 || config1->hash != config2->hash)
+        return false;
+    return config1->use_system_config == config2->use_system_config &&
+           config1->auto_discover == config2->auto_discover &&
+           proxy_resolver_config_string_equals(config1->auto_config_url, config2->auto_config_url) &&
+           proxy_resolver_config_string_equals(config1->script, config2->script) &&
+           proxy_resolver_config_string_equals(config1->proxy, config2->proxy) &&
+           proxy_resolver_config_string_equals(config1->bypass_list, config2->bypass_list);
+}
+
+uint64_t proxy_resolver_config_get_hash(const proxy_resolver_config_s *config) {
+    return config ? config->hash : 0;
+}
+
+static uint64_t proxy_resolver_config_hash_string(const char *string, uint64_t hash) {
+    // Include terminator so that adjacent settings can't be confused with each other
+    if (!string)
+        return hash_fnv1a("", 0, hash);
+    return hash_fnv1a(string, strlen(string) + 1, hash);
+}
+
+void proxy_resolver_config_get_options(const proxy_resolver_config_s *config, proxy_resolver_options_s *options) {
+    memset(options, 0, sizeof(proxy_resolver_options_s));
+    if (!config) {
+        options->use_system_config = true;
+        return;
+    }
+    options->use_system_config = config->use_system_config;
+    options->auto_discover = config->auto_discover;
+    options->auto_config_url = config->auto_config_url;
+    options->script = config->script;
+    options->proxy = config->proxy;
+    options->bypass_list = config->bypass_list;
+}
+
+proxy_resolver_config_s *proxy_resolver_config_acquire(proxy_resolver_config_s *config) {
+    if (config)
+        atomic_increment_i32(&config->ref_count);
+    return config;
+}
+
+bool proxy_resolver_config_release(proxy_resolver_config_s **config) {
+    if (!config || !*config)
+        return false;
+    if (atomic_decrement_i32(&(*config)->ref_count) == 0) {
+        bypass_delete(&(*config)->bypass);
+        free(*config);
+    }
+    *config = NULL;
+    return true;
+}
+
+static const char *proxy_resolver_config_copy_string(char **buffer, const char *value) {
+    if (!value)
+        return NULL;
+    const size_t value_len = strlen(value) + 1;
+    char *copy = *buffer;
+    memcpy(copy, value, value_len);
+    *buffer += value_len;
+    return copy;
+}
+
+static size_t proxy_resolver_config_string_size(const char *value) {
+    return value ? strlen(value) + 1 : 0;
+}
+
+proxy_resolver_config_s *proxy_resolver_config_create(const proxy_resolver_options_s *options) {
+    if (!options)
+        return NULL;
+
+    // Allocate config and strings together so the snapshot is released with a single free
+    const size_t strings_size = proxy_resolver_config_string_size(options->auto_config_url) +
+                                proxy_resolver_config_string_size(options->script) +
+                                proxy_resolver_config_string_size(options->proxy) +
+                                proxy_resolver_config_string_size(options->bypass_list);
+    proxy_resolver_config_s *config =
+        (proxy_resolver_config_s *)calloc(1, sizeof(proxy_resolver_config_s) + strings_size);
+    if (!config)
+        return NULL;
+
+    char *buffer = (char *)(config + 1);
+    config->ref_count = 1;
+    config->use_system_config = options->use_system_config;
+    config->auto_discover = options->auto_discover;
+    config->auto_config_url = proxy_resolver_config_copy_string(&buffer, options->auto_config_url);
+    config->script = proxy_resolver_config_copy_string(&buffer, options->script);
+    config->proxy = proxy_resolver_config_copy_string(&buffer, options->proxy);
+    config->bypass_list = proxy_resolver_config_copy_string(&buffer, options->bypass_list);
+
+    const uint8_t flags = (uint8_t)((config->use_system_config ? 1 : 0) | (config->auto_discover ? 2 : 0));
+    config->hash = hash_fnv1a(&flags, sizeof(flags), HASH_FNV1A_INIT);
+    config->hash = proxy_resolver_config_hash_string(config->auto_config_url, config->hash);
+    config->hash = proxy_resolver_config_hash_string(config->script, config->hash);
+    config->hash = proxy_resolver_config_hash_string(config->proxy, config->hash);
+    config->hash = proxy_resolver_config_hash_string(config->bypass_list, config->hash);
+
+    // Analyze script once so that resolutions that only differ in parts of the url it ignores can be shared
+#ifdef PROXYRES_EXECUTE
+    if (config->script)
+        config->is_analyzed = proxy_execute_analyze_script(config->script, &config->analysis);
+#endif
+
+    if (config->bypass_list) {
+        config->bypass = bypass_create(config->bypass_list);
+        if (!config->bypass) {
+            free(config);
+            return NULL;
+        }
+    }
+    return config;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "execute.h"
+
+typedef struct proxy_resolver_config_s {
+    // Number of resolvers and pending resolutions using the config
+    volatile int32_t ref_count;
+    // Use the system config for any setting that is not specified
+    bool use_system_config;
+    // Discover proxy auto-config url using WPAD
+    bool auto_discover;
+    // Settings stored in the same allocation as the config, NULL when not specified
+    const char *auto_config_url;
+    const char *script;
+    const char *proxy;
+    const char *bypass_list;
+    // Compiled bypass list, NULL when not specified
+    void *bypass;
+    // What results of the script depend on, only valid if the script was analyzed
+    proxy_execute_analysis_s analysis;
+    bool is_analyzed;
+    // Hash of all settings used to find configs with identical settings
+    uint64_t hash;
+} proxy_resolver_config_s;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Check whether the config requires the proxy auto-config script to be evaluated
+bool proxy_resolver_config_needs_execute(const proxy_resolver_config_s *config);
+
+// Check whether the system config should be used for settings that are not specified
+bool proxy_resolver_config_uses_system_config(const proxy_resolver_config_s *config);
+
+// Check whether two configs have identical settings, NULL configs use the system config
+bool proxy_resolver_config_equals(const proxy_resolver_config_s *config1, const proxy_resolver_config_s *config2);
+
+// Get the hash of the config settings, 0 for the system config
+uint64_t proxy_resolver_config_get_hash(const proxy_resolver_config_s *config);
+
+// Copy config options into the options structure
+void proxy_resolver_config_get_options(const proxy_resolver_config_s *config, proxy_resolver_options_s *options);
+
+// Acquire an additional reference to an immutable config snapshot
+proxy_resolver_config_s *proxy_resolver_config_acquire(proxy_resolver_config_s *config);
+
+// Release a reference to a config snapshot
+bool proxy_resolver_config_release(proxy_resolver_config_s **config);
+
+// Create an immutable config snapshot from the options
+proxy_resolver_config_s *proxy_resolver_config_create(const proxy_resolver_options_s *options);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,551 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include <errno.h>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define LOG_CATEGORY PROXYRES_LOG_CATEGORY_RESOLVER
+
+#include "config.h"
+#include "event_futex.h"
+#include "log.h"
+#include "mutex.h"
+#include "resolver.h"
+#include "resolver_config.h"
+#include "resolver_i.h"
+#include "resolver_daemon.h"
+#ifdef PROXYRES_EXECUTE
+#  include "resolver_posix.h"
+#endif
+#include "threadpool.h"
+#include "util.h"
+
+#ifdef __cplusplus
+#  define delete f_delete
+#endif
+
+#define PROXY_RESOLVER_DAEMON_MAX_LINE    (64 * 1024)
+#define PROXY_RESOLVER_DAEMON_SOCKET_NAME "proxyres.sock"
+
+struct proxy_resolver_daemon_s;
+
+typedef struct g_proxy_resolver_daemon_s {
+    // Path of the resolver daemon's unix domain socket
+    struct sockaddr_un address;
+    // Connection to the resolver daemon, -1 when not connected
+    int fd;
+    // Incremented for each connection so that responses are only matched against requests sent on it
+    uint64_t connection_id;
+    // Id of the last request sent
+    uint64_t request_id;
+    // Lock for the connection and pending requests
+    void *mutex;
+    // Requests waiting for a response
+    struct proxy_resolver_daemon_s *pending;
+    // Thread that reads responses from the connection
+    void *threadpool;
+    // In-process resolution for configs the resolver daemon can't evaluate, started on first use
+    bool local_init;
+    void *local_threadpool;
+} g_proxy_resolver_daemon_s;
+
+g_proxy_resolver_daemon_s g_proxy_resolver_daemon;
+
+typedef struct proxy_resolver_daemon_s {
+    // Last system error
+    int32_t error;
+    // Complete event
+    event_futex_s complete;
+    // Proxy list
+    char *list;
+    // Config snapshot specific to this resolver instance
+    proxy_resolver_config_s *config;
+    // Request and connection ids used to match the response
+    uint64_t request_id;
+    uint64_t connection_id;
+    // Next request waiting for a response
+    struct proxy_resolver_daemon_s *next_pending;
+    // In-process resolver used instead of the resolver daemon, NULL when not used
+    void *local;
+    // Url resolved in-process
+    char *local_url;
+} proxy_resolver_daemon_s;
+
+// Must be called with lock held
+static void proxy_resolver_daemon_complete(proxy_resolver_daemon_s *proxy_resolver, const char *list, int32_t error) {
+    free(proxy_resolver->list);
+    proxy_resolver->list = list ? strdup(list) : NULL;
+    proxy_resolver->error = error;
+    if (list && !proxy_resolver->list)
+        proxy_resolver->error = ENOMEM;
+    event_futex_set(&proxy_resolver->complete);
+}
+
+// Must be called with lock held
+static proxy_resolver_daemon_s *proxy_resolver_daemon_remove_pending(uint64_t connection_id, uint64_t request_id) {
+    proxy_resolver_daemon_s **pendingp = &g_proxy_resolver_daemon.pending;
+    while (*pendingp) {
+        proxy_resolver_daemon_s *proxy_resolver = *pendingp;
+        if (proxy_resolver->connection_id == connection_id &&
+            (!request_id || proxy_resolver->request_id == request_id)) {
+            *pendingp = proxy_resolver->next_pending;
+            proxy_resolver->next_pending = NULL;
+            return proxy_resolver;
+        }
+        pendingp = &proxy_resolver->next_pending;
+    }
+    return NULL;
+}
+
+// Response line format is "<request id> <error> [proxy list]"
+static void proxy_resolver_daemon_handle_response(uint64_t connection_id, char *line) {
+    char *end = NULL;
+
+    const uint64_t request_id = strtoull(line, &end, 10);
+    if (end == line || *end != ' ') {
+        LOG_WARN("Invalid response from resolver daemon\n");
+        return;
+    }
+    line = end + 1;
+    const int32_t error = (int32_t)strtol(line, &end, 10);
+    if (end == line) {
+        LOG_WARN("Invalid response from resolver daemon\n");
+        return;
+    }
+    const char *list = *end == ' ' && end[1] ? end + 1 : NULL;
+
+    mutex_lock(g_proxy_resolver_daemon.mutex);
+    proxy_resolver_daemon_s *proxy_resolver = proxy_resolver_daemon_remove_pending(connection_id, request_id);
+    if (proxy_resolver)
+        proxy_resolver_daemon_complete(proxy_resolver, list, error);
+    mutex_unlock(g_proxy_resolver_daemon.mutex);
+}
+
+static void proxy_resolver_daemon_read_responses(void *arg) {
+    const uint64_t connection_id = (uint64_t)(uintptr_t)arg;
+    size_t buffer_len = 0;
+    bool discard = false;
+    int fd = -1;
+
+    mutex_lock(g_proxy_resolver_daemon.mutex);
+    if (g_proxy_resolver_daemon.connection_id == connection_id)
+        fd = g_proxy_resolver_daemon.fd;
+    mutex_unlock(g_proxy_resolver_daemon.mutex);
+    if (fd < 0)
+        return;
+
+    char *buffer = (char *)malloc(PROXY_RESOLVER_DAEMON_MAX_LINE);
+    while (buffer) {
+        const ssize_t bytes_read = recv(fd, buffer + buffer_len, PROXY_RESOLVER_DAEMON_MAX_LINE - buffer_len, 0);
+        if (bytes_read < 0 && errno == EINTR)
+            continue;
+        if (bytes_read <= 0)
+            break;
+        buffer_len += (size_t)bytes_read;
+
+        // Handle each complete response line, responses may arrive in any order
+        char *line = buffer;
+        char *line_end = NULL;
+        while ((line_end = (char *)memchr(line, '\n', buffer_len - (size_t)(line - buffer))) != NULL) {
+            *line_end = 0;
+            if (!discard)
+                proxy_resolver_daemon_handle_response(connection_id, line);
+            discard = false;
+            line = line_end + 1;
+        }
+        buffer_len -= (size_t)(line - buffer);
+        memmove(buffer, line, buffer_len);
+
+        // Skip responses that are too long to buffer
+        if (buffer_len == PROXY_RESOLVER_DAEMON_MAX_LINE) {
+            LOG_WARN("Response from resolver daemon too long\n");
+            discard = true;
+            buffer_len = 0;
+        }
+    }
+    free(buffer);
+
+    mutex_lock(g_proxy_resolver_daemon.mutex);
+
+    // Requests sent on the connection will never receive a response
+    proxy_resolver_daemon_s *proxy_resolver = NULL;
+    while ((proxy_resolver = proxy_resolver_daemon_remove_pending(connection_id, 0)) != NULL)
+        proxy_resolver_daemon_complete(proxy_resolver, NULL, ECONNRESET);
+
+    if (g_proxy_resolver_daemon.connection_id == connection_id)
+        g_proxy_resolver_daemon.fd = -1;
+    close(fd);
+
+    mutex_unlock(g_proxy_resolver_daemon.mutex);
+}
+
+// Must be called with lock held, returns zero or the error captured when connecting failed
+static int32_t proxy_resolver_daemon_connect(void) {
+    if (g_proxy_resolver_daemon.fd >= 0)
+        return 0;
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return errno;
+    if (connect(fd, (struct sockaddr *)&g_proxy_resolver_daemon.address, sizeof(g_proxy_resolver_daemon.address))) {
+        const int32_t error = errno;
+        close(fd);
+        return error;
+    }
+
+    g_proxy_resolver_daemon.fd = fd;
+    g_proxy_resolver_daemon.connection_id++;
+
+    const uintptr_t connection_id = (uintptr_t)g_proxy_resolver_daemon.connection_id;
+    if (!threadpool_enqueue(g_proxy_resolver_daemon.threadpool, (void *)connection_id,
+                            proxy_resolver_daemon_read_responses)) {
+        g_proxy_resolver_daemon.fd = -1;
+        close(fd);
+        return ENOMEM;
+    }
+    return 0;
+}
+
+// Must be called with lock held
+static bool proxy_resolver_daemon_send(const char *request, size_t request_len) {
+    while (request_len > 0) {
+        const ssize_t bytes_sent = send(g_proxy_resolver_daemon.fd, request, request_len, MSG_NOSIGNAL);
+        if (bytes_sent < 0 && errno == EINTR)
+            continue;
+        if (bytes_sent <= 0)
+            return false;
+        request += bytes_sent;
+        request_len -= (size_t)bytes_sent;
+    }
+    return true;
+}
+
+#ifdef PROXYRES_EXECUTE
+static void proxy_resolver_daemon_local_threadpool(void *arg) {
+    proxy_resolver_daemon_s *proxy_resolver = (proxy_resolver_daemon_s *)arg;
+    proxy_resolver_posix_get_proxies_for_url(proxy_resolver->local, proxy_resolver->local_url);
+}
+
+static bool proxy_resolver_daemon_local_init(void) {
+    mutex_lock(g_proxy_resolver_daemon.mutex);
+    if (!g_proxy_resolver_daemon.local_init) {
+        // WPAD discovery is not started since only instances with their own script are resolved in-process
+        g_proxy_resolver_daemon.local_threadpool =
+            threadpool_create(THREADPOOL_DEFAULT_MIN_THREADS, THREADPOOL_DEFAULT_MAX_THREADS);
+        if (g_proxy_resolver_daemon.local_threadpool && proxy_resolver_posix_global_init())
+            g_proxy_resolver_daemon.local_init = true;
+        else if (g_proxy_resolver_daemon.local_threadpool)
+            threadpool_delete(&g_proxy_resolver_daemon.local_threadpool);
+    }
+    const bool is_ok = g_proxy_resolver_daemon.local_init;
+    mutex_unlock(g_proxy_resolver_daemon.mutex);
+    return is_ok;
+}
+
+static bool proxy_resolver_daemon_local_get_proxies_for_url(proxy_resolver_daemon_s *proxy_resolver, const char *url) {
+    free(proxy_resolver->local_url);
+    proxy_resolver->local_url = strdup(url);
+    if (proxy_resolver->local_url && threadpool_enqueue(g_proxy_resolver_daemon.local_threadpool, proxy_resolver,
+                                                        proxy_resolver_daemon_local_threadpool))
+        return true;
+    // Resolve on the calling thread if the resolution can't be queued
+    free(proxy_resolver->local_url);
+    proxy_resolver->local_url = NULL;
+    return proxy_resolver_posix_get_proxies_for_url(proxy_resolver->local, url);
+}
+
+static void proxy_resolver_daemon_local_delete(proxy_resolver_daemon_s *proxy_resolver) {
+    // In-process resolutions can't be cancelled so wait for them to finish using the instance
+    if (proxy_resolver->local_url)
+        proxy_resolver_posix_wait(proxy_resolver->local, -1);
+    proxy_resolver_posix_delete(&proxy_resolver->local);
+    free(proxy_resolver->local_url);
+    proxy_resolver->local_url = NULL;
+}
+#endif
+
+bool proxy_resolver_daemon_get_proxies_for_url(void *ctx, const char *url) {
+    proxy_resolver_daemon_s *proxy_resolver = (proxy_resolver_daemon_s *)ctx;
+    const proxy_resolver_config_s *config = proxy_resolver->config;
+    const char *auto_config_url = config ? config->auto_config_url : NULL;
+    char *system_auto_config_url = NULL;
+    char *request = NULL;
+    size_t max_request = 0;
+    int request_len = 0;
+    int32_t error = 0;
+
+#ifdef PROXYRES_EXECUTE
+    if (proxy_resolver->local)
+        return proxy_resolver_daemon_local_get_proxies_for_url(proxy_resolver, url);
+#endif
+
+    // Resolver daemon may not have the same system config as the client
+    if (!auto_config_url && proxy_resolver_config_uses_system_config(config))
+        auto_config_url = system_auto_config_url = proxy_config_get_auto_config_url();
+
+    // Request line format is "<request id> <url> [auto config url]"
+    if (strpbrk(url, " \r\n") || (auto_config_url && strpbrk(auto_config_url, " \r\n"))) {
+        error = EINVAL;
+        LOG_ERROR("Unable to send url to resolver daemon (%" PRId32 ")\n", error);
+        goto daemon_error;
+    }
+    max_request = strlen(url) + (auto_config_url ? strlen(auto_config_url) : 0) + 32;
+    request = (char *)malloc(max_request);
+    if (!request) {
+        error = ENOMEM;
+        LOG_ERROR("Unable to allocate memory for %s (%" PRId32 ")\n", "request", error);
+        goto daemon_error;
+    }
+
+    mutex_lock(g_proxy_resolver_daemon.mutex);
+
+    // Reconnect if the resolver daemon was restarted
+    error = proxy_resolver_daemon_connect();
+    if (error) {
+        mutex_unlock(g_proxy_resolver_daemon.mutex);
+        LOG_ERROR("Unable to connect to resolver daemon (%" PRId32 ")\n", error);
+        goto daemon_error;
+    }
+
+    proxy_resolver->request_id = ++g_proxy_resolver_daemon.request_id;
+    proxy_resolver->connection_id = g_proxy_resolver_daemon.connection_id;
+
+    request_len = snprintf(request, max_request, "%" PRIu64 " %s%s%s\n", proxy_resolver->request_id, url,
+                           auto_config_url ? " " : "", auto_config_url ? auto_config_url : "");
+
+    // Requests are pipelined on the shared connection
+    proxy_resolver->next_pending = g_proxy_resolver_daemon.pending;
+    g_proxy_resolver_daemon.pending = proxy_resolver;
+
+    if (!proxy_resolver_daemon_send(request, (size_t)request_len)) {
+        error = errno;
+        proxy_resolver_daemon_remove_pending(proxy_resolver->connection_id, proxy_resolver->request_id);
+        // Wake the reader so that other requests sent on the connection fail too
+        shutdown(g_proxy_resolver_daemon.fd, SHUT_RDWR);
+        mutex_unlock(g_proxy_resolver_daemon.mutex);
+        LOG_ERROR("Unable to send request to resolver daemon (%" PRId32 ")\n", error);
+        goto daemon_error;
+    }
+
+    mutex_unlock(g_proxy_resolver_daemon.mutex);
+    free(request);
+    free(system_auto_config_url);
+    return true;
+
+daemon_error:
+    free(request);
+    free(system_auto_config_url);
+    proxy_resolver->error = error;
+    event_futex_set(&proxy_resolver->complete);
+    return false;
+}
+
+const char *proxy_resolver_daemon_get_list(void *ctx) {
+    proxy_resolver_daemon_s *proxy_resolver = (proxy_resolver_daemon_s *)ctx;
+    if (!proxy_resolver)
+        return NULL;
+#ifdef PROXYRES_EXECUTE
+    if (proxy_resolver->local)
+        return proxy_resolver_posix_get_list(proxy_resolver->local);
+#endif
+    return proxy_resolver->list;
+}
+
+int32_t proxy_resolver_daemon_get_error(void *ctx) {
+    proxy_resolver_daemon_s *proxy_resolver = (proxy_resolver_daemon_s *)ctx;
+#ifdef PROXYRES_EXECUTE
+    if (proxy_resolver->local)
+        return proxy_resolver_posix_get_error(proxy_resolver->local);
+#endif
+    return proxy_resolver->error;
+}
+
+bool proxy_resolver_daemon_wait(void *ctx, int32_t timeout_ms) {
+    proxy_resolver_daemon_s *proxy_resolver = (proxy_resolver_daemon_s *)ctx;
+    if (!proxy_resolver)
+        return false;
+#ifdef PROXYRES_EXECUTE
+    if (proxy_resolver->local)
+        return proxy_resolver_posix_wait(proxy_resolver->local, timeout_ms);
+#endif
+    return event_futex_wait(&proxy_resolver->complete, timeout_ms);
+}
+
+bool proxy_resolver_daemon_cancel(void *ctx) {
+    proxy_resolver_daemon_s *proxy_resolver = (proxy_resolver_daemon_s *)ctx;
+    if (!proxy_resolver)
+        return false;
+#ifdef PROXYRES_EXECUTE
+    if (proxy_resolver->local)
+        return proxy_resolver_posix_cancel(proxy_resolver->local);
+#endif
+
+    // Response is ignored if it arrives after the request has been cancelled
+    mutex_lock(g_proxy_resolver_daemon.mutex);
+    if (proxy_resolver_daemon_remove_pending(proxy_resolver->connection_id, proxy_resolver->request_id))
+        proxy_resolver_daemon_complete(proxy_resolver, NULL, ECANCELED);
+    mutex_unlock(g_proxy_resolver_daemon.mutex);
+    return true;
+}
+
+bool proxy_resolver_daemon_set_config(void *ctx, proxy_resolver_config_s *config) {
+    proxy_resolver_daemon_s *proxy_resolver = (proxy_resolver_daemon_s *)ctx;
+    if (!proxy_resolver)
+        return false;
+#ifdef PROXYRES_EXECUTE
+    // Only the auto config url is sent to the resolver daemon so scripts are evaluated in-process
+    if (config && config->script) {
+        if (!proxy_resolver->local) {
+            if (!proxy_resolver_daemon_local_init()) {
+                LOG_ERROR("Unable to initialize in-process resolver for proxy auto config script\n");
+                return false;
+            }
+            proxy_resolver->local = proxy_resolver_posix_create();
+            if (!proxy_resolver->local)
+                return false;
+        }
+        if (!proxy_resolver_posix_set_config(proxy_resolver->local, config))
+            return false;
+    } else if (proxy_resolver->local) {
+        proxy_resolver_daemon_local_delete(proxy_resolver);
+    }
+#else
+    if (config && config->script) {
+        LOG_ERROR("Proxy auto config script not supported by resolver daemon\n");
+        return false;
+    }
+#endif
+    proxy_resolver_config_release(&proxy_resolver->config);
+    proxy_resolver->config = proxy_resolver_config_acquire(config);
+    return true;
+}
+
+bool proxy_resolver_daemon_reset(void *ctx) {
+    proxy_resolver_daemon_s *proxy_resolver = (proxy_resolver_daemon_s *)ctx;
+    if (!proxy_resolver)
+        return false;
+#ifdef PROXYRES_EXECUTE
+    if (proxy_resolver->local && !proxy_resolver_posix_reset(proxy_resolver->local))
+        return false;
+#endif
+    proxy_resolver->error = 0;
+    free(proxy_resolver->list);
+    proxy_resolver->list = NULL;
+    // Re-arm complete event so that waiting does not return the previous resolution
+    return event_futex_reset(&proxy_resolver->complete);
+}
+
+void *proxy_resolver_daemon_create(void) {
+    proxy_resolver_daemon_s *proxy_resolver = (proxy_resolver_daemon_s *)calloc(1, sizeof(proxy_resolver_daemon_s));
+    if (!proxy_resolver)
+        return NULL;
+    event_futex_init(&proxy_resolver->complete, false);
+    return proxy_resolver;
+}
+
+bool proxy_resolver_daemon_delete(void **ctx) {
+    if (!ctx)
+        return false;
+    proxy_resolver_daemon_s *proxy_resolver = (proxy_resolver_daemon_s *)*ctx;
+    if (!proxy_resolver)
+        return false;
+    proxy_resolver_daemon_cancel(proxy_resolver);
+#ifdef PROXYRES_EXECUTE
+    if (proxy_resolver->local)
+        proxy_resolver_daemon_local_delete(proxy_resolver);
+#endif
+    free(proxy_resolver->list);
+    proxy_resolver_config_release(&proxy_resolver->config);
+    free(proxy_resolver);
+    return true;
+}
+
+// Socket path is specified by PROXYRES_DAEMON_SOCKET, otherwise it is in the user's runtime directory
+static bool proxy_resolver_daemon_get_socket_path(char *path, size_t max_path) {
+    const char *socket_path = getenv("PROXYRES_DAEMON_SOCKET");
+    if (socket_path)
+        return *socket_path && snprintf(path, max_path, "%s", socket_path) < (int)max_path;
+    const char *runtime_dir = getenv("XDG_RUNTIME_DIR");
+    if (!runtime_dir || !*runtime_dir)
+        return false;
+    return snprintf(path, max_path, "%s/%s", runtime_dir, PROXY_RESOLVER_DAEMON_SOCKET_NAME) < (int)max_path;
+}
+
+bool proxy_resolver_daemon_global_init(void) {
+    memset(&g_proxy_resolver_daemon, 0, sizeof(g_proxy_resolver_daemon));
+    g_proxy_resolver_daemon.fd = -1;
+    g_proxy_resolver_daemon.address.sun_family = AF_UNIX;
+
+    // Only use the resolver daemon if it is running
+    if (!proxy_resolver_daemon_get_socket_path(g_proxy_resolver_daemon.address.sun_path,
+                                               sizeof(g_proxy_resolver_daemon.address.sun_path)))
+        return false;
+
+    g_proxy_resolver_daemon.mutex = mutex_create();
+    g_proxy_resolver_daemon.threadpool = threadpool_create(1, 1);
+    if (!g_proxy_resolver_daemon.mutex || !g_proxy_resolver_daemon.threadpool) {
+        proxy_resolver_daemon_global_cleanup();
+        return false;
+    }
+
+    mutex_lock(g_proxy_resolver_daemon.mutex);
+    const bool is_connected = proxy_resolver_daemon_connect() == 0;
+    mutex_unlock(g_proxy_resolver_daemon.mutex);
+    if (!is_connected) {
+        proxy_resolver_daemon_global_cleanup();
+        return false;
+    }
+
+    LOG_INFO("Using resolver daemon at %s\n", g_proxy_resolver_daemon.address.sun_path);
+    return true;
+}
+
+bool proxy_resolver_daemon_global_cleanup(void) {
+    // Wake the reader so that the thread pool can be deleted
+    if (g_proxy_resolver_daemon.mutex) {
+        mutex_lock(g_proxy_resolver_daemon.mutex);
+        if (g_proxy_resolver_daemon.fd >= 0)
+            shutdown(g_proxy_resolver_daemon.fd, SHUT_RDWR);
+        mutex_unlock(g_proxy_resolver_daemon.mutex);
+    }
+    if (g_proxy_resolver_daemon.threadpool)
+        threadpool_delete(&g_proxy_resolver_daemon.threadpool);
+#ifdef PROXYRES_EXECUTE
+    if (g_proxy_resolver_daemon.local_threadpool)
+        threadpool_delete(&g_proxy_resolver_daemon.local_threadpool);
+    if (g_proxy_resolver_daemon.local_init)
+        proxy_resolver_posix_global_cleanup();
+#endif
+    if (g_proxy_resolver_daemon.mutex)
+        mutex_delete(&g_proxy_resolver_daemon.mutex);
+
+    memset(&g_proxy_resolver_daemon, 0, sizeof(g_proxy_resolver_daemon));
+    g_proxy_resolver_daemon.fd = -1;
+    return true;
+}
+
+const proxy_resolver_i_s *proxy_resolver_daemon_get_interface(void) {
+    static const proxy_resolver_i_s proxy_resolver_daemon_i = {
+        proxy_resolver_daemon_get_proxies_for_url,
+        proxy_resolver_daemon_get_list,
+        proxy_resolver_daemon_get_error,
+        proxy_resolver_daemon_wait,
+        proxy_resolver_daemon_cancel,
+        proxy_resolver_daemon_create,
+        proxy_resolver_daemon_delete,
+        true,   // get_proxies_for_url is handled asynchronously by the resolver daemon
+        false,  // get_proxies_for_url does not take into account system config
+        proxy_resolver_daemon_global_init,
+        proxy_resolver_daemon_global_cleanup,
+        proxy_resolver_daemon_set_config,
+        proxy_resolver_daemon_reset,
+        NULL,
+        NULL};
+    return &proxy_resolver_daemon_i;
+}
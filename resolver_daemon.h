@@ -0,0 +1,25 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bool proxy_resolver_daemon_get_proxies_for_url(void *ctx, const char *url);
+const char *proxy_resolver_daemon_get_list(void *ctx);
+int32_t proxy_resolver_daemon_get_error(void *ctx);
+bool proxy_resolver_daemon_wait(void *ctx, int32_t timeout_ms);
+bool proxy_resolver_daemon_cancel(void *ctx);
+bool proxy_resolver_daemon_set_config(void *ctx, proxy_resolver_config_s *config);
+bool proxy_resolver_daemon_reset(void *ctx);
+
+void *proxy_resolver_daemon_create(void);
+bool proxy_resolver_daemon_delete(void **ctx);
+
+bool proxy_resolver_daemon_global_init(void);
+bool proxy_resolver_daemon_global_cleanup(void);
+
+const proxy_resolver_i_s *proxy_resolver_daemon_get_interface(void);
+
+#ifdef __cplusplus
+}
+#endif
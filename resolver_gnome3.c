@@ -9,7 +9,9 @@
 #include <dlfcn.h>
 #include <gio/gio.h>
 
-#include "event.h"
+#define LOG_CATEGORY PROXYRES_LOG_CATEGORY_RESOLVER
+
+#include "event_futex.h"
 #include "log.h"
 #include "resolver.h"
 #include "resolver_i.h"
@@ -42,7 +44,7 @@ typedef struct proxy_resolver_gnome3_s {
     // Last system error
     int32_t error;
     // Complete event
-    void *complete;
+    event_futex_s complete;
     // Cancellable object
     GCancellable *cancellable;
     // Proxy list
@@ -143,7 +145,7 @@ bool proxy_resolver_gnome3_get_proxies_for_url(void *ctx, const char *url) {
 
     proxy_resolver_gnome3_delete_resolver(proxy_resolver);
 
-    event_set(proxy_resolver->complete);
+    event_futex_set(&proxy_resolver->complete);
 
     return is_ok;
 }
@@ -164,7 +166,7 @@ bool proxy_resolver_gnome3_wait(void *ctx, int32_t timeout_ms) {
     proxy_resolver_gnome3_s *proxy_resolver = (proxy_resolver_gnome3_s *)ctx;
     if (!proxy_resolver)
         return false;
-    return event_wait(proxy_resolver->complete, timeout_ms);
+    return event_futex_wait(&proxy_resolver->complete, timeout_ms);
 }
 
 bool proxy_resolver_gnome3_cancel(void *ctx) {
@@ -182,11 +184,7 @@ void *proxy_resolver_gnome3_create(void) {
     proxy_resolver_gnome3_s *proxy_resolver = (proxy_resolver_gnome3_s *)calloc(1, sizeof(proxy_resolver_gnome3_s));
     if (!proxy_resolver)
         return NULL;
-    proxy_resolver->complete = event_create();
-    if (!proxy_resolver->complete) {
-        free(proxy_resolver);
-        return NULL;
-    }
+    event_futex_init(&proxy_resolver->complete, false);
     return proxy_resolver;
 }
 
@@ -197,7 +195,6 @@ bool proxy_resolver_gnome3_delete(void **ctx) {
     if (!proxy_resolver)
         return false;
     proxy_resolver_cancel(ctx);
-    event_delete(&proxy_resolver->complete);
     free(proxy_resolver->list);
     free(proxy_resolver);
     return true;
@@ -1,5 +1,7 @@
 #pragma once
 
+typedef void (*proxy_resolver_complete_cb)(void *user_data);
+
 typedef struct proxy_resolver_i_s {
     bool (*get_proxies_for_url)(void *ctx, const char *url);
 
@@ -20,4 +22,18 @@ typedef struct proxy_resolver_i_s {
 
     bool (*global_init)(void);
     bool (*global_cleanup)(void);
+
+    // Optional support for proxy auto config specific to a resolver instance
+    bool (*set_config)(void *ctx, struct proxy_resolver_config_s *config);
+
+    // Optional support for reusing a resolver instance by clearing the result of its last resolution
+    bool (*reset)(void *ctx);
+
+    // Optional support for completing a resolution with the result of an identical resolution
+    bool (*set_result)(void *ctx, const char *list, int32_t error);
+
+    // Optional support for finishing a resolution on another thread instead of blocking the calling thread while
+    // it waits, returns true if the callback will be called once the resolution has completed
+    bool (*get_proxies_for_url_async)(void *ctx, const char *url, proxy_resolver_complete_cb callback,
+                                      void *user_data);
 } proxy_resolver_i_s;
@@ -7,6 +7,8 @@
 #include <CoreFoundation/CoreFoundation.h>
 #include <CFNetwork/CFNetwork.h>
 
+#define LOG_CATEGORY PROXYRES_LOG_CATEGORY_RESOLVER
+
 #include "config.h"
 #include "event.h"
 #include "log.h"
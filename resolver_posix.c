@@ -7,33 +7,55 @@
 #include <errno.h>
 #include <time.h>
 
+#define LOG_CATEGORY PROXYRES_LOG_CATEGORY_RESOLVER
+
+#include "atomic.h"
 #include "config.h"
 #include "event.h"
 #include "fetch.h"
 #include "log.h"
 #include "execute.h"
+#include "execute_dns.h"
 #include "mutex.h"
 #include "net_adapter.h"
 #include "resolver.h"
+#include "resolver_config.h"
 #include "resolver_i.h"
 #include "resolver_posix.h"
+#include "script_store.h"
+#include "stats_record.h"
 #include "threadpool.h"
+#include "trace_record.h"
 #include "util.h"
+#include "wpad_cache.h"
 #include "wpad_dhcp.h"
 #include "wpad_dns.h"
 
 #define WPAD_DHCP_TIMEOUT   (3)
 #define WPAD_EXPIRE_SECONDS (300)
 
+typedef struct proxy_resolver_posix_script_s {
+    // PAC script, never modified once shared
+    char *script;
+    // Number of outstanding references including the global one
+    int32_t ref_count;
+} proxy_resolver_posix_script_s;
+
 typedef struct g_proxy_resolver_posix_s {
+    // Reference count so that the resolver daemon can share in-process resolution
+    int32_t ref_count;
     // WPAD discovered url
     char *auto_config_url;
     // WPAD discovery lock
     void *mutex;
-    // PAC script
-    char *script;
+    // PAC script borrowed by resolutions so that it can be replaced while they are executing
+    proxy_resolver_posix_script_s *script;
     time_t last_wpad_time;
     time_t last_fetch_time;
+    // Network fingerprint used for cache file
+    uint64_t network_fingerprint;
+    // Thread pool that resolutions continue on once the host names their script looked up have been resolved
+    void *threadpool;
 } g_proxy_resolver_posix_s;
 
 g_proxy_resolver_posix_s g_proxy_resolver_posix;
@@ -41,48 +63,112 @@ g_proxy_resolver_posix_s g_proxy_resolver_posix;
 typedef struct proxy_resolver_posix_s {
     // Last system error
     int32_t error;
-    // Complete event
+    // Complete event, allocated because this resolver is also built on platforms without event_futex_s
     void *complete;
     // Proxy list
     char *list;
+    // Config snapshot specific to this resolver instance
+    proxy_resolver_config_s *config;
+    // Resolution in progress, kept while its script waits for host names to be resolved
+    char *url;
+    const char *script;
+    void *script_entry;
+    proxy_resolver_posix_script_s *wpad_script;
+    void *proxy_execute;
+    void *dns;
+    int32_t restarts;
+    uint64_t start_us;
+    // Called once the resolution has completed if it can finish on another thread
+    proxy_resolver_complete_cb callback;
+    void *user_data;
 } proxy_resolver_posix_s;
 
+static void proxy_resolver_posix_script_release(proxy_resolver_posix_script_s **script) {
+    if (!*script)
+        return;
+    if (atomic_decrement_i32(&(*script)->ref_count) == 0) {
+        free((*script)->script);
+        free(*script);
+    }
+    *script = NULL;
+}
+
+// Must be called with lock held
+static proxy_resolver_posix_script_s *proxy_resolver_posix_script_acquire(void) {
+    proxy_resolver_posix_script_s *script = g_proxy_resolver_posix.script;
+    if (script)
+        atomic_increment_i32(&script->ref_count);
+    return script;
+}
+
+// Must be called with lock held, takes ownership of the script
+static void proxy_resolver_posix_set_script(char *script) {
+    proxy_resolver_posix_script_s *shared = NULL;
+
+    if (script) {
+        shared = (proxy_resolver_posix_script_s *)calloc(1, sizeof(proxy_resolver_posix_script_s));
+        if (!shared) {
+            LOG_ERROR("Unable to allocate memory for %s (%" PRId32 ")\n", "script", (int32_t)ENOMEM);
+            free(script);
+            script = NULL;
+        } else {
+            shared->script = script;
+            shared->ref_count = 1;
+        }
+    }
+
+    // Resolutions still executing the previous script keep it alive until they release it
+    proxy_resolver_posix_script_release(&g_proxy_resolver_posix.script);
+    g_proxy_resolver_posix.script = shared;
+}
+
 static char *proxy_resolver_posix_wpad_discover(void) {
     char *auto_config_url = NULL;
     char *script = NULL;
 
+    trace_begin("proxy_resolver_posix_wpad_discover");
+
     // Check if we need to re-discover the WPAD auto config url
     if (g_proxy_resolver_posix.last_wpad_time > 0 &&
         g_proxy_resolver_posix.last_wpad_time + WPAD_EXPIRE_SECONDS >= time(NULL)) {
         // Use cached version of WPAD auto config url
         auto_config_url = g_proxy_resolver_posix.auto_config_url;
+        stats_add(STATS_CACHE_HITS, 1);
     } else {
         free(g_proxy_resolver_posix.auto_config_url);
         g_proxy_resolver_posix.auto_config_url = NULL;
+        stats_add(STATS_CACHE_MISSES, 1);
 
         // Detect proxy auto configuration using DHCP
         LOG_INFO("Discovering proxy auto config using WPAD (%s)\n", "DHCP");
+        uint64_t start_us = stats_get_time_us();
         auto_config_url = wpad_dhcp(WPAD_DHCP_TIMEOUT);
+        stats_record_since(STATS_WPAD_DHCP_TIME, start_us);
 
         // Detect proxy auto configuration using DNS
         if (!auto_config_url) {
             LOG_INFO("Discovering proxy auto config using WPAD (%s)\n", "DNS");
+            start_us = stats_get_time_us();
             script = wpad_dns(NULL);
-            if (script) {
-                g_proxy_resolver_posix.script = script;
+            stats_record_since(STATS_WPAD_DNS_TIME, start_us);
+            // Script from a previous discovery is no longer valid
+            proxy_resolver_posix_set_script(script);
+            if (script)
                 g_proxy_resolver_posix.last_fetch_time = time(NULL);
-            }
         }
 
         g_proxy_resolver_posix.auto_config_url = auto_config_url;
         g_proxy_resolver_posix.last_wpad_time = time(NULL);
     }
 
+    trace_end("proxy_resolver_posix_wpad_discover");
+
     // Duplicate so it can be freed the same if proxy_config_get_auto_config_url() returns a string
     return auto_config_url ? strdup(auto_config_url) : NULL;
 }
 
-static char *proxy_resolver_posix_fetch_pac(const char *auto_config_url, int32_t *error) {
+// Must be called with lock held
+static proxy_resolver_posix_script_s *proxy_resolver_posix_fetch_pac(const char *auto_config_url, int32_t *error) {
     char *script = NULL;
 
     // Check if the auto config url has changed
@@ -96,98 +182,219 @@ static char *proxy_resolver_posix_fetch_pac(const char *auto_config_url, int32_t
     if (g_proxy_resolver_posix.last_fetch_time > 0 &&
         g_proxy_resolver_posix.last_fetch_time + WPAD_EXPIRE_SECONDS >= time(NULL) && !url_changed) {
         // Use cached version of the PAC script
-        script = g_proxy_resolver_posix.script;
+        stats_add(STATS_CACHE_HITS, 1);
     } else {
         LOG_INFO("Fetching proxy auto config script from %s\n", auto_config_url);
+        stats_add(STATS_CACHE_MISSES, 1);
 
+        const uint64_t start_us = stats_get_time_us();
         script = fetch_get(auto_config_url, error);
-        if (!script)
+        stats_record_since(STATS_PAC_FETCH_TIME, start_us);
+        if (script)
+            stats_add(STATS_PAC_FETCH_BYTES, strlen(script));
+        else
             LOG_ERROR("Unable to fetch proxy auto config script %s (%" PRId32 ")\n", auto_config_url, *error);
 
-        free(g_proxy_resolver_posix.script);
-        g_proxy_resolver_posix.script = script;
+        proxy_resolver_posix_set_script(script);
         g_proxy_resolver_posix.last_fetch_time = time(NULL);
     }
 
-    return script;
+    return proxy_resolver_posix_script_acquire();
 }
 
-bool proxy_resolver_posix_get_proxies_for_url(void *ctx, const char *url) {
-    proxy_resolver_posix_s *proxy_resolver = (proxy_resolver_posix_s *)ctx;
-    void *proxy_execute = NULL;
-    char *auto_config_url = NULL;
-    char *proxy = NULL;
-    char *script = NULL;
+static bool proxy_resolver_posix_finish(proxy_resolver_posix_s *proxy_resolver) {
+    proxy_resolver_complete_cb callback = proxy_resolver->callback;
+    void *user_data = proxy_resolver->user_data;
+
+    if (proxy_resolver->proxy_execute)
+        proxy_execute_delete(&proxy_resolver->proxy_execute);
+    if (proxy_resolver->dns)
+        execute_dns_delete(&proxy_resolver->dns);
+    if (proxy_resolver->script_entry)
+        script_store_release(&proxy_resolver->script_entry);
+    proxy_resolver_posix_script_release(&proxy_resolver->wpad_script);
+    proxy_resolver->script = NULL;
+    free(proxy_resolver->url);
+    proxy_resolver->url = NULL;
+    proxy_resolver->callback = NULL;
+    proxy_resolver->user_data = NULL;
+
+    if (proxy_resolver->error)
+        stats_record_error(proxy_resolver->error);
+
+    // Instance may be reused or deleted as soon as it is signalled or the callback has been called
+    const bool is_ok = proxy_resolver->list != NULL;
+    event_set(proxy_resolver->complete);
+    if (callback)
+        callback(user_data);
+    return is_ok;
+}
+
+static void proxy_resolver_posix_execute_threadpool(void *arg);
+
+static void proxy_resolver_posix_dns_resolved(void *user_data) {
+    // Continue on the resolver thread pool rather than on the thread that resolved the last host name
+    if (!threadpool_enqueue(g_proxy_resolver_posix.threadpool, user_data, proxy_resolver_posix_execute_threadpool))
+        proxy_resolver_posix_execute_threadpool(user_data);
+}
+
+// Returns false if the resolution failed or continues on another thread
+static bool proxy_resolver_posix_execute(proxy_resolver_posix_s *proxy_resolver) {
+    const char *list = NULL;
     char *scheme = NULL;
-    bool locked = false;
     bool is_ok = false;
 
-    if (proxy_config_get_auto_discover()) {
-        locked = mutex_lock(g_proxy_resolver_posix.mutex);
-        // Discover the proxy auto config url
-        auto_config_url = proxy_resolver_posix_wpad_discover();
+    for (;;) {
+        // Host names that have not been resolved yet are recorded rather than blocking the script, until the last
+        // attempt which resolves any remaining host names directly
+        execute_dns_set_nonblocking(proxy_resolver->dns, proxy_resolver->restarts < EXECUTE_DNS_MAX_RESTARTS);
+        execute_dns_set_current(proxy_resolver->dns);
+        is_ok = proxy_execute_get_proxies_for_url(proxy_resolver->proxy_execute, proxy_resolver->script,
+                                                  proxy_resolver->url);
+        execute_dns_set_current(NULL);
+
+        // Results are only valid when the script did not look up any unresolved host names
+        if (!execute_dns_get_missing_count(proxy_resolver->dns))
+            break;
+
+        proxy_resolver->restarts++;
+        stats_add(STATS_PAC_DNS_RESTARTS, 1);
+
+        // Free the thread while the recorded host names are resolved and run the script again once they have been
+        if (proxy_resolver->callback && g_proxy_resolver_posix.threadpool &&
+            execute_dns_resolve_missing_async(proxy_resolver->dns, proxy_resolver_posix_dns_resolved, proxy_resolver))
+            return false;
+        execute_dns_resolve_missing(proxy_resolver->dns);
     }
 
-    // Use manually specified proxy auto configuration
-    if (!auto_config_url)
-        auto_config_url = proxy_config_get_auto_config_url();
+    stats_record_since(STATS_PAC_EXECUTE_TIME, proxy_resolver->start_us);
+    if (!is_ok) {
+        proxy_resolver->error = proxy_execute_get_error(proxy_resolver->proxy_execute);
+        LOG_ERROR("Unable to get proxies for url (%" PRId32 ")\n", proxy_resolver->error);
+        goto posix_done;
+    }
 
-    if (auto_config_url) {
-        // Download proxy auto config script if available
-        script = proxy_resolver_posix_fetch_pac(auto_config_url, &proxy_resolver->error);
-        locked = locked && !mutex_unlock(g_proxy_resolver_posix.mutex);
+    // Get return value from FindProxyForURL
+    list = proxy_execute_get_list(proxy_resolver->proxy_execute);
 
-        if (!script)
-            goto posix_done;
+    // Use scheme associated with the URL when determining proxy
+    scheme = get_url_scheme(proxy_resolver->url, "http");
+    if (!scheme) {
+        proxy_resolver->error = ENOMEM;
+        LOG_ERROR("Unable to allocate memory for %s (%" PRId32 ")\n", "scheme", proxy_resolver->error);
+        goto posix_done;
+    }
 
-        // Execute blocking proxy auto config script for url
-        proxy_execute = proxy_execute_create();
-        if (!proxy_execute) {
-            proxy_resolver->error = ENOMEM;
-            LOG_ERROR("Unable to allocate memory for %s (%" PRId32 ")\n", "execute object", proxy_resolver->error);
-            goto posix_done;
-        }
+    // Convert return value from FindProxyForURL to uri list. We use the default
+    // scheme corresponding to the protocol of the original request.
+    proxy_resolver->list = convert_proxy_list_to_uri_list(list, scheme);
 
-        if (!proxy_execute_get_proxies_for_url(proxy_execute, g_proxy_resolver_posix.script, url)) {
-            proxy_resolver->error = proxy_execute_get_error(proxy_execute);
-            LOG_ERROR("Unable to get proxies for url (%" PRId32 ")\n", proxy_resolver->error);
-            goto posix_done;
+posix_done:
+
+    free(scheme);
+    return proxy_resolver_posix_finish(proxy_resolver);
+}
+
+static void proxy_resolver_posix_execute_threadpool(void *arg) {
+    proxy_resolver_posix_execute((proxy_resolver_posix_s *)arg);
+}
+
+// Returns false if the resolution failed or continues on another thread
+static bool proxy_resolver_posix_start(proxy_resolver_posix_s *proxy_resolver, const char *url,
+                                       proxy_resolver_complete_cb callback, void *user_data) {
+    char *auto_config_url = NULL;
+
+    proxy_resolver->callback = callback;
+    proxy_resolver->user_data = user_data;
+    proxy_resolver->restarts = 0;
+
+    const proxy_resolver_config_s *config = proxy_resolver->config;
+    const bool use_system_config = proxy_resolver_config_uses_system_config(config);
+
+    if (config && config->script) {
+        // Use proxy auto config script specific to this resolver instance
+        proxy_resolver->script = config->script;
+    } else if (config && config->auto_config_url) {
+        // Use proxy auto config url specific to this resolver instance
+        auto_config_url = strdup(config->auto_config_url);
+    } else if ((config && config->auto_discover) || (use_system_config && proxy_config_get_auto_discover())) {
+        mutex_lock(g_proxy_resolver_posix.mutex);
+
+        // Discover the proxy auto config url
+        auto_config_url = proxy_resolver_posix_wpad_discover();
+        if (auto_config_url) {
+            // Download proxy auto config script if available
+            proxy_resolver->wpad_script = proxy_resolver_posix_fetch_pac(auto_config_url, &proxy_resolver->error);
+        } else {
+            // Use proxy auto config script discovered using DNS
+            proxy_resolver->wpad_script = proxy_resolver_posix_script_acquire();
         }
 
-        // Get return value from FindProxyForURL
-        const char *list = proxy_execute_get_list(proxy_execute);
+        mutex_unlock(g_proxy_resolver_posix.mutex);
+
+        // Borrow the script so that background WPAD revalidation can replace it while it is executing
+        if (proxy_resolver->wpad_script)
+            proxy_resolver->script = proxy_resolver->wpad_script->script;
 
-        // Use scheme associated with the URL when determining proxy
-        scheme = get_url_scheme(url, "http");
-        if (!scheme) {
-            proxy_resolver->error = ENOMEM;
-            LOG_ERROR("Unable to allocate memory for %s (%" PRId32 ")\n", "scheme", proxy_resolver->error);
+        if (auto_config_url && !proxy_resolver->script)
             goto posix_done;
-        }
+    }
 
-        // Convert return value from FindProxyForURL to uri list. We use the default
-        // scheme corresponding to the protocol of the original request.
-        proxy_resolver->list = convert_proxy_list_to_uri_list(list, scheme);
-    } else {
+    // Use manually specified proxy auto configuration
+    if (!auto_config_url && !proxy_resolver->script && use_system_config)
+        auto_config_url = proxy_config_get_auto_config_url();
+
+    if (!auto_config_url && !proxy_resolver->script) {
         // Use DIRECT connection since WPAD didn't result in a proxy auto-configuration url
         proxy_resolver->list = strdup("direct://");
+        goto posix_done;
     }
 
-posix_done:
+    if (!proxy_resolver->script) {
+        // Download proxy auto config script shared with other resolvers using the same url
+        proxy_resolver->script_entry = script_store_acquire(auto_config_url, &proxy_resolver->error);
+        proxy_resolver->script = script_store_get_script(proxy_resolver->script_entry);
+        if (!proxy_resolver->script)
+            goto posix_done;
+    }
 
-    if (proxy_execute)
-        proxy_execute_delete(&proxy_execute);
-    if (locked)
-        mutex_unlock(g_proxy_resolver_posix.mutex);
+    // Execute proxy auto config script for url
+    proxy_resolver->url = strdup(url);
+    proxy_resolver->proxy_execute = proxy_execute_create();
+    if (!proxy_resolver->url || !proxy_resolver->proxy_execute) {
+        proxy_resolver->error = ENOMEM;
+        LOG_ERROR("Unable to allocate memory for %s (%" PRId32 ")\n", "execute object", proxy_resolver->error);
+        goto posix_done;
+    }
 
-    is_ok = proxy_resolver->list != NULL;
-    event_set(proxy_resolver->complete);
+    // Host names are resolved inside the script if they can't be recorded
+    proxy_resolver->dns = execute_dns_create();
+    proxy_resolver->start_us = stats_get_time_us();
 
-    free(scheme);
-    free(proxy);
     free(auto_config_url);
+    return proxy_resolver_posix_execute(proxy_resolver);
 
-    return is_ok;
+posix_done:
+
+    free(auto_config_url);
+    return proxy_resolver_posix_finish(proxy_resolver);
+}
+
+bool proxy_resolver_posix_get_proxies_for_url(void *ctx, const char *url) {
+    proxy_resolver_posix_s *proxy_resolver = (proxy_resolver_posix_s *)ctx;
+    if (!proxy_resolver)
+        return false;
+    // Resolution completes before returning when there is no callback
+    return proxy_resolver_posix_start(proxy_resolver, url, NULL, NULL);
+}
+
+bool proxy_resolver_posix_get_proxies_for_url_async(void *ctx, const char *url, proxy_resolver_complete_cb callback,
+                                                    void *user_data) {
+    proxy_resolver_posix_s *proxy_resolver = (proxy_resolver_posix_s *)ctx;
+    if (!proxy_resolver)
+        return false;
+    proxy_resolver_posix_start(proxy_resolver, url, callback, user_data);
+    return true;
 }
 
 const char *proxy_resolver_posix_get_list(void *ctx) {
@@ -214,6 +421,40 @@ bool proxy_resolver_posix_cancel(void *ctx) {
     return false;
 }
 
+bool proxy_resolver_posix_set_config(void *ctx, proxy_resolver_config_s *config) {
+    proxy_resolver_posix_s *proxy_resolver = (proxy_resolver_posix_s *)ctx;
+    if (!proxy_resolver)
+        return false;
+    proxy_resolver_config_release(&proxy_resolver->config);
+    proxy_resolver->config = proxy_resolver_config_acquire(config);
+    return true;
+}
+
+bool proxy_resolver_posix_reset(void *ctx) {
+    proxy_resolver_posix_s *proxy_resolver = (proxy_resolver_posix_s *)ctx;
+    if (!proxy_resolver)
+        return false;
+    proxy_resolver->error = 0;
+    free(proxy_resolver->list);
+    proxy_resolver->list = NULL;
+    // Re-arm complete event so that waiting does not return the previous resolution
+    return event_reset(proxy_resolver->complete);
+}
+
+bool proxy_resolver_posix_set_result(void *ctx, const char *list, int32_t error) {
+    proxy_resolver_posix_s *proxy_resolver = (proxy_resolver_posix_s *)ctx;
+    if (!proxy_resolver)
+        return false;
+    free(proxy_resolver->list);
+    proxy_resolver->list = list ? strdup(list) : NULL;
+    proxy_resolver->error = error;
+    if (list && !proxy_resolver->list) {
+        proxy_resolver->error = ENOMEM;
+        LOG_ERROR("Unable to allocate memory for %s (%" PRId32 ")\n", "list", proxy_resolver->error);
+    }
+    return event_set(proxy_resolver->complete);
+}
+
 void *proxy_resolver_posix_create(void) {
     proxy_resolver_posix_s *proxy_resolver = (proxy_resolver_posix_s *)calloc(1, sizeof(proxy_resolver_posix_s));
     if (!proxy_resolver)
@@ -232,13 +473,21 @@ bool proxy_resolver_posix_delete(void **ctx) {
     proxy_resolver_posix_s *proxy_resolver = (proxy_resolver_posix_s *)*ctx;
     if (!proxy_resolver)
         return false;
-    proxy_resolver_cancel(ctx);
+    proxy_resolver_posix_cancel(proxy_resolver);
     event_delete(&proxy_resolver->complete);
     free(proxy_resolver->list);
+    proxy_resolver_config_release(&proxy_resolver->config);
     free(proxy_resolver);
     return true;
 }
 
+static void proxy_resolver_posix_save_cache(void) {
+    if (!wpad_cache_is_enabled() || !g_proxy_resolver_posix.script)
+        return;
+    wpad_cache_save(g_proxy_resolver_posix.network_fingerprint, g_proxy_resolver_posix.auto_config_url,
+                    g_proxy_resolver_posix.script->script, g_proxy_resolver_posix.last_fetch_time);
+}
+
 static void proxy_resolver_posix_wpad_startup(void *arg) {
     UNUSED(arg);
 
@@ -250,37 +499,133 @@ static void proxy_resolver_posix_wpad_startup(void *arg) {
         int32_t error = 0;
 
         // Download proxy auto config script if available
-        proxy_resolver_posix_fetch_pac(auto_config_url, &error);
+        proxy_resolver_posix_script_s *script = proxy_resolver_posix_fetch_pac(auto_config_url, &error);
+        proxy_resolver_posix_script_release(&script);
         free(auto_config_url);
     }
 
+    proxy_resolver_posix_save_cache();
     mutex_unlock(g_proxy_resolver_posix.mutex);
 }
 
+static void proxy_resolver_posix_wpad_revalidate(void *arg) {
+    char *auto_config_url = NULL;
+    char *script = NULL;
+    int32_t error = 0;
+
+    UNUSED(arg);
+
+    // Discover without holding the lock so that resolutions continue to use the cached script
+    LOG_INFO("Revalidating cached proxy auto config using WPAD\n");
+    auto_config_url = wpad_dhcp(WPAD_DHCP_TIMEOUT);
+    if (auto_config_url)
+        script = fetch_get(auto_config_url, &error);
+    else
+        script = wpad_dns(NULL);
+
+    mutex_lock(g_proxy_resolver_posix.mutex);
+
+    if (!auto_config_url && !script) {
+        // WPAD is no longer available on this network
+        free(g_proxy_resolver_posix.auto_config_url);
+        g_proxy_resolver_posix.auto_config_url = NULL;
+        proxy_resolver_posix_set_script(NULL);
+        g_proxy_resolver_posix.last_fetch_time = 0;
+    } else if (script) {
+        free(g_proxy_resolver_posix.auto_config_url);
+        g_proxy_resolver_posix.auto_config_url = auto_config_url;
+        auto_config_url = NULL;
+
+        // Only replace the script if it has changed
+        if (!g_proxy_resolver_posix.script || strcmp(g_proxy_resolver_posix.script->script, script) != 0) {
+            proxy_resolver_posix_set_script(script);
+            script = NULL;
+        }
+        g_proxy_resolver_posix.last_fetch_time = time(NULL);
+        proxy_resolver_posix_save_cache();
+    }
+    g_proxy_resolver_posix.last_wpad_time = time(NULL);
+
+    mutex_unlock(g_proxy_resolver_posix.mutex);
+
+    free(auto_config_url);
+    free(script);
+}
+
+static bool proxy_resolver_posix_load_cache(bool *needs_revalidate) {
+    char *auto_config_url = NULL;
+    char *script = NULL;
+    time_t fetch_time = 0;
+
+    if (!wpad_cache_load(g_proxy_resolver_posix.network_fingerprint, &auto_config_url, &script, &fetch_time))
+        return false;
+
+    g_proxy_resolver_posix.auto_config_url = auto_config_url;
+    proxy_resolver_posix_set_script(script);
+    stats_add(STATS_CACHE_HITS, 1);
+
+    // Cached result expires at the same time it would have in the process that fetched it
+    const time_t now = time(NULL);
+    if (fetch_time <= now && fetch_time + WPAD_EXPIRE_SECONDS >= now) {
+        g_proxy_resolver_posix.last_wpad_time = fetch_time;
+        g_proxy_resolver_posix.last_fetch_time = fetch_time;
+        return true;
+    }
+
+    // Trust the expired result until revalidation completes
+    g_proxy_resolver_posix.last_wpad_time = now;
+    g_proxy_resolver_posix.last_fetch_time = now;
+    *needs_revalidate = true;
+    return true;
+}
+
 bool proxy_resolver_posix_global_init(void) {
     return proxy_resolver_posix_init_ex(NULL);
 }
 
 bool proxy_resolver_posix_init_ex(void *threadpool) {
+    if (g_proxy_resolver_posix.ref_count > 0) {
+        g_proxy_resolver_posix.ref_count++;
+        return true;
+    }
+    g_proxy_resolver_posix.threadpool = threadpool;
     g_proxy_resolver_posix.mutex = mutex_create();
     if (!g_proxy_resolver_posix.mutex)
         return false;
 
-    if (!fetch_global_init() || !proxy_execute_global_init())
+    if (!fetch_global_init() || !proxy_execute_global_init() || !script_store_global_init())
         return proxy_resolver_posix_global_cleanup();
 
     // Start WPAD discovery process immediately
-    if (threadpool && proxy_config_get_auto_discover())
+    if (threadpool && proxy_config_get_auto_discover()) {
+        if (wpad_cache_is_enabled()) {
+            g_proxy_resolver_posix.network_fingerprint = wpad_cache_get_network_fingerprint();
+
+            // Use result from previous process and revalidate it in the background once it has expired
+            bool needs_revalidate = false;
+            if (proxy_resolver_posix_load_cache(&needs_revalidate)) {
+                if (needs_revalidate)
+                    threadpool_enqueue(threadpool, NULL, proxy_resolver_posix_wpad_revalidate);
+                g_proxy_resolver_posix.ref_count++;
+                return true;
+            }
+        }
         threadpool_enqueue(threadpool, NULL, proxy_resolver_posix_wpad_startup);
+    }
 
+    g_proxy_resolver_posix.ref_count++;
     return true;
 }
 
 bool proxy_resolver_posix_global_cleanup(void) {
-    free(g_proxy_resolver_posix.script);
+    if (--g_proxy_resolver_posix.ref_count > 0)
+        return true;
+
+    proxy_resolver_posix_script_release(&g_proxy_resolver_posix.script);
     free(g_proxy_resolver_posix.auto_config_url);
     mutex_delete(&g_proxy_resolver_posix.mutex);
 
+    script_store_global_cleanup();
     fetch_global_cleanup();
     proxy_execute_global_cleanup();
 
@@ -300,6 +645,10 @@ const proxy_resolver_i_s *proxy_resolver_posix_get_interface(void) {
         false,  // get_proxies_for_url should be spooled to another thread
         false,  // get_proxies_for_url does not take into account system config
         proxy_resolver_posix_global_init,
-        proxy_resolver_posix_global_cleanup};
+        proxy_resolver_posix_global_cleanup,
+        proxy_resolver_posix_set_config,
+        proxy_resolver_posix_reset,
+        proxy_resolver_posix_set_result,
+        proxy_resolver_posix_get_proxies_for_url_async};
     return &proxy_resolver_posix_i;
 }
@@ -6,6 +6,11 @@ const char *proxy_resolver_posix_get_list(void *ctx);
 int32_t proxy_resolver_posix_get_error(void *ctx);
 bool proxy_resolver_posix_wait(void *ctx, int32_t timeout_ms);
 bool proxy_resolver_posix_cancel(void *ctx);
+bool proxy_resolver_posix_set_config(void *ctx, proxy_resolver_config_s *config);
+bool proxy_resolver_posix_reset(void *ctx);
+bool proxy_resolver_posix_set_result(void *ctx, const char *list, int32_t error);
+bool proxy_resolver_posix_get_proxies_for_url_async(void *ctx, const char *url, proxy_resolver_complete_cb callback,
+                                                    void *user_data);
 
 void *proxy_resolver_posix_create(void);
 bool proxy_resolver_posix_delete(void **ctx);
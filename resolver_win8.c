@@ -8,6 +8,8 @@
 #include <windows.h>
 #include <winhttp.h>
 
+#define LOG_CATEGORY PROXYRES_LOG_CATEGORY_RESOLVER
+
 #include "config.h"
 #include "event.h"
 #include "log.h"
@@ -10,6 +10,8 @@
 
 #include <windows.networking.connectivity.h>
 
+#define LOG_CATEGORY PROXYRES_LOG_CATEGORY_RESOLVER
+
 #include "config.h"
 #include "event.h"
 #include "log.h"
@@ -0,0 +1,451 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <time.h>
+
+#ifdef __linux__
+#  include <unistd.h>
+#  include <sys/inotify.h>
+#endif
+
+#define LOG_CATEGORY PROXYRES_LOG_CATEGORY_FETCH
+
+#include "event.h"
+#include "execute.h"
+#include "fetch.h"
+#include "fetch_local.h"
+#include "log.h"
+#include "mutex.h"
+#include "script_store.h"
+#include "stats_record.h"
+#include "util.h"
+
+#define SCRIPT_STORE_BUCKETS              (256)
+#define SCRIPT_STORE_EXPIRE_SECONDS       (300)
+#define SCRIPT_STORE_ERROR_EXPIRE_SECONDS (10)
+
+typedef struct script_store_entry_s {
+    // Auto config url the script was fetched from
+    char *url;
+    uint64_t url_hash;
+    // PAC script, never modified once fetched
+    char *script;
+    // Error from fetching the script, failures are remembered briefly so that every caller doesn't fetch again
+    int32_t error;
+    // Signalled once the script has been fetched, other callers wait for it instead of fetching it themselves
+    void *fetched;
+    bool is_fetching;
+    // What results of the script depend on, only valid if the script was analyzed
+    proxy_execute_analysis_s analysis;
+    bool is_analyzed;
+    // Changes each time a script is fetched so that results of previous scripts are not reused
+    uint64_t generation;
+    time_t fetch_time;
+    // Local scripts are replaced when changed instead of expiring
+    bool never_expires;
+    // Watch descriptor of the directory containing file:// urls, -1 when not watched
+    int32_t watch;
+    // Name of the file within the watched directory
+    char *watch_name;
+    // Used to find the least recently used script
+    uint64_t last_used;
+    // Number of outstanding references including the store's own reference
+    int32_t ref_count;
+    // Next entry in bucket
+    struct script_store_entry_s *next;
+} script_store_entry_s;
+
+// Directories are watched once no matter how many scripts they contain
+typedef struct script_store_watch_s {
+    int32_t wd;
+    int32_t ref_count;
+    struct script_store_watch_s *next;
+} script_store_watch_s;
+
+typedef struct g_script_store_s {
+    // Script store lock
+    void *mutex;
+    uint64_t clock;
+    // Last generation given to a fetched script
+    uint64_t generation;
+    // Number of scripts in the store
+    int32_t count;
+    // Notifies when files used by file:// urls change, -1 when not available
+    int32_t inotify_fd;
+    // Watched directories
+    script_store_watch_s *watches;
+    // Scripts by auto config url
+    script_store_entry_s *buckets[SCRIPT_STORE_BUCKETS];
+} g_script_store_s;
+
+g_script_store_s g_script_store;
+
+static void script_store_entry_delete(script_store_entry_s *entry) {
+    event_delete(&entry->fetched);
+    free(entry->watch_name);
+    free(entry->url);
+    free(entry->script);
+    free(entry);
+}
+
+// Must be called with lock held, entry is freed once the last reference is released
+static void script_store_entry_unref(script_store_entry_s *entry) {
+    if (--entry->ref_count == 0)
+        script_store_entry_delete(entry);
+}
+
+static script_store_entry_s **script_store_find(const char *url, uint64_t url_hash) {
+    script_store_entry_s **entryp = &g_script_store.buckets[url_hash % SCRIPT_STORE_BUCKETS];
+    while (*entryp) {
+        if ((*entryp)->url_hash == url_hash && strcmp((*entryp)->url, url) == 0)
+            break;
+        entryp = &(*entryp)->next;
+    }
+    return entryp;
+}
+
+// Must be called with lock held, directory is only unwatched once no other script in it is watched
+static void script_store_unwatch(script_store_entry_s *entry) {
+#ifdef __linux__
+    for (script_store_watch_s **watchp = &g_script_store.watches; *watchp; watchp = &(*watchp)->next) {
+        script_store_watch_s *watch = *watchp;
+        if (watch->wd != entry->watch)
+            continue;
+        if (--watch->ref_count == 0) {
+            inotify_rm_watch(g_script_store.inotify_fd, watch->wd);
+            *watchp = watch->next;
+            free(watch);
+        }
+        break;
+    }
+#endif
+    entry->watch = -1;
+}
+
+static void script_store_remove(script_store_entry_s **entryp) {
+    script_store_entry_s *entry = *entryp;
+    if (entry->watch >= 0)
+        script_store_unwatch(entry);
+    *entryp = entry->next;
+    entry->next = NULL;
+    g_script_store.count--;
+    script_store_entry_unref(entry);
+}
+
+static void script_store_evict(void) {
+    script_store_entry_s **oldestp = NULL;
+
+    // Scripts still being executed stay alive until their last reference is released
+    for (int32_t i = 0; i < SCRIPT_STORE_BUCKETS; i++) {
+        for (script_store_entry_s **entryp = &g_script_store.buckets[i]; *entryp; entryp = &(*entryp)->next) {
+            if (!oldestp || (*entryp)->last_used < (*oldestp)->last_used)
+                oldestp = entryp;
+        }
+    }
+    if (oldestp) {
+        LOG_DEBUG("Evicting proxy auto config script %s\n", (*oldestp)->url);
+        script_store_remove(oldestp);
+    }
+}
+
+static void script_store_watch(script_store_entry_s *entry) {
+    if (!fetch_local_is_supported(entry->url))
+        return;
+    char *path = fetch_local_get_path(entry->url);
+    if (!path) {
+        // Contents of data: urls never change
+        entry->never_expires = true;
+        return;
+    }
+#ifdef __linux__
+    if (g_script_store.inotify_fd >= 0) {
+        // Watch the directory so that files replaced by rename are noticed as well as files written in place
+        char *name = strrchr(path, '/');
+        entry->watch_name = strdup(name + 1);
+        *name = 0;
+        const int32_t wd = inotify_add_watch(g_script_store.inotify_fd, *path ? path : "/",
+                                             IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE);
+        if (wd >= 0 && entry->watch_name) {
+            script_store_watch_s *watch = g_script_store.watches;
+            while (watch && watch->wd != wd)
+                watch = watch->next;
+            if (!watch) {
+                watch = (script_store_watch_s *)calloc(1, sizeof(script_store_watch_s));
+                if (watch) {
+                    watch->wd = wd;
+                    watch->next = g_script_store.watches;
+                    g_script_store.watches = watch;
+                } else {
+                    inotify_rm_watch(g_script_store.inotify_fd, wd);
+                }
+            }
+            if (watch) {
+                watch->ref_count++;
+                entry->watch = wd;
+                entry->never_expires = true;
+            }
+        } else if (wd < 0) {
+            LOG_DEBUG("Unable to watch proxy auto config directory %s (%d)\n", path, errno);
+        }
+    }
+#endif
+    free(path);
+}
+
+// Must be called with lock held
+static void script_store_process_changes(void) {
+#ifdef __linux__
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+    if (g_script_store.inotify_fd < 0)
+        return;
+
+    // Remove scripts for files that have changed so that they are read again on next use
+    ssize_t buffer_len = 0;
+    while ((buffer_len = read(g_script_store.inotify_fd, buffer, sizeof(buffer))) > 0) {
+        for (char *eventp = buffer; eventp < buffer + buffer_len;) {
+            const struct inotify_event *event = (const struct inotify_event *)eventp;
+            eventp += sizeof(struct inotify_event) + event->len;
+
+            // Every script in the directory is affected when the directory itself is no longer watched
+            const bool is_ignored = (event->mask & IN_IGNORED) != 0;
+            if (!is_ignored && !event->len)
+                continue;
+
+            for (int32_t i = 0; i < SCRIPT_STORE_BUCKETS; i++) {
+                script_store_entry_s **entryp = &g_script_store.buckets[i];
+                while (*entryp) {
+                    if ((*entryp)->watch != event->wd ||
+                        (!is_ignored && strcmp((*entryp)->watch_name, event->name) != 0)) {
+                        entryp = &(*entryp)->next;
+                        continue;
+                    }
+                    LOG_INFO("Proxy auto config file changed %s\n", (*entryp)->url);
+                    script_store_remove(entryp);
+                }
+            }
+        }
+    }
+#endif
+}
+
+static bool script_store_is_expired(const script_store_entry_s *entry) {
+    if (entry->error)
+        return entry->fetch_time + SCRIPT_STORE_ERROR_EXPIRE_SECONDS < time(NULL);
+    return !entry->never_expires && entry->fetch_time + SCRIPT_STORE_EXPIRE_SECONDS < time(NULL);
+}
+
+static script_store_entry_s *script_store_lookup(const char *url, uint64_t url_hash) {
+    script_store_entry_s **entryp = script_store_find(url, url_hash);
+    script_store_entry_s *entry = *entryp;
+
+    if (!entry)
+        return NULL;
+    if (!entry->is_fetching && script_store_is_expired(entry)) {
+        script_store_remove(entryp);
+        return NULL;
+    }
+    entry->last_used = ++g_script_store.clock;
+    entry->ref_count++;
+    return entry;
+}
+
+// Must be called with lock held, inserts an entry for a script that is about to be fetched by the caller
+static script_store_entry_s *script_store_insert(const char *url, uint64_t url_hash) {
+    script_store_entry_s *entry = (script_store_entry_s *)calloc(1, sizeof(script_store_entry_s));
+    if (!entry)
+        return NULL;
+    entry->url = strdup(url);
+    entry->fetched = event_create();
+    if (!entry->url || !entry->fetched) {
+        script_store_entry_delete(entry);
+        return NULL;
+    }
+    entry->url_hash = url_hash;
+    entry->is_fetching = true;
+    entry->watch = -1;
+    entry->last_used = ++g_script_store.clock;
+    // One reference for the store and one for the caller
+    entry->ref_count = 2;
+
+    script_store_entry_s **entryp = script_store_find(url, url_hash);
+    if (*entryp)
+        script_store_remove(entryp);
+    else if (g_script_store.count >= SCRIPT_STORE_MAX_SCRIPTS)
+        script_store_evict();
+
+    script_store_watch(entry);
+
+    entryp = &g_script_store.buckets[url_hash % SCRIPT_STORE_BUCKETS];
+    entry->next = *entryp;
+    *entryp = entry;
+    g_script_store.count++;
+    return entry;
+}
+
+static void script_store_fetch(script_store_entry_s *entry) {
+    int32_t error = 0;
+
+    LOG_INFO("Fetching proxy auto config script from %s\n", entry->url);
+    stats_add(STATS_CACHE_MISSES, 1);
+
+    const uint64_t start_us = stats_get_time_us();
+    char *script = NULL;
+    if (fetch_local_is_supported(entry->url))
+        script = fetch_local_get(entry->url, &error);
+    else
+        script = fetch_get(entry->url, &error);
+    stats_record_since(STATS_PAC_FETCH_TIME, start_us);
+
+    // Analyze the script once so that resolutions can share results safely
+    proxy_execute_analysis_s analysis;
+    bool is_analyzed = false;
+    if (script) {
+        stats_add(STATS_PAC_FETCH_BYTES, strlen(script));
+        is_analyzed = proxy_execute_analyze_script(script, &analysis);
+    } else {
+        if (!error)
+            error = EIO;
+        LOG_ERROR("Unable to fetch proxy auto config script %s (%" PRId32 ")\n", entry->url, error);
+    }
+
+    mutex_lock(g_script_store.mutex);
+    entry->script = script;
+    entry->error = error;
+    if (is_analyzed)
+        entry->analysis = analysis;
+    entry->is_analyzed = is_analyzed;
+    entry->generation = ++g_script_store.generation;
+    entry->fetch_time = time(NULL);
+    entry->is_fetching = false;
+    mutex_unlock(g_script_store.mutex);
+
+    event_set(entry->fetched);
+}
+
+void *script_store_acquire(const char *auto_config_url, int32_t *error) {
+    script_store_entry_s *entry = NULL;
+    bool is_fetcher = false;
+
+    if (!g_script_store.mutex || !auto_config_url)
+        return NULL;
+
+    const uint64_t url_hash = hash_fnv1a(auto_config_url, strlen(auto_config_url), HASH_FNV1A_INIT);
+
+    mutex_lock(g_script_store.mutex);
+    script_store_process_changes();
+    entry = script_store_lookup(auto_config_url, url_hash);
+    if (!entry) {
+        // Only the first caller fetches the script, everyone else waits for it below
+        entry = script_store_insert(auto_config_url, url_hash);
+        is_fetcher = entry != NULL;
+    }
+    mutex_unlock(g_script_store.mutex);
+
+    if (!entry) {
+        *error = ENOMEM;
+        LOG_ERROR("Unable to allocate memory for %s (%" PRId32 ")\n", "script store entry", *error);
+        return NULL;
+    }
+
+    // Fetch without holding the lock so that other auto config urls can continue to be resolved
+    if (is_fetcher)
+        script_store_fetch(entry);
+    else {
+        stats_add(STATS_CACHE_HITS, 1);
+        event_wait(entry->fetched, -1);
+    }
+
+    if (entry->error) {
+        *error = entry->error;
+        script_store_release((void **)&entry);
+        return NULL;
+    }
+    return entry;
+}
+
+const char *script_store_get_script(void *entry) {
+    if (!entry)
+        return NULL;
+    return ((script_store_entry_s *)entry)->script;
+}
+
+bool script_store_get_analysis(const char *auto_config_url, proxy_execute_analysis_s *analysis,
+                               uint64_t *generation) {
+    bool is_analyzed = false;
+
+    if (!g_script_store.mutex || !auto_config_url || !analysis || !generation)
+        return false;
+
+    const uint64_t url_hash = hash_fnv1a(auto_config_url, strlen(auto_config_url), HASH_FNV1A_INIT);
+
+    // Only look at the cached script, it is fetched again when resolving if it has changed or expired
+    mutex_lock(g_script_store.mutex);
+    script_store_process_changes();
+    script_store_entry_s *entry = *script_store_find(auto_config_url, url_hash);
+    if (entry && !entry->is_fetching && entry->is_analyzed && !script_store_is_expired(entry)) {
+        *analysis = entry->analysis;
+        *generation = entry->generation;
+        is_analyzed = true;
+    }
+    mutex_unlock(g_script_store.mutex);
+    return is_analyzed;
+}
+
+bool script_store_release(void **entry) {
+    if (!entry || !*entry)
+        return false;
+    mutex_lock(g_script_store.mutex);
+    script_store_entry_unref((script_store_entry_s *)*entry);
+    mutex_unlock(g_script_store.mutex);
+    *entry = NULL;
+    return true;
+}
+
+int32_t script_store_get_count(void) {
+    int32_t count = 0;
+    if (!g_script_store.mutex)
+        return 0;
+    mutex_lock(g_script_store.mutex);
+    count = g_script_store.count;
+    mutex_unlock(g_script_store.mutex);
+    return count;
+}
+
+bool script_store_clear(void) {
+    if (!g_script_store.mutex)
+        return false;
+    mutex_lock(g_script_store.mutex);
+    for (int32_t i = 0; i < SCRIPT_STORE_BUCKETS; i++) {
+        while (g_script_store.buckets[i])
+            script_store_remove(&g_script_store.buckets[i]);
+    }
+    mutex_unlock(g_script_store.mutex);
+    return true;
+}
+
+bool script_store_global_init(void) {
+    g_script_store.inotify_fd = -1;
+#ifdef __linux__
+    g_script_store.inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (g_script_store.inotify_fd < 0)
+        LOG_WARN("Unable to watch proxy auto config files (%d)\n", errno);
+#endif
+    g_script_store.mutex = mutex_create();
+    return g_script_store.mutex != NULL;
+}
+
+bool script_store_global_cleanup(void) {
+    script_store_clear();
+    mutex_delete(&g_script_store.mutex);
+#ifdef __linux__
+    if (g_script_store.inotify_fd >= 0)
+        close(g_script_store.inotify_fd);
+#endif
+    memset(&g_script_store, 0, sizeof(g_script_store));
+    return true;
+}
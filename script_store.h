@@ -0,0 +1,37 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Maximum number of PAC scripts held in the script store
+#define SCRIPT_STORE_MAX_SCRIPTS (1024)
+
+// Acquire a reference to the PAC script for the auto config url, fetching it if not cached or expired
+void *script_store_acquire(const char *auto_config_url, int32_t *error);
+
+// Get the PAC script for an acquired reference, the script remains valid until the reference is released
+const char *script_store_get_script(void *entry);
+
+// Get the analysis of the cached PAC script and the generation it was fetched in, false if not cached or expired
+bool script_store_get_analysis(const char *auto_config_url, proxy_execute_analysis_s *analysis,
+                               uint64_t *generation);
+
+// Release a reference acquired from the script store
+bool script_store_release(void **entry);
+
+// Get the number of PAC scripts in the script store
+int32_t script_store_get_count(void);
+
+// Remove all PAC scripts from the script store
+bool script_store_clear(void);
+
+// Initialization function for the script store
+bool script_store_global_init(void);
+
+// Uninitialization function for the script store
+bool script_store_global_cleanup(void);
+
+#ifdef __cplusplus
+}
+#endif
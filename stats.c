@@ -0,0 +1,323 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <inttypes.h>
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <time.h>
+#endif
+
+#include "atomic.h"
+#include "stats.h"
+#include "stats_record.h"
+
+typedef struct g_proxyres_stats_s {
+    // Counters and histograms updated atomically
+    proxyres_stats_s stats;
+    // Error code slot keys, zero when unused
+    uint64_t error_keys[PROXYRES_STATS_MAX_ERRORS];
+} g_proxyres_stats_s;
+
+g_proxyres_stats_s g_proxyres_stats;
+
+static proxyres_histogram_s *stats_get_histogram(proxyres_stats_s *stats, stats_histogram_id id) {
+    switch (id) {
+    case STATS_THREADPOOL_QUEUE_WAIT:
+        return &stats->threadpool_queue_wait;
+    case STATS_WPAD_DHCP_TIME:
+        return &stats->wpad_dhcp_time;
+    case STATS_WPAD_DNS_TIME:
+        return &stats->wpad_dns_time;
+    case STATS_PAC_FETCH_TIME:
+        return &stats->pac_fetch_time;
+    case STATS_PAC_EXECUTE_TIME:
+        return &stats->pac_execute_time;
+    case STATS_PAC_COMPILE_TIME:
+        return &stats->pac_compile_time;
+    case STATS_DNS_RESOLVE_TIME:
+        return &stats->dns_resolve_time;
+    }
+    return NULL;
+}
+
+static uint64_t *stats_get_counter(proxyres_stats_s *stats, stats_counter_id id) {
+    switch (id) {
+    case STATS_PAC_FETCH_BYTES:
+        return &stats->pac_fetch_bytes;
+    case STATS_PAC_COMPILE_CACHE_HITS:
+        return &stats->pac_compile_cache_hits;
+    case STATS_PAC_COMPILE_CACHE_MISSES:
+        return &stats->pac_compile_cache_misses;
+    case STATS_PAC_COMPILE_TIME_SAVED:
+        return &stats->pac_compile_time_saved_us;
+    case STATS_CACHE_HITS:
+        return &stats->cache_hits;
+    case STATS_CACHE_MISSES:
+        return &stats->cache_misses;
+    case STATS_COALESCED_REQUESTS:
+        return &stats->coalesced_requests;
+    case STATS_MEMOIZED_REQUESTS:
+        return &stats->memoized_requests;
+    case STATS_PAC_DNS_RESTARTS:
+        return &stats->pac_dns_restarts;
+    case STATS_RESOLVER_REUSES:
+        return &stats->resolver_reuses;
+    }
+    return NULL;
+}
+
+// Get the log2 bucket for a sample, which is the number of significant bits
+static inline int32_t stats_get_bucket(uint64_t value) {
+    int32_t bucket = 0;
+    if (value) {
+#if defined(_MSC_VER)
+        unsigned long index = 0;
+        _BitScanReverse64(&index, value);
+        bucket = (int32_t)index + 1;
+#else
+        bucket = 64 - __builtin_clzll(value);
+#endif
+    }
+    if (bucket >= PROXYRES_STATS_HISTOGRAM_BUCKETS)
+        bucket = PROXYRES_STATS_HISTOGRAM_BUCKETS - 1;
+    return bucket;
+}
+
+uint64_t stats_get_time_us(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER frequency = {0};
+    LARGE_INTEGER counter;
+    if (!frequency.QuadPart)
+        QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000 +
+           (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+#endif
+}
+
+void stats_record_time(stats_histogram_id id, uint64_t elapsed_us) {
+    proxyres_histogram_s *histogram = stats_get_histogram(&g_proxyres_stats.stats, id);
+    if (!histogram)
+        return;
+    atomic_add_u64(&histogram->count, 1);
+    atomic_add_u64(&histogram->sum_us, elapsed_us);
+    atomic_add_u64(&histogram->buckets[stats_get_bucket(elapsed_us)], 1);
+}
+
+void stats_record_since(stats_histogram_id id, uint64_t start_us) {
+    const uint64_t now_us = stats_get_time_us();
+    stats_record_time(id, now_us > start_us ? now_us - start_us : 0);
+}
+
+void stats_add(stats_counter_id id, uint64_t value) {
+    uint64_t *counter = stats_get_counter(&g_proxyres_stats.stats, id);
+    if (counter)
+        atomic_add_u64(counter, value);
+}
+
+void stats_record_error(int32_t code) {
+    // Encode error code so that the key is never zero
+    const uint64_t key = (uint64_t)(uint32_t)code | ((uint64_t)1 << 32);
+
+    for (int32_t i = 0; i < PROXYRES_STATS_MAX_ERRORS; i++) {
+        uint64_t *slot_key = &g_proxyres_stats.error_keys[i];
+        uint64_t existing_key = atomic_load_u64(slot_key);
+
+        // Claim an unused slot for the error code
+        if (!existing_key && atomic_cas_u64(slot_key, 0, key))
+            existing_key = key;
+        else if (!existing_key)
+            existing_key = atomic_load_u64(slot_key);
+
+        if (existing_key == key) {
+            atomic_add_u64(&g_proxyres_stats.stats.errors[i].count, 1);
+            return;
+        }
+    }
+
+    atomic_add_u64(&g_proxyres_stats.stats.errors_other, 1);
+}
+
+static void stats_copy_histogram(proxyres_histogram_s *dest, proxyres_histogram_s *src) {
+    dest->count = atomic_load_u64(&src->count);
+    dest->sum_us = atomic_load_u64(&src->sum_us);
+    for (int32_t i = 0; i < PROXYRES_STATS_HISTOGRAM_BUCKETS; i++)
+        dest->buckets[i] = atomic_load_u64(&src->buckets[i]);
+}
+
+bool proxyres_get_stats(proxyres_stats_s *stats) {
+    if (!stats)
+        return false;
+
+    proxyres_stats_s *current = &g_proxyres_stats.stats;
+    memset(stats, 0, sizeof(proxyres_stats_s));
+
+    stats_copy_histogram(&stats->threadpool_queue_wait, &current->threadpool_queue_wait);
+    stats_copy_histogram(&stats->wpad_dhcp_time, &current->wpad_dhcp_time);
+    stats_copy_histogram(&stats->wpad_dns_time, &current->wpad_dns_time);
+    stats_copy_histogram(&stats->pac_fetch_time, &current->pac_fetch_time);
+    stats_copy_histogram(&stats->pac_execute_time, &current->pac_execute_time);
+    stats_copy_histogram(&stats->pac_compile_time, &current->pac_compile_time);
+    stats_copy_histogram(&stats->dns_resolve_time, &current->dns_resolve_time);
+
+    stats->pac_fetch_bytes = atomic_load_u64(&current->pac_fetch_bytes);
+    stats->pac_compile_cache_hits = atomic_load_u64(&current->pac_compile_cache_hits);
+    stats->pac_compile_cache_misses = atomic_load_u64(&current->pac_compile_cache_misses);
+    stats->pac_compile_time_saved_us = atomic_load_u64(&current->pac_compile_time_saved_us);
+    stats->cache_hits = atomic_load_u64(&current->cache_hits);
+    stats->cache_misses = atomic_load_u64(&current->cache_misses);
+    stats->coalesced_requests = atomic_load_u64(&current->coalesced_requests);
+    stats->memoized_requests = atomic_load_u64(&current->memoized_requests);
+    stats->pac_dns_restarts = atomic_load_u64(&current->pac_dns_restarts);
+    stats->resolver_reuses = atomic_load_u64(&current->resolver_reuses);
+
+    for (int32_t i = 0; i < PROXYRES_STATS_MAX_ERRORS; i++) {
+        const uint64_t key = atomic_load_u64(&g_proxyres_stats.error_keys[i]);
+        if (!key)
+            continue;
+        stats->errors[i].code = (int32_t)(uint32_t)key;
+        stats->errors[i].count = atomic_load_u64(&current->errors[i].count);
+    }
+    stats->errors_other = atomic_load_u64(&current->errors_other);
+    return true;
+}
+
+void proxyres_reset_stats(void) {
+    volatile uint64_t *values = (volatile uint64_t *)&g_proxyres_stats.stats;
+    const size_t value_count = sizeof(proxyres_stats_s) / sizeof(uint64_t);
+
+    for (size_t i = 0; i < value_count; i++)
+        atomic_store_u64(&values[i], 0);
+    for (int32_t i = 0; i < PROXYRES_STATS_MAX_ERRORS; i++)
+        atomic_store_u64(&g_proxyres_stats.error_keys[i], 0);
+}
+
+typedef struct stats_buffer_s {
+    char *string;
+    size_t string_len;
+    size_t max_string;
+} stats_buffer_s;
+
+static bool stats_buffer_printf(stats_buffer_s *buffer, const char *fmt, ...) {
+    va_list args;
+
+    if (!buffer->string)
+        return false;
+
+    while (true) {
+        va_start(args, fmt);
+        int written = vsnprintf(buffer->string + buffer->string_len, buffer->max_string - buffer->string_len, fmt, args);
+        va_end(args);
+        if (written < 0)
+            return false;
+
+        if (buffer->string_len + (size_t)written < buffer->max_string) {
+            buffer->string_len += (size_t)written;
+            return true;
+        }
+
+        // Grow buffer and try again
+        size_t max_string = buffer->max_string * 2 + (size_t)written;
+        char *string = (char *)realloc(buffer->string, max_string);
+        if (!string) {
+            free(buffer->string);
+            buffer->string = NULL;
+            return false;
+        }
+        buffer->string = string;
+        buffer->max_string = max_string;
+    }
+}
+
+static void stats_print_histogram(stats_buffer_s *buffer, const char *name, const char *help,
+                                  const proxyres_histogram_s *histogram) {
+    uint64_t cumulative = 0;
+
+    stats_buffer_printf(buffer, "# HELP proxyres_%s_seconds %s\n", name, help);
+    stats_buffer_printf(buffer, "# TYPE proxyres_%s_seconds histogram\n", name);
+
+    // Prometheus buckets are cumulative and use upper bounds in seconds
+    for (int32_t i = 0; i < PROXYRES_STATS_HISTOGRAM_BUCKETS - 1; i++) {
+        cumulative += histogram->buckets[i];
+        stats_buffer_printf(buffer, "proxyres_%s_seconds_bucket{le=\"%g\"} %" PRIu64 "\n", name,
+                            (double)((uint64_t)1 << i) / 1000000.0, cumulative);
+    }
+    stats_buffer_printf(buffer, "proxyres_%s_seconds_bucket{le=\"+Inf\"} %" PRIu64 "\n", name, histogram->count);
+    stats_buffer_printf(buffer, "proxyres_%s_seconds_sum %g\n", name, (double)histogram->sum_us / 1000000.0);
+    stats_buffer_printf(buffer, "proxyres_%s_seconds_count %" PRIu64 "\n", name, histogram->count);
+}
+
+static void stats_print_counter(stats_buffer_s *buffer, const char *name, const char *help, uint64_t value) {
+    stats_buffer_printf(buffer, "# HELP proxyres_%s_total %s\n", name, help);
+    stats_buffer_printf(buffer, "# TYPE proxyres_%s_total counter\n", name);
+    stats_buffer_printf(buffer, "proxyres_%s_total %" PRIu64 "\n", name, value);
+}
+
+char *proxyres_stats_to_prometheus(const proxyres_stats_s *stats) {
+    stats_buffer_s buffer = {NULL, 0, 4096};
+
+    if (!stats)
+        return NULL;
+
+    buffer.string = (char *)calloc(buffer.max_string, sizeof(char));
+    if (!buffer.string)
+        return NULL;
+
+    stats_print_histogram(&buffer, "threadpool_queue_wait", "Time jobs waited in the thread pool queue.",
+                          &stats->threadpool_queue_wait);
+    stats_print_histogram(&buffer, "wpad_dhcp", "Time spent discovering WPAD using DHCP.", &stats->wpad_dhcp_time);
+    stats_print_histogram(&buffer, "wpad_dns", "Time spent discovering WPAD using DNS.", &stats->wpad_dns_time);
+    stats_print_histogram(&buffer, "pac_fetch", "Time spent downloading PAC scripts.", &stats->pac_fetch_time);
+    stats_print_counter(&buffer, "pac_fetch_bytes", "Number of PAC script bytes downloaded.", stats->pac_fetch_bytes);
+    stats_print_histogram(&buffer, "pac_execute", "Time spent executing PAC scripts.", &stats->pac_execute_time);
+    stats_print_histogram(&buffer, "pac_compile", "Time spent evaluating PAC scripts into reusable contexts.",
+                          &stats->pac_compile_time);
+    stats_print_counter(&buffer, "pac_compile_cache_hits", "Number of times an evaluated PAC script was reused.",
+                        stats->pac_compile_cache_hits);
+    stats_print_counter(&buffer, "pac_compile_cache_misses", "Number of times a PAC script had to be evaluated.",
+                        stats->pac_compile_cache_misses);
+    stats_buffer_printf(&buffer, "# HELP proxyres_pac_compile_saved_seconds_total %s\n",
+                        "Time saved by reusing evaluated PAC scripts.");
+    stats_buffer_printf(&buffer, "# TYPE proxyres_pac_compile_saved_seconds_total counter\n");
+    stats_buffer_printf(&buffer, "proxyres_pac_compile_saved_seconds_total %g\n",
+                        (double)stats->pac_compile_time_saved_us / 1000000.0);
+    stats_print_histogram(&buffer, "dns_resolve", "Time spent resolving host names for PAC scripts.",
+                          &stats->dns_resolve_time);
+    stats_print_counter(&buffer, "pac_dns_restarts",
+                        "Number of times a PAC script was run again after resolving the host names it looked up.",
+                        stats->pac_dns_restarts);
+    stats_print_counter(&buffer, "cache_hits", "Number of times a cached WPAD url or PAC script was used.",
+                        stats->cache_hits);
+    stats_print_counter(&buffer, "cache_misses", "Number of times a WPAD url or PAC script was not cached.",
+                        stats->cache_misses);
+    stats_print_counter(&buffer, "coalesced_requests",
+                        "Number of resolutions completed by an identical resolution already in progress.",
+                        stats->coalesced_requests);
+    stats_print_counter(&buffer, "memoized_requests",
+                        "Number of resolutions completed by the reusable result of an identical resolution.",
+                        stats->memoized_requests);
+    stats_print_counter(&buffer, "resolver_reuses",
+                        "Number of resolver instances reused from previously deleted instances.",
+                        stats->resolver_reuses);
+
+    stats_buffer_printf(&buffer, "# HELP proxyres_errors_total Number of proxy resolution errors by error code.\n");
+    stats_buffer_printf(&buffer, "# TYPE proxyres_errors_total counter\n");
+    for (int32_t i = 0; i < PROXYRES_STATS_MAX_ERRORS; i++) {
+        if (!stats->errors[i].count)
+            continue;
+        stats_buffer_printf(&buffer, "proxyres_errors_total{code=\"%" PRId32 "\"} %" PRIu64 "\n", stats->errors[i].code,
+                            stats->errors[i].count);
+    }
+    stats_buffer_printf(&buffer, "proxyres_errors_total{code=\"other\"} %" PRIu64 "\n", stats->errors_other);
+
+    return buffer.string;
+}
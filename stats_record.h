@@ -0,0 +1,49 @@
+#pragma once
+
+#include "stats.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum stats_histogram_id {
+    STATS_THREADPOOL_QUEUE_WAIT,
+    STATS_WPAD_DHCP_TIME,
+    STATS_WPAD_DNS_TIME,
+    STATS_PAC_FETCH_TIME,
+    STATS_PAC_EXECUTE_TIME,
+    STATS_PAC_COMPILE_TIME,
+    STATS_DNS_RESOLVE_TIME
+} stats_histogram_id;
+
+typedef enum stats_counter_id {
+    STATS_PAC_FETCH_BYTES,
+    STATS_PAC_COMPILE_CACHE_HITS,
+    STATS_PAC_COMPILE_CACHE_MISSES,
+    STATS_PAC_COMPILE_TIME_SAVED,
+    STATS_CACHE_HITS,
+    STATS_CACHE_MISSES,
+    STATS_COALESCED_REQUESTS,
+    STATS_MEMOIZED_REQUESTS,
+    STATS_PAC_DNS_RESTARTS,
+    STATS_RESOLVER_REUSES
+} stats_counter_id;
+
+// Get monotonic time in microseconds
+uint64_t stats_get_time_us(void);
+
+// Record a duration sample in microseconds
+void stats_record_time(stats_histogram_id id, uint64_t elapsed_us);
+
+// Record a duration sample that started at the given monotonic time
+void stats_record_since(stats_histogram_id id, uint64_t start_us);
+
+// Add a value to a counter
+void stats_add(stats_counter_id id, uint64_t value);
+
+// Increment the count for an error code
+void stats_record_error(int32_t code);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,101 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "execute.h"
+
+// Construct a representative PAC script of approximately the given size in bytes
+static std::string make_pac_script(size_t script_size) {
+    std::string script = "function FindProxyForURL(url, host) {\n";
+    script += "  if (isPlainHostName(host) || shExpMatch(host, \"*.local\"))\n";
+    script += "    return \"DIRECT\";\n";
+
+    char rule[512];
+    for (int32_t i = 0; script.size() < script_size; i++) {
+        switch (i % 3) {
+        case 0:
+            snprintf(rule, sizeof(rule),
+                     "  if (dnsDomainIs(host, \".domain%d.example.com\"))\n"
+                     "    return \"PROXY proxy%d.example.com:8080; DIRECT\";\n",
+                     i, i % 16);
+            break;
+        case 1:
+            snprintf(rule, sizeof(rule),
+                     "  if (shExpMatch(url, \"*://*.wildcard%d.example.com/*\"))\n"
+                     "    return \"HTTPS proxy%d.example.com:443\";\n",
+                     i, i % 16);
+            break;
+        case 2:
+            snprintf(rule, sizeof(rule),
+                     "  if (host == \"host%d.example.com\" || localHostOrDomainIs(host, \"alias%d\"))\n"
+                     "    return \"SOCKS5 proxy%d.example.com:1080\";\n",
+                     i, i, i % 16);
+            break;
+        }
+        script += rule;
+    }
+
+    script += "  return \"PROXY fallback.example.com:8080; DIRECT\";\n";
+    script += "}\n";
+    return script;
+}
+
+static void BM_proxy_execute_get_proxies_for_url(benchmark::State &state) {
+    const std::string script = make_pac_script((size_t)state.range(0));
+
+    for (auto _ : state) {
+        void *proxy_execute = proxy_execute_create();
+        if (!proxy_execute) {
+            state.SkipWithError("Unable to create execute instance");
+            return;
+        }
+        // Url that does not match any rule so the whole script is evaluated
+        if (!proxy_execute_get_proxies_for_url(proxy_execute, script.c_str(), "https://www.no-match.com/path")) {
+            proxy_execute_delete(&proxy_execute);
+            state.SkipWithError("Unable to execute PAC script");
+            return;
+        }
+        benchmark::DoNotOptimize(proxy_execute_get_list(proxy_execute));
+        proxy_execute_delete(&proxy_execute);
+    }
+
+    state.SetBytesProcessed(state.iterations() * script.size());
+}
+BENCHMARK(BM_proxy_execute_get_proxies_for_url)
+    ->Arg(1 * 1024)
+    ->Arg(50 * 1024)
+    ->Arg(250 * 1024)
+    ->Unit(benchmark::kMicrosecond);
+
+// Each iteration uses a different script so that a new context is created and evaluated every time. Run with the
+// environment variable PROXYRES_EXECUTE_ENGINE set to compare script engines.
+static void BM_proxy_execute_context_create(benchmark::State &state) {
+    const std::string script = make_pac_script((size_t)state.range(0));
+    int64_t iteration = 0;
+
+    void *proxy_execute = proxy_execute_create();
+    if (!proxy_execute) {
+        state.SkipWithError("Unable to create execute instance");
+        return;
+    }
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        const std::string unique_script = script + "// " + std::to_string(iteration++) + "\n";
+        state.ResumeTiming();
+
+        if (!proxy_execute_get_proxies_for_url(proxy_execute, unique_script.c_str(), "https://www.no-match.com/path")) {
+            state.SkipWithError("Unable to execute PAC script");
+            break;
+        }
+        benchmark::DoNotOptimize(proxy_execute_get_list(proxy_execute));
+    }
+
+    proxy_execute_delete(&proxy_execute);
+}
+BENCHMARK(BM_proxy_execute_context_create)->Arg(1 * 1024)->Arg(50 * 1024)->Unit(benchmark::kMicrosecond);
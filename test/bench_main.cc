@@ -0,0 +1,17 @@
+#include <stdint.h>
+
+#include <benchmark/benchmark.h>
+
+#include "proxyres.h"
+
+int main(int argc, char **argv) {
+    proxyres_global_early_init();
+    proxyres_global_init();
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    proxyres_global_cleanup();
+    return 0;
+}
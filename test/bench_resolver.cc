@@ -0,0 +1,54 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <benchmark/benchmark.h>
+
+#include "proxyres.h"
+#include "pac_server.h"
+
+static const char *script = R"(
+function FindProxyForURL(url, host) {
+  if (isPlainHostName(host) || host == "127.0.0.1") {
+    return "DIRECT";
+  }
+  if (host == "simple.com") {
+    return "PROXY no-such-proxy:80";
+  }
+  return "HTTPS some-such-proxy:443;HTTPS any-such-proxy:41";
+})";
+
+static void BM_proxy_resolver_get_proxies_for_url(benchmark::State &state) {
+    char auto_config_url[128];
+
+    void *pac_server = pac_server_create(script);
+    if (!pac_server) {
+        state.SkipWithError("Unable to create PAC server");
+        return;
+    }
+
+    // Point resolver at the local PAC server
+    snprintf(auto_config_url, sizeof(auto_config_url), "http://127.0.0.1:%d/pac.js",
+             (int)pac_server_get_port(pac_server));
+    proxy_config_set_auto_config_url_override(auto_config_url);
+
+    // Measure the latency of a complete resolution for a single url
+    for (auto _ : state) {
+        void *proxy_resolver = proxy_resolver_create();
+        if (!proxy_resolver) {
+            state.SkipWithError("Unable to create proxy resolver");
+            break;
+        }
+        proxy_resolver_get_proxies_for_url(proxy_resolver, "http://simple.com/");
+        proxy_resolver_wait(proxy_resolver, -1);
+        benchmark::DoNotOptimize(proxy_resolver_get_list(proxy_resolver));
+        proxy_resolver_delete(&proxy_resolver);
+    }
+
+    state.counters["pac_fetches"] = pac_server_get_request_count(pac_server);
+
+    proxy_config_set_auto_config_url_override(NULL);
+    pac_server_delete(&pac_server);
+}
+BENCHMARK(BM_proxy_resolver_get_proxies_for_url)->Unit(benchmark::kMicrosecond)->UseRealTime();
@@ -0,0 +1,37 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <atomic>
+
+#include <benchmark/benchmark.h>
+
+#include "threadpool.h"
+
+static void threadpool_bench_worker(void *arg) {
+    std::atomic<int32_t> *jobs_run = (std::atomic<int32_t> *)arg;
+    jobs_run->fetch_add(1, std::memory_order_relaxed);
+}
+
+static void BM_threadpool_enqueue(benchmark::State &state) {
+    const int32_t job_count = (int32_t)state.range(0);
+    std::atomic<int32_t> jobs_run(0);
+
+    void *pool = threadpool_create(THREADPOOL_DEFAULT_MIN_THREADS, THREADPOOL_DEFAULT_MAX_THREADS);
+    if (!pool) {
+        state.SkipWithError("Unable to create thread pool");
+        return;
+    }
+
+    // Measure time to enqueue and drain a batch of jobs
+    for (auto _ : state) {
+        for (int32_t i = 0; i < job_count; i++)
+            threadpool_enqueue(pool, &jobs_run, threadpool_bench_worker);
+        threadpool_wait(pool);
+    }
+
+    threadpool_delete(&pool);
+    state.SetItemsProcessed(state.iterations() * job_count);
+}
+BENCHMARK(BM_threadpool_enqueue)->Arg(1)->Arg(100)->Arg(10000)->UseRealTime();
@@ -0,0 +1,92 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "bypass.h"
+#include "util.h"
+
+// Construct a bypass list containing a mix of domain, wildcard, port and cidr rules
+static std::string make_bypass_list(int32_t rule_count) {
+    std::string bypass_list;
+    char rule[HOST_MAX];
+
+    for (int32_t i = 0; i < rule_count; i++) {
+        switch (i % 4) {
+        case 0:
+            snprintf(rule, sizeof(rule), "host%d.example.com", i);
+            break;
+        case 1:
+            snprintf(rule, sizeof(rule), ".domain%d.example.com", i);
+            break;
+        case 2:
+            snprintf(rule, sizeof(rule), "*.port%d.example.com:8080", i);
+            break;
+        case 3:
+            snprintf(rule, sizeof(rule), "10.%d.%d.0/24", (i >> 8) & 0xff, i & 0xff);
+            break;
+        }
+        if (!bypass_list.empty())
+            bypass_list += ",";
+        bypass_list += rule;
+    }
+    bypass_list += ",<local>";
+    return bypass_list;
+}
+
+static void BM_should_bypass_proxy(benchmark::State &state) {
+    const std::string bypass_list = make_bypass_list((int32_t)state.range(0));
+
+    // Url that does not match any rule so the whole list is evaluated
+    for (auto _ : state)
+        benchmark::DoNotOptimize(should_bypass_proxy("https://www.no-match.com/path", bypass_list.c_str()));
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_should_bypass_proxy)->Arg(10)->Arg(100)->Arg(1000);
+
+static void BM_bypass_should_bypass(benchmark::State &state) {
+    const std::string bypass_list = make_bypass_list((int32_t)state.range(0));
+    void *bypass = bypass_create(bypass_list.c_str());
+
+    // Bypass list is compiled once and evaluated for each url
+    for (auto _ : state)
+        benchmark::DoNotOptimize(bypass_should_bypass(bypass, "https://www.no-match.com/path"));
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    bypass_delete(&bypass);
+}
+BENCHMARK(BM_bypass_should_bypass)->Arg(10)->Arg(100)->Arg(1000);
+
+// Construct a proxy list as returned by FindProxyForURL
+static std::string make_proxy_list(int32_t proxy_count) {
+    static const char *types[] = {"PROXY", "HTTPS", "SOCKS5", "HTTP", "SOCKS"};
+    std::string proxy_list;
+    char proxy[HOST_MAX];
+
+    for (int32_t i = 0; i < proxy_count; i++) {
+        snprintf(proxy, sizeof(proxy), "%s proxy%d.example.com:%d", types[i % 5], i, 8000 + i);
+        if (!proxy_list.empty())
+            proxy_list += "; ";
+        proxy_list += proxy;
+    }
+    proxy_list += "; DIRECT";
+    return proxy_list;
+}
+
+static void BM_convert_proxy_list_to_uri_list(benchmark::State &state) {
+    const std::string proxy_list = make_proxy_list((int32_t)state.range(0));
+
+    for (auto _ : state) {
+        char *uri_list = convert_proxy_list_to_uri_list(proxy_list.c_str(), "http");
+        benchmark::DoNotOptimize(uri_list);
+        free(uri_list);
+    }
+
+    state.SetBytesProcessed(state.iterations() * proxy_list.size());
+}
+BENCHMARK(BM_convert_proxy_list_to_uri_list)->Arg(1)->Arg(8)->Arg(64);
@@ -0,0 +1,275 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#  include <winsock2.h>
+#  include <ws2tcpip.h>
+#  include <windows.h>
+#else
+#  include <arpa/inet.h>
+#  include <netinet/in.h>
+#  include <sys/types.h>
+#  include <sys/socket.h>
+#  include <pthread.h>
+#  include <unistd.h>
+#endif
+
+#ifdef _WIN32
+#  define socklen_t int
+#else
+#  define SOCKET         int
+#  define INVALID_SOCKET (-1)
+#  define closesocket    close
+#endif
+
+#include "atomic.h"
+#include "pac_server.h"
+
+typedef struct pac_server_s {
+    // Listening socket
+    SOCKET sfd;
+    // Listening port
+    uint16_t port;
+    // PAC script to serve
+    char *script;
+    size_t script_len;
+    // Number of requests served
+    volatile int32_t request_count;
+    // Stop flag
+    volatile int32_t stop;
+#ifdef _WIN32
+    // Signalled when responses are not being held
+    HANDLE released;
+    HANDLE thread;
+#else
+    pthread_mutex_t mutex;
+    pthread_cond_t released;
+    bool is_held;
+    pthread_t thread;
+#endif
+} pac_server_s;
+
+static void pac_server_wait_released(pac_server_s *pac_server) {
+#ifdef _WIN32
+    WaitForSingleObject(pac_server->released, INFINITE);
+#else
+    pthread_mutex_lock(&pac_server->mutex);
+    while (pac_server->is_held)
+        pthread_cond_wait(&pac_server->released, &pac_server->mutex);
+    pthread_mutex_unlock(&pac_server->mutex);
+#endif
+}
+
+static void pac_server_set_held(pac_server_s *pac_server, bool is_held) {
+#ifdef _WIN32
+    if (is_held)
+        ResetEvent(pac_server->released);
+    else
+        SetEvent(pac_server->released);
+#else
+    pthread_mutex_lock(&pac_server->mutex);
+    pac_server->is_held = is_held;
+    pthread_cond_broadcast(&pac_server->released);
+    pthread_mutex_unlock(&pac_server->mutex);
+#endif
+}
+
+static void pac_server_handle_client(pac_server_s *pac_server, SOCKET cfd) {
+    char request[4096];
+    size_t request_len = 0;
+
+    // Read until the end of the request headers
+    while (request_len < sizeof(request) - 1) {
+        int count = recv(cfd, request + request_len, (int)(sizeof(request) - request_len - 1), 0);
+        if (count <= 0)
+            break;
+        request_len += count;
+        request[request_len] = 0;
+        if (strstr(request, "\r\n\r\n"))
+            break;
+    }
+
+    pac_server_wait_released(pac_server);
+
+    // Send response headers followed by the script
+    char header[256];
+    int header_len = snprintf(header, sizeof(header),
+                              "HTTP/1.0 200 OK\r\n"
+                              "Content-Type: application/x-ns-proxy-autoconfig\r\n"
+                              "Content-Length: %u\r\n"
+                              "Connection: close\r\n"
+                              "\r\n",
+                              (uint32_t)pac_server->script_len);
+    send(cfd, header, header_len, 0);
+
+    size_t sent = 0;
+    while (sent < pac_server->script_len) {
+        int count = send(cfd, pac_server->script + sent, (int)(pac_server->script_len - sent), 0);
+        if (count <= 0)
+            break;
+        sent += count;
+    }
+
+    atomic_increment_i32(&pac_server->request_count);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI pac_server_do_work(LPVOID arg) {
+#else
+static void *pac_server_do_work(void *arg) {
+#endif
+    pac_server_s *pac_server = (pac_server_s *)arg;
+
+    while (!atomic_load_acquire_i32(&pac_server->stop)) {
+        SOCKET cfd = accept(pac_server->sfd, NULL, NULL);
+        if (cfd == INVALID_SOCKET)
+            break;
+
+        pac_server_handle_client(pac_server, cfd);
+
+#ifdef _WIN32
+        shutdown(cfd, SD_SEND);
+#else
+        shutdown(cfd, SHUT_WR);
+#endif
+        closesocket(cfd);
+    }
+
+    return 0;
+}
+
+uint16_t pac_server_get_port(void *ctx) {
+    pac_server_s *pac_server = (pac_server_s *)ctx;
+    if (!pac_server)
+        return 0;
+    return pac_server->port;
+}
+
+int32_t pac_server_get_request_count(void *ctx) {
+    pac_server_s *pac_server = (pac_server_s *)ctx;
+    if (!pac_server)
+        return 0;
+    return atomic_load_acquire_i32(&pac_server->request_count);
+}
+
+bool pac_server_hold(void *ctx) {
+    pac_server_s *pac_server = (pac_server_s *)ctx;
+    if (!pac_server)
+        return false;
+    pac_server_set_held(pac_server, true);
+    return true;
+}
+
+bool pac_server_release(void *ctx) {
+    pac_server_s *pac_server = (pac_server_s *)ctx;
+    if (!pac_server)
+        return false;
+    pac_server_set_held(pac_server, false);
+    return true;
+}
+
+void *pac_server_create(const char *script) {
+    return pac_server_create_ex(script, 0);
+}
+
+void *pac_server_create_ex(const char *script, uint16_t port) {
+    struct sockaddr_in address = {0};
+    socklen_t address_len = sizeof(address);
+
+    if (!script)
+        return NULL;
+
+    pac_server_s *pac_server = (pac_server_s *)calloc(1, sizeof(pac_server_s));
+    if (!pac_server)
+        return NULL;
+
+#ifdef _WIN32
+    pac_server->released = CreateEvent(NULL, TRUE, TRUE, NULL);
+    if (!pac_server->released)
+        goto pac_server_error;
+#else
+    pthread_mutex_init(&pac_server->mutex, NULL);
+    pthread_cond_init(&pac_server->released, NULL);
+#endif
+
+    pac_server->script = strdup(script);
+    if (!pac_server->script)
+        goto pac_server_error;
+    pac_server->script_len = strlen(script);
+
+    // Create listening socket on the loopback adapter
+    pac_server->sfd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (pac_server->sfd == INVALID_SOCKET)
+        goto pac_server_error;
+
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+
+    if (bind(pac_server->sfd, (struct sockaddr *)&address, sizeof(address)) != 0)
+        goto pac_server_error;
+    if (listen(pac_server->sfd, 128) != 0)
+        goto pac_server_error;
+    if (getsockname(pac_server->sfd, (struct sockaddr *)&address, &address_len) != 0)
+        goto pac_server_error;
+
+    pac_server->port = ntohs(address.sin_port);
+
+    // Serve requests on a background thread
+#ifdef _WIN32
+    pac_server->thread = CreateThread(NULL, 0, pac_server_do_work, pac_server, 0, NULL);
+    if (!pac_server->thread)
+        goto pac_server_error;
+#else
+    if (pthread_create(&pac_server->thread, NULL, pac_server_do_work, pac_server) != 0)
+        goto pac_server_error;
+#endif
+
+    return pac_server;
+
+pac_server_error:
+    if (pac_server->sfd && pac_server->sfd != INVALID_SOCKET)
+        closesocket(pac_server->sfd);
+#ifdef _WIN32
+    if (pac_server->released)
+        CloseHandle(pac_server->released);
+#else
+    pthread_cond_destroy(&pac_server->released);
+    pthread_mutex_destroy(&pac_server->mutex);
+#endif
+    free(pac_server->script);
+    free(pac_server);
+    return NULL;
+}
+
+bool pac_server_delete(void **ctx) {
+    if (!ctx)
+        return false;
+    pac_server_s *pac_server = (pac_server_s *)*ctx;
+    if (!pac_server)
+        return false;
+
+    // Unblock accept by shutting down the listening socket
+    atomic_store_release_i32(&pac_server->stop, true);
+    pac_server_set_held(pac_server, false);
+#ifdef _WIN32
+    closesocket(pac_server->sfd);
+    WaitForSingleObject(pac_server->thread, INFINITE);
+    CloseHandle(pac_server->thread);
+    CloseHandle(pac_server->released);
+#else
+    shutdown(pac_server->sfd, SHUT_RDWR);
+    pthread_join(pac_server->thread, NULL);
+    closesocket(pac_server->sfd);
+    pthread_cond_destroy(&pac_server->released);
+    pthread_mutex_destroy(&pac_server->mutex);
+#endif
+
+    free(pac_server->script);
+    free(pac_server);
+    *ctx = NULL;
+    return true;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Get the port the PAC server is listening on.
+uint16_t pac_server_get_port(void *ctx);
+
+// Get the number of requests served by the PAC server.
+int32_t pac_server_get_request_count(void *ctx);
+
+// Hold responses to requests until released so that clients can be kept waiting.
+bool pac_server_hold(void *ctx);
+
+// Send responses to held requests and stop holding responses.
+bool pac_server_release(void *ctx);
+
+// Create a HTTP server on the loopback adapter that serves a PAC script for every request.
+void *pac_server_create(const char *script);
+
+// Create a HTTP server on the loopback adapter listening on a specific port, or an ephemeral port if 0.
+void *pac_server_create_ex(const char *script, uint16_t port);
+
+// Stop and delete a PAC server instance.
+bool pac_server_delete(void **ctx);
+
+#ifdef __cplusplus
+}
+#endif
@@ -11,6 +11,7 @@
 
 #include "proxyres/config.h"
 #include "proxyres/execute.h"
+#include "proxyres/proxyres.h"
 #include "proxyres/resolver.h"
 
 #ifdef _WIN32
@@ -19,6 +20,13 @@
 #  define O_BINARY _O_BINARY
 #  define ssize_t  int
 #else
+#  include <errno.h>
+#  include <time.h>
+#  include <poll.h>
+#  include <pthread.h>
+#  include <signal.h>
+#  include <sys/socket.h>
+#  include <sys/un.h>
 #  include <unistd.h>
 #  define O_BINARY 0
 #endif
@@ -118,6 +126,163 @@ static bool resolve_proxies_for_url_async(int argc, char *argv[], bool verbose)
     return is_ok;
 }
 
+#define RESOLVE_DEFAULT_WINDOW (64)
+#define RESOLVE_MAX_URL        (8192)
+
+typedef struct resolve_slot_s {
+    // Resolver instance, NULL if the slot is free
+    void *proxy_resolver;
+    char *url;
+    uint64_t start_us;
+} resolve_slot_s;
+
+static uint64_t get_time_us(void) {
+#ifdef _WIN32
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000 +
+           (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000 / (uint64_t)frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+#endif
+}
+
+static void print_json_string(const char *value) {
+    putchar('"');
+    for (const unsigned char *c = (const unsigned char *)value; *c; c++) {
+        if (*c == '"' || *c == '\\')
+            printf("\\%c", *c);
+        else if (*c < 0x20)
+            printf("\\u%04x", *c);
+        else
+            putchar(*c);
+    }
+    putchar('"');
+}
+
+// Read the next non-empty line, skipping lines that are too long to be urls
+static bool read_url_line(FILE *stream, char *line, size_t max_line) {
+    while (fgets(line, (int)max_line, stream)) {
+        size_t line_len = strlen(line);
+        if (line_len == max_line - 1 && line[line_len - 1] != '\n' && !feof(stream)) {
+            int c = 0;
+            while ((c = fgetc(stream)) != EOF && c != '\n')
+                ;
+            fprintf(stderr, "Skipping url longer than %d characters\n", (int)max_line - 2);
+            continue;
+        }
+        while (line_len > 0 && strchr("\r\n\t ", line[line_len - 1]))
+            line[--line_len] = 0;
+        if (line_len > 0)
+            return true;
+    }
+    return false;
+}
+
+static void print_resolve_result(resolve_slot_s *slot, uint64_t base_us, bool json) {
+    const char *list = proxy_resolver_get_list(slot->proxy_resolver);
+    const int32_t error = proxy_resolver_get_error(slot->proxy_resolver);
+    const uint64_t elapsed_us = get_time_us() - slot->start_us;
+
+    if (json) {
+        printf("{\"url\":");
+        print_json_string(slot->url);
+        printf(",\"proxy\":");
+        if (list)
+            print_json_string(list);
+        else
+            printf("null");
+        printf(",\"error\":%" PRId32 ",\"start_us\":%" PRIu64 ",\"elapsed_us\":%" PRIu64 "}\n", error,
+               slot->start_us - base_us, elapsed_us);
+    } else {
+        printf("%s=%s\n", slot->url, list ? list : "direct://");
+        if (error != 0)
+            fprintf(stderr, "Unable to resolve proxy for %s (%" PRId32 ")\n", slot->url, error);
+    }
+}
+
+static bool resolve_proxies_for_url_stream(FILE *stream, int32_t window, bool json, bool verbose) {
+    char url[RESOLVE_MAX_URL + 2];
+    int64_t resolved_count = 0;
+    int64_t error_count = 0;
+    int32_t in_flight = 0;
+    bool is_eof = false;
+
+    resolve_slot_s *slots = (resolve_slot_s *)calloc(window, sizeof(resolve_slot_s));
+    if (!slots)
+        return false;
+
+    const uint64_t base_us = get_time_us();
+
+    while (!is_eof || in_flight > 0) {
+        // Keep the window of concurrent resolutions full
+        for (int32_t i = 0; i < window && !is_eof; i++) {
+            resolve_slot_s *slot = &slots[i];
+            if (slot->proxy_resolver)
+                continue;
+            if (!read_url_line(stream, url, sizeof(url))) {
+                is_eof = true;
+                break;
+            }
+            slot->url = strdup(url);
+            slot->proxy_resolver = proxy_resolver_create();
+            if (!slot->url || !slot->proxy_resolver) {
+                fprintf(stderr, "Unable to create proxy resolver\n");
+                proxy_resolver_delete(&slot->proxy_resolver);
+                free(slot->url);
+                slot->url = NULL;
+                is_eof = true;
+                error_count++;
+                break;
+            }
+            slot->start_us = get_time_us();
+            proxy_resolver_get_proxies_for_url(slot->proxy_resolver, slot->url);
+            in_flight++;
+        }
+
+        // Print results in the order resolutions complete
+        int32_t completed = 0;
+        resolve_slot_s *oldest = NULL;
+        for (int32_t i = 0; i < window; i++) {
+            resolve_slot_s *slot = &slots[i];
+            if (!slot->proxy_resolver)
+                continue;
+            if (!proxy_resolver_wait(slot->proxy_resolver, 0)) {
+                if (!oldest || slot->start_us < oldest->start_us)
+                    oldest = slot;
+                continue;
+            }
+            print_resolve_result(slot, base_us, json);
+            if (proxy_resolver_get_error(slot->proxy_resolver) != 0)
+                error_count++;
+            proxy_resolver_delete(&slot->proxy_resolver);
+            free(slot->url);
+            slot->url = NULL;
+            resolved_count++;
+            in_flight--;
+            completed++;
+        }
+
+        // Block briefly on the oldest resolution instead of spinning when nothing has completed
+        if (!completed && oldest)
+            proxy_resolver_wait(oldest->proxy_resolver, 1);
+    }
+
+    free(slots);
+    fflush(stdout);
+
+    if (verbose) {
+        const double elapsed_s = (double)(get_time_us() - base_us) / 1000000.0;
+        fprintf(stderr, "Resolved %" PRId64 " urls with %" PRId64 " errors in %.3f s (%.0f urls/s)\n", resolved_count,
+                error_count, elapsed_s, elapsed_s > 0 ? (double)resolved_count / elapsed_s : 0.0);
+    }
+    return error_count == 0;
+}
+
 #ifdef PROXYRES_EXECUTE
 static bool execute_pac_script(const char *script_path, const char *url, bool verbose) {
     bool is_ok = false;
@@ -180,30 +345,426 @@ execute_pac_cleanup:
 }
 #endif
 
+#ifndef _WIN32
+#  define SERVE_MAX_LINE    (64 * 1024)
+#  define SERVE_MAX_PENDING (256)
+#  define SERVE_WORKERS     (16)
+
+typedef struct serve_client_s {
+    int fd;
+    pthread_mutex_t mutex;
+    pthread_cond_t changed;
+    // Number of requests that have not been responded to
+    int32_t pending;
+    // Lock so that responses written by different requests are not interleaved
+    pthread_mutex_t write_mutex;
+    // Client can no longer be written to
+    bool write_failed;
+    struct serve_client_s *next;
+} serve_client_s;
+
+typedef struct serve_request_s {
+    serve_client_s *client;
+    // Request id echoed in the response
+    uint64_t id;
+    // Resolver instance, NULL if the request could not be started
+    void *proxy_resolver;
+    int32_t error;
+    struct serve_request_s *next;
+} serve_request_s;
+
+typedef struct serve_s {
+    pthread_mutex_t mutex;
+    pthread_cond_t client_exited;
+    serve_client_s *clients;
+    // Requests being resolved in the order they were started, responded to by a fixed number of workers
+    pthread_cond_t queued;
+    serve_request_s *queue;
+    serve_request_s *queue_tail;
+    bool stopping;
+} serve_s;
+
+static serve_s g_serve = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, NULL, PTHREAD_COND_INITIALIZER,
+                          NULL, NULL, false};
+static volatile sig_atomic_t g_serve_stop = 0;
+
+static void serve_signal_handler(int signum) {
+    (void)signum;
+    g_serve_stop = 1;
+}
+
+static bool serve_write_all(int fd, const char *buffer, size_t buffer_len) {
+    while (buffer_len > 0) {
+        const ssize_t bytes_sent = send(fd, buffer, buffer_len, MSG_NOSIGNAL);
+        if (bytes_sent < 0 && errno == EINTR)
+            continue;
+        if (bytes_sent <= 0)
+            return false;
+        buffer += bytes_sent;
+        buffer_len -= (size_t)bytes_sent;
+    }
+    return true;
+}
+
+// Write the response once the request has been resolved, response line format is
+// "<request id> <error> [proxy list]"
+static void serve_respond(serve_request_s *request) {
+    serve_client_s *client = request->client;
+    const char *list = NULL;
+    int32_t error = request->error;
+
+    if (request->proxy_resolver) {
+        proxy_resolver_wait(request->proxy_resolver, -1);
+        list = proxy_resolver_get_list(request->proxy_resolver);
+        error = proxy_resolver_get_error(request->proxy_resolver);
+    }
+
+    const size_t max_response = (list ? strlen(list) : 0) + 48;
+    char *response = (char *)malloc(max_response);
+    if (response) {
+        const int written = snprintf(response, max_response, "%" PRIu64 " %" PRId32 "%s%s\n", request->id, error,
+                                     list ? " " : "", list ? list : "");
+        // Keep resolving requests after the client goes away so that resolvers are released
+        pthread_mutex_lock(&client->write_mutex);
+        if (!client->write_failed)
+            client->write_failed = !serve_write_all(client->fd, response, (size_t)written);
+        pthread_mutex_unlock(&client->write_mutex);
+        free(response);
+    }
+
+    if (request->proxy_resolver)
+        proxy_resolver_delete(&request->proxy_resolver);
+    free(request);
+
+    pthread_mutex_lock(&client->mutex);
+    client->pending--;
+    pthread_cond_broadcast(&client->changed);
+    pthread_mutex_unlock(&client->mutex);
+}
+
+// Waits for started requests so that responses are written as soon as they are resolved, a request that takes long
+// to resolve only holds up one worker
+static void *serve_worker(void *arg) {
+    (void)arg;
+    while (true) {
+        pthread_mutex_lock(&g_serve.mutex);
+        while (!g_serve.queue && !g_serve.stopping)
+            pthread_cond_wait(&g_serve.queued, &g_serve.mutex);
+        serve_request_s *request = g_serve.queue;
+        if (request) {
+            g_serve.queue = request->next;
+            if (!g_serve.queue)
+                g_serve.queue_tail = NULL;
+        }
+        pthread_mutex_unlock(&g_serve.mutex);
+        if (!request)
+            break;
+        serve_respond(request);
+    }
+    return NULL;
+}
+
+// Request line format is "<request id> <url> [auto config url]"
+static void serve_start_request(serve_client_s *client, char *line) {
+    char *end = NULL;
+
+    const uint64_t id = strtoull(line, &end, 10);
+    if (end == line || *end != ' ')
+        return;
+
+    serve_request_s *request = (serve_request_s *)calloc(1, sizeof(serve_request_s));
+    if (!request)
+        return;
+    request->client = client;
+    request->id = id;
+
+    char *url = end + 1;
+    char *auto_config_url = strchr(url, ' ');
+    if (auto_config_url)
+        *auto_config_url++ = 0;
+
+    // Stop reading requests while too many are being resolved for the client
+    pthread_mutex_lock(&client->mutex);
+    while (client->pending >= SERVE_MAX_PENDING)
+        pthread_cond_wait(&client->changed, &client->mutex);
+    client->pending++;
+    pthread_mutex_unlock(&client->mutex);
+
+    if (!*url) {
+        request->error = EINVAL;
+    } else if (auto_config_url && *auto_config_url) {
+        proxy_resolver_options_s options = {0};
+        options.use_system_config = true;
+        options.auto_config_url = auto_config_url;
+        request->proxy_resolver = proxy_resolver_create_ex(&options);
+    } else {
+        request->proxy_resolver = proxy_resolver_create();
+    }
+    if (request->proxy_resolver)
+        proxy_resolver_get_proxies_for_url(request->proxy_resolver, url);
+    else if (!request->error)
+        request->error = ENOMEM;
+
+    if (!request->proxy_resolver) {
+        serve_respond(request);
+        return;
+    }
+
+    pthread_mutex_lock(&g_serve.mutex);
+    if (g_serve.queue_tail)
+        g_serve.queue_tail->next = request;
+    else
+        g_serve.queue = request;
+    g_serve.queue_tail = request;
+    pthread_cond_signal(&g_serve.queued);
+    pthread_mutex_unlock(&g_serve.mutex);
+}
+
+static void *serve_client(void *arg) {
+    serve_client_s *client = (serve_client_s *)arg;
+    size_t buffer_len = 0;
+    bool discard = false;
+
+    char *buffer = (char *)malloc(SERVE_MAX_LINE);
+    while (buffer) {
+        const ssize_t bytes_read = recv(client->fd, buffer + buffer_len, SERVE_MAX_LINE - buffer_len, 0);
+        if (bytes_read < 0 && errno == EINTR)
+            continue;
+        if (bytes_read <= 0)
+            break;
+        buffer_len += (size_t)bytes_read;
+
+        // Start resolving each complete request line so that pipelined requests are resolved in parallel
+        char *line = buffer;
+        char *line_end = NULL;
+        while ((line_end = (char *)memchr(line, '\n', buffer_len - (size_t)(line - buffer))) != NULL) {
+            *line_end = 0;
+            if (line_end > line && line_end[-1] == '\r')
+                line_end[-1] = 0;
+            if (!discard)
+                serve_start_request(client, line);
+            discard = false;
+            line = line_end + 1;
+        }
+        buffer_len -= (size_t)(line - buffer);
+        memmove(buffer, line, buffer_len);
+
+        // Skip requests that are too long to buffer
+        if (buffer_len == SERVE_MAX_LINE) {
+            discard = true;
+            buffer_len = 0;
+        }
+    }
+    free(buffer);
+
+    // Wait for requests that are still being resolved before releasing the client
+    pthread_mutex_lock(&client->mutex);
+    while (client->pending > 0)
+        pthread_cond_wait(&client->changed, &client->mutex);
+    pthread_mutex_unlock(&client->mutex);
+
+    pthread_mutex_lock(&g_serve.mutex);
+    serve_client_s **clientp = &g_serve.clients;
+    while (*clientp && *clientp != client)
+        clientp = &(*clientp)->next;
+    if (*clientp)
+        *clientp = client->next;
+    pthread_cond_broadcast(&g_serve.client_exited);
+    pthread_mutex_unlock(&g_serve.mutex);
+
+    close(client->fd);
+    pthread_mutex_destroy(&client->mutex);
+    pthread_cond_destroy(&client->changed);
+    pthread_mutex_destroy(&client->write_mutex);
+    free(client);
+    return NULL;
+}
+
+static bool serve_accept_client(int listen_fd) {
+    pthread_t thread;
+
+    const int fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0)
+        return errno == EINTR || errno == EAGAIN || errno == ECONNABORTED;
+
+    serve_client_s *client = (serve_client_s *)calloc(1, sizeof(serve_client_s));
+    if (!client) {
+        close(fd);
+        return true;
+    }
+    client->fd = fd;
+    pthread_mutex_init(&client->mutex, NULL);
+    pthread_cond_init(&client->changed, NULL);
+    pthread_mutex_init(&client->write_mutex, NULL);
+
+    pthread_mutex_lock(&g_serve.mutex);
+    client->next = g_serve.clients;
+    g_serve.clients = client;
+    if (pthread_create(&thread, NULL, serve_client, client) != 0) {
+        g_serve.clients = client->next;
+        pthread_mutex_unlock(&g_serve.mutex);
+        close(fd);
+        pthread_mutex_destroy(&client->mutex);
+        pthread_cond_destroy(&client->changed);
+        pthread_mutex_destroy(&client->write_mutex);
+        free(client);
+        return true;
+    }
+    pthread_detach(thread);
+    pthread_mutex_unlock(&g_serve.mutex);
+    return true;
+}
+
+static bool serve_get_socket_path(const char *socket_path, struct sockaddr_un *address) {
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+
+    // Use the same socket path as the library unless one is specified
+    if (!socket_path)
+        socket_path = getenv("PROXYRES_DAEMON_SOCKET");
+    if (socket_path && *socket_path)
+        return snprintf(address->sun_path, sizeof(address->sun_path), "%s", socket_path) <
+               (int)sizeof(address->sun_path);
+    const char *runtime_dir = getenv("XDG_RUNTIME_DIR");
+    if (!runtime_dir || !*runtime_dir)
+        return false;
+    return snprintf(address->sun_path, sizeof(address->sun_path), "%s/proxyres.sock", runtime_dir) <
+           (int)sizeof(address->sun_path);
+}
+
+static bool serve_resolver_daemon(const char *socket_path, bool verbose) {
+    pthread_t workers[SERVE_WORKERS];
+    int32_t worker_count = 0;
+    struct sockaddr_un address;
+    struct sigaction action;
+
+    if (!serve_get_socket_path(socket_path, &address)) {
+        printf("Socket path not specified and XDG_RUNTIME_DIR not set\n");
+        return false;
+    }
+
+    // Resolve locally instead of connecting to ourselves
+    setenv("PROXYRES_DAEMON_SOCKET", "", 1);
+
+    const int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0) {
+        printf("Unable to create socket (%d)\n", errno);
+        return false;
+    }
+
+    // Replace socket left behind by a resolver daemon that is no longer running
+    if (connect(listen_fd, (struct sockaddr *)&address, sizeof(address)) == 0) {
+        printf("Resolver daemon already running at %s\n", address.sun_path);
+        close(listen_fd);
+        return false;
+    }
+    unlink(address.sun_path);
+
+    if (bind(listen_fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(listen_fd, SOMAXCONN) != 0) {
+        printf("Unable to listen on %s (%d)\n", address.sun_path, errno);
+        close(listen_fd);
+        return false;
+    }
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = serve_signal_handler;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    if (verbose)
+        printf("Resolver daemon listening on %s\n", address.sun_path);
+    fflush(stdout);
+
+    const bool is_init = proxy_resolver_global_init();
+    bool is_ok = is_init;
+
+    // Fixed number of workers write responses instead of a thread per request
+    while (is_ok && worker_count < SERVE_WORKERS) {
+        if (pthread_create(&workers[worker_count], NULL, serve_worker, NULL) != 0)
+            break;
+        worker_count++;
+    }
+    if (is_ok && !worker_count) {
+        printf("Unable to start workers\n");
+        is_ok = false;
+    }
+
+    while (is_ok && !g_serve_stop) {
+        struct pollfd poll_fd = {listen_fd, POLLIN, 0};
+        if (poll(&poll_fd, 1, 1000) > 0)
+            is_ok = serve_accept_client(listen_fd);
+    }
+
+    close(listen_fd);
+    unlink(address.sun_path);
+
+    // Stop reading from clients and wait for their pending requests to finish
+    pthread_mutex_lock(&g_serve.mutex);
+    for (serve_client_s *client = g_serve.clients; client; client = client->next)
+        shutdown(client->fd, SHUT_RDWR);
+    while (g_serve.clients)
+        pthread_cond_wait(&g_serve.client_exited, &g_serve.mutex);
+    g_serve.stopping = true;
+    pthread_cond_broadcast(&g_serve.queued);
+    pthread_mutex_unlock(&g_serve.mutex);
+    for (int32_t i = 0; i < worker_count; i++)
+        pthread_join(workers[i], NULL);
+
+    if (is_init)
+        proxy_resolver_global_cleanup();
+    return is_ok;
+}
+#endif
+
 static int print_help(void) {
-    printf("proxyres [--help] [--verbose] cmd cmd_args\n");
+    printf("proxyres [--help] [--verbose] [--trace file] cmd cmd_args\n");
     printf(" commands:\n");
     printf("  config                  - dumps all proxy configuration values\n");
 #ifdef PROXYRES_EXECUTE
     printf("  execute [file] [urls..] - executes pac file with script\n");
 #endif
     printf("  resolve [url..]         - resolves proxy for urls\n");
+    printf("    --stdin               - reads urls from stdin, one per line\n");
+    printf("    --window n            - number of concurrent resolutions with --stdin (default %d)\n",
+           RESOLVE_DEFAULT_WINDOW);
+    printf("    --json                - prints results with timing as ndjson\n");
+#ifndef _WIN32
+    printf("  serve [socket]          - resolves proxies for other processes over unix socket\n");
+#endif
     return 1;
 }
 
 int main(int argc, char *argv[]) {
     int exit_code = 0;
     bool verbose = false;
+    const char *trace_path = NULL;
     int32_t argi = 1;
 
     if (argc <= 1)
         return print_help();
 
+    // Lets scripts be executed in helper processes when PROXYRES_EXECUTE_PROCESSES is set
+    proxyres_global_early_init();
+
     if (strcmp(argv[argi], "--verbose") == 0) {
         verbose = true;
         argi++;
     }
 
+    if (argi + 1 < argc && strcmp(argv[argi], "--trace") == 0) {
+        trace_path = argv[argi + 1];
+        argi += 2;
+    }
+    if (argi >= argc)
+        return print_help();
+
+    // Write Chrome trace event JSON for all commands
+    if (trace_path) {
+        proxyres_global_init();
+        if (!proxyres_trace_start_json(trace_path))
+            printf("Unable to open trace file %s\n", trace_path);
+    }
+
     const char *cmd = argv[argi++];
     if (strcmp(cmd, "--help") == 0) {
         print_help();
@@ -226,10 +787,48 @@ int main(int argc, char *argv[]) {
         proxy_execute_global_cleanup();
 #endif
     } else if (strcmp(cmd, "resolve") == 0) {
+        int32_t window = RESOLVE_DEFAULT_WINDOW;
+        bool has_window = false;
+        bool from_stdin = false;
+        bool json = false;
+
+        while (argi < argc && strncmp(argv[argi], "--", 2) == 0) {
+            if (strcmp(argv[argi], "--stdin") == 0) {
+                from_stdin = true;
+            } else if (strcmp(argv[argi], "--json") == 0) {
+                json = true;
+            } else if (strcmp(argv[argi], "--window") == 0 && argi + 1 < argc) {
+                window = atoi(argv[++argi]);
+                has_window = true;
+            } else {
+                return print_help();
+            }
+            argi++;
+        }
+        // Window and json output only apply to urls read from stdin
+        if (window <= 0 || (!from_stdin && (has_window || json)))
+            return print_help();
+
         proxy_resolver_global_init();
-        if (!resolve_proxies_for_url_async(argc - argi, argv + argi, verbose))
+        if (from_stdin) {
+            if (!resolve_proxies_for_url_stream(stdin, window, json, verbose))
+                exit_code = 1;
+        } else if (!resolve_proxies_for_url_async(argc - argi, argv + argi, verbose)) {
             exit_code = 1;
+        }
         proxy_resolver_global_cleanup();
+    } else if (strcmp(cmd, "serve") == 0) {
+#ifdef _WIN32
+        return print_help();
+#else
+        if (!serve_resolver_daemon(argi < argc ? argv[argi] : NULL, verbose))
+            exit_code = 1;
+#endif
+    }
+
+    if (trace_path) {
+        proxyres_trace_stop_json();
+        proxyres_global_cleanup();
     }
 
     return exit_code;
@@ -0,0 +1,574 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <math.h>
+
+#ifdef _WIN32
+#  include <winsock2.h>
+#  include <ws2tcpip.h>
+#  include <windows.h>
+#else
+#  include <arpa/inet.h>
+#  include <netinet/in.h>
+#  include <sys/types.h>
+#  include <sys/socket.h>
+#  include <pthread.h>
+#  include <time.h>
+#  include <unistd.h>
+#endif
+
+#ifdef _WIN32
+#  define socklen_t int
+#else
+#  define SOCKET         int
+#  define INVALID_SOCKET (-1)
+#  define closesocket    close
+#endif
+
+#include "proxyres/proxyres.h"
+#include "proxyres/resolver.h"
+
+#include "atomic.h"
+#include "pac_server.h"
+
+#define LOADGEN_DEFAULT_THREADS  (4)
+#define LOADGEN_DEFAULT_DURATION (5)
+#define LOADGEN_DEFAULT_HOSTS    (1000)
+#define LOADGEN_DEFAULT_ZIPF_S   (1.0)
+
+#define DHCP_SERVER_PORT         (67)
+#define DHCP_CLIENT_PORT         (68)
+#define DHCP_HEADER_LEN          (236)
+#define DHCP_OPT_MIN_LENGTH      (312)
+#define DHCP_MAGIC               ("\x63\x82\x53\x63")
+#define DHCP_MAGIC_LEN           (4)
+#define DHCP_ACK                 (5)
+#define DHCP_INFORM              (8)
+#define DHCP_BOOT_REQUEST        (1)
+#define DHCP_BOOT_REPLY          (2)
+#define DHCP_OPT_PAD             (0)
+#define DHCP_OPT_MSGTYPE         (0x35)
+#define DHCP_OPT_WPAD            (0xfc)
+#define DHCP_OPT_END             (0xff)
+
+// Script evaluated for every request, it does not perform any DNS lookups so that the results are network-free
+static const char *loadgen_script =
+    "function FindProxyForURL(url, host) {\n"
+    "  if (isPlainHostName(host) || dnsDomainIs(host, \".local\"))\n"
+    "    return \"DIRECT\";\n"
+    "  if (shExpMatch(host, \"*.internal.example.com\"))\n"
+    "    return \"PROXY internal-proxy:8080\";\n"
+    "  if (shExpMatch(url, \"https:*\"))\n"
+    "    return \"PROXY secure-proxy:8443; PROXY fallback-proxy:8080\";\n"
+    "  return \"PROXY proxy:8080; DIRECT\";\n"
+    "}\n";
+
+typedef struct loadgen_s {
+    // Settings
+    int32_t thread_count;
+    int32_t duration_sec;
+    int64_t requests_per_thread;
+    // Requests per second issued on a fixed schedule regardless of how long requests take, 0 for closed loop
+    int32_t rate;
+    int32_t host_count;
+    bool use_zipf;
+    double zipf_s;
+    char auto_config_url[128];
+    // Cumulative distribution of host popularity used for zipf sampling
+    double *zipf_cdf;
+    // Threads stop issuing requests once set
+    volatile int32_t stop;
+} loadgen_s;
+
+typedef struct loadgen_thread_s {
+    loadgen_s *loadgen;
+    int32_t index;
+    uint64_t seed;
+    // Latency of each request in microseconds
+    uint32_t *latencies;
+    int64_t latency_count;
+    int64_t max_latencies;
+    int64_t error_count;
+#ifdef _WIN32
+    HANDLE thread;
+#else
+    pthread_t thread;
+#endif
+} loadgen_thread_s;
+
+static uint64_t get_time_us(void) {
+#ifdef _WIN32
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000 +
+           (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000 / (uint64_t)frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+#endif
+}
+
+static void sleep_ms(int32_t ms) {
+#ifdef _WIN32
+    Sleep(ms);
+#else
+    usleep(ms * 1000);
+#endif
+}
+
+static void sleep_until_us(uint64_t time_us) {
+    const uint64_t now_us = get_time_us();
+    if (time_us <= now_us)
+        return;
+#ifdef _WIN32
+    Sleep((DWORD)((time_us - now_us) / 1000));
+#else
+    usleep((useconds_t)(time_us - now_us));
+#endif
+}
+
+// Xorshift random number generator, each thread has its own state
+static uint64_t loadgen_random(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+static bool loadgen_create_zipf(loadgen_s *loadgen) {
+    double sum = 0;
+
+    loadgen->zipf_cdf = (double *)malloc(loadgen->host_count * sizeof(double));
+    if (!loadgen->zipf_cdf)
+        return false;
+    for (int32_t i = 0; i < loadgen->host_count; i++) {
+        sum += 1.0 / pow((double)(i + 1), loadgen->zipf_s);
+        loadgen->zipf_cdf[i] = sum;
+    }
+    for (int32_t i = 0; i < loadgen->host_count; i++)
+        loadgen->zipf_cdf[i] /= sum;
+    return true;
+}
+
+static int32_t loadgen_pick_host(loadgen_s *loadgen, uint64_t *state) {
+    if (!loadgen->use_zipf)
+        return (int32_t)(loadgen_random(state) % (uint64_t)loadgen->host_count);
+
+    // Find the first host whose cumulative probability covers the sample
+    const double sample = (double)(loadgen_random(state) >> 11) / (double)(1ULL << 53);
+    int32_t low = 0;
+    int32_t high = loadgen->host_count - 1;
+    while (low < high) {
+        const int32_t mid = low + (high - low) / 2;
+        if (loadgen->zipf_cdf[mid] < sample)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+static bool loadgen_add_latency(loadgen_thread_s *thread, uint64_t latency_us) {
+    if (thread->latency_count == thread->max_latencies) {
+        const int64_t max_latencies = thread->max_latencies ? thread->max_latencies * 2 : 65536;
+        uint32_t *latencies = (uint32_t *)realloc(thread->latencies, max_latencies * sizeof(uint32_t));
+        if (!latencies)
+            return false;
+        thread->latencies = latencies;
+        thread->max_latencies = max_latencies;
+    }
+    thread->latencies[thread->latency_count++] = latency_us > UINT32_MAX ? UINT32_MAX : (uint32_t)latency_us;
+    return true;
+}
+
+#ifdef _WIN32
+static DWORD WINAPI loadgen_do_work(LPVOID arg) {
+#else
+static void *loadgen_do_work(void *arg) {
+#endif
+    loadgen_thread_s *thread = (loadgen_thread_s *)arg;
+    loadgen_s *loadgen = thread->loadgen;
+    proxy_resolver_options_s options = {0};
+    char url[128];
+
+    // Each thread reuses its resolver instance for all of its requests
+    options.auto_config_url = loadgen->auto_config_url;
+    void *proxy_resolver = proxy_resolver_create_ex(&options);
+    if (!proxy_resolver) {
+        thread->error_count++;
+        return 0;
+    }
+
+    // Open loop requests are spread evenly over the threads, each thread starting at a different offset
+    const uint64_t interval_us = loadgen->rate > 0 ? (uint64_t)loadgen->thread_count * 1000000 / loadgen->rate : 0;
+    const uint64_t schedule_us = get_time_us() + interval_us * thread->index / (uint64_t)loadgen->thread_count;
+
+    for (int64_t i = 0; !atomic_load_acquire_i32(&loadgen->stop); i++) {
+        if (loadgen->requests_per_thread > 0 && i >= loadgen->requests_per_thread)
+            break;
+
+        const int32_t host = loadgen_pick_host(loadgen, &thread->seed);
+        snprintf(url, sizeof(url), "%s://host%" PRId32 ".example.com/", (host & 1) ? "https" : "http", host);
+
+        // Latency of open loop requests is measured from when they were scheduled, so that time spent waiting on
+        // earlier requests that were too slow is not hidden
+        uint64_t start_us = get_time_us();
+        if (interval_us) {
+            start_us = schedule_us + (uint64_t)i * interval_us;
+            sleep_until_us(start_us);
+        }
+
+        const bool is_ok = proxy_resolver_get_proxies_for_url(proxy_resolver, url) &&
+                           proxy_resolver_wait(proxy_resolver, -1) && proxy_resolver_get_error(proxy_resolver) == 0;
+        if (!loadgen_add_latency(thread, get_time_us() - start_us))
+            break;
+        if (!is_ok)
+            thread->error_count++;
+    }
+
+    proxy_resolver_delete(&proxy_resolver);
+    return 0;
+}
+
+static int compare_latency(const void *a, const void *b) {
+    const uint32_t latency_a = *(const uint32_t *)a;
+    const uint32_t latency_b = *(const uint32_t *)b;
+    return (latency_a > latency_b) - (latency_a < latency_b);
+}
+
+static uint32_t get_percentile(const uint32_t *latencies, int64_t count, double percentile) {
+    if (!count)
+        return 0;
+    int64_t index = (int64_t)ceil(percentile / 100.0 * (double)count) - 1;
+    if (index < 0)
+        index = 0;
+    return latencies[index];
+}
+
+static bool loadgen_report(loadgen_s *loadgen, loadgen_thread_s *threads, uint64_t elapsed_us) {
+    int64_t request_count = 0;
+    int64_t error_count = 0;
+
+    for (int32_t i = 0; i < loadgen->thread_count; i++) {
+        request_count += threads[i].latency_count;
+        error_count += threads[i].error_count;
+    }
+
+    // Merge latencies from all threads to compute percentiles
+    uint32_t *latencies = (uint32_t *)malloc((request_count ? request_count : 1) * sizeof(uint32_t));
+    if (!latencies)
+        return false;
+    int64_t offset = 0;
+    for (int32_t i = 0; i < loadgen->thread_count; i++) {
+        if (threads[i].latency_count)
+            memcpy(latencies + offset, threads[i].latencies, threads[i].latency_count * sizeof(uint32_t));
+        offset += threads[i].latency_count;
+    }
+    qsort(latencies, (size_t)request_count, sizeof(uint32_t), compare_latency);
+
+    const double elapsed_s = (double)elapsed_us / 1000000.0;
+    printf("Threads:      %" PRId32 "\n", loadgen->thread_count);
+    printf("Hosts:        %" PRId32 " (%s)\n", loadgen->host_count, loadgen->use_zipf ? "zipf" : "uniform");
+    if (loadgen->rate > 0)
+        printf("Target QPS:   %" PRId32 "\n", loadgen->rate);
+    printf("Requests:     %" PRId64 "\n", request_count);
+    printf("Errors:       %" PRId64 "\n", error_count);
+    printf("Elapsed:      %.3f s\n", elapsed_s);
+    printf("QPS:          %.0f\n", elapsed_s > 0 ? (double)request_count / elapsed_s : 0.0);
+    printf("Latency p50:  %" PRIu32 " us\n", get_percentile(latencies, request_count, 50.0));
+    printf("Latency p99:  %" PRIu32 " us\n", get_percentile(latencies, request_count, 99.0));
+    printf("Latency p999: %" PRIu32 " us\n", get_percentile(latencies, request_count, 99.9));
+    printf("Latency max:  %" PRIu32 " us\n", request_count ? latencies[request_count - 1] : 0);
+
+    free(latencies);
+    return error_count == 0;
+}
+
+static bool loadgen_run(loadgen_s *loadgen) {
+    bool is_ok = false;
+
+    loadgen_thread_s *threads = (loadgen_thread_s *)calloc(loadgen->thread_count, sizeof(loadgen_thread_s));
+    if (!threads)
+        return false;
+
+    const uint64_t start_us = get_time_us();
+
+    int32_t started = 0;
+    for (; started < loadgen->thread_count; started++) {
+        loadgen_thread_s *thread = &threads[started];
+        thread->loadgen = loadgen;
+        thread->index = started;
+        thread->seed = 0x9e3779b97f4a7c15ULL * (uint64_t)(started + 1);
+#ifdef _WIN32
+        thread->thread = CreateThread(NULL, 0, loadgen_do_work, thread, 0, NULL);
+        if (!thread->thread)
+            break;
+#else
+        if (pthread_create(&thread->thread, NULL, loadgen_do_work, thread) != 0)
+            break;
+#endif
+    }
+
+    // Run for the specified duration unless a fixed number of requests was requested
+    if (started != loadgen->thread_count) {
+        printf("Unable to start thread %" PRId32 "\n", started);
+        atomic_store_release_i32(&loadgen->stop, true);
+    } else if (loadgen->requests_per_thread <= 0) {
+        while (get_time_us() - start_us < (uint64_t)loadgen->duration_sec * 1000000)
+            sleep_ms(10);
+        atomic_store_release_i32(&loadgen->stop, true);
+    }
+
+    for (int32_t i = 0; i < started; i++) {
+#ifdef _WIN32
+        WaitForSingleObject(threads[i].thread, INFINITE);
+        CloseHandle(threads[i].thread);
+#else
+        pthread_join(threads[i].thread, NULL);
+#endif
+    }
+
+    const uint64_t elapsed_us = get_time_us() - start_us;
+    if (started == loadgen->thread_count)
+        is_ok = loadgen_report(loadgen, threads, elapsed_us);
+
+    for (int32_t i = 0; i < loadgen->thread_count; i++)
+        free(threads[i].latencies);
+    free(threads);
+    return is_ok;
+}
+
+static int print_help(void) {
+    printf("proxyres_loadgen [options]\n");
+    printf(" options:\n");
+    printf("  --threads n             - number of threads issuing requests (default %d)\n", LOADGEN_DEFAULT_THREADS);
+    printf("  --duration sec          - seconds to run for (default %d)\n", LOADGEN_DEFAULT_DURATION);
+    printf("  --requests n            - requests per thread instead of running for a duration\n");
+    printf("  --hosts n               - number of distinct hosts (default %d)\n", LOADGEN_DEFAULT_HOSTS);
+    printf("  --zipf                  - pick hosts using zipf distribution instead of uniform distribution\n");
+    printf("  --zipf-s s              - exponent of zipf distribution (default %.1f)\n", LOADGEN_DEFAULT_ZIPF_S);
+    printf("  --rate qps              - issue requests at a fixed rate instead of as fast as possible\n");
+    printf("  --serve-pac port file   - serve PAC script file on loopback port instead of generating load\n");
+    printf("  --serve-dhcp url        - answer DHCP inform requests with WPAD url instead of generating load\n");
+    return 1;
+}
+
+// Build DHCPACK reply containing the WPAD url for a DHCPINFORM request, returns 0 if the request is ignored
+static size_t loadgen_dhcp_reply(const uint8_t *request, size_t request_len, const char *wpad_url, uint8_t *reply) {
+    const uint8_t *opts = request + DHCP_HEADER_LEN + DHCP_MAGIC_LEN;
+    const uint8_t *opts_end = request + request_len;
+    const size_t wpad_url_len = strlen(wpad_url);
+    bool is_inform = false;
+
+    if (request_len < DHCP_HEADER_LEN + DHCP_MAGIC_LEN || request[0] != DHCP_BOOT_REQUEST)
+        return 0;
+    if (memcmp(request + DHCP_HEADER_LEN, DHCP_MAGIC, DHCP_MAGIC_LEN) != 0)
+        return 0;
+
+    // Only inform requests are answered since no addresses are leased
+    while (opts + 2 <= opts_end && *opts != DHCP_OPT_END) {
+        if (*opts == DHCP_OPT_PAD) {
+            opts++;
+            continue;
+        }
+        if (opts[0] == DHCP_OPT_MSGTYPE && opts[1] == 1 && opts + 3 <= opts_end)
+            is_inform = opts[2] == DHCP_INFORM;
+        opts += 2 + opts[1];
+    }
+    if (!is_inform)
+        return 0;
+
+    // Reply echoes the transaction id and client addresses from the request
+    memset(reply, 0, DHCP_HEADER_LEN + DHCP_OPT_MIN_LENGTH);
+    memcpy(reply, request, DHCP_HEADER_LEN);
+    reply[0] = DHCP_BOOT_REPLY;
+    // Inform replies do not assign addresses, so clear your, server and gateway addresses
+    memset(reply + 16, 0, 12);
+
+    uint8_t *reply_opts = reply + DHCP_HEADER_LEN;
+    memcpy(reply_opts, DHCP_MAGIC, DHCP_MAGIC_LEN);
+    reply_opts += DHCP_MAGIC_LEN;
+    *reply_opts++ = DHCP_OPT_MSGTYPE;
+    *reply_opts++ = 1;
+    *reply_opts++ = DHCP_ACK;
+    *reply_opts++ = DHCP_OPT_WPAD;
+    *reply_opts++ = (uint8_t)wpad_url_len;
+    memcpy(reply_opts, wpad_url, wpad_url_len);
+    reply_opts += wpad_url_len;
+    *reply_opts = DHCP_OPT_END;
+    return DHCP_HEADER_LEN + DHCP_OPT_MIN_LENGTH;
+}
+
+// Answer DHCP inform requests for the WPAD url, such as those made by the wpad.dhcp test, until stopped
+static bool loadgen_serve_dhcp(const char *wpad_url) {
+    uint8_t request[1024];
+    uint8_t reply[DHCP_HEADER_LEN + DHCP_OPT_MIN_LENGTH];
+    struct sockaddr_in address = {0};
+
+    SOCKET sfd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sfd == INVALID_SOCKET)
+        return false;
+
+    int enable = 1;
+    setsockopt(sfd, SOL_SOCKET, SO_BROADCAST, (const char *)&enable, sizeof(enable));
+    setsockopt(sfd, SOL_SOCKET, SO_REUSEADDR, (const char *)&enable, sizeof(enable));
+
+    // Requests are broadcast so the responder can't only listen on the loopback adapter
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(DHCP_SERVER_PORT);
+    if (bind(sfd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+        closesocket(sfd);
+        return false;
+    }
+
+    printf("Serving %s using DHCP on port %d\n", wpad_url, DHCP_SERVER_PORT);
+    fflush(stdout);
+
+    while (true) {
+        struct sockaddr_in client = {0};
+        socklen_t client_len = sizeof(client);
+        const int request_len =
+            (int)recvfrom(sfd, (char *)request, sizeof(request), 0, (struct sockaddr *)&client, &client_len);
+        if (request_len <= 0)
+            continue;
+
+        const size_t reply_len = loadgen_dhcp_reply(request, (size_t)request_len, wpad_url, reply);
+        if (!reply_len)
+            continue;
+
+        // Clients without an address yet can only receive broadcasts on the client port
+        if (client.sin_addr.s_addr == htonl(INADDR_ANY)) {
+            client.sin_addr.s_addr = htonl(INADDR_BROADCAST);
+            client.sin_port = htons(DHCP_CLIENT_PORT);
+        }
+        sendto(sfd, (const char *)reply, (int)reply_len, 0, (struct sockaddr *)&client, client_len);
+    }
+    return true;
+}
+
+static char *read_script(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return NULL;
+    char *script = NULL;
+    long script_len = 0;
+    if (fseek(file, 0, SEEK_END) == 0 && (script_len = ftell(file)) >= 0 && fseek(file, 0, SEEK_SET) == 0)
+        script = (char *)calloc(1, (size_t)script_len + 1);
+    if (script && fread(script, 1, (size_t)script_len, file) != (size_t)script_len) {
+        free(script);
+        script = NULL;
+    }
+    fclose(file);
+    return script;
+}
+
+int main(int argc, char *argv[]) {
+    loadgen_s loadgen = {0};
+    const char *serve_path = NULL;
+    const char *serve_wpad_url = NULL;
+    int32_t serve_port = 0;
+    int exit_code = 0;
+
+    loadgen.thread_count = LOADGEN_DEFAULT_THREADS;
+    loadgen.duration_sec = LOADGEN_DEFAULT_DURATION;
+    loadgen.host_count = LOADGEN_DEFAULT_HOSTS;
+    loadgen.zipf_s = LOADGEN_DEFAULT_ZIPF_S;
+
+    for (int32_t argi = 1; argi < argc; argi++) {
+        const bool has_value = argi + 1 < argc;
+        if (strcmp(argv[argi], "--help") == 0) {
+            print_help();
+            return 0;
+        } else if (strcmp(argv[argi], "--threads") == 0 && has_value) {
+            loadgen.thread_count = atoi(argv[++argi]);
+        } else if (strcmp(argv[argi], "--duration") == 0 && has_value) {
+            loadgen.duration_sec = atoi(argv[++argi]);
+        } else if (strcmp(argv[argi], "--requests") == 0 && has_value) {
+            loadgen.requests_per_thread = strtoll(argv[++argi], NULL, 10);
+        } else if (strcmp(argv[argi], "--hosts") == 0 && has_value) {
+            loadgen.host_count = atoi(argv[++argi]);
+        } else if (strcmp(argv[argi], "--zipf") == 0) {
+            loadgen.use_zipf = true;
+        } else if (strcmp(argv[argi], "--zipf-s") == 0 && has_value) {
+            loadgen.zipf_s = atof(argv[++argi]);
+        } else if (strcmp(argv[argi], "--rate") == 0 && has_value) {
+            loadgen.rate = atoi(argv[++argi]);
+        } else if (strcmp(argv[argi], "--serve-pac") == 0 && argi + 2 < argc) {
+            serve_port = atoi(argv[++argi]);
+            serve_path = argv[++argi];
+        } else if (strcmp(argv[argi], "--serve-dhcp") == 0 && has_value) {
+            serve_wpad_url = argv[++argi];
+        } else {
+            return print_help();
+        }
+    }
+    if (loadgen.thread_count <= 0 || loadgen.duration_sec <= 0 || loadgen.host_count <= 0 || loadgen.zipf_s <= 0 ||
+        loadgen.rate < 0)
+        return print_help();
+    if (serve_wpad_url && strlen(serve_wpad_url) > UINT8_MAX)
+        return print_help();
+    if (serve_path && (serve_port <= 0 || serve_port > UINT16_MAX))
+        return print_help();
+
+    // Keep debug logging from skewing latencies
+    proxyres_log_set_level(PROXYRES_LOG_CATEGORY_ALL, PROXYRES_LOG_LEVEL_WARN);
+    proxyres_global_early_init();
+    proxyres_global_init();
+
+    // Serve a PAC script for other processes, such as the proxycli checks run by CI
+    if (serve_path) {
+        char *script = read_script(serve_path);
+        void *pac_server = script ? pac_server_create_ex(script, (uint16_t)serve_port) : NULL;
+        free(script);
+        if (!pac_server) {
+            printf("Unable to serve %s on port %" PRId32 "\n", serve_path, serve_port);
+            proxyres_global_cleanup();
+            return 1;
+        }
+        printf("Serving %s on http://127.0.0.1:%" PRId32 "/\n", serve_path, serve_port);
+        fflush(stdout);
+        while (true)
+            sleep_ms(1000);
+    }
+
+    // Answer WPAD requests for other processes, binding the DHCP server port requires elevated privileges
+    if (serve_wpad_url) {
+        if (!loadgen_serve_dhcp(serve_wpad_url)) {
+            printf("Unable to serve DHCP on port %d\n", DHCP_SERVER_PORT);
+            exit_code = 1;
+        }
+        proxyres_global_cleanup();
+        return exit_code;
+    }
+
+    // Serve the PAC script from the loopback adapter so that requests don't depend on the network
+    void *pac_server = pac_server_create(loadgen_script);
+    if (!pac_server) {
+        printf("Unable to start PAC server\n");
+        proxyres_global_cleanup();
+        return 1;
+    }
+    snprintf(loadgen.auto_config_url, sizeof(loadgen.auto_config_url), "http://127.0.0.1:%d/loadgen.pac",
+             (int)pac_server_get_port(pac_server));
+
+    if (loadgen.use_zipf && !loadgen_create_zipf(&loadgen)) {
+        printf("Unable to allocate memory for zipf distribution\n");
+        exit_code = 1;
+    } else if (!loadgen_run(&loadgen)) {
+        exit_code = 1;
+    }
+
+    free(loadgen.zipf_cdf);
+    pac_server_delete(&pac_server);
+    proxyres_global_cleanup();
+    return exit_code;
+}
@@ -0,0 +1,42 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <gtest/gtest.h>
+
+#include "bypass.h"
+
+TEST(bypass, evaluate_compiled_list) {
+    void *bypass = bypass_create("*.google.com, apple.com:443, 192.168.0.0/16, <local>");
+    ASSERT_NE(bypass, nullptr);
+
+    // Compiled list can be evaluated for any number of urls
+    EXPECT_TRUE(bypass_should_bypass(bypass, "http://www.google.com/"));
+    EXPECT_TRUE(bypass_should_bypass(bypass, "https://apple.com/"));
+    EXPECT_FALSE(bypass_should_bypass(bypass, "http://apple.com/"));
+    EXPECT_TRUE(bypass_should_bypass(bypass, "http://192.168.1.1:8080/"));
+    EXPECT_FALSE(bypass_should_bypass(bypass, "http://10.0.0.1/"));
+    EXPECT_TRUE(bypass_should_bypass(bypass, "http://intranet/"));
+    EXPECT_FALSE(bypass_should_bypass(bypass, "http://microsoft.com/"));
+
+    EXPECT_TRUE(bypass_delete(&bypass));
+    EXPECT_EQ(bypass, nullptr);
+}
+
+TEST(bypass, no_list) {
+    // Localhost is always bypassed unless overridden by a rule
+    EXPECT_TRUE(bypass_should_bypass(nullptr, "http://localhost/"));
+    EXPECT_FALSE(bypass_should_bypass(nullptr, "http://google.com/"));
+    EXPECT_EQ(bypass_create(nullptr), nullptr);
+}
+
+TEST(bypass, credentials_in_path) {
+    void *bypass = bypass_create("bypass.com");
+    ASSERT_NE(bypass, nullptr);
+
+    // Only characters before the path are used to find the host
+    EXPECT_TRUE(bypass_should_bypass(bypass, "http://user@bypass.com/"));
+    EXPECT_FALSE(bypass_should_bypass(bypass, "http://google.com/@bypass.com"));
+    bypass_delete(&bypass);
+}
@@ -3,9 +3,17 @@
 #include <string.h>
 #include <stdlib.h>
 
+#include <atomic>
+#include <thread>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include "proxyres.h"
+#ifdef __linux__
+#  include "config_i.h"
+#  include "config_env.h"
+#endif
 
 TEST(config, override_auto_config_url) {
     proxy_config_set_auto_config_url_override("http://127.0.0.1:8000/wpad.dat");
@@ -37,3 +45,170 @@ TEST(config, override_bypass_list_with_empty_list) {
     EXPECT_STREQ(bypass_list, "");
     free(bypass_list);  // In case the condition above is not met
 }
+
+TEST(config, generation_incremented_by_override) {
+    const uint64_t generation = proxy_config_get_generation();
+    proxy_config_set_proxy_override("http://127.0.0.1:8000/");
+    EXPECT_GT(proxy_config_get_generation(), generation);
+    proxy_config_set_proxy_override(NULL);
+}
+
+TEST(config, snapshot_override) {
+    proxy_config_set_proxy_override("127.0.0.1:8000");
+    proxy_config_set_bypass_list_override("*.bypass.com");
+
+    void *snapshot = proxy_config_snapshot_acquire();
+    ASSERT_NE(snapshot, nullptr);
+    EXPECT_STREQ(proxy_config_snapshot_get_proxy(snapshot, "https"), "127.0.0.1:8000");
+    EXPECT_STREQ(proxy_config_snapshot_get_proxy(snapshot, "gopher"), "127.0.0.1:8000");
+    EXPECT_STREQ(proxy_config_snapshot_get_bypass_list(snapshot), "*.bypass.com");
+    EXPECT_FALSE(proxy_config_snapshot_get_auto_discover(snapshot));
+
+    // Strings remain valid after the config changes until the snapshot is released
+    proxy_config_set_proxy_override("127.0.0.1:9000");
+    void *new_snapshot = proxy_config_snapshot_acquire();
+    ASSERT_NE(new_snapshot, nullptr);
+    EXPECT_STREQ(proxy_config_snapshot_get_proxy(new_snapshot, "https"), "127.0.0.1:9000");
+    EXPECT_STREQ(proxy_config_snapshot_get_proxy(snapshot, "https"), "127.0.0.1:8000");
+
+    EXPECT_TRUE(proxy_config_snapshot_release(&snapshot));
+    EXPECT_EQ(snapshot, nullptr);
+    EXPECT_TRUE(proxy_config_snapshot_release(&new_snapshot));
+
+    proxy_config_set_proxy_override(NULL);
+    proxy_config_set_bypass_list_override(NULL);
+}
+
+#ifdef __linux__
+TEST(config, swap_frees_old_data_after_readers) {
+    proxy_config_swap_s swap = {};
+    std::atomic<bool> stop(false);
+    std::atomic<int32_t> invalid(0);
+    std::vector<std::thread> readers;
+
+    swap.data = new uint32_t(0x12345678);
+    for (int32_t i = 0; i < 4; i++) {
+        readers.emplace_back([&]() {
+            while (!stop) {
+                uint32_t epoch = 0;
+                volatile uint32_t *data = (volatile uint32_t *)proxy_config_swap_read_begin(&swap, &epoch);
+                if (*data != 0x12345678)
+                    invalid++;
+                proxy_config_swap_read_end(&swap, epoch);
+            }
+        });
+    }
+
+    // Old data is overwritten before being freed so readers still using it would notice
+    for (int32_t i = 0; i < 1000; i++) {
+        uint32_t *old_data = (uint32_t *)proxy_config_swap_exchange(&swap, new uint32_t(0x12345678));
+        *old_data = 0;
+        delete old_data;
+    }
+    stop = true;
+    for (auto &reader : readers)
+        reader.join();
+
+    EXPECT_EQ(invalid, 0);
+    EXPECT_EQ(swap.readers[0], 0);
+    EXPECT_EQ(swap.readers[1], 0);
+    delete (uint32_t *)swap.data;
+}
+
+TEST(config, snapshot_other_scheme) {
+    // Only applies when the system config is read from the environment
+    setenv("gopher_proxy", "127.0.0.1:7070", 1);
+    proxy_config_refresh();
+    char *proxy = proxy_config_get_proxy("gopher");
+    const bool is_env = proxy && strcmp(proxy, "127.0.0.1:7070") == 0;
+    free(proxy);
+    if (!is_env) {
+        unsetenv("gopher_proxy");
+        GTEST_SKIP() << "System config is not read from the environment";
+    }
+
+    // Schemes that are not read up front are read from the system config when first requested
+    void *snapshot = proxy_config_snapshot_acquire();
+    ASSERT_NE(snapshot, nullptr);
+    const char *snapshot_proxy = proxy_config_snapshot_get_proxy(snapshot, "gopher");
+    EXPECT_STREQ(snapshot_proxy, "127.0.0.1:7070");
+    EXPECT_EQ(proxy_config_snapshot_get_proxy(snapshot, "gopher"), snapshot_proxy);
+    EXPECT_EQ(proxy_config_snapshot_get_proxy(snapshot, "telnet"), nullptr);
+    EXPECT_TRUE(proxy_config_snapshot_release(&snapshot));
+
+    unsetenv("gopher_proxy");
+    proxy_config_refresh();
+}
+
+TEST(config, snapshot_shared_until_changed) {
+    void *snapshots[2] = {0};
+
+    // Monitored configs are only read again when the config generation changes, even once snapshots are too old
+    proxy_config_snapshot_set_max_age(0);
+    snapshots[0] = proxy_config_snapshot_acquire();
+    ASSERT_NE(snapshots[0], nullptr);
+    snapshots[1] = proxy_config_snapshot_acquire();
+    EXPECT_EQ(snapshots[0], snapshots[1]);
+    proxy_config_snapshot_release(&snapshots[1]);
+    proxy_config_snapshot_set_max_age(1);
+
+    proxy_config_refresh();
+    snapshots[1] = proxy_config_snapshot_acquire();
+    EXPECT_NE(snapshots[0], snapshots[1]);
+    proxy_config_snapshot_release(&snapshots[1]);
+    proxy_config_snapshot_release(&snapshots[0]);
+}
+
+TEST(config, snapshot_acquire_while_changed) {
+    std::atomic<bool> stop(false);
+    std::atomic<int32_t> invalid(0);
+    std::vector<std::thread> readers;
+
+    // Snapshots acquired without locking stay valid while other threads replace them
+    proxy_config_set_bypass_list_override("*.bypass.com");
+    for (int32_t i = 0; i < 4; i++) {
+        readers.emplace_back([&]() {
+            while (!stop) {
+                void *snapshot = proxy_config_snapshot_acquire();
+                const char *bypass_list = proxy_config_snapshot_get_bypass_list(snapshot);
+                if (!bypass_list || strcmp(bypass_list, "*.bypass.com") != 0)
+                    invalid++;
+                proxy_config_snapshot_release(&snapshot);
+            }
+        });
+    }
+    for (int32_t i = 0; i < 1000; i++) {
+        proxy_config_increment_generation();
+        void *snapshot = proxy_config_snapshot_acquire();
+        proxy_config_snapshot_release(&snapshot);
+    }
+    stop = true;
+    for (auto &reader : readers)
+        reader.join();
+    proxy_config_set_bypass_list_override(NULL);
+
+    EXPECT_EQ(invalid, 0);
+}
+
+TEST(config, env_refresh) {
+    setenv("ftp_proxy", "127.0.0.1:2121", 1);
+    setenv("no_proxy", "*.bypass.com,", 1);
+    proxy_config_refresh();
+
+    char *proxy = proxy_config_env_get_proxy("ftp");
+    ASSERT_NE(proxy, nullptr);
+    EXPECT_STREQ(proxy, "127.0.0.1:2121");
+    free(proxy);
+    char *bypass_list = proxy_config_env_get_bypass_list();
+    ASSERT_NE(bypass_list, nullptr);
+    EXPECT_STREQ(bypass_list, "*.bypass.com");
+    free(bypass_list);
+
+    unsetenv("ftp_proxy");
+    unsetenv("no_proxy");
+    proxy_config_refresh();
+
+    EXPECT_EQ(proxy_config_env_get_proxy("ftp"), nullptr);
+    EXPECT_EQ(proxy_config_env_get_bypass_list(), nullptr);
+}
+#endif
@@ -0,0 +1,139 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include <dlfcn.h>
+
+#include <gtest/gtest.h>
+
+#include "config_i.h"
+#include "config_gnome3.h"
+#include "util_linux.h"
+
+// Settings are written through GIO directly using the in-process memory backend
+typedef struct gio_s {
+    void *module;
+    void *(*g_settings_schema_source_get_default)(void);
+    void *(*g_settings_schema_source_lookup)(void *source, const char *schema_id, int recursive);
+    void (*g_settings_schema_unref)(void *schema);
+    void *(*g_settings_new)(const char *schema_id);
+    int (*g_settings_set_string)(void *settings, const char *key, const char *value);
+    int (*g_settings_set_int)(void *settings, const char *key, int value);
+    void (*g_settings_sync)(void);
+    void (*g_object_unref)(void *object);
+} gio_s;
+
+class config_gnome3 : public ::testing::Test {
+  protected:
+    gio_s gio = {};
+
+    void SetUp() override {
+        // Global config already owns the GNOME settings when running on a GNOME desktop
+        if (get_desktop_env() == DESKTOP_ENV_GNOME3)
+            GTEST_SKIP() << "GNOME settings are in use by the global config";
+        setenv("GSETTINGS_BACKEND", "memory", 1);
+
+        gio.module = dlopen("libgio-2.0.so.0", RTLD_LAZY | RTLD_LOCAL);
+        if (!gio.module)
+            GTEST_SKIP() << "GIO is not installed";
+        *(void **)&gio.g_settings_schema_source_get_default =
+            dlsym(gio.module, "g_settings_schema_source_get_default");
+        *(void **)&gio.g_settings_schema_source_lookup = dlsym(gio.module, "g_settings_schema_source_lookup");
+        *(void **)&gio.g_settings_schema_unref = dlsym(gio.module, "g_settings_schema_unref");
+        *(void **)&gio.g_settings_new = dlsym(gio.module, "g_settings_new");
+        *(void **)&gio.g_settings_set_string = dlsym(gio.module, "g_settings_set_string");
+        *(void **)&gio.g_settings_set_int = dlsym(gio.module, "g_settings_set_int");
+        *(void **)&gio.g_settings_sync = dlsym(gio.module, "g_settings_sync");
+        *(void **)&gio.g_object_unref = dlsym(gio.module, "g_object_unref");
+        ASSERT_NE(gio.g_settings_new, nullptr);
+
+        // Creating settings for a missing schema aborts the process
+        void *source = gio.g_settings_schema_source_get_default();
+        void *schema = source ? gio.g_settings_schema_source_lookup(source, "org.gnome.system.proxy", 1) : NULL;
+        if (!schema)
+            GTEST_SKIP() << "GNOME proxy settings schema is not installed";
+        gio.g_settings_schema_unref(schema);
+
+        set_string("org.gnome.system.proxy", "mode", "none");
+        ASSERT_TRUE(proxy_config_gnome3_global_init());
+    }
+
+    void TearDown() override {
+        if (!gio.module)
+            return;
+        proxy_config_gnome3_global_cleanup();
+        dlclose(gio.module);
+    }
+
+    void set_string(const char *schema_id, const char *key, const char *value) {
+        void *settings = gio.g_settings_new(schema_id);
+        gio.g_settings_set_string(settings, key, value);
+        gio.g_settings_sync();
+        gio.g_object_unref(settings);
+    }
+
+    void set_int(const char *schema_id, const char *key, int value) {
+        void *settings = gio.g_settings_new(schema_id);
+        gio.g_settings_set_int(settings, key, value);
+        gio.g_settings_sync();
+        gio.g_object_unref(settings);
+    }
+
+    // Change notifications are delivered on the config's own main loop thread
+    std::string wait_for_proxy(const char *scheme, const char *expected) {
+        std::string proxy;
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        do {
+            char *value = proxy_config_gnome3_get_proxy(scheme);
+            proxy = value ? value : "";
+            free(value);
+            if (proxy == expected)
+                break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        } while (std::chrono::steady_clock::now() < deadline);
+        return proxy;
+    }
+};
+
+TEST_F(config_gnome3, manual_proxy) {
+    set_string("org.gnome.system.proxy.http", "host", "127.0.0.1");
+    set_int("org.gnome.system.proxy.http", "port", 8080);
+    set_string("org.gnome.system.proxy.socks", "host", "127.0.0.2");
+    set_int("org.gnome.system.proxy.socks", "port", 1080);
+    set_string("org.gnome.system.proxy", "mode", "manual");
+
+    EXPECT_EQ(wait_for_proxy("http", "127.0.0.1:8080"), "127.0.0.1:8080");
+    EXPECT_EQ(wait_for_proxy("socks", "127.0.0.2:1080"), "127.0.0.2:1080");
+
+    // Schemes without their own settings use the closest matching proxy
+    EXPECT_EQ(wait_for_proxy("ws", "127.0.0.1:8080"), "127.0.0.1:8080");
+    EXPECT_EQ(wait_for_proxy("HTTP://example.com/", "127.0.0.1:8080"), "127.0.0.1:8080");
+    EXPECT_EQ(wait_for_proxy("gopher", "127.0.0.2:1080"), "127.0.0.2:1080");
+
+    // Proxies are not used once manual mode is turned off
+    set_string("org.gnome.system.proxy", "mode", "none");
+    EXPECT_EQ(wait_for_proxy("http", ""), "");
+}
+
+TEST_F(config_gnome3, auto_config_url) {
+    set_string("org.gnome.system.proxy", "autoconfig-url", "http://127.0.0.1/wpad.dat");
+    set_string("org.gnome.system.proxy", "mode", "auto");
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    char *auto_config_url = NULL;
+    while (!auto_config_url && std::chrono::steady_clock::now() < deadline) {
+        auto_config_url = proxy_config_gnome3_get_auto_config_url();
+        if (!auto_config_url)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_NE(auto_config_url, nullptr);
+    EXPECT_STREQ(auto_config_url, "http://127.0.0.1/wpad.dat");
+    EXPECT_TRUE(proxy_config_gnome3_get_auto_discover());
+    free(auto_config_url);
+}
@@ -0,0 +1,85 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "event.h"
+#ifdef __linux__
+#  include "atomic.h"
+#  include "event_futex.h"
+#endif
+
+// Returns whether a waiter is known to be blocked on the event
+static bool event_has_parked_waiters(void *event) {
+#ifdef __linux__
+    return atomic_load_acquire_u32(&((event_futex_s *)event)->state) & EVENT_FUTEX_WAITERS;
+#else
+    // Other platforms don't expose their wait queue, starting the waiters is all that can be observed
+    (void)event;
+    return true;
+#endif
+}
+
+TEST(event, wait_timeout) {
+    void *event = event_create();
+    ASSERT_NE(event, nullptr);
+    EXPECT_FALSE(event_wait(event, 0));
+    EXPECT_FALSE(event_wait(event, 10));
+    EXPECT_TRUE(event_delete(&event));
+    ASSERT_EQ(event, nullptr);
+}
+
+TEST(event, reset) {
+    void *event = event_create();
+    ASSERT_NE(event, nullptr);
+    EXPECT_TRUE(event_set(event));
+    EXPECT_TRUE(event_wait(event, 10));
+    EXPECT_TRUE(event_reset(event));
+    EXPECT_FALSE(event_wait(event, 0));
+    EXPECT_TRUE(event_set(event));
+    EXPECT_TRUE(event_wait(event, -1));
+    EXPECT_TRUE(event_delete(&event));
+}
+
+TEST(event, wait_timeout_elapsed) {
+    void *event = event_create();
+    ASSERT_NE(event, nullptr);
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(event_wait(event, 100));
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    EXPECT_GE(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count(), 90);
+    EXPECT_TRUE(event_delete(&event));
+}
+
+TEST(event, set_wakes_all_waiters) {
+    void *event = event_create();
+    ASSERT_NE(event, nullptr);
+    std::atomic<int32_t> started(0);
+    std::atomic<int32_t> woken(0);
+    std::vector<std::thread> waiters;
+    for (int32_t i = 0; i < 4; i++) {
+        waiters.emplace_back([event, &started, &woken]() {
+            started++;
+            if (event_wait(event, 5000))
+                woken++;
+        });
+    }
+    // Set the event only once waiters are blocked so that it has to wake them instead of them seeing the signal
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while ((started != 4 || !event_has_parked_waiters(event)) && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    EXPECT_EQ(started, 4);
+    EXPECT_TRUE(event_has_parked_waiters(event));
+    EXPECT_TRUE(event_set(event));
+    for (auto &waiter : waiters)
+        waiter.join();
+    EXPECT_EQ(woken, 4);
+    EXPECT_TRUE(event_delete(&event));
+}
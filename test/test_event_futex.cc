@@ -0,0 +1,92 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "atomic.h"
+#include "event_futex.h"
+
+TEST(event_futex, size) {
+    EXPECT_EQ(sizeof(event_futex_s), 4);
+}
+
+TEST(event_futex, manual_reset) {
+    event_futex_s event;
+    event_futex_init(&event, false);
+    EXPECT_FALSE(event_futex_wait(&event, 0));
+    EXPECT_FALSE(event_futex_wait(&event, 10));
+    EXPECT_TRUE(event_futex_set(&event));
+    EXPECT_TRUE(event_futex_wait(&event, 0));
+    EXPECT_TRUE(event_futex_wait(&event, -1));
+    EXPECT_TRUE(event_futex_reset(&event));
+    EXPECT_FALSE(event_futex_wait(&event, 0));
+}
+
+TEST(event_futex, auto_reset) {
+    event_futex_s event;
+    event_futex_init(&event, true);
+    EXPECT_TRUE(event_futex_set(&event));
+    EXPECT_TRUE(event_futex_wait(&event, 0));
+    EXPECT_FALSE(event_futex_wait(&event, 0));
+    EXPECT_TRUE(event_futex_set(&event));
+    EXPECT_TRUE(event_futex_wait(&event, -1));
+    EXPECT_FALSE(event_futex_wait(&event, 10));
+}
+
+// Poll instead of sleeping for a fixed time so that the test does not depend on scheduling
+template <typename Condition>
+static bool wait_until(Condition condition) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!condition()) {
+        if (std::chrono::steady_clock::now() >= deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+TEST(event_futex, auto_reset_releases_single_waiter) {
+    event_futex_s event;
+    event_futex_init(&event, true);
+    std::atomic<int32_t> started(0);
+    std::atomic<int32_t> woken(0);
+    std::vector<std::thread> waiters;
+    for (int32_t i = 0; i < 2; i++) {
+        waiters.emplace_back([&event, &started, &woken]() {
+            started++;
+            if (event_futex_wait(&event, 5000))
+                woken++;
+        });
+    }
+
+    // Set the event once both threads have started and one of them is blocked on it
+    const auto is_waiting = [&event]() { return (atomic_load_acquire_u32(&event.state) & EVENT_FUTEX_WAITERS) != 0; };
+    EXPECT_TRUE(wait_until([&]() { return started == 2 && is_waiting(); }));
+    EXPECT_TRUE(event_futex_set(&event));
+    EXPECT_TRUE(wait_until([&]() { return woken > 0; }));
+
+    // Remaining thread goes back to waiting since the signal was consumed by the first
+    EXPECT_TRUE(wait_until(is_waiting));
+    EXPECT_EQ(woken, 1);
+    EXPECT_TRUE(event_futex_set(&event));
+    for (auto &waiter : waiters)
+        waiter.join();
+    EXPECT_EQ(woken, 2);
+}
+
+TEST(event_futex, wait_timeout_elapsed) {
+    event_futex_s event;
+    event_futex_init(&event, false);
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(event_futex_wait(&event, 100));
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    EXPECT_GE(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count(), 90);
+}
@@ -3,10 +3,15 @@
 #include <string.h>
 #include <stdlib.h>
 
+#include <future>
+#include <string>
+#include <thread>
+
 #include <gtest/gtest.h>
 
 #include "execute.h"
 #include "net_util.h"
+#include "stats.h"
 #include "util.h"
 
 struct execute_param {
@@ -147,3 +152,181 @@ TEST_P(execute, get_proxies_for_url) {
         proxy_execute_delete(&proxy_execute);
     }
 }
+
+TEST(execute, url_with_quotes_and_long_length) {
+    const char *echo_script = "function FindProxyForURL(url, host) { return \"PROXY \" + host + \":\" + url.length; }";
+
+    // Url is passed to FindProxyForURL as is without being escaped or truncated
+    std::string url = "http://echo.com/?q=\"quoted\\\"&pad=" + std::string(8192, 'a');
+    std::string expected = "PROXY echo.com:" + std::to_string(url.size());
+
+    void *proxy_execute = proxy_execute_create();
+    ASSERT_NE(proxy_execute, nullptr);
+    EXPECT_TRUE(proxy_execute_get_proxies_for_url(proxy_execute, echo_script, url.c_str()));
+    EXPECT_STREQ(proxy_execute_get_list(proxy_execute), expected.c_str());
+    proxy_execute_delete(&proxy_execute);
+}
+
+TEST(execute_cache, reuse_evaluated_script) {
+    const char *cached_script = "function FindProxyForURL(url, host) { return \"PROXY cached-proxy:80\"; }";
+    proxyres_stats_s stats;
+
+    proxyres_reset_stats();
+    for (int32_t i = 0; i < 2; i++) {
+        void *proxy_execute = proxy_execute_create();
+        ASSERT_NE(proxy_execute, nullptr);
+        EXPECT_TRUE(proxy_execute_get_proxies_for_url(proxy_execute, cached_script, "http://simple.com/"));
+        proxy_execute_delete(&proxy_execute);
+    }
+
+    ASSERT_TRUE(proxyres_get_stats(&stats));
+    if (!stats.pac_compile_cache_misses)
+        GTEST_SKIP() << "Execute backend does not support reusing evaluated scripts";
+    EXPECT_EQ(stats.pac_compile_cache_misses, 1);
+    EXPECT_EQ(stats.pac_compile_cache_hits, 1);
+    EXPECT_EQ(stats.pac_compile_time.count, 1);
+}
+
+TEST(execute_cache, context_not_shared_between_threads) {
+    const char *cached_script = "function FindProxyForURL(url, host) { return \"PROXY thread-proxy:80\"; }";
+    proxyres_stats_s stats;
+
+    auto run_script = [cached_script]() {
+        void *proxy_execute = proxy_execute_create();
+        ASSERT_NE(proxy_execute, nullptr);
+        EXPECT_TRUE(proxy_execute_get_proxies_for_url(proxy_execute, cached_script, "http://simple.com/"));
+        proxy_execute_delete(&proxy_execute);
+    };
+
+    // Context evaluated on this thread is reused on this thread only
+    proxyres_reset_stats();
+    run_script();
+    run_script();
+    std::thread other_thread(run_script);
+    other_thread.join();
+
+    ASSERT_TRUE(proxyres_get_stats(&stats));
+    if (!stats.pac_compile_cache_misses)
+        GTEST_SKIP() << "Execute backend does not support reusing evaluated scripts";
+    EXPECT_EQ(stats.pac_compile_cache_misses, 2);
+    EXPECT_EQ(stats.pac_compile_cache_hits, 1);
+}
+
+TEST(execute_cache, evict_context_of_other_thread) {
+    const char *other_script = "function FindProxyForURL(url, host) { return \"PROXY other-proxy:80\"; }";
+    std::promise<void> evicted;
+    std::future<void> evicted_future = evicted.get_future();
+    proxyres_stats_s stats;
+
+    auto run_script = [](const char *script) {
+        void *proxy_execute = proxy_execute_create();
+        ASSERT_NE(proxy_execute, nullptr);
+        EXPECT_TRUE(proxy_execute_get_proxies_for_url(proxy_execute, script, "http://simple.com/"));
+        proxy_execute_delete(&proxy_execute);
+    };
+
+    proxyres_reset_stats();
+
+    // Other thread keeps running while its context is evicted so that it has to delete the context itself
+    std::promise<void> created;
+    std::thread other_thread([&]() {
+        run_script(other_script);
+        created.set_value();
+        evicted_future.wait();
+        run_script(other_script);
+    });
+    created.get_future().wait();
+
+    // Fill the cache from this thread until the context of the other thread is the least recently used
+    for (int32_t i = 0; i < 1024; i++) {
+        std::string script =
+            "function FindProxyForURL(url, host) { return \"PROXY evict-proxy:80\"; } // " + std::to_string(i);
+        run_script(script.c_str());
+    }
+    evicted.set_value();
+    other_thread.join();
+
+    ASSERT_TRUE(proxyres_get_stats(&stats));
+    if (!stats.pac_compile_cache_misses)
+        GTEST_SKIP() << "Execute backend does not support reusing evaluated scripts";
+    // Other thread evaluated its script again since the context was evicted
+    EXPECT_EQ(stats.pac_compile_cache_misses, 1026);
+    EXPECT_EQ(stats.pac_compile_cache_hits, 0);
+}
+
+struct execute_analyze_param {
+    const char *script;
+    proxy_execute_memo_key memo_key;
+    int32_t ttl;
+
+    friend std::ostream &operator<<(std::ostream &os, const execute_analyze_param &param) {
+        return os << "script: " << param.script;
+    }
+};
+
+constexpr execute_analyze_param execute_analyze_tests[] = {
+    {"function FindProxyForURL(url, host) { return \"DIRECT\"; }", PROXY_EXECUTE_MEMO_KEY_HOST, -1},
+    {"function FindProxyForURL(url, host) { if (dnsDomainIs(host, \".url.com\")) return \"DIRECT\"; }",
+     PROXY_EXECUTE_MEMO_KEY_HOST, -1},
+    {"function FindProxyForURL(u, h) { if (shExpMatch(u, \"https:*\")) return \"DIRECT\"; }",
+     PROXY_EXECUTE_MEMO_KEY_SCHEME_HOST, -1},
+    {"function FindProxyForURL(url, host) { if (url.substring(0, 5) == \"http:\") return \"DIRECT\"; }",
+     PROXY_EXECUTE_MEMO_KEY_SCHEME_HOST, -1},
+    {"function FindProxyForURL(url, host) { if (url.startsWith(\"ftp://\")) return \"DIRECT\"; }",
+     PROXY_EXECUTE_MEMO_KEY_SCHEME_HOST, -1},
+    {"function FindProxyForURL(url, host) { if (shExpMatch(url, \"*/api/*\")) return \"DIRECT\"; }",
+     PROXY_EXECUTE_MEMO_KEY_URL, -1},
+    {"FindProxyForURL = function (url, host) { var u = url; return \"DIRECT\"; }", PROXY_EXECUTE_MEMO_KEY_URL, -1},
+    {"function FindProxyForURL(url, host) { return arguments[0] ? \"DIRECT\" : \"\"; }", PROXY_EXECUTE_MEMO_KEY_URL,
+     -1},
+    {"function FindProxyForURL(url, host) { // url\n return \"DIRECT\"; /* url */ }", PROXY_EXECUTE_MEMO_KEY_HOST,
+     -1},
+    {"function FindProxyForURL(url, host) { if (/url/.test(host)) return \"url\"; }", PROXY_EXECUTE_MEMO_KEY_HOST,
+     -1},
+    {"function FindProxyForURL(url, host) { if (isInNet(host, \"10.0.0.0\", \"255.0.0.0\")) return \"DIRECT\"; }",
+     PROXY_EXECUTE_MEMO_KEY_HOST, 60},
+    {"function FindProxyForURL(url, host) { return \"PROXY \" + myIpAddress() + \":80\"; }",
+     PROXY_EXECUTE_MEMO_KEY_HOST, 60},
+    {"function FindProxyForURL(url, host) { if (timeRange(8, 18)) return \"DIRECT\"; }", PROXY_EXECUTE_MEMO_KEY_HOST,
+     20},
+    {"function FindProxyForURL(url, host) { if (timeRange(8, 0, 30, 18, 0, 0)) return \"DIRECT\"; }",
+     PROXY_EXECUTE_MEMO_KEY_HOST, 1},
+    {"function FindProxyForURL(url, host) { if (weekdayRange(\"MON\", \"FRI\")) return \"DIRECT\"; }",
+     PROXY_EXECUTE_MEMO_KEY_HOST, 860},
+    {"function FindProxyForURL(url, host) { if (new Date().getHours() > 8) return \"DIRECT\"; }",
+     PROXY_EXECUTE_MEMO_KEY_HOST, 0},
+    {"function FindProxyForURL(url, host) { return eval(\"url\"); }", PROXY_EXECUTE_MEMO_KEY_URL, 0},
+    {"function FindProxyForURL(url, host) { return this[\"dns\" + \"Resolve\"](host); }", PROXY_EXECUTE_MEMO_KEY_URL,
+     0},
+    {"function FindProxyForURL(url, host) { return `PROXY ${host}:80`; }", PROXY_EXECUTE_MEMO_KEY_URL, 0},
+    {"function Find(url, host) { return \"DIRECT\"; }", PROXY_EXECUTE_MEMO_KEY_URL, -1}};
+
+class execute_analyze : public ::testing::TestWithParam<execute_analyze_param> {};
+
+INSTANTIATE_TEST_SUITE_P(execute_analyze, execute_analyze, testing::ValuesIn(execute_analyze_tests));
+
+TEST_P(execute_analyze, memo_policy) {
+    const auto &param = GetParam();
+    proxy_execute_analysis_s analysis;
+
+    // Time is 40 seconds past a 15 minute boundary
+    const time_t now = 1700000100 + 40;
+
+    ASSERT_TRUE(proxy_execute_analyze_script(param.script, &analysis));
+    EXPECT_EQ(analysis.memo_key, param.memo_key);
+    EXPECT_EQ(proxy_execute_get_memo_ttl(&analysis, now), param.ttl);
+}
+
+TEST(execute, memo_url) {
+    char *memo_url = proxy_execute_get_memo_url("https://user@simple.com:8443/path?query", PROXY_EXECUTE_MEMO_KEY_HOST);
+    EXPECT_STREQ(memo_url, "https://simple.com:8443");
+    free(memo_url);
+
+    memo_url = proxy_execute_get_memo_url("http://simple.com/path", PROXY_EXECUTE_MEMO_KEY_SCHEME_HOST);
+    EXPECT_STREQ(memo_url, "http://simple.com");
+    free(memo_url);
+
+    memo_url = proxy_execute_get_memo_url("http://simple.com/path", PROXY_EXECUTE_MEMO_KEY_URL);
+    EXPECT_STREQ(memo_url, "http://simple.com/path");
+    free(memo_url);
+}
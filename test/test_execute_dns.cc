@@ -0,0 +1,143 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <gtest/gtest.h>
+
+#include "event.h"
+#include "execute_dns.h"
+
+// Answers are shared between executions so each test starts without any
+class execute_dns : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        execute_dns_clear();
+    }
+};
+
+static void set_event(void *user_data) {
+    event_set(user_data);
+}
+
+TEST_F(execute_dns, nonblocking_records_host) {
+    void *dns = execute_dns_create();
+    ASSERT_NE(dns, nullptr);
+
+    execute_dns_set_nonblocking(dns, true);
+    execute_dns_set_current(dns);
+    int32_t error = 0;
+    char *address = execute_dns_resolve("localhost", &error);
+    EXPECT_EQ(address, nullptr);
+    EXPECT_NE(error, 0);
+    // Looking up the same host again does not record it twice
+    address = execute_dns_resolve("localhost", NULL);
+    EXPECT_EQ(address, nullptr);
+    execute_dns_set_current(NULL);
+    EXPECT_EQ(execute_dns_get_missing_count(dns), 1);
+
+    EXPECT_TRUE(execute_dns_delete(&dns));
+    EXPECT_EQ(dns, nullptr);
+}
+
+TEST_F(execute_dns, resolve_missing_seeds_answers) {
+    void *dns = execute_dns_create();
+    ASSERT_NE(dns, nullptr);
+
+    execute_dns_set_nonblocking(dns, true);
+    execute_dns_set_current(dns);
+    EXPECT_EQ(execute_dns_resolve("localhost", NULL), nullptr);
+    EXPECT_EQ(execute_dns_resolve("127.0.0.1", NULL), nullptr);
+    EXPECT_EQ(execute_dns_resolve_ex("127.0.0.1", NULL), nullptr);
+    EXPECT_EQ(execute_dns_get_missing_count(dns), 3);
+
+    // Answers are available without blocking once recorded host names have been resolved
+    EXPECT_TRUE(execute_dns_resolve_missing(dns));
+    EXPECT_EQ(execute_dns_get_missing_count(dns), 0);
+    EXPECT_EQ(execute_dns_get_count(), 3);
+
+    char *address = execute_dns_resolve("127.0.0.1", NULL);
+    EXPECT_NE(address, nullptr);
+    if (address) {
+        EXPECT_STREQ(address, "127.0.0.1");
+        free(address);
+    }
+    char *addresses = execute_dns_resolve_ex("127.0.0.1", NULL);
+    EXPECT_NE(addresses, nullptr);
+    free(addresses);
+    address = execute_dns_resolve("localhost", NULL);
+    EXPECT_NE(address, nullptr);
+    free(address);
+
+    execute_dns_set_current(NULL);
+    EXPECT_EQ(execute_dns_get_missing_count(dns), 0);
+    EXPECT_TRUE(execute_dns_delete(&dns));
+}
+
+TEST_F(execute_dns, resolve_missing_async) {
+    void *dns = execute_dns_create();
+    ASSERT_NE(dns, nullptr);
+    void *resolved = event_create();
+    ASSERT_NE(resolved, nullptr);
+
+    execute_dns_set_nonblocking(dns, true);
+    execute_dns_set_current(dns);
+    EXPECT_EQ(execute_dns_resolve("127.0.0.1", NULL), nullptr);
+    execute_dns_set_current(NULL);
+
+    // Callback is only called when the host names were not already resolved before returning
+    if (execute_dns_resolve_missing_async(dns, set_event, resolved))
+        EXPECT_TRUE(event_wait(resolved, 5000));
+    EXPECT_EQ(execute_dns_get_missing_count(dns), 0);
+
+    execute_dns_set_current(dns);
+    char *address = execute_dns_resolve("127.0.0.1", NULL);
+    execute_dns_set_current(NULL);
+    EXPECT_NE(address, nullptr);
+    free(address);
+
+    event_delete(&resolved);
+    EXPECT_TRUE(execute_dns_delete(&dns));
+}
+
+TEST_F(execute_dns, answers_shared_between_executions) {
+    void *dns = execute_dns_create();
+    ASSERT_NE(dns, nullptr);
+    execute_dns_set_nonblocking(dns, true);
+    execute_dns_set_current(dns);
+    EXPECT_EQ(execute_dns_resolve("127.0.0.1", NULL), nullptr);
+    execute_dns_set_current(NULL);
+    EXPECT_TRUE(execute_dns_resolve_missing(dns));
+    EXPECT_TRUE(execute_dns_delete(&dns));
+
+    // Later executions use the answer without having to run the script again
+    dns = execute_dns_create();
+    ASSERT_NE(dns, nullptr);
+    execute_dns_set_nonblocking(dns, true);
+    execute_dns_set_current(dns);
+    char *address = execute_dns_resolve("127.0.0.1", NULL);
+    execute_dns_set_current(NULL);
+    EXPECT_NE(address, nullptr);
+    free(address);
+    EXPECT_EQ(execute_dns_get_missing_count(dns), 0);
+    EXPECT_TRUE(execute_dns_delete(&dns));
+
+    EXPECT_TRUE(execute_dns_clear());
+    EXPECT_EQ(execute_dns_get_count(), 0);
+}
+
+TEST_F(execute_dns, blocking_resolves_directly) {
+    void *dns = execute_dns_create();
+    ASSERT_NE(dns, nullptr);
+
+    execute_dns_set_current(dns);
+    char *address = execute_dns_resolve("127.0.0.1", NULL);
+    execute_dns_set_current(NULL);
+    EXPECT_NE(address, nullptr);
+    if (address) {
+        EXPECT_STREQ(address, "127.0.0.1");
+        free(address);
+    }
+    EXPECT_EQ(execute_dns_get_missing_count(dns), 0);
+    EXPECT_TRUE(execute_dns_delete(&dns));
+}
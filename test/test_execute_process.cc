@@ -0,0 +1,117 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "execute_i.h"
+#include "execute_process.h"
+
+// Script engine evaluated in helper processes that reports the process it ran in
+static char g_fake_list[64];
+
+static bool fake_get_proxies_for_url(void *ctx, const char *script, const char *url) {
+    if (strstr(url, "crash"))
+        _exit(1);
+    snprintf(g_fake_list, sizeof(g_fake_list), "PROXY %s:%d", script, (int)getpid());
+    return true;
+}
+
+static const char *fake_get_list(void *ctx) {
+    return g_fake_list;
+}
+
+static int32_t fake_get_error(void *ctx) {
+    return 0;
+}
+
+static void *fake_create(void) {
+    return g_fake_list;
+}
+
+static bool fake_delete(void **ctx) {
+    *ctx = NULL;
+    return true;
+}
+
+static bool fake_global_init(void) {
+    return true;
+}
+
+static bool fake_global_cleanup(void) {
+    return true;
+}
+
+static proxy_execute_i_s fake_execute_i = {fake_get_proxies_for_url,
+                                           fake_get_list,
+                                           fake_get_error,
+                                           fake_create,
+                                           fake_delete,
+                                           fake_global_init,
+                                           fake_global_cleanup,
+                                           NULL,
+                                           NULL,
+                                           NULL};
+
+static const char *get_proxies(void *proxy_execute, const char *script, const char *url) {
+    if (!proxy_execute_process_get_proxies_for_url(proxy_execute, script, url))
+        return NULL;
+    return proxy_execute_process_get_list(proxy_execute);
+}
+
+TEST(execute_process, get_proxies_for_url) {
+    ASSERT_TRUE(proxy_execute_process_init_ex(&fake_execute_i, 1, 0, 0));
+    void *proxy_execute = proxy_execute_process_create();
+    ASSERT_NE(proxy_execute, nullptr);
+
+    const char *list = get_proxies(proxy_execute, "script1", "http://example.com/");
+    ASSERT_NE(list, nullptr);
+    EXPECT_EQ(strncmp(list, "PROXY script1:", 14), 0);
+    // Evaluated in a different process
+    EXPECT_NE(atoi(list + 14), (int)getpid());
+
+    // Changed script is sent again
+    list = get_proxies(proxy_execute, "script2", "http://example.com/");
+    ASSERT_NE(list, nullptr);
+    EXPECT_EQ(strncmp(list, "PROXY script2:", 14), 0);
+
+    EXPECT_TRUE(proxy_execute_process_delete(&proxy_execute));
+    EXPECT_TRUE(proxy_execute_process_global_cleanup());
+}
+
+TEST(execute_process, recycle_after_max_evaluations) {
+    ASSERT_TRUE(proxy_execute_process_init_ex(&fake_execute_i, 1, 2, 0));
+    void *proxy_execute = proxy_execute_process_create();
+    ASSERT_NE(proxy_execute, nullptr);
+    int pids[3] = {0};
+
+    for (int32_t i = 0; i < 3; i++) {
+        const char *list = get_proxies(proxy_execute, "script", "http://example.com/");
+        ASSERT_NE(list, nullptr);
+        pids[i] = atoi(strchr(list, ':') + 1);
+    }
+    EXPECT_EQ(pids[0], pids[1]);
+    EXPECT_NE(pids[1], pids[2]);
+
+    EXPECT_TRUE(proxy_execute_process_delete(&proxy_execute));
+    EXPECT_TRUE(proxy_execute_process_global_cleanup());
+}
+
+TEST(execute_process, helper_crash) {
+    ASSERT_TRUE(proxy_execute_process_init_ex(&fake_execute_i, 1, 0, 0));
+    void *proxy_execute = proxy_execute_process_create();
+    ASSERT_NE(proxy_execute, nullptr);
+
+    EXPECT_FALSE(proxy_execute_process_get_proxies_for_url(proxy_execute, "script", "http://crash.com/"));
+    EXPECT_NE(proxy_execute_process_get_error(proxy_execute), 0);
+
+    // Helper is replaced and the next evaluation succeeds
+    EXPECT_NE(get_proxies(proxy_execute, "script", "http://example.com/"), nullptr);
+
+    EXPECT_TRUE(proxy_execute_process_delete(&proxy_execute));
+    EXPECT_TRUE(proxy_execute_process_global_cleanup());
+}
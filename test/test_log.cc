@@ -0,0 +1,121 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "log.h"
+#include "logging.h"
+
+typedef struct log_message_s {
+    int32_t level;
+    int32_t category;
+    std::string message;
+} log_message_s;
+
+static void log_collect(void *user_data, int32_t level, int32_t category, const char *message) {
+    std::vector<log_message_s> *messages = (std::vector<log_message_s> *)user_data;
+    messages->push_back({level, category, message});
+}
+
+static const log_message_s *log_find(const std::vector<log_message_s> &messages, const char *message) {
+    // Other threads may log at the same time so look for messages by content
+    for (auto &log_message : messages) {
+        if (log_message.message == message)
+            return &log_message;
+    }
+    return NULL;
+}
+
+class log_test : public ::testing::Test {
+  protected:
+    std::vector<log_message_s> messages;
+
+    void SetUp() override {
+        proxyres_log_set_rate_limit(0);
+        proxyres_log_set_level(PROXYRES_LOG_CATEGORY_ALL, PROXYRES_LOG_LEVEL_DEBUG);
+        proxyres_log_set_callback(log_collect, &messages);
+    }
+    void TearDown() override {
+        log_flush();
+        log_reset_defaults();
+    }
+};
+
+TEST_F(log_test, callback) {
+
+    log_printf(PROXYRES_LOG_LEVEL_ERROR, PROXYRES_LOG_CATEGORY_FETCH, "Unable to fetch %s (%d)\n", "pac.js", 404);
+    log_flush();
+
+    const log_message_s *message = log_find(messages, "Unable to fetch pac.js (404)");
+    ASSERT_NE(message, nullptr);
+    EXPECT_EQ(message->level, PROXYRES_LOG_LEVEL_ERROR);
+    EXPECT_EQ(message->category, PROXYRES_LOG_CATEGORY_FETCH);
+}
+
+TEST_F(log_test, level) {
+    proxyres_log_set_level(PROXYRES_LOG_CATEGORY_WPAD, PROXYRES_LOG_LEVEL_WARN);
+
+    EXPECT_TRUE(log_is_enabled(PROXYRES_LOG_LEVEL_WARN, PROXYRES_LOG_CATEGORY_WPAD));
+    EXPECT_FALSE(log_is_enabled(PROXYRES_LOG_LEVEL_INFO, PROXYRES_LOG_CATEGORY_WPAD));
+    EXPECT_TRUE(log_is_enabled(PROXYRES_LOG_LEVEL_INFO, PROXYRES_LOG_CATEGORY_RESOLVER));
+
+    log_printf(PROXYRES_LOG_LEVEL_INFO, PROXYRES_LOG_CATEGORY_WPAD, "filtered");
+    log_printf(PROXYRES_LOG_LEVEL_WARN, PROXYRES_LOG_CATEGORY_WPAD, "wpad");
+    log_printf(PROXYRES_LOG_LEVEL_DEBUG, PROXYRES_LOG_CATEGORY_RESOLVER, "resolver");
+    log_flush();
+
+    EXPECT_EQ(log_find(messages, "filtered"), nullptr);
+    EXPECT_NE(log_find(messages, "wpad"), nullptr);
+    EXPECT_NE(log_find(messages, "resolver"), nullptr);
+}
+
+TEST_F(log_test, disabled_arguments) {
+    int32_t evaluated = 0;
+
+    // Arguments of messages that are not logged are never evaluated
+    proxyres_log_set_level(PROXYRES_LOG_CATEGORY_GENERAL, PROXYRES_LOG_LEVEL_WARN);
+    LOG_DEBUG("evaluated %d", (int)++evaluated);
+    EXPECT_EQ(evaluated, 0);
+    LOG_WARN("evaluated %d", (int)++evaluated);
+    EXPECT_EQ(evaluated, 1);
+    log_flush();
+
+    EXPECT_NE(log_find(messages, "evaluated 1"), nullptr);
+}
+
+TEST_F(log_test, rate_limit) {
+    int32_t delivered = 0;
+
+    proxyres_log_set_rate_limit(5);
+    for (int32_t i = 0; i < 100; i++)
+        log_printf(PROXYRES_LOG_LEVEL_ERROR, PROXYRES_LOG_CATEGORY_CONFIG, "flapping %d", i);
+    log_flush();
+
+    for (auto &message : messages) {
+        if (!strncmp(message.message.c_str(), "flapping", 8))
+            delivered++;
+    }
+
+    // Allow for the rate limiting window rolling over once during the loop
+    EXPECT_GE(delivered, 5);
+    EXPECT_LE(delivered, 10);
+}
+
+TEST_F(log_test, reset_defaults) {
+    proxyres_log_set_level(PROXYRES_LOG_CATEGORY_ALL, PROXYRES_LOG_LEVEL_NONE);
+    EXPECT_FALSE(log_is_enabled(PROXYRES_LOG_LEVEL_ERROR, PROXYRES_LOG_CATEGORY_GENERAL));
+    log_reset_defaults();
+    EXPECT_TRUE(log_is_enabled(PROXYRES_LOG_LEVEL_ERROR, PROXYRES_LOG_CATEGORY_GENERAL));
+}
+
+TEST_F(log_test, names) {
+    EXPECT_STREQ(proxyres_log_get_level_name(PROXYRES_LOG_LEVEL_ERROR), "ERROR");
+    EXPECT_STREQ(proxyres_log_get_level_name(PROXYRES_LOG_LEVEL_DEBUG), "DEBUG");
+    EXPECT_STREQ(proxyres_log_get_category_name(PROXYRES_LOG_CATEGORY_WPAD), "wpad");
+    EXPECT_STREQ(proxyres_log_get_category_name(PROXYRES_LOG_CATEGORY_COUNT), "unknown");
+}
@@ -6,6 +6,8 @@
 
 GTEST_API_ int main(int argc, char **argv) {
     int32_t error = 0;
+    // Before gtest or the library start any threads
+    proxyres_global_early_init();
     proxyres_global_init();
     testing::InitGoogleTest(&argc, argv);
     error = RUN_ALL_TESTS();
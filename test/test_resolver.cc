@@ -0,0 +1,329 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <gtest/gtest.h>
+
+#include "execute_dns.h"
+#include "pac_server.h"
+#include "resolver.h"
+#include "stats.h"
+
+static const char *script = R"(
+function FindProxyForURL(url, host) {
+  if (host == "simple.com") {
+    return "PROXY no-such-proxy:80";
+  }
+  return "DIRECT";
+})";
+
+TEST(resolver, instance_proxy) {
+    void *proxy_resolver = proxy_resolver_create();
+    ASSERT_NE(proxy_resolver, nullptr);
+    EXPECT_TRUE(proxy_resolver_set_proxy(proxy_resolver, "instance-proxy:8080"));
+    EXPECT_TRUE(proxy_resolver_set_bypass_list(proxy_resolver, "*.bypass.com"));
+
+    EXPECT_TRUE(proxy_resolver_get_proxies_for_url(proxy_resolver, "http://simple.com/"));
+    EXPECT_TRUE(proxy_resolver_wait(proxy_resolver, -1));
+    EXPECT_STREQ(proxy_resolver_get_list(proxy_resolver), "http://instance-proxy:8080");
+
+    EXPECT_TRUE(proxy_resolver_get_proxies_for_url(proxy_resolver, "http://www.bypass.com/"));
+    EXPECT_TRUE(proxy_resolver_wait(proxy_resolver, -1));
+    EXPECT_STREQ(proxy_resolver_get_list(proxy_resolver), "direct://");
+
+    proxy_resolver_delete(&proxy_resolver);
+}
+
+TEST(resolver, instance_auto_config_url) {
+    char auto_config_url[128];
+
+    void *pac_server = pac_server_create(script);
+    ASSERT_NE(pac_server, nullptr);
+    snprintf(auto_config_url, sizeof(auto_config_url), "http://127.0.0.1:%d/instance.pac",
+             (int)pac_server_get_port(pac_server));
+
+    // Resolvers using the same url share a single fetch of the PAC script
+    for (int32_t i = 0; i < 2; i++) {
+        void *proxy_resolver = proxy_resolver_create();
+        ASSERT_NE(proxy_resolver, nullptr);
+        if (!proxy_resolver_set_auto_config_url(proxy_resolver, auto_config_url)) {
+            proxy_resolver_delete(&proxy_resolver);
+            pac_server_delete(&pac_server);
+            GTEST_SKIP() << "Proxy auto config url per resolver instance not supported";
+        }
+        EXPECT_TRUE(proxy_resolver_get_proxies_for_url(proxy_resolver, "http://simple.com/"));
+        EXPECT_TRUE(proxy_resolver_wait(proxy_resolver, -1));
+        EXPECT_STREQ(proxy_resolver_get_list(proxy_resolver), "http://no-such-proxy:80");
+        proxy_resolver_delete(&proxy_resolver);
+    }
+    EXPECT_EQ(pac_server_get_request_count(pac_server), 1);
+
+    pac_server_delete(&pac_server);
+}
+
+TEST(resolver, create_ex_script) {
+    proxy_resolver_options_s options = {0};
+    options.script = script;
+
+    void *proxy_resolver = proxy_resolver_create_ex(&options);
+    if (!proxy_resolver)
+        GTEST_SKIP() << "Proxy auto config per resolver instance not supported";
+
+    EXPECT_TRUE(proxy_resolver_get_proxies_for_url(proxy_resolver, "http://simple.com/"));
+    EXPECT_TRUE(proxy_resolver_wait(proxy_resolver, -1));
+    EXPECT_STREQ(proxy_resolver_get_list(proxy_resolver), "http://no-such-proxy:80");
+
+    proxy_resolver_delete(&proxy_resolver);
+}
+
+TEST(resolver, create_ex_parallel) {
+    proxy_resolver_options_s options[2] = {{0}};
+    void *proxy_resolver[2] = {0};
+
+    // Resolvers with different settings do not affect each other
+    options[0].proxy = "first-proxy:8080";
+    options[1].proxy = "second-proxy:8080";
+    options[1].bypass_list = "simple.com";
+    for (int32_t i = 0; i < 2; i++) {
+        proxy_resolver[i] = proxy_resolver_create_ex(&options[i]);
+        ASSERT_NE(proxy_resolver[i], nullptr);
+    }
+    for (int32_t i = 0; i < 2; i++)
+        EXPECT_TRUE(proxy_resolver_get_proxies_for_url(proxy_resolver[i], "http://simple.com/"));
+    for (int32_t i = 0; i < 2; i++)
+        EXPECT_TRUE(proxy_resolver_wait(proxy_resolver[i], -1));
+
+    EXPECT_STREQ(proxy_resolver_get_list(proxy_resolver[0]), "http://first-proxy:8080");
+    EXPECT_STREQ(proxy_resolver_get_list(proxy_resolver[1]), "direct://");
+
+    for (int32_t i = 0; i < 2; i++)
+        proxy_resolver_delete(&proxy_resolver[i]);
+}
+
+TEST(resolver, create_ex_direct) {
+    proxy_resolver_options_s options = {0};
+
+    // No settings and no system config results in a direct connection
+    void *proxy_resolver = proxy_resolver_create_ex(&options);
+    ASSERT_NE(proxy_resolver, nullptr);
+    EXPECT_TRUE(proxy_resolver_get_proxies_for_url(proxy_resolver, "http://simple.com/"));
+    EXPECT_TRUE(proxy_resolver_wait(proxy_resolver, -1));
+    EXPECT_STREQ(proxy_resolver_get_list(proxy_resolver), "direct://");
+    proxy_resolver_delete(&proxy_resolver);
+}
+
+TEST(resolver, try_get_proxies_fast) {
+    proxy_resolver_options_s options = {0};
+    char list[MAX_PROXY_URL];
+
+    options.proxy = "instance-proxy:8080";
+    options.bypass_list = "*.bypass.com";
+    void *proxy_resolver = proxy_resolver_create_ex(&options);
+    ASSERT_NE(proxy_resolver, nullptr);
+
+    EXPECT_EQ(proxy_resolver_try_get_proxies_fast(proxy_resolver, "http://simple.com/", list, sizeof(list)),
+              PROXY_RESOLVER_FAST_OK);
+    EXPECT_STREQ(list, "http://instance-proxy:8080");
+    EXPECT_EQ(proxy_resolver_try_get_proxies_fast(proxy_resolver, "http://www.bypass.com/", list, sizeof(list)),
+              PROXY_RESOLVER_FAST_OK);
+    EXPECT_STREQ(list, "direct://");
+    EXPECT_EQ(proxy_resolver_try_get_proxies_fast(proxy_resolver, "http://simple.com/", list, 8),
+              PROXY_RESOLVER_FAST_BUFFER_TOO_SMALL);
+    proxy_resolver_delete(&proxy_resolver);
+
+    // No settings and no system config results in a direct connection
+    memset(&options, 0, sizeof(options));
+    proxy_resolver = proxy_resolver_create_ex(&options);
+    ASSERT_NE(proxy_resolver, nullptr);
+    EXPECT_EQ(proxy_resolver_try_get_proxies_fast(proxy_resolver, "http://simple.com/", list, sizeof(list)),
+              PROXY_RESOLVER_FAST_OK);
+    EXPECT_STREQ(list, "direct://");
+    proxy_resolver_delete(&proxy_resolver);
+}
+
+TEST(resolver, try_get_proxies_fast_needs_async) {
+    proxy_resolver_options_s options = {0};
+    char list[MAX_PROXY_URL];
+
+    options.script = script;
+    void *proxy_resolver = proxy_resolver_create_ex(&options);
+    if (!proxy_resolver)
+        GTEST_SKIP() << "Proxy auto config per resolver instance not supported";
+
+    // Scripts are never evaluated synchronously
+    EXPECT_EQ(proxy_resolver_try_get_proxies_fast(proxy_resolver, "http://simple.com/", list, sizeof(list)),
+              PROXY_RESOLVER_FAST_NEEDS_ASYNC);
+    proxy_resolver_delete(&proxy_resolver);
+}
+
+TEST(resolver, reuse_after_delete) {
+    proxy_resolver_options_s options = {0};
+
+    proxyres_stats_s stats;
+    uint64_t resolver_reuses = 0;
+
+    options.script = script;
+    for (int32_t i = 0; i < 2; i++) {
+        ASSERT_TRUE(proxyres_get_stats(&stats));
+        resolver_reuses = stats.resolver_reuses;
+        void *proxy_resolver = proxy_resolver_create_ex(&options);
+        if (!proxy_resolver)
+            GTEST_SKIP() << "Proxy auto config per resolver instance not supported";
+
+        // Instance deleted in the previous iteration is taken from the pool instead of creating a new one
+        ASSERT_TRUE(proxyres_get_stats(&stats));
+        if (i > 0)
+            EXPECT_EQ(stats.resolver_reuses, resolver_reuses + 1);
+
+        // Each resolution waits for its own result rather than completing with the previous one
+        EXPECT_TRUE(proxy_resolver_get_proxies_for_url(proxy_resolver, "http://simple.com/"));
+        EXPECT_TRUE(proxy_resolver_wait(proxy_resolver, -1));
+        EXPECT_STREQ(proxy_resolver_get_list(proxy_resolver), "http://no-such-proxy:80");
+        EXPECT_TRUE(proxy_resolver_get_proxies_for_url(proxy_resolver, "http://other.com/"));
+        EXPECT_TRUE(proxy_resolver_wait(proxy_resolver, -1));
+        EXPECT_STREQ(proxy_resolver_get_list(proxy_resolver), "direct://");
+        proxy_resolver_delete(&proxy_resolver);
+        EXPECT_EQ(proxy_resolver, nullptr);
+    }
+
+    // Reused instances do not keep the config of the deleted instance
+    memset(&options, 0, sizeof(options));
+    ASSERT_TRUE(proxyres_get_stats(&stats));
+    resolver_reuses = stats.resolver_reuses;
+    void *proxy_resolver = proxy_resolver_create_ex(&options);
+    ASSERT_NE(proxy_resolver, nullptr);
+    ASSERT_TRUE(proxyres_get_stats(&stats));
+    EXPECT_EQ(stats.resolver_reuses, resolver_reuses + 1);
+    EXPECT_TRUE(proxy_resolver_get_proxies_for_url(proxy_resolver, "http://simple.com/"));
+    EXPECT_TRUE(proxy_resolver_wait(proxy_resolver, -1));
+    EXPECT_STREQ(proxy_resolver_get_list(proxy_resolver), "direct://");
+    proxy_resolver_delete(&proxy_resolver);
+}
+
+TEST(resolver, coalesce_identical) {
+    proxy_resolver_options_s options = {0};
+    void *proxy_resolver[8] = {0};
+    proxyres_stats_s stats;
+    char auto_config_url[128];
+
+    // Script is not served until all resolutions have started so that they can't complete before the last one starts
+    void *pac_server = pac_server_create(script);
+    ASSERT_NE(pac_server, nullptr);
+    ASSERT_TRUE(pac_server_hold(pac_server));
+    snprintf(auto_config_url, sizeof(auto_config_url), "http://127.0.0.1:%d/coalesce.pac",
+             (int)pac_server_get_port(pac_server));
+    options.auto_config_url = auto_config_url;
+
+    proxyres_reset_stats();
+    for (int32_t i = 0; i < 8; i++) {
+        proxy_resolver[i] = proxy_resolver_create_ex(&options);
+        if (!proxy_resolver[i]) {
+            pac_server_delete(&pac_server);
+            GTEST_SKIP() << "Proxy auto config url per resolver instance not supported";
+        }
+        EXPECT_TRUE(proxy_resolver_get_proxies_for_url(proxy_resolver[i], "http://simple.com/"));
+    }
+    EXPECT_TRUE(pac_server_release(pac_server));
+    for (int32_t i = 0; i < 8; i++) {
+        EXPECT_TRUE(proxy_resolver_wait(proxy_resolver[i], -1));
+        EXPECT_STREQ(proxy_resolver_get_list(proxy_resolver[i]), "http://no-such-proxy:80");
+        proxy_resolver_delete(&proxy_resolver[i]);
+    }
+    EXPECT_EQ(pac_server_get_request_count(pac_server), 1);
+    pac_server_delete(&pac_server);
+
+    ASSERT_TRUE(proxyres_get_stats(&stats));
+    if (!stats.pac_execute_time.count)
+        GTEST_SKIP() << "Resolutions are not coalesced by underlying resolver";
+    EXPECT_EQ(stats.pac_execute_time.count, 1);
+    EXPECT_EQ(stats.coalesced_requests, 7);
+}
+
+TEST(resolver, memoize_result) {
+    proxy_resolver_options_s options = {0};
+    proxyres_stats_s stats;
+    char url[64];
+
+    // Script only depends on the host and has nothing that changes over time
+    options.script = R"(
+function FindProxyForURL(url, host) {
+  if (dnsDomainIs(host, "simple.com")) {
+    return "PROXY no-such-proxy:80";
+  }
+  return "DIRECT";
+})";
+
+    proxyres_reset_stats();
+    for (int32_t i = 0; i < 2; i++) {
+        void *proxy_resolver = proxy_resolver_create_ex(&options);
+        if (!proxy_resolver)
+            GTEST_SKIP() << "Proxy auto config per resolver instance not supported";
+        snprintf(url, sizeof(url), "http://simple.com/memo%d", (int)i);
+        EXPECT_TRUE(proxy_resolver_get_proxies_for_url(proxy_resolver, url));
+        EXPECT_TRUE(proxy_resolver_wait(proxy_resolver, -1));
+        EXPECT_STREQ(proxy_resolver_get_list(proxy_resolver), "http://no-such-proxy:80");
+        proxy_resolver_delete(&proxy_resolver);
+    }
+
+    ASSERT_TRUE(proxyres_get_stats(&stats));
+    if (!stats.pac_execute_time.count)
+        GTEST_SKIP() << "Resolutions are not memoized by underlying resolver";
+    EXPECT_EQ(stats.pac_execute_time.count, 1);
+    EXPECT_EQ(stats.memoized_requests, 1);
+
+    // Results of scripts that read the current time are never reused
+    options.script = R"(
+function FindProxyForURL(url, host) {
+  if (new Date().getFullYear() > 2000) {
+    return "PROXY no-such-proxy:80";
+  }
+  return "DIRECT";
+})";
+
+    proxyres_reset_stats();
+    for (int32_t i = 0; i < 2; i++) {
+        void *proxy_resolver = proxy_resolver_create_ex(&options);
+        ASSERT_NE(proxy_resolver, nullptr);
+        EXPECT_TRUE(proxy_resolver_get_proxies_for_url(proxy_resolver, "http://simple.com/"));
+        EXPECT_TRUE(proxy_resolver_wait(proxy_resolver, -1));
+        proxy_resolver_delete(&proxy_resolver);
+    }
+
+    ASSERT_TRUE(proxyres_get_stats(&stats));
+    EXPECT_EQ(stats.pac_execute_time.count, 2);
+    EXPECT_EQ(stats.memoized_requests, 0);
+}
+
+TEST(resolver, dns_restart) {
+    proxy_resolver_options_s options = {0};
+    proxyres_stats_s stats;
+
+    // Script is run again once both host names have been resolved, later resolutions use the same answers
+    options.script = R"(
+function FindProxyForURL(url, host) {
+  var local = dnsResolve("localhost");
+  var loopback = dnsResolve("127.0.0.1");
+  if (local && loopback) {
+    return "PROXY dns-proxy:80";
+  }
+  return "DIRECT";
+})";
+
+    execute_dns_clear();
+    proxyres_reset_stats();
+    for (int32_t i = 0; i < 2; i++) {
+        void *proxy_resolver = proxy_resolver_create_ex(&options);
+        if (!proxy_resolver)
+            GTEST_SKIP() << "Proxy auto config per resolver instance not supported";
+        EXPECT_TRUE(proxy_resolver_get_proxies_for_url(proxy_resolver, "http://simple.com/"));
+        EXPECT_TRUE(proxy_resolver_wait(proxy_resolver, -1));
+        EXPECT_STREQ(proxy_resolver_get_list(proxy_resolver), "http://dns-proxy:80");
+        proxy_resolver_delete(&proxy_resolver);
+    }
+
+    ASSERT_TRUE(proxyres_get_stats(&stats));
+    if (!stats.pac_execute_time.count)
+        GTEST_SKIP() << "Proxy auto config is not executed in this process";
+    EXPECT_EQ(stats.pac_dns_restarts, 1);
+}
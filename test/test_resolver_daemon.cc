@@ -0,0 +1,182 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "config.h"
+#include "resolver.h"
+#include "resolver_config.h"
+#include "resolver_i.h"
+#include "resolver_daemon.h"
+
+// Resolver daemon that answers a batch of requests in reverse order, then closes the connection
+class resolver_daemon : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        snprintf(address.sun_path, sizeof(address.sun_path), "/tmp/proxyres-test-%d.sock", (int)getpid());
+        address.sun_family = AF_UNIX;
+        unlink(address.sun_path);
+        listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        ASSERT_GE(listen_fd, 0);
+        ASSERT_EQ(bind(listen_fd, (struct sockaddr *)&address, sizeof(address)), 0);
+        ASSERT_EQ(listen(listen_fd, 1), 0);
+        setenv("PROXYRES_DAEMON_SOCKET", address.sun_path, 1);
+    }
+    void TearDown() override {
+        proxy_resolver_daemon_global_cleanup();
+        if (server.joinable())
+            server.join();
+        unsetenv("PROXYRES_DAEMON_SOCKET");
+        if (listen_fd >= 0)
+            close(listen_fd);
+        unlink(address.sun_path);
+    }
+    void Serve(size_t batch_size) {
+        server = std::thread([this, batch_size]() {
+            int fd = accept(listen_fd, NULL, NULL);
+            // Refuse connections once the first client has connected
+            close(listen_fd);
+            listen_fd = -1;
+            if (fd < 0)
+                return;
+            std::string buffer;
+            std::vector<std::string> ids;
+            char chunk[1024];
+            while (ids.size() < batch_size) {
+                ssize_t bytes_read = recv(fd, chunk, sizeof(chunk), 0);
+                if (bytes_read <= 0)
+                    break;
+                buffer.append(chunk, bytes_read);
+                size_t line_end = 0;
+                while ((line_end = buffer.find('\n')) != std::string::npos) {
+                    requests.push_back(buffer.substr(0, line_end));
+                    ids.push_back(buffer.substr(0, buffer.find(' ')));
+                    buffer.erase(0, line_end + 1);
+                }
+            }
+            for (auto id = ids.rbegin(); id != ids.rend(); id++) {
+                std::string response = *id + " 0 http://daemon-proxy-" + *id + ":8080\n";
+                send(fd, response.c_str(), response.size(), MSG_NOSIGNAL);
+            }
+            close(fd);
+        });
+    }
+
+    struct sockaddr_un address = {};
+    int listen_fd = -1;
+    std::thread server;
+    // Request lines received by the resolver daemon
+    std::vector<std::string> requests;
+};
+
+TEST_F(resolver_daemon, not_running) {
+    // Socket exists but nothing is accepting connections
+    close(listen_fd);
+    listen_fd = -1;
+    EXPECT_FALSE(proxy_resolver_daemon_global_init());
+}
+
+TEST_F(resolver_daemon, pipelined_requests) {
+    const proxy_resolver_i_s *proxy_resolver_i = proxy_resolver_daemon_get_interface();
+    void *proxy_resolver[3] = {0};
+
+    Serve(3);
+    ASSERT_TRUE(proxy_resolver_daemon_global_init());
+
+    // Responses are matched to requests even when they arrive in a different order
+    for (int32_t i = 0; i < 3; i++) {
+        proxy_resolver[i] = proxy_resolver_i->create();
+        ASSERT_NE(proxy_resolver[i], nullptr);
+        EXPECT_TRUE(proxy_resolver_i->get_proxies_for_url(proxy_resolver[i], "http://simple.com/"));
+    }
+    for (int32_t i = 0; i < 3; i++) {
+        char expected[64];
+        snprintf(expected, sizeof(expected), "http://daemon-proxy-%d:8080", i + 1);
+        EXPECT_TRUE(proxy_resolver_i->wait(proxy_resolver[i], 5000));
+        EXPECT_EQ(proxy_resolver_i->get_error(proxy_resolver[i]), 0);
+        EXPECT_STREQ(proxy_resolver_i->get_list(proxy_resolver[i]), expected);
+        proxy_resolver_i->f_delete(&proxy_resolver[i]);
+    }
+}
+
+TEST_F(resolver_daemon, connection_closed) {
+    const proxy_resolver_i_s *proxy_resolver_i = proxy_resolver_daemon_get_interface();
+
+    Serve(1);
+    ASSERT_TRUE(proxy_resolver_daemon_global_init());
+
+    void *answered = proxy_resolver_i->create();
+    ASSERT_NE(answered, nullptr);
+    EXPECT_TRUE(proxy_resolver_i->get_proxies_for_url(answered, "http://simple.com/"));
+    EXPECT_TRUE(proxy_resolver_i->wait(answered, 5000));
+    EXPECT_STREQ(proxy_resolver_i->get_list(answered), "http://daemon-proxy-1:8080");
+
+    // Requests fail once the resolver daemon goes away
+    void *failed = proxy_resolver_i->create();
+    ASSERT_NE(failed, nullptr);
+    proxy_resolver_i->get_proxies_for_url(failed, "http://simple.com/");
+    EXPECT_TRUE(proxy_resolver_i->wait(failed, 5000));
+    EXPECT_NE(proxy_resolver_i->get_error(failed), 0);
+    EXPECT_EQ(proxy_resolver_i->get_list(failed), nullptr);
+
+    proxy_resolver_i->f_delete(&answered);
+    proxy_resolver_i->f_delete(&failed);
+}
+
+TEST_F(resolver_daemon, system_auto_config_url) {
+    const proxy_resolver_i_s *proxy_resolver_i = proxy_resolver_daemon_get_interface();
+
+    Serve(1);
+    ASSERT_TRUE(proxy_resolver_daemon_global_init());
+
+    // Resolver daemon uses the client's auto config url instead of its own system config
+    proxy_config_set_auto_config_url_override("http://127.0.0.1/wpad.dat");
+    void *proxy_resolver = proxy_resolver_i->create();
+    ASSERT_NE(proxy_resolver, nullptr);
+    EXPECT_TRUE(proxy_resolver_i->get_proxies_for_url(proxy_resolver, "http://simple.com/"));
+    EXPECT_TRUE(proxy_resolver_i->wait(proxy_resolver, 5000));
+    proxy_config_set_auto_config_url_override(NULL);
+    server.join();
+
+    ASSERT_EQ(requests.size(), 1u);
+    EXPECT_EQ(requests[0], "1 http://simple.com/ http://127.0.0.1/wpad.dat");
+    proxy_resolver_i->f_delete(&proxy_resolver);
+}
+
+TEST_F(resolver_daemon, script_resolved_in_process) {
+    const proxy_resolver_i_s *proxy_resolver_i = proxy_resolver_daemon_get_interface();
+    proxy_resolver_options_s options = {0};
+
+    Serve(1);
+    ASSERT_TRUE(proxy_resolver_daemon_global_init());
+
+    // Scripts can't be sent to the resolver daemon so they are evaluated in-process
+    options.script = R"(function FindProxyForURL(url, host) { return "PROXY no-such-proxy:80"; })";
+    proxy_resolver_config_s *config = proxy_resolver_config_create(&options);
+    ASSERT_NE(config, nullptr);
+    void *proxy_resolver = proxy_resolver_i->create();
+    ASSERT_NE(proxy_resolver, nullptr);
+    EXPECT_TRUE(proxy_resolver_i->set_config(proxy_resolver, config));
+    proxy_resolver_config_release(&config);
+
+    proxy_resolver_i->get_proxies_for_url(proxy_resolver, "http://simple.com/");
+    EXPECT_TRUE(proxy_resolver_i->wait(proxy_resolver, 5000));
+    EXPECT_EQ(proxy_resolver_i->get_error(proxy_resolver), 0);
+    EXPECT_STREQ(proxy_resolver_i->get_list(proxy_resolver), "http://no-such-proxy:80");
+    proxy_resolver_i->f_delete(&proxy_resolver);
+
+    proxy_resolver_daemon_global_cleanup();
+    server.join();
+    EXPECT_TRUE(requests.empty());
+}
@@ -0,0 +1,245 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "execute.h"
+#include "pac_server.h"
+#include "script_store.h"
+
+static const char *script = "function FindProxyForURL(url, host) { return \"DIRECT\"; }";
+
+TEST(script_store, acquire) {
+    char auto_config_url[2][128];
+    void *entries[3] = {0};
+    proxy_execute_analysis_s analysis;
+    uint64_t generation[2] = {0};
+    int32_t error = 0;
+
+    void *pac_server = pac_server_create(script);
+    ASSERT_NE(pac_server, nullptr);
+    for (int32_t i = 0; i < 2; i++) {
+        snprintf(auto_config_url[i], sizeof(auto_config_url[i]), "http://127.0.0.1:%d/store%d.pac",
+                 (int)pac_server_get_port(pac_server), (int)i);
+    }
+
+    script_store_clear();
+    EXPECT_FALSE(script_store_get_analysis(auto_config_url[0], &analysis, &generation[0]));
+
+    // Same url is only fetched once and shares the same script
+    entries[0] = script_store_acquire(auto_config_url[0], &error);
+    entries[1] = script_store_acquire(auto_config_url[0], &error);
+    ASSERT_NE(entries[0], nullptr);
+    ASSERT_NE(entries[1], nullptr);
+    EXPECT_EQ(error, 0);
+    EXPECT_EQ(script_store_get_script(entries[0]), script_store_get_script(entries[1]));
+    EXPECT_STREQ(script_store_get_script(entries[0]), script);
+    EXPECT_EQ(pac_server_get_request_count(pac_server), 1);
+
+    // Script is analyzed when stored
+    ASSERT_TRUE(script_store_get_analysis(auto_config_url[0], &analysis, &generation[0]));
+    EXPECT_EQ(analysis.memo_key, PROXY_EXECUTE_MEMO_KEY_HOST);
+
+    // Different url is fetched separately and in a different generation
+    entries[2] = script_store_acquire(auto_config_url[1], &error);
+    ASSERT_NE(entries[2], nullptr);
+    EXPECT_EQ(pac_server_get_request_count(pac_server), 2);
+    EXPECT_EQ(script_store_get_count(), 2);
+    ASSERT_TRUE(script_store_get_analysis(auto_config_url[1], &analysis, &generation[1]));
+    EXPECT_NE(generation[0], generation[1]);
+
+    // Scripts remain valid after being removed from the store until released
+    EXPECT_TRUE(script_store_clear());
+    EXPECT_EQ(script_store_get_count(), 0);
+    EXPECT_STREQ(script_store_get_script(entries[2]), script);
+
+    for (int32_t i = 0; i < 3; i++)
+        EXPECT_TRUE(script_store_release(&entries[i]));
+
+    pac_server_delete(&pac_server);
+}
+
+TEST(script_store, concurrent_miss) {
+    char auto_config_url[128];
+    void *entries[8] = {0};
+    int32_t errors[8] = {0};
+    std::vector<std::thread> threads;
+
+    void *pac_server = pac_server_create(script);
+    ASSERT_NE(pac_server, nullptr);
+    snprintf(auto_config_url, sizeof(auto_config_url), "http://127.0.0.1:%d/concurrent.pac",
+             (int)pac_server_get_port(pac_server));
+
+    script_store_clear();
+
+    // Only a single caller fetches the script while the others wait for it
+    for (int32_t i = 0; i < 8; i++) {
+        threads.emplace_back([&, i]() { entries[i] = script_store_acquire(auto_config_url, &errors[i]); });
+    }
+    for (auto &thread : threads)
+        thread.join();
+
+    EXPECT_EQ(pac_server_get_request_count(pac_server), 1);
+    for (int32_t i = 0; i < 8; i++) {
+        ASSERT_NE(entries[i], nullptr);
+        EXPECT_EQ(errors[i], 0);
+        EXPECT_EQ(script_store_get_script(entries[i]), script_store_get_script(entries[0]));
+    }
+    for (int32_t i = 0; i < 8; i++)
+        EXPECT_TRUE(script_store_release(&entries[i]));
+
+    script_store_clear();
+    pac_server_delete(&pac_server);
+}
+
+TEST(script_store, data_url) {
+    int32_t error = 0;
+
+    // Percent-encoded and base64 encoded scripts are decoded without any network request
+    void *entry = script_store_acquire("data:application/x-ns-proxy-autoconfig,function%20FindProxyForURL()%7B%7D",
+                                       &error);
+    ASSERT_NE(entry, nullptr);
+    EXPECT_STREQ(script_store_get_script(entry), "function FindProxyForURL(){}");
+    script_store_release(&entry);
+
+    entry = script_store_acquire(
+        "data:application/x-ns-proxy-autoconfig;base64,ZnVuY3Rpb24gRmluZFByb3h5Rm9yVVJMKCl7fQ==", &error);
+    ASSERT_NE(entry, nullptr);
+    EXPECT_STREQ(script_store_get_script(entry), "function FindProxyForURL(){}");
+    script_store_release(&entry);
+}
+
+static bool write_file(const char *path, const char *contents) {
+    FILE *file = fopen(path, "wb");
+    if (!file)
+        return false;
+    const bool is_ok = fwrite(contents, strlen(contents), 1, file) == 1;
+    return fclose(file) == 0 && is_ok;
+}
+
+TEST(script_store, file_url) {
+    char path[256];
+    char auto_config_url[300];
+    int32_t error = 0;
+
+    snprintf(path, sizeof(path), "%s/proxyres_test_%d.pac", testing::TempDir().c_str(), (int)rand());
+    snprintf(auto_config_url, sizeof(auto_config_url), "file://%s", path);
+    ASSERT_TRUE(write_file(path, "function FindProxyForURL() { return \"DIRECT\"; }"));
+
+    void *entry = script_store_acquire(auto_config_url, &error);
+    ASSERT_NE(entry, nullptr);
+    EXPECT_STREQ(script_store_get_script(entry), "function FindProxyForURL() { return \"DIRECT\"; }");
+    script_store_release(&entry);
+
+    // Changes to the file are picked up on next use
+    ASSERT_TRUE(write_file(path, "function FindProxyForURL() { return \"PROXY changed:80\"; }"));
+    entry = script_store_acquire(auto_config_url, &error);
+    ASSERT_NE(entry, nullptr);
+#ifdef __linux__
+    EXPECT_STREQ(script_store_get_script(entry), "function FindProxyForURL() { return \"PROXY changed:80\"; }");
+#endif
+    script_store_release(&entry);
+
+    remove(path);
+
+    EXPECT_EQ(script_store_acquire("file:///proxyres/no-such-file.pac", &error), nullptr);
+    EXPECT_NE(error, 0);
+}
+
+TEST(script_store, file_url_same_directory) {
+    char path[2][256];
+    char auto_config_url[2][300];
+    void *entry = NULL;
+    int32_t error = 0;
+
+    const int32_t id = (int32_t)rand();
+    for (int32_t i = 0; i < 2; i++) {
+        snprintf(path[i], sizeof(path[i]), "%s/proxyres_test_%d_%d.pac", testing::TempDir().c_str(), (int)id, (int)i);
+        snprintf(auto_config_url[i], sizeof(auto_config_url[i]), "file://%s", path[i]);
+        ASSERT_TRUE(write_file(path[i], "function FindProxyForURL() { return \"DIRECT\"; }"));
+        entry = script_store_acquire(auto_config_url[i], &error);
+        ASSERT_NE(entry, nullptr);
+        script_store_release(&entry);
+    }
+
+    // Reloading one script must not stop changes to the other script in the same directory from being noticed
+    ASSERT_TRUE(write_file(path[0], "function FindProxyForURL() { return \"PROXY first:80\"; }"));
+    entry = script_store_acquire(auto_config_url[0], &error);
+    ASSERT_NE(entry, nullptr);
+#ifdef __linux__
+    EXPECT_STREQ(script_store_get_script(entry), "function FindProxyForURL() { return \"PROXY first:80\"; }");
+#endif
+    script_store_release(&entry);
+
+    // Files replaced by rename are noticed as well as files written in place
+    char temp_path[300];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path[1]);
+    ASSERT_TRUE(write_file(temp_path, "function FindProxyForURL() { return \"PROXY second:80\"; }"));
+#ifdef _WIN32
+    remove(path[1]);
+#endif
+    ASSERT_EQ(rename(temp_path, path[1]), 0);
+    entry = script_store_acquire(auto_config_url[1], &error);
+    ASSERT_NE(entry, nullptr);
+#ifdef __linux__
+    EXPECT_STREQ(script_store_get_script(entry), "function FindProxyForURL() { return \"PROXY second:80\"; }");
+#endif
+    script_store_release(&entry);
+
+    script_store_clear();
+    for (int32_t i = 0; i < 2; i++)
+        remove(path[i]);
+}
+
+TEST(script_store, failure_cached) {
+    char dir[256];
+    char path[300];
+    char auto_config_url[320];
+    int32_t error = 0;
+
+    // Directory doesn't exist yet so the file can't be watched for changes
+    snprintf(dir, sizeof(dir), "%s/proxyres_missing_%d", testing::TempDir().c_str(), (int)rand());
+    snprintf(path, sizeof(path), "%s/proxy.pac", dir);
+    snprintf(auto_config_url, sizeof(auto_config_url), "file://%s", path);
+
+    // Failures are remembered so that the file isn't read again until the failure expires
+    script_store_clear();
+    EXPECT_EQ(script_store_acquire(auto_config_url, &error), nullptr);
+    EXPECT_NE(error, 0);
+
+#ifdef _WIN32
+    ASSERT_EQ(_mkdir(dir), 0);
+#else
+    ASSERT_EQ(mkdir(dir, 0700), 0);
+#endif
+    ASSERT_TRUE(write_file(path, script));
+    error = 0;
+    EXPECT_EQ(script_store_acquire(auto_config_url, &error), nullptr);
+    EXPECT_NE(error, 0);
+
+    script_store_clear();
+    void *entry = script_store_acquire(auto_config_url, &error);
+    ASSERT_NE(entry, nullptr);
+    EXPECT_STREQ(script_store_get_script(entry), script);
+    script_store_release(&entry);
+    script_store_clear();
+
+    remove(path);
+#ifdef _WIN32
+    _rmdir(dir);
+#else
+    rmdir(dir);
+#endif
+}
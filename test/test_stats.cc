@@ -0,0 +1,77 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <gtest/gtest.h>
+
+#include "stats.h"
+#include "stats_record.h"
+
+TEST(stats, record_time) {
+    proxyres_stats_s stats;
+
+    proxyres_reset_stats();
+    stats_record_time(STATS_PAC_EXECUTE_TIME, 0);
+    stats_record_time(STATS_PAC_EXECUTE_TIME, 1);
+    stats_record_time(STATS_PAC_EXECUTE_TIME, 3);
+    stats_record_time(STATS_PAC_EXECUTE_TIME, UINT32_MAX);
+
+    ASSERT_TRUE(proxyres_get_stats(&stats));
+    EXPECT_EQ(stats.pac_execute_time.count, 4);
+    EXPECT_EQ(stats.pac_execute_time.sum_us, (uint64_t)UINT32_MAX + 4);
+    EXPECT_EQ(stats.pac_execute_time.buckets[0], 1);
+    EXPECT_EQ(stats.pac_execute_time.buckets[1], 1);
+    EXPECT_EQ(stats.pac_execute_time.buckets[2], 1);
+    EXPECT_EQ(stats.pac_execute_time.buckets[PROXYRES_STATS_HISTOGRAM_BUCKETS - 1], 1);
+    EXPECT_EQ(stats.pac_fetch_time.count, 0);
+}
+
+TEST(stats, add_counter) {
+    proxyres_stats_s stats;
+
+    proxyres_reset_stats();
+    stats_add(STATS_CACHE_HITS, 2);
+    stats_add(STATS_CACHE_MISSES, 1);
+    stats_add(STATS_PAC_FETCH_BYTES, 1024);
+
+    ASSERT_TRUE(proxyres_get_stats(&stats));
+    EXPECT_EQ(stats.cache_hits, 2);
+    EXPECT_EQ(stats.cache_misses, 1);
+    EXPECT_EQ(stats.pac_fetch_bytes, 1024);
+}
+
+TEST(stats, record_error) {
+    proxyres_stats_s stats;
+
+    proxyres_reset_stats();
+    stats_record_error(-1);
+    stats_record_error(5);
+    stats_record_error(5);
+    for (int32_t i = 0; i < PROXYRES_STATS_MAX_ERRORS; i++)
+        stats_record_error(100 + i);
+
+    ASSERT_TRUE(proxyres_get_stats(&stats));
+    EXPECT_EQ(stats.errors[0].code, -1);
+    EXPECT_EQ(stats.errors[0].count, 1);
+    EXPECT_EQ(stats.errors[1].code, 5);
+    EXPECT_EQ(stats.errors[1].count, 2);
+    EXPECT_EQ(stats.errors_other, 2);
+}
+
+TEST(stats, prometheus) {
+    proxyres_stats_s stats;
+
+    proxyres_reset_stats();
+    stats_record_time(STATS_PAC_FETCH_TIME, 1000);
+    stats_record_error(110);
+
+    ASSERT_TRUE(proxyres_get_stats(&stats));
+    char *text = proxyres_stats_to_prometheus(&stats);
+    ASSERT_NE(text, nullptr);
+    EXPECT_NE(strstr(text, "# TYPE proxyres_pac_fetch_seconds histogram\n"), nullptr);
+    EXPECT_NE(strstr(text, "proxyres_pac_fetch_seconds_count 1\n"), nullptr);
+    EXPECT_NE(strstr(text, "proxyres_pac_fetch_seconds_bucket{le=\"+Inf\"} 1\n"), nullptr);
+    EXPECT_NE(strstr(text, "proxyres_errors_total{code=\"110\"} 1\n"), nullptr);
+    free(text);
+}
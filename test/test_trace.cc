@@ -0,0 +1,147 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "threadpool.h"
+#include "trace.h"
+#include "trace_record.h"
+
+typedef struct trace_event_s {
+    bool begin;
+    uint64_t request_id;
+    std::string name;
+    uint64_t time_us;
+} trace_event_s;
+
+static void trace_collect_begin(void *user_data, uint64_t request_id, const char *name, uint64_t time_us) {
+    std::vector<trace_event_s> *events = (std::vector<trace_event_s> *)user_data;
+    events->push_back({true, request_id, name, time_us});
+}
+
+static void trace_collect_end(void *user_data, uint64_t request_id, const char *name, uint64_t time_us) {
+    std::vector<trace_event_s> *events = (std::vector<trace_event_s> *)user_data;
+    events->push_back({false, request_id, name, time_us});
+}
+
+TEST(trace, callbacks) {
+    std::vector<trace_event_s> events;
+
+    proxyres_trace_set_callbacks(trace_collect_begin, trace_collect_end, &events);
+    trace_set_request_id(42);
+    trace_begin("outer");
+    trace_span("inner", 0);
+    trace_end("outer");
+    trace_set_request_id(0);
+    proxyres_trace_set_callbacks(NULL, NULL, NULL);
+
+    // Spans are not recorded once callbacks are removed
+    trace_begin("ignored");
+
+    ASSERT_EQ(events.size(), 4);
+    EXPECT_TRUE(events[0].begin);
+    EXPECT_STREQ(events[0].name.c_str(), "outer");
+    EXPECT_TRUE(events[1].begin);
+    EXPECT_STREQ(events[1].name.c_str(), "inner");
+    EXPECT_FALSE(events[2].begin);
+    EXPECT_STREQ(events[2].name.c_str(), "inner");
+    EXPECT_FALSE(events[3].begin);
+    EXPECT_STREQ(events[3].name.c_str(), "outer");
+    for (auto &event : events)
+        EXPECT_EQ(event.request_id, 42);
+    EXPECT_LE(events[0].time_us, events[3].time_us);
+}
+
+static std::atomic<int32_t> trace_mismatched(0);
+static int32_t trace_tag_a = 0, trace_tag_b = 0;
+
+static void trace_check_a(void *user_data, uint64_t request_id, const char *name, uint64_t time_us) {
+    if (user_data != &trace_tag_a)
+        trace_mismatched++;
+}
+
+static void trace_check_b(void *user_data, uint64_t request_id, const char *name, uint64_t time_us) {
+    if (user_data != &trace_tag_b)
+        trace_mismatched++;
+}
+
+TEST(trace, set_callbacks_while_tracing) {
+    std::atomic<bool> stop(false);
+
+    // Callbacks must always be invoked with the user data they were set with
+    std::thread tracer([&stop]() {
+        while (!stop)
+            trace_span("swap", 0);
+    });
+    for (int32_t i = 0; i < 1000; i++) {
+        if (i & 1)
+            proxyres_trace_set_callbacks(trace_check_a, trace_check_a, &trace_tag_a);
+        else
+            proxyres_trace_set_callbacks(trace_check_b, trace_check_b, &trace_tag_b);
+    }
+    stop = true;
+    tracer.join();
+    proxyres_trace_set_callbacks(NULL, NULL, NULL);
+
+    EXPECT_EQ(trace_mismatched, 0);
+}
+
+TEST(trace, request_id) {
+    const uint64_t first = trace_create_request_id();
+    const uint64_t second = trace_create_request_id();
+    EXPECT_NE(first, 0);
+    EXPECT_GT(second, first);
+}
+
+static void trace_job(void *arg) {
+    uint64_t *request_id = (uint64_t *)arg;
+    *request_id = trace_get_request_id();
+}
+
+TEST(trace, threadpool_request_id) {
+    uint64_t job_request_id = 0;
+
+    void *threadpool = threadpool_create(1, 1);
+    ASSERT_NE(threadpool, nullptr);
+
+    // Request id is carried from the thread that queued the job
+    trace_set_request_id(7);
+    threadpool_enqueue(threadpool, &job_request_id, trace_job);
+    trace_set_request_id(0);
+    threadpool_wait(threadpool);
+    threadpool_delete(&threadpool);
+
+    EXPECT_EQ(job_request_id, 7);
+}
+
+TEST(trace, json) {
+    char path[] = "proxyres_trace.json";
+    char contents[1024] = {0};
+
+    ASSERT_TRUE(proxyres_trace_start_json(path));
+    trace_set_request_id(3);
+    trace_begin("fetch_get");
+    trace_end("fetch_get");
+    trace_set_request_id(0);
+    ASSERT_TRUE(proxyres_trace_stop_json());
+    EXPECT_FALSE(proxyres_trace_stop_json());
+
+    FILE *file = fopen(path, "r");
+    ASSERT_NE(file, nullptr);
+    fread(contents, 1, sizeof(contents) - 1, file);
+    fclose(file);
+    remove(path);
+
+    EXPECT_EQ(contents[0], '[');
+    EXPECT_NE(strstr(contents, "\"name\":\"fetch_get\",\"cat\":\"proxyres\",\"ph\":\"B\""), nullptr);
+    EXPECT_NE(strstr(contents, "\"ph\":\"E\""), nullptr);
+    EXPECT_NE(strstr(contents, "\"request_id\":3"), nullptr);
+    EXPECT_NE(strstr(contents, "]\n"), nullptr);
+}
@@ -3,6 +3,10 @@
 #include <string.h>
 #include <stdlib.h>
 
+#include <atomic>
+#include <thread>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include "util.h"
@@ -158,6 +162,8 @@ constexpr should_bypass_list_param should_bypass_list_tests[] = {
     // Bypass due to url matches
     {"http://google.com/", "google.com", true},
     {"http://google.com/", "google.com,apple.com", true},
+    {"http://apple.com/", "google.com,apple.com", true},
+    {"http://apple.com/", "google.com, apple.com", true},
     // Bypass due to url matches with wildcard
     {"http://google.com/", "*google.com", true},
     {"http://google.com/", "google.com,apple.com", true},
@@ -207,6 +213,27 @@ TEST_P(util_should_bypass, list) {
     EXPECT_EQ(should_bypass_proxy(param.url, param.bypass_list), param.expected);
 }
 
+TEST(util, should_bypass_concurrent_lists) {
+    std::atomic<int32_t> mismatches(0);
+    std::vector<std::thread> threads;
+
+    // Compiled bypass list is reused between calls, so alternate lists from several threads
+    for (int32_t i = 0; i < 4; i++) {
+        threads.emplace_back([&mismatches, i]() {
+            const char *bypass_list = (i % 2) ? "*.example.com" : "*.example.org";
+            for (int32_t j = 0; j < 1000; j++) {
+                if (!should_bypass_proxy((i % 2) ? "http://www.example.com/" : "http://www.example.org/", bypass_list))
+                    mismatches++;
+                if (should_bypass_proxy("http://www.example.net/", bypass_list))
+                    mismatches++;
+            }
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+    EXPECT_EQ(mismatches, 0);
+}
+
 TEST(util, str_sep_dup) {
     const char *tokens = "hi;bye";
     const char **tokenp = &tokens;
@@ -226,4 +253,42 @@ TEST(util, str_sep_dup) {
     EXPECT_EQ(*tokenp, nullptr);
     char *third_token = str_sep_dup(tokenp, ";");
     EXPECT_EQ(third_token, nullptr);
-}
\ No newline at end of file
+}
+
+TEST(util, str_percent_decode) {
+    char *decoded = str_percent_decode("a%20b%2Fc%zz%4", 14);
+    ASSERT_NE(decoded, nullptr);
+    EXPECT_STREQ(decoded, "a b/c%zz%4");
+    free(decoded);
+
+    decoded = str_percent_decode("%41BCD", 4);
+    ASSERT_NE(decoded, nullptr);
+    EXPECT_STREQ(decoded, "AB");
+    free(decoded);
+}
+
+TEST(util, str_base64_decode) {
+    size_t decoded_len = 0;
+    char *decoded = str_base64_decode("aGVsbG8gd29y\nbGQ=", 18, &decoded_len);
+    ASSERT_NE(decoded, nullptr);
+    EXPECT_STREQ(decoded, "hello world");
+    EXPECT_EQ(decoded_len, 11);
+    free(decoded);
+
+    EXPECT_EQ(str_base64_decode("aGV*bG8=", 8, NULL), nullptr);
+}
+
+TEST(util, hash_fnv1a) {
+    EXPECT_EQ(hash_fnv1a("", 0, HASH_FNV1A_INIT), HASH_FNV1A_INIT);
+    EXPECT_EQ(hash_fnv1a("a", 1, HASH_FNV1A_INIT), 0xaf63dc4c8601ec8cULL);
+    EXPECT_EQ(hash_fnv1a("foobar", 6, HASH_FNV1A_INIT), 0x85944171f73967e8ULL);
+    // Hashing in parts is the same as hashing all at once
+    EXPECT_EQ(hash_fnv1a("bar", 3, hash_fnv1a("foo", 3, HASH_FNV1A_INIT)), 0x85944171f73967e8ULL);
+}
+
+TEST(util, hash_xxh64) {
+    EXPECT_EQ(hash_xxh64("", 0, 0), 0xef46db3751d8e999ULL);
+    EXPECT_EQ(hash_xxh64("a", 1, 0), 0xd24ec4f1a98c6e5bULL);
+    EXPECT_EQ(hash_xxh64("abc", 3, 0), 0x44bc2cf5ad770999ULL);
+    EXPECT_EQ(hash_xxh64("Nobody inspects the spammish repetition", 39, 0), 0xfbcea83c8a378bf1ULL);
+}
@@ -59,4 +59,28 @@ TEST_P(util_config, get_value) {
     } else {
         EXPECT_EQ(value, param.expected);
     }
-}
\ No newline at end of file
+}
+
+TEST_P(util_config, table_get_value) {
+    const auto &param = GetParam();
+    void *table = config_table_create(config);
+    ASSERT_NE(table, nullptr);
+    const char *value = config_table_get_value(table, param.section, param.key);
+    if (value)
+        EXPECT_STREQ(value, param.expected);
+    else
+        EXPECT_EQ(value, param.expected);
+    config_table_delete(&table);
+}
+
+TEST(util, config_table_whitespace) {
+    void *table = config_table_create("top=level\r\n[ Section ]\r\n; comment=ignored\r\n  key = value with spaces  \r\n"
+                                      "key=duplicate\r\n[Other]\r\nkey=other");
+    ASSERT_NE(table, nullptr);
+    EXPECT_STREQ(config_table_get_value(table, "", "top"), "level");
+    EXPECT_STREQ(config_table_get_value(table, " Section ", "key"), "value with spaces");
+    EXPECT_STREQ(config_table_get_value(table, "Other", "key"), "other");
+    EXPECT_EQ(config_table_get_value(table, " Section ", "; comment"), nullptr);
+    EXPECT_EQ(config_table_get_value(table, "Missing", "key"), nullptr);
+    config_table_delete(&table);
+}
@@ -2,11 +2,13 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
 
 #ifdef _WIN32
 #include <winsock2.h>
 #include <ws2tcpip.h>
 #include <windows.h>
+#include <direct.h>
 #else
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -17,6 +19,7 @@
 #include <gtest/gtest.h>
 
 #include "net_adapter.h"
+#include "wpad_cache.h"
 #include "wpad_dhcp.h"
 #include "wpad_dhcp_posix.h"
 #include "wpad_dns.h"
@@ -66,3 +69,50 @@ TEST(wpad, dns) {
         EXPECT_STREQ(wpad, "http://wpad.com/wpad.dat");
     free(wpad);*/
 }
+
+TEST(wpad, cache) {
+    const char *script = "function FindProxyForURL(url, host) { return \"DIRECT\"; }";
+    char *auto_config_url = NULL;
+    char *cached_script = NULL;
+    time_t fetch_time = 0;
+    char cache_dir[512];
+    char cache_path[600];
+
+    snprintf(cache_dir, sizeof(cache_dir), "%s/proxyres_wpad_cache_%d", testing::TempDir().c_str(), (int)rand());
+    snprintf(cache_path, sizeof(cache_path), "%s/wpad.cache", cache_dir);
+
+    ASSERT_TRUE(wpad_cache_set_dir(true, cache_dir));
+    EXPECT_TRUE(wpad_cache_is_enabled());
+    EXPECT_TRUE(wpad_cache_save(1234, "http://wpad.com/wpad.dat", script, 5678));
+
+    // Cache is only trusted on the same network
+    EXPECT_FALSE(wpad_cache_load(4321, &auto_config_url, &cached_script, &fetch_time));
+
+    ASSERT_TRUE(wpad_cache_load(1234, &auto_config_url, &cached_script, &fetch_time));
+    EXPECT_STREQ(auto_config_url, "http://wpad.com/wpad.dat");
+    EXPECT_STREQ(cached_script, script);
+    EXPECT_EQ(fetch_time, 5678);
+    free(auto_config_url);
+    free(cached_script);
+
+    // Script discovered using DNS has no url
+    EXPECT_TRUE(wpad_cache_save(1234, NULL, script, 5678));
+    ASSERT_TRUE(wpad_cache_load(1234, &auto_config_url, &cached_script, &fetch_time));
+    EXPECT_EQ(auto_config_url, nullptr);
+    EXPECT_STREQ(cached_script, script);
+    free(cached_script);
+
+    remove(cache_path);
+#ifdef _WIN32
+    _rmdir(cache_dir);
+#else
+    rmdir(cache_dir);
+#endif
+    EXPECT_FALSE(wpad_cache_load(1234, &auto_config_url, &cached_script, &fetch_time));
+    EXPECT_TRUE(wpad_cache_set_dir(false, NULL));
+    EXPECT_FALSE(wpad_cache_is_enabled());
+}
+
+TEST(wpad, cache_fingerprint) {
+    EXPECT_EQ(wpad_cache_get_network_fingerprint(), wpad_cache_get_network_fingerprint());
+}
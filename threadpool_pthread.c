@@ -7,8 +7,12 @@
 
 #include <pthread.h>
 
+#define LOG_CATEGORY PROXYRES_LOG_CATEGORY_THREADPOOL
+
 #include "log.h"
+#include "stats_record.h"
 #include "threadpool.h"
+#include "trace_record.h"
 
 #ifdef __APPLE__
 #  include <objc/message.h>
@@ -17,6 +21,8 @@
 typedef struct threadpool_job_s {
     void *user_data;
     threadpool_job_cb callback;
+    uint64_t enqueue_time_us;
+    uint64_t request_id;
     struct threadpool_job_s *next;
 } threadpool_job_s;
 
@@ -48,6 +54,8 @@ static threadpool_job_s *threadpool_job_create(void *user_data, threadpool_job_c
         return NULL;
     job->user_data = user_data;
     job->callback = callback;
+    job->enqueue_time_us = stats_get_time_us();
+    job->request_id = trace_get_request_id();
     job->next = NULL;
     return job;
 }
@@ -117,6 +125,10 @@ static void *threadpool_do_work(void *arg) {
 
         // Do the job
         if (job) {
+            stats_record_since(STATS_THREADPOOL_QUEUE_WAIT, job->enqueue_time_us);
+            trace_set_request_id(job->request_id);
+            trace_span("threadpool_dequeue", job->enqueue_time_us);
+
 #ifdef __APPLE__
             // The implicit thread autorelease pool on macOS doesn’t drain until the thread terminates, and long-lived
             // threads can run out of memory. Thus, create and drain the autorelease pool for every job callback.
@@ -131,7 +143,9 @@ static void *threadpool_do_work(void *arg) {
 
             LOG_DEBUG("threadpool - worker 0x%" PRIx64 " - processing job 0x%" PRIxPTR "\n", (uint64_t)pthread_self(),
                       (intptr_t)job);
+            trace_begin("threadpool_run");
             job->callback(job->user_data);
+            trace_end("threadpool_run");
             LOG_DEBUG("threadpool - worker 0x%" PRIx64 " - job complete 0x%" PRIxPTR "\n", (uint64_t)pthread_self(),
                       (intptr_t)job);
 
@@ -140,6 +154,7 @@ static void *threadpool_do_work(void *arg) {
             ((drain)objc_msgSend)(autorelease_pool, sel_getUid("drain"));
 #endif
 
+            trace_set_request_id(0);
             threadpool_job_delete(&job);
         }
 
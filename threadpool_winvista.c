@@ -6,15 +6,21 @@
 
 #include <windows.h>
 
+#define LOG_CATEGORY PROXYRES_LOG_CATEGORY_THREADPOOL
+
 #include "log.h"
 #include "mutex.h"
+#include "stats_record.h"
 #include "threadpool.h"
+#include "trace_record.h"
 #include "util.h"
 
 typedef struct threadpool_job_s {
     PTP_WORK handle;
     void *user_data;
     threadpool_job_cb callback;
+    uint64_t enqueue_time_us;
+    uint64_t request_id;
     struct threadpool_s *pool;
     struct threadpool_job_s *next;
     struct threadpool_job_s *prev;
@@ -35,6 +41,8 @@ static threadpool_job_s *threadpool_job_create(void *user_data, threadpool_job_c
         return NULL;
     job->user_data = user_data;
     job->callback = callback;
+    job->enqueue_time_us = stats_get_time_us();
+    job->request_id = trace_get_request_id();
     job->next = NULL;
     return job;
 }
@@ -89,9 +97,15 @@ VOID CALLBACK threadpool_job_callback(PTP_CALLBACK_INSTANCE instance, PVOID cont
         return;
 
     // Do the job
+    stats_record_since(STATS_THREADPOOL_QUEUE_WAIT, job->enqueue_time_us);
+    trace_set_request_id(job->request_id);
+    trace_span("threadpool_dequeue", job->enqueue_time_us);
     LOG_DEBUG("threadpool - worker 0x%" PRIxPTR " - processing job 0x%" PRIxPTR "\n", (intptr_t)work, (intptr_t)job);
+    trace_begin("threadpool_run");
     job->callback(job->user_data);
+    trace_end("threadpool_run");
     LOG_DEBUG("threadpool - worker 0x%" PRIxPTR " - job complete 0x%" PRIxPTR "\n", (intptr_t)work, (intptr_t)job);
+    trace_set_request_id(0);
 
     // Remove job from job queue
     threadpool_s *threadpool = job->pool;
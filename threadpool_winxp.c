@@ -9,14 +9,20 @@
 #include <windows.h>
 #include <process.h>
 
+#define LOG_CATEGORY PROXYRES_LOG_CATEGORY_THREADPOOL
+
 #include "event.h"
 #include "log.h"
 #include "mutex.h"
+#include "stats_record.h"
 #include "threadpool.h"
+#include "trace_record.h"
 
 typedef struct threadpool_job_s {
     void *user_data;
     threadpool_job_cb callback;
+    uint64_t enqueue_time_us;
+    uint64_t request_id;
     struct threadpool_job_s *next;
 } threadpool_job_s;
 
@@ -48,6 +54,8 @@ static threadpool_job_s *threadpool_job_create(void *user_data, threadpool_job_c
         return NULL;
     job->user_data = user_data;
     job->callback = callback;
+    job->enqueue_time_us = stats_get_time_us();
+    job->request_id = trace_get_request_id();
     job->next = NULL;
     return job;
 }
@@ -120,11 +128,18 @@ static void __cdecl threadpool_do_work(void *arg) {
 
         // Do the job
         if (job) {
+            stats_record_since(STATS_THREADPOOL_QUEUE_WAIT, job->enqueue_time_us);
+            trace_set_request_id(job->request_id);
+            trace_span("threadpool_dequeue", job->enqueue_time_us);
+
             LOG_DEBUG("threadpool - worker 0x%" PRIx32 " - processing job 0x%" PRIxPTR "\n", GetCurrentThreadId(),
                       (intptr_t)job);
+            trace_begin("threadpool_run");
             job->callback(job->user_data);
+            trace_end("threadpool_run");
             LOG_DEBUG("threadpool - worker 0x%" PRIx32 " - job complete 0x%" PRIxPTR "\n", GetCurrentThreadId(),
                       (intptr_t)job);
+            trace_set_request_id(0);
             threadpool_job_delete(&job);
         }
 
@@ -0,0 +1,213 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "atomic.h"
+#include "mutex.h"
+#include "stats_record.h"
+#include "trace.h"
+#include "trace_record.h"
+
+#ifdef _MSC_VER
+#  define TRACE_THREAD_LOCAL __declspec(thread)
+#else
+#  define TRACE_THREAD_LOCAL __thread
+#endif
+
+typedef struct trace_callbacks_s {
+    proxyres_trace_span_cb begin_span;
+    proxyres_trace_span_cb end_span;
+    void *user_data;
+    // Previously published callbacks
+    struct trace_callbacks_s *retired;
+} trace_callbacks_s;
+
+typedef struct g_proxyres_trace_s {
+    // Whether or not spans are being recorded
+    uint64_t enabled;
+    // Span callbacks published as a whole so that readers never see a mix of old and new values
+    trace_callbacks_s *callbacks;
+    // Trace file lock
+    void *mutex;
+    // Chrome trace event JSON file
+    FILE *file;
+    bool first_event;
+    // Last request id handed out
+    uint64_t last_request_id;
+    // Last thread id handed out
+    uint64_t last_thread_id;
+} g_proxyres_trace_s;
+
+g_proxyres_trace_s g_proxyres_trace;
+
+static TRACE_THREAD_LOCAL uint64_t trace_request_id;
+static TRACE_THREAD_LOCAL uint64_t trace_thread_id;
+
+static trace_callbacks_s *trace_get_callbacks(void) {
+    return (trace_callbacks_s *)atomic_load_acquire_ptr((void *volatile *)&g_proxyres_trace.callbacks);
+}
+
+static void trace_update_enabled(void) {
+    const trace_callbacks_s *callbacks = trace_get_callbacks();
+    const bool enabled = (callbacks && (callbacks->begin_span || callbacks->end_span)) || g_proxyres_trace.file;
+    atomic_store_release_u64(&g_proxyres_trace.enabled, enabled);
+}
+
+static uint64_t trace_get_thread_id(void) {
+    // Small sequential ids are easier to read in trace viewers than native thread ids
+    if (!trace_thread_id)
+        trace_thread_id = atomic_add_u64(&g_proxyres_trace.last_thread_id, 1) + 1;
+    return trace_thread_id;
+}
+
+static void trace_write_event(const char *name, char phase, uint64_t time_us, uint64_t duration_us) {
+    if (!g_proxyres_trace.mutex || !mutex_lock(g_proxyres_trace.mutex))
+        return;
+
+    FILE *file = g_proxyres_trace.file;
+    if (file) {
+        fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"proxyres\",\"ph\":\"%c\",\"ts\":%llu,",
+                g_proxyres_trace.first_event ? "" : ",\n", name, phase, (unsigned long long)time_us);
+        if (phase == 'X')
+            fprintf(file, "\"dur\":%llu,", (unsigned long long)duration_us);
+        fprintf(file, "\"pid\":1,\"tid\":%llu,\"args\":{\"request_id\":%llu}}",
+                (unsigned long long)trace_get_thread_id(), (unsigned long long)trace_request_id);
+        g_proxyres_trace.first_event = false;
+    }
+
+    mutex_unlock(g_proxyres_trace.mutex);
+}
+
+uint64_t trace_create_request_id(void) {
+    return atomic_add_u64(&g_proxyres_trace.last_request_id, 1) + 1;
+}
+
+uint64_t trace_get_request_id(void) {
+    return trace_request_id;
+}
+
+void trace_set_request_id(uint64_t request_id) {
+    trace_request_id = request_id;
+}
+
+void trace_begin(const char *name) {
+    if (!atomic_load_acquire_u64(&g_proxyres_trace.enabled))
+        return;
+
+    const uint64_t now_us = stats_get_time_us();
+    const trace_callbacks_s *callbacks = trace_get_callbacks();
+    if (callbacks && callbacks->begin_span)
+        callbacks->begin_span(callbacks->user_data, trace_request_id, name, now_us);
+    if (g_proxyres_trace.file)
+        trace_write_event(name, 'B', now_us, 0);
+}
+
+void trace_end(const char *name) {
+    if (!atomic_load_acquire_u64(&g_proxyres_trace.enabled))
+        return;
+
+    const uint64_t now_us = stats_get_time_us();
+    const trace_callbacks_s *callbacks = trace_get_callbacks();
+    if (callbacks && callbacks->end_span)
+        callbacks->end_span(callbacks->user_data, trace_request_id, name, now_us);
+    if (g_proxyres_trace.file)
+        trace_write_event(name, 'E', now_us, 0);
+}
+
+void trace_span(const char *name, uint64_t start_us) {
+    if (!atomic_load_acquire_u64(&g_proxyres_trace.enabled))
+        return;
+
+    const uint64_t now_us = stats_get_time_us();
+    if (start_us > now_us)
+        start_us = now_us;
+    const trace_callbacks_s *callbacks = trace_get_callbacks();
+    if (callbacks && callbacks->begin_span)
+        callbacks->begin_span(callbacks->user_data, trace_request_id, name, start_us);
+    if (callbacks && callbacks->end_span)
+        callbacks->end_span(callbacks->user_data, trace_request_id, name, now_us);
+    if (g_proxyres_trace.file)
+        trace_write_event(name, 'X', start_us, now_us - start_us);
+}
+
+void proxyres_trace_set_callbacks(proxyres_trace_span_cb begin_span, proxyres_trace_span_cb end_span,
+                                  void *user_data) {
+    trace_callbacks_s *callbacks = (trace_callbacks_s *)calloc(1, sizeof(trace_callbacks_s));
+    if (!callbacks)
+        return;
+    callbacks->begin_span = begin_span;
+    callbacks->end_span = end_span;
+    callbacks->user_data = user_data;
+
+    if (g_proxyres_trace.mutex)
+        mutex_lock(g_proxyres_trace.mutex);
+    // Other threads may still be calling the previous callbacks so keep them until cleanup
+    callbacks->retired = trace_get_callbacks();
+    atomic_store_release_ptr((void *volatile *)&g_proxyres_trace.callbacks, callbacks);
+    trace_update_enabled();
+    if (g_proxyres_trace.mutex)
+        mutex_unlock(g_proxyres_trace.mutex);
+}
+
+bool proxyres_trace_start_json(const char *path) {
+    if (!path || !g_proxyres_trace.mutex)
+        return false;
+
+    FILE *file = fopen(path, "w");
+    if (!file)
+        return false;
+    fputs("[\n", file);
+
+    proxyres_trace_stop_json();
+
+    mutex_lock(g_proxyres_trace.mutex);
+    g_proxyres_trace.file = file;
+    g_proxyres_trace.first_event = true;
+    trace_update_enabled();
+    mutex_unlock(g_proxyres_trace.mutex);
+    return true;
+}
+
+bool proxyres_trace_stop_json(void) {
+    if (!g_proxyres_trace.mutex)
+        return false;
+
+    mutex_lock(g_proxyres_trace.mutex);
+    FILE *file = g_proxyres_trace.file;
+    g_proxyres_trace.file = NULL;
+    trace_update_enabled();
+    mutex_unlock(g_proxyres_trace.mutex);
+
+    if (!file)
+        return false;
+    fputs("\n]\n", file);
+    fclose(file);
+    return true;
+}
+
+bool trace_global_init(void) {
+    if (g_proxyres_trace.mutex)
+        return true;
+    g_proxyres_trace.mutex = mutex_create();
+    return g_proxyres_trace.mutex != NULL;
+}
+
+bool trace_global_cleanup(void) {
+    proxyres_trace_stop_json();
+
+    // No spans are running anymore so previous callbacks can be freed
+    trace_callbacks_s *callbacks = trace_get_callbacks();
+    if (callbacks) {
+        trace_callbacks_s *retired = callbacks->retired;
+        callbacks->retired = NULL;
+        while (retired) {
+            trace_callbacks_s *next = retired->retired;
+            free(retired);
+            retired = next;
+        }
+    }
+    mutex_delete(&g_proxyres_trace.mutex);
+    return true;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "trace.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Create a new unique request id
+uint64_t trace_create_request_id(void);
+
+// Get the request id associated with the current thread
+uint64_t trace_get_request_id(void);
+
+// Associate a request id with the current thread
+void trace_set_request_id(uint64_t request_id);
+
+// Begin a span on the current thread
+void trace_begin(const char *name);
+
+// End a span on the current thread
+void trace_end(const char *name);
+
+// Record a span on the current thread that began at the given monotonic time
+void trace_span(const char *name, uint64_t start_us);
+
+// Initialize tracing
+bool trace_global_init(void);
+
+// Stop tracing and close any open trace file
+bool trace_global_cleanup(void);
+
+#ifdef __cplusplus
+}
+#endif
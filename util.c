@@ -11,7 +11,8 @@
 #  define strncasecmp _strnicmp
 #endif
 
-#include "net_util.h"
+#include "atomic.h"
+#include "bypass.h"
 #include "util.h"
 
 // Replace one character in the string with another
@@ -174,6 +175,177 @@ bool str_wildcard_match(const char *str, const char *pattern, bool ignore_case)
     return true;
 }
 
+static int32_t hex_digit_value(char c) {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+// Decode percent-encoded characters in a string up to max length
+char *str_percent_decode(const char *str, size_t str_len) {
+    char *decoded = (char *)calloc(str_len + 1, sizeof(char));
+    if (!decoded)
+        return NULL;
+
+    char *decodedp = decoded;
+    for (size_t i = 0; i < str_len && str[i]; i++) {
+        if (str[i] == '%' && i + 2 < str_len && hex_digit_value(str[i + 1]) >= 0 && hex_digit_value(str[i + 2]) >= 0) {
+            *decodedp++ = (char)(hex_digit_value(str[i + 1]) << 4 | hex_digit_value(str[i + 2]));
+            i += 2;
+        } else {
+            *decodedp++ = str[i];
+        }
+    }
+    return decoded;
+}
+
+static int32_t base64_digit_value(char c) {
+    if (c >= 'A' && c <= 'Z')
+        return c - 'A';
+    if (c >= 'a' && c <= 'z')
+        return c - 'a' + 26;
+    if (c >= '0' && c <= '9')
+        return c - '0' + 52;
+    if (c == '+' || c == '-')
+        return 62;
+    if (c == '/' || c == '_')
+        return 63;
+    return -1;
+}
+
+// Decode base64 encoded string up to max length
+char *str_base64_decode(const char *str, size_t str_len, size_t *decoded_len) {
+    uint32_t bits = 0;
+    int32_t bit_count = 0;
+
+    char *decoded = (char *)calloc(str_len / 4 * 3 + 4, sizeof(char));
+    if (!decoded)
+        return NULL;
+
+    char *decodedp = decoded;
+    for (size_t i = 0; i < str_len && str[i] && str[i] != '='; i++) {
+        const int32_t value = base64_digit_value(str[i]);
+        if (value < 0) {
+            // Ignore whitespace that may be used to wrap lines
+            if (isspace((unsigned char)str[i]))
+                continue;
+            free(decoded);
+            return NULL;
+        }
+        bits = bits << 6 | (uint32_t)value;
+        bit_count += 6;
+        if (bit_count >= 8) {
+            bit_count -= 8;
+            *decodedp++ = (char)(bits >> bit_count);
+        }
+    }
+    if (decoded_len)
+        *decoded_len = (size_t)(decodedp - decoded);
+    return decoded;
+}
+
+// Calculate 64-bit FNV-1a hash of a buffer, continuing from a previous hash value
+uint64_t hash_fnv1a(const void *data, size_t data_len, uint64_t hash) {
+    const uint8_t *bytes = (const uint8_t *)data;
+    for (size_t i = 0; i < data_len; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+#define XXH_PRIME64_1 (0x9e3779b185ebca87ULL)
+#define XXH_PRIME64_2 (0xc2b2ae3d27d4eb4fULL)
+#define XXH_PRIME64_3 (0x165667b19e3779f9ULL)
+#define XXH_PRIME64_4 (0x85ebca77c2b2ae63ULL)
+#define XXH_PRIME64_5 (0x27d4eb2f165667c5ULL)
+
+static inline uint64_t xxh64_rotl(uint64_t value, int32_t bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static inline uint64_t xxh64_read64(const uint8_t *ptr) {
+    uint64_t value = 0;
+    memcpy(&value, ptr, sizeof(value));
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    value = __builtin_bswap64(value);
+#endif
+    return value;
+}
+
+static inline uint64_t xxh64_round(uint64_t acc, uint64_t input) {
+    acc += input * XXH_PRIME64_2;
+    acc = xxh64_rotl(acc, 31);
+    return acc * XXH_PRIME64_1;
+}
+
+static inline uint64_t xxh64_merge_round(uint64_t acc, uint64_t value) {
+    acc ^= xxh64_round(0, value);
+    return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+// Calculate 64-bit xxHash of a buffer
+uint64_t hash_xxh64(const void *data, size_t data_len, uint64_t seed) {
+    const uint8_t *ptr = (const uint8_t *)data;
+    const uint8_t *end = ptr + data_len;
+    uint64_t hash = 0;
+
+    if (data_len >= 32) {
+        uint64_t v1 = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+        uint64_t v2 = seed + XXH_PRIME64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - XXH_PRIME64_1;
+
+        // Process 32 byte stripes using four independent accumulators
+        do {
+            v1 = xxh64_round(v1, xxh64_read64(ptr));
+            v2 = xxh64_round(v2, xxh64_read64(ptr + 8));
+            v3 = xxh64_round(v3, xxh64_read64(ptr + 16));
+            v4 = xxh64_round(v4, xxh64_read64(ptr + 24));
+            ptr += 32;
+        } while (ptr + 32 <= end);
+
+        hash = xxh64_rotl(v1, 1) + xxh64_rotl(v2, 7) + xxh64_rotl(v3, 12) + xxh64_rotl(v4, 18);
+        hash = xxh64_merge_round(hash, v1);
+        hash = xxh64_merge_round(hash, v2);
+        hash = xxh64_merge_round(hash, v3);
+        hash = xxh64_merge_round(hash, v4);
+    } else {
+        hash = seed + XXH_PRIME64_5;
+    }
+
+    hash += (uint64_t)data_len;
+
+    // Process remaining bytes
+    for (; ptr + 8 <= end; ptr += 8) {
+        hash ^= xxh64_round(0, xxh64_read64(ptr));
+        hash = xxh64_rotl(hash, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+    }
+    if (ptr + 4 <= end) {
+        const uint64_t value = (uint64_t)ptr[0] | ((uint64_t)ptr[1] << 8) | ((uint64_t)ptr[2] << 16) |
+                               ((uint64_t)ptr[3] << 24);
+        hash ^= value * XXH_PRIME64_1;
+        hash = xxh64_rotl(hash, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+        ptr += 4;
+    }
+    for (; ptr < end; ptr++) {
+        hash ^= (*ptr) * XXH_PRIME64_5;
+        hash = xxh64_rotl(hash, 11) * XXH_PRIME64_1;
+    }
+
+    // Final avalanche
+    hash ^= hash >> 33;
+    hash *= XXH_PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= XXH_PRIME64_3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
 // Find host for a given url
 char *get_url_host(const char *url) {
     // Find the start of the host after the scheme
@@ -246,48 +418,77 @@ char *get_url_scheme(const char *url, const char *default_scheme) {
     return NULL;
 }
 
-// Create url from host with port
-char *get_url_from_host(const char *scheme, const char *host) {
-    // Create buffer to store and return url
-    size_t max_url = strlen(host) + strlen(scheme) + 24;
-    char *url = (char *)calloc(max_url, sizeof(char));
-    if (!url)
-        return NULL;
+// Append to string up to max length, returns length the string would have if not truncated
+static size_t str_append_len(char *str, size_t max_str, size_t str_len, const char *append, size_t append_len) {
+    if (str_len < max_str) {
+        size_t copy_len = max_str - str_len - 1;
+        if (copy_len > append_len)
+            copy_len = append_len;
+        memcpy(str + str_len, append, copy_len);
+        str[str_len + copy_len] = 0;
+    }
+    return str_len + append_len;
+}
 
-    // In case we are passed a url instead of a scheme
-    char *real_scheme = get_url_scheme(scheme, "http");
+// Create url from host with port into a buffer
+size_t get_url_from_host_buffer(const char *scheme, const char *host, char *url, size_t max_url) {
+    char port[16];
+    size_t url_len = 0;
 
-    if (strstr(host, "://") == NULL) {
-        // Construct url with scheme and host
-        snprintf(url, max_url, "%s://%s", real_scheme, host);
-    } else {
-        // Host is already a url so just copy it
-        strncat(url, host, max_url - 1);
-    }
+    if (url && max_url > 0)
+        *url = 0;
+    else
+        max_url = 0;
 
-    str_trim_end(url, '/');
+    // Remove trailing slashes
+    size_t host_len = strlen(host);
+    while (host_len > 0 && host[host_len - 1] == '/')
+        host_len--;
 
     // Find start of where we should be looking for port
-    const char *host_start = strstr(url, "://");
-    if (host_start)
-        host_start += 3;
-    else
-        host_start = url;
+    const char *host_scheme_end = strstr(host, "://");
+    const char *host_start = host;
+    if (!host_scheme_end) {
+        // In case we are passed a url instead of a scheme
+        const char *scheme_end = strstr(scheme, "://");
+        if (scheme_end)
+            url_len = str_append_len(url, max_url, url_len, scheme, (size_t)(scheme_end - scheme));
+        else
+            url_len = str_append_len(url, max_url, url_len, "http", 4);
 
-    // Append port if it does not exist
-    if (strchr(host_start, ':') == NULL) {
-        size_t url_len = strlen(url);
-        // Use default port based on scheme in host if available, otherwise
-        // fallback to using the scheme passed in
-        char *host_scheme = get_url_scheme(host, "http");
+        // Construct url with scheme and host
+        url_len = str_append_len(url, max_url, url_len, "://", 3);
+    } else if (host_scheme_end + 3 <= host + host_len) {
+        // Host is already a url so just copy it
+        host_start = host_scheme_end + 3;
+    } else {
+        host_start = host + host_len;
+    }
+    url_len = str_append_len(url, max_url, url_len, host, host_len);
 
-        snprintf(url + url_len, max_url - url_len, ":%d",
-                 get_scheme_default_port(host_scheme ? host_scheme : real_scheme));
+    // Append port if it does not exist
+    if (!str_find_len_char(host_start, (size_t)(host + host_len - host_start), ':')) {
+        // Use default port based on scheme in host if available
+        char host_scheme[16] = "http";
+        if (host_scheme_end && (size_t)(host_scheme_end - host) < sizeof(host_scheme)) {
+            memcpy(host_scheme, host, (size_t)(host_scheme_end - host));
+            host_scheme[host_scheme_end - host] = 0;
+        }
 
-        free(host_scheme);
+        const int port_len = snprintf(port, sizeof(port), ":%d", get_scheme_default_port(host_scheme));
+        url_len = str_append_len(url, max_url, url_len, port, (size_t)port_len);
     }
+    return url_len;
+}
 
-    free(real_scheme);
+// Create url from host with port
+char *get_url_from_host(const char *scheme, const char *host) {
+    // Create buffer to store and return url
+    const size_t max_url = get_url_from_host_buffer(scheme, host, NULL, 0) + 1;
+    char *url = (char *)calloc(max_url, sizeof(char));
+    if (!url)
+        return NULL;
+    get_url_from_host_buffer(scheme, host, url, max_url);
     return url;
 }
 
@@ -466,116 +667,50 @@ char *convert_proxy_list_to_uri_list(const char *proxy_list, const char *default
     return uri_list;
 }
 
-// Evaluates whether or not the proxy should be bypassed for a given url
-bool should_bypass_proxy(const char *url, const char *bypass_list) {
-    char bypass_rule[HOST_MAX] = {0};
-    bool is_local = false;
-    bool is_simple = false;
-    bool should_bypass = false;
+typedef struct should_bypass_cache_s {
+    char *bypass_list;
+    void *bypass;
+} should_bypass_cache_s;
 
-    if (!url)
-        return true;
-
-    // Chromium documentation for proxy bypass rules:
-    // https://chromium.googlesource.com/chromium/src/+/HEAD/net/docs/proxy.md#Proxy-bypass-rules
-
-    // Parse host without port for url
-    char *host = get_url_host(url);
-    if (!host)
-        return true;
-
-    // Strip and parse port from host
-    uint16_t host_port = strip_host_port(host, strlen(host), 0);
-
-    // Check for localhost address
-    if (!strcmp(host, "127.0.0.1") || !strcmp(host, "[::1]") || !strcasecmp(host, "localhost"))
-        is_local = true;
-
-    // By default don't allow localhost urls to go through proxy
-    if (is_local)
-        should_bypass = true;
-
-    if (!bypass_list) {
-        free(host);
-        return should_bypass;
-    }
+// Most recently compiled bypass list, taken by a single caller at a time
+static should_bypass_cache_s *volatile g_should_bypass_cache;
 
-    // Check for simple hostnames
-    if (strchr(host, '.') == NULL)
-        is_simple = true;
-
-    // Enumerate through each bypass expression in the bypass list
-    const char *bypass_list_end = bypass_list + strlen(bypass_list);
-    const char *rule_start = bypass_list;
-    const char *rule_end = NULL;
+static void should_bypass_cache_delete(should_bypass_cache_s *cache) {
+    if (!cache)
+        return;
+    free(cache->bypass_list);
+    bypass_delete(&cache->bypass);
+    free(cache);
+}
 
-    do {
-        // Ignore leading whitespace
-        while (*rule_start == ' ')
-            rule_start++;
-
-        // Rules can be separated by a comma
-        rule_end = strchr(rule_start, ',');
-        if (!rule_end)
-            rule_end = rule_start + strlen(rule_start);
-        size_t rule_len = (size_t)(rule_end - rule_start);
-        if (rule_len > sizeof(bypass_rule) - 1)
-            rule_len = sizeof(bypass_rule) - 2;
-
-        // Copy wildcard to match subdomain rule
-        if (*rule_start == '.')
-            strncat(bypass_rule, "*", sizeof(bypass_rule) - strlen(bypass_rule) - 1);
-
-        // Copy rule to temporary buffer
-        strncat(bypass_rule, rule_start, rule_len);
-
-        // Check if the rule is in cidr notation
-        bool is_cidr = strchr(bypass_rule, '/') != 0;
-        if (is_cidr) {
-            strip_host_ipv6_brackets(host);
-
-            // If the rule is an ip that matches cidr range then bypass proxy
-            if (is_ipv4_in_cidr_range(host, bypass_rule))
-                should_bypass = true;
-            else if (is_ipv6_in_cidr_range(host, bypass_rule))
-                should_bypass = true;
-        } else {
-            // Strip and parse port from bypass rule
-            const uint16_t bypass_rule_port = strip_host_port(bypass_rule, strlen(bypass_rule), 0);
-
-            // If the rule matches hostname of url then bypass proxy
-            if (str_wildcard_match(host, bypass_rule, true)) {
-                should_bypass = true;
-
-                // Check bypass rule port
-                if (bypass_rule_port) {
-                    if (!host_port) {
-                        // Infer default host port from url scheme
-                        char *scheme = get_url_scheme(url, "http");
-                        if (scheme) {
-                            host_port = get_scheme_default_port(scheme);
-                            free(scheme);
-                        }
-                    }
-
-                    // If the host port doesn't match the bypass rule port then don't bypass
-                    if (bypass_rule_port != host_port)
-                        should_bypass = false;
-                }
-            }
+// Evaluates whether or not the proxy should be bypassed for a given url
+bool should_bypass_proxy(const char *url, const char *bypass_list) {
+    if (!bypass_list)
+        return bypass_should_bypass(NULL, url);
+
+    // Bypass list is usually the same system bypass list so reuse it instead of compiling it again
+    should_bypass_cache_s *cache =
+        (should_bypass_cache_s *)atomic_load_acquire_ptr((void *volatile *)&g_should_bypass_cache);
+    while (cache && !atomic_cas_ptr((void *volatile *)&g_should_bypass_cache, cache, NULL))
+        cache = (should_bypass_cache_s *)atomic_load_acquire_ptr((void *volatile *)&g_should_bypass_cache);
+
+    if (!cache || strcmp(cache->bypass_list, bypass_list) != 0) {
+        should_bypass_cache_delete(cache);
+        cache = (should_bypass_cache_s *)calloc(1, sizeof(should_bypass_cache_s));
+        if (cache) {
+            cache->bypass_list = strdup(bypass_list);
+            cache->bypass = bypass_create(bypass_list);
         }
+        if (!cache || !cache->bypass_list || !cache->bypass) {
+            should_bypass_cache_delete(cache);
+            return bypass_should_bypass(NULL, url);
+        }
+    }
 
-        // If the rule is <local> then allow all simple hostnames to bypass proxy
-        if (is_simple && strcasecmp(bypass_rule, "<local>") == 0)
-            should_bypass = true;
-        // If the rule is <-loopback> then allow localhost urls to go through proxy
-        if (is_local && strcasecmp(bypass_rule, "<-loopback>") == 0)
-            should_bypass = false;
-
-        rule_start = rule_end + 1;
-    } while (rule_end < bypass_list_end);
-
-    free(host);
+    const bool should_bypass = bypass_should_bypass(cache->bypass, url);
 
+    // Keep the compiled list for the next caller unless another caller already put one back
+    if (!atomic_cas_ptr((void *volatile *)&g_should_bypass_cache, NULL, cache))
+        should_bypass_cache_delete(cache);
     return should_bypass;
 }
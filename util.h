@@ -4,6 +4,8 @@
 #define SCRIPT_MAX (256 * 1024)
 #define UNUSED(x)  ((void)x)
 
+#define HASH_FNV1A_INIT (0xcbf29ce484222325ULL)
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -35,6 +37,18 @@ char *str_sep_dup(const char **strp, const char *delim);
 // Compare a string using wildcard pattern
 bool str_wildcard_match(const char *str, const char *pattern, bool ignore_case);
 
+// Decode percent-encoded characters in a string up to max length
+char *str_percent_decode(const char *str, size_t str_len);
+
+// Decode base64 encoded string up to max length
+char *str_base64_decode(const char *str, size_t str_len, size_t *decoded_len);
+
+// Calculate 64-bit FNV-1a hash of a buffer, continuing from a previous hash value
+uint64_t hash_fnv1a(const void *data, size_t data_len, uint64_t hash);
+
+// Calculate 64-bit xxHash of a buffer
+uint64_t hash_xxh64(const void *data, size_t data_len, uint64_t seed);
+
 // Find host for a given url
 char *get_url_host(const char *url);
 
@@ -47,6 +61,9 @@ char *get_url_scheme(const char *url, const char *default_scheme);
 // Create url from host with port
 char *get_url_from_host(const char *scheme, const char *host);
 
+// Create url from host with port into a buffer, returns length of url even if truncated
+size_t get_url_from_host_buffer(const char *scheme, const char *host, char *url, size_t max_url);
+
 // Get port from host
 uint16_t get_host_port(const char *host, size_t host_len, uint16_t default_port);
 
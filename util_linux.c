@@ -2,11 +2,28 @@
 #include <stdbool.h>
 #include <string.h>
 #include <stdlib.h>
+#include <ctype.h>
 
 #include <unistd.h>
 
+#include "util.h"
 #include "util_linux.h"
 
+typedef struct config_table_entry_s {
+    uint64_t hash;
+    const char *section;
+    const char *key;
+    const char *value;
+} config_table_entry_s;
+
+typedef struct config_table_s {
+    // Copy of the config with sections, keys and values terminated in place
+    char *buffer;
+    // Open addressing hash table with power of two size
+    size_t entry_mask;
+    config_table_entry_s *entries;
+} config_table_s;
+
 int32_t get_desktop_env(void) {
     const char *current_desktop = getenv("XDG_CURRENT_DESKTOP");  // Since 2012
     if (current_desktop) {
@@ -97,3 +114,116 @@ char *get_config_value(const char *config, const char *section, const char *key)
 
     return NULL;
 }
+
+static uint64_t config_table_hash(const char *section, const char *key) {
+    // Include terminator so that section and key boundaries are part of the hash
+    uint64_t hash = hash_fnv1a(section, strlen(section) + 1, HASH_FNV1A_INIT);
+    return hash_fnv1a(key, strlen(key), hash);
+}
+
+static char *config_table_trim(char *start, char *end) {
+    while (start < end && isspace((unsigned char)*start))
+        start++;
+    while (end > start && isspace((unsigned char)end[-1]))
+        end--;
+    *end = 0;
+    return start;
+}
+
+static void config_table_insert(config_table_s *table, const char *section, const char *key, const char *value) {
+    const uint64_t hash = config_table_hash(section, key);
+    size_t index = (size_t)hash & table->entry_mask;
+
+    while (table->entries[index].key) {
+        config_table_entry_s *entry = &table->entries[index];
+        // First value found in the config is used, same as get_config_value
+        if (entry->hash == hash && strcmp(entry->section, section) == 0 && strcmp(entry->key, key) == 0)
+            return;
+        index = (index + 1) & table->entry_mask;
+    }
+
+    table->entries[index].hash = hash;
+    table->entries[index].section = section;
+    table->entries[index].key = key;
+    table->entries[index].value = value;
+}
+
+void *config_table_create(const char *config) {
+    const char *section = "";
+    char *line_start = NULL;
+    size_t entry_count = 16;
+
+    if (!config)
+        return NULL;
+
+    config_table_s *table = (config_table_s *)calloc(1, sizeof(config_table_s));
+    if (!table)
+        return NULL;
+
+    // Keep the table at most half full so lookups stay short
+    const size_t max_entries = (size_t)str_count_chr(config, '\n') + 1;
+    while (entry_count < max_entries * 2)
+        entry_count <<= 1;
+    table->entry_mask = entry_count - 1;
+    table->entries = (config_table_entry_s *)calloc(entry_count, sizeof(config_table_entry_s));
+    table->buffer = strdup(config);
+    if (!table->entries || !table->buffer) {
+        config_table_delete((void **)&table);
+        return NULL;
+    }
+
+    line_start = table->buffer;
+    while (*line_start) {
+        char *line_end = strchr(line_start, '\n');
+        char *next_line = line_end ? line_end + 1 : line_start + strlen(line_start);
+        if (!line_end)
+            line_end = next_line;
+
+        char *line = config_table_trim(line_start, line_end);
+        const size_t line_len = strlen(line);
+
+        if (line_len > 2 && line[0] == '[' && line[line_len - 1] == ']') {
+            line[line_len - 1] = 0;
+            section = line + 1;
+        } else if (line[0] != '#' && line[0] != ';') {
+            char *key_end = strchr(line, '=');
+            if (key_end) {
+                char *value = config_table_trim(key_end + 1, line + line_len);
+                const char *key = config_table_trim(line, key_end);
+                config_table_insert(table, section, key, value);
+            }
+        }
+
+        line_start = next_line;
+    }
+
+    return table;
+}
+
+const char *config_table_get_value(void *ctx, const char *section, const char *key) {
+    config_table_s *table = (config_table_s *)ctx;
+    if (!table || !section || !key)
+        return NULL;
+
+    const uint64_t hash = config_table_hash(section, key);
+    size_t index = (size_t)hash & table->entry_mask;
+
+    while (table->entries[index].key) {
+        const config_table_entry_s *entry = &table->entries[index];
+        if (entry->hash == hash && strcmp(entry->section, section) == 0 && strcmp(entry->key, key) == 0)
+            return *entry->value ? entry->value : NULL;
+        index = (index + 1) & table->entry_mask;
+    }
+    return NULL;
+}
+
+bool config_table_delete(void **ctx) {
+    if (!ctx || !*ctx)
+        return false;
+    config_table_s *table = (config_table_s *)*ctx;
+    free(table->entries);
+    free(table->buffer);
+    free(table);
+    *ctx = NULL;
+    return true;
+}
@@ -19,6 +19,15 @@ int32_t get_desktop_env(void);
 // Retrieve the value for a setting stored in an INI configuration file
 char *get_config_value(const char *config, const char *section, const char *key);
 
+// Parse an INI configuration file into a table hashed by section and key
+void *config_table_create(const char *config);
+
+// Retrieve the value for a setting in a parsed INI configuration, NULL if not found or empty
+const char *config_table_get_value(void *ctx, const char *section, const char *key);
+
+// Delete a parsed INI configuration
+bool config_table_delete(void **ctx);
+
 #ifdef __cplusplus
 }
 #endif
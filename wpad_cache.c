@@ -0,0 +1,281 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#ifdef _WIN32
+#  include <windows.h>
+#  include <direct.h>
+#  define mkdir(path, mode) _mkdir(path)
+#else
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <sys/stat.h>
+#endif
+
+#define LOG_CATEGORY PROXYRES_LOG_CATEGORY_WPAD
+
+#include "log.h"
+#include "net_adapter.h"
+#include "util.h"
+#include "wpad_cache.h"
+
+#define WPAD_CACHE_MAGIC    (0x43585250)  // PRXC
+#define WPAD_CACHE_VERSION  (1)
+#define WPAD_CACHE_FILENAME "wpad.cache"
+#define WPAD_CACHE_PATH_MAX (4096)
+
+typedef struct wpad_cache_header_s {
+    uint32_t magic;
+    uint32_t version;
+    // Fingerprint of network adapters when WPAD was discovered
+    uint64_t fingerprint;
+    // Time the PAC script was fetched
+    int64_t fetch_time;
+    // Hash of the url and script used to detect torn writes
+    uint64_t content_hash;
+    uint32_t url_len;
+    uint32_t script_len;
+} wpad_cache_header_s;
+
+typedef struct g_wpad_cache_s {
+    // Path to cache file, empty when disabled. Kept across global cleanup so that re-initializing uses the same
+    // setting.
+    char path[WPAD_CACHE_PATH_MAX + sizeof(WPAD_CACHE_FILENAME) + 1];
+} g_wpad_cache_s;
+
+g_wpad_cache_s g_wpad_cache;
+
+static bool wpad_cache_get_default_dir(char *cache_dir, size_t max_cache_dir) {
+    const char *base_dir = NULL;
+    const char *sub_dir = "";
+
+#ifdef _WIN32
+    base_dir = getenv("LOCALAPPDATA");
+#else
+    base_dir = getenv("XDG_CACHE_HOME");
+    if (!base_dir || !*base_dir) {
+        base_dir = getenv("HOME");
+        sub_dir = "/.cache";
+    }
+#endif
+    if (!base_dir || !*base_dir)
+        return false;
+
+    snprintf(cache_dir, max_cache_dir, "%s%s/proxyres", base_dir, sub_dir);
+    return true;
+}
+
+static void wpad_cache_create_dir(const char *path) {
+    char dir[WPAD_CACHE_PATH_MAX];
+
+    strncpy(dir, path, sizeof(dir) - 1);
+    dir[sizeof(dir) - 1] = 0;
+
+    // Create each parent directory of the cache file
+    for (char *sep = dir + 1; *sep; sep++) {
+        if (*sep != '/' && *sep != '\\')
+            continue;
+        const char saved = *sep;
+        *sep = 0;
+        mkdir(dir, 0700);
+        *sep = saved;
+    }
+}
+
+static bool wpad_cache_hash_adapter(void *user_data, net_adapter_s *adapter) {
+    uint64_t *fingerprint = (uint64_t *)user_data;
+
+    if (!adapter->is_connected)
+        return true;
+
+    *fingerprint = hash_fnv1a(adapter->name, strlen(adapter->name), *fingerprint);
+    *fingerprint = hash_fnv1a(adapter->mac, adapter->mac_length, *fingerprint);
+    *fingerprint = hash_fnv1a(adapter->ip, sizeof(adapter->ip), *fingerprint);
+    *fingerprint = hash_fnv1a(adapter->netmask, sizeof(adapter->netmask), *fingerprint);
+    *fingerprint = hash_fnv1a(adapter->gateway, sizeof(adapter->gateway), *fingerprint);
+    *fingerprint = hash_fnv1a(adapter->primary_dns, sizeof(adapter->primary_dns), *fingerprint);
+    *fingerprint = hash_fnv1a(adapter->secondary_dns, sizeof(adapter->secondary_dns), *fingerprint);
+    *fingerprint = hash_fnv1a(adapter->dhcp, sizeof(adapter->dhcp), *fingerprint);
+    return true;
+}
+
+uint64_t wpad_cache_get_network_fingerprint(void) {
+    uint64_t fingerprint = HASH_FNV1A_INIT;
+    net_adapter_enum(&fingerprint, wpad_cache_hash_adapter);
+    return fingerprint;
+}
+
+static uint64_t wpad_cache_get_content_hash(const char *url, size_t url_len, const char *script, size_t script_len) {
+    uint64_t hash = hash_fnv1a(url, url_len, HASH_FNV1A_INIT);
+    return hash_fnv1a(script, script_len, hash);
+}
+
+static bool wpad_cache_parse(const uint8_t *data, size_t data_len, uint64_t fingerprint, char **auto_config_url,
+                             char **script, time_t *fetch_time) {
+    wpad_cache_header_s header;
+
+    if (data_len < sizeof(header))
+        return false;
+    memcpy(&header, data, sizeof(header));
+
+    if (header.magic != WPAD_CACHE_MAGIC || header.version != WPAD_CACHE_VERSION)
+        return false;
+    if (header.fingerprint != fingerprint) {
+        LOG_DEBUG("WPAD cache network fingerprint does not match\n");
+        return false;
+    }
+    if (!header.script_len || header.script_len >= SCRIPT_MAX ||
+        (uint64_t)sizeof(header) + header.url_len + header.script_len != data_len)
+        return false;
+
+    const char *url_start = (const char *)data + sizeof(header);
+    const char *script_start = url_start + header.url_len;
+    if (wpad_cache_get_content_hash(url_start, header.url_len, script_start, header.script_len) != header.content_hash)
+        return false;
+
+    *auto_config_url = NULL;
+    if (header.url_len) {
+        *auto_config_url = (char *)calloc(header.url_len + 1, sizeof(char));
+        if (!*auto_config_url)
+            return false;
+        memcpy(*auto_config_url, url_start, header.url_len);
+    }
+
+    *script = (char *)calloc(header.script_len + 1, sizeof(char));
+    if (!*script) {
+        free(*auto_config_url);
+        *auto_config_url = NULL;
+        return false;
+    }
+    memcpy(*script, script_start, header.script_len);
+
+    *fetch_time = (time_t)header.fetch_time;
+    return true;
+}
+
+bool wpad_cache_load(uint64_t fingerprint, char **auto_config_url, char **script, time_t *fetch_time) {
+    bool is_ok = false;
+
+    if (!*g_wpad_cache.path || !auto_config_url || !script || !fetch_time)
+        return false;
+
+#ifdef _WIN32
+    FILE *file = fopen(g_wpad_cache.path, "rb");
+    if (!file)
+        return false;
+
+    uint8_t *data = (uint8_t *)malloc(sizeof(wpad_cache_header_s) + SCRIPT_MAX * 2);
+    if (data) {
+        size_t data_len = fread(data, 1, sizeof(wpad_cache_header_s) + SCRIPT_MAX * 2, file);
+        is_ok = wpad_cache_parse(data, data_len, fingerprint, auto_config_url, script, fetch_time);
+        free(data);
+    }
+    fclose(file);
+#else
+    int fd = open(g_wpad_cache.path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    // Read the cache file in one call using its size instead of reading it in chunks
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0 &&
+        (uint64_t)st.st_size <= sizeof(wpad_cache_header_s) + (uint64_t)SCRIPT_MAX * 2) {
+        uint8_t *data = (uint8_t *)malloc((size_t)st.st_size);
+        size_t data_len = 0;
+        while (data && data_len < (size_t)st.st_size) {
+            const ssize_t bytes_read = read(fd, data + data_len, (size_t)st.st_size - data_len);
+            if (bytes_read < 0 && errno == EINTR)
+                continue;
+            if (bytes_read <= 0)
+                break;
+            data_len += (size_t)bytes_read;
+        }
+        // Parsing fails if the file was truncated while it was being read
+        if (data)
+            is_ok = wpad_cache_parse(data, data_len, fingerprint, auto_config_url, script, fetch_time);
+        free(data);
+    }
+    close(fd);
+#endif
+
+    if (is_ok)
+        LOG_INFO("Loaded proxy auto config from cache %s\n", g_wpad_cache.path);
+    return is_ok;
+}
+
+bool wpad_cache_save(uint64_t fingerprint, const char *auto_config_url, const char *script, time_t fetch_time) {
+    char temp_path[WPAD_CACHE_PATH_MAX + 32];
+    wpad_cache_header_s header = {0};
+
+    if (!*g_wpad_cache.path || !script)
+        return false;
+
+    const size_t url_len = auto_config_url ? strlen(auto_config_url) : 0;
+    const size_t script_len = strlen(script);
+
+    header.magic = WPAD_CACHE_MAGIC;
+    header.version = WPAD_CACHE_VERSION;
+    header.fingerprint = fingerprint;
+    header.fetch_time = (int64_t)fetch_time;
+    header.content_hash = wpad_cache_get_content_hash(auto_config_url, url_len, script, script_len);
+    header.url_len = (uint32_t)url_len;
+    header.script_len = (uint32_t)script_len;
+
+    wpad_cache_create_dir(g_wpad_cache.path);
+
+    // Write to temporary file and rename so readers never see a partially written cache
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", g_wpad_cache.path);
+    FILE *file = fopen(temp_path, "wb");
+    if (!file) {
+        LOG_DEBUG("Unable to create WPAD cache %s (%d)\n", temp_path, errno);
+        return false;
+    }
+
+    bool is_ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    if (is_ok && url_len)
+        is_ok = fwrite(auto_config_url, url_len, 1, file) == 1;
+    if (is_ok)
+        is_ok = fwrite(script, script_len, 1, file) == 1;
+    is_ok = fclose(file) == 0 && is_ok;
+
+#ifdef _WIN32
+    if (is_ok)
+        is_ok = MoveFileExA(temp_path, g_wpad_cache.path, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    if (is_ok)
+        is_ok = rename(temp_path, g_wpad_cache.path) == 0;
+#endif
+    if (!is_ok) {
+        LOG_DEBUG("Unable to write WPAD cache %s\n", g_wpad_cache.path);
+        remove(temp_path);
+    }
+    return is_ok;
+}
+
+bool wpad_cache_set_dir(bool enabled, const char *cache_dir) {
+    char default_dir[WPAD_CACHE_PATH_MAX];
+
+    *g_wpad_cache.path = 0;
+
+    if (!enabled)
+        return true;
+
+    if (!cache_dir) {
+        if (!wpad_cache_get_default_dir(default_dir, sizeof(default_dir)))
+            return false;
+        cache_dir = default_dir;
+    }
+    if (strlen(cache_dir) >= WPAD_CACHE_PATH_MAX)
+        return false;
+
+    snprintf(g_wpad_cache.path, sizeof(g_wpad_cache.path), "%s/%s", cache_dir, WPAD_CACHE_FILENAME);
+    return true;
+}
+
+bool wpad_cache_is_enabled(void) {
+    return *g_wpad_cache.path != 0;
+}
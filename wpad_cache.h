@@ -0,0 +1,24 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Enable or disable the WPAD cache file. Uses the user's cache directory when cache_dir is NULL.
+bool wpad_cache_set_dir(bool enabled, const char *cache_dir);
+
+// Check whether the WPAD cache file is enabled
+bool wpad_cache_is_enabled(void);
+
+// Calculate fingerprint of the network adapters used to determine if the cache is still valid
+uint64_t wpad_cache_get_network_fingerprint(void);
+
+// Load WPAD url and PAC script from the cache file if the network fingerprint matches
+bool wpad_cache_load(uint64_t fingerprint, char **auto_config_url, char **script, time_t *fetch_time);
+
+// Save WPAD url and PAC script to the cache file
+bool wpad_cache_save(uint64_t fingerprint, const char *auto_config_url, const char *script, time_t fetch_time);
+
+#ifdef __cplusplus
+}
+#endif
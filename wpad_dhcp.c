@@ -3,8 +3,11 @@
 #include <stdlib.h>
 #include <stdio.h>
 
+#define LOG_CATEGORY PROXYRES_LOG_CATEGORY_WPAD
+
 #include "log.h"
 #include "net_adapter.h"
+#include "trace_record.h"
 #include "util.h"
 #include "wpad_dhcp.h"
 #include "wpad_dhcp_posix.h"
@@ -58,7 +61,9 @@ char *wpad_dhcp(int32_t timeout_sec) {
     wpad_dhcp_adapter_enum_s adapter_enum = {NULL, timeout_sec};
 
     // Enumerate each network adapter and send DHCP request for WPAD
+    trace_begin("wpad_dhcp");
     net_adapter_enum(&adapter_enum, wpad_dhcp_enum_adapter);
+    trace_end("wpad_dhcp");
 
     return adapter_enum.url;
 }
\ No newline at end of file
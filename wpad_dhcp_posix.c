@@ -19,6 +19,8 @@
 #  include <unistd.h>
 #endif
 
+#define LOG_CATEGORY PROXYRES_LOG_CATEGORY_WPAD
+
 #include "log.h"
 #include "net_adapter.h"
 #include "util.h"
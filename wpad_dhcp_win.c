@@ -6,6 +6,8 @@
 #include <windows.h>
 #include <dhcpcsdk.h>
 
+#define LOG_CATEGORY PROXYRES_LOG_CATEGORY_WPAD
+
 #include "log.h"
 #include "net_adapter.h"
 #include "util.h"
@@ -17,9 +17,12 @@
 #  include <unistd.h>
 #endif
 
+#define LOG_CATEGORY PROXYRES_LOG_CATEGORY_WPAD
+
 #include "fetch.h"
 #include "log.h"
 #include "net_util.h"
+#include "trace_record.h"
 #include "util.h"
 #include "wpad_dns.h"
 
@@ -29,8 +32,8 @@
 #  define socketerr errno
 #endif
 
-// Request WPAD script using DNS
-char *wpad_dns(const char *fqdn) {
+// Search for WPAD script on each part of the FQDN
+static char *wpad_dns_search(const char *fqdn) {
     char hostname[HOST_MAX] = {0};
     char wpad_host[HOST_MAX] = {0};
     int32_t error = 0;
@@ -84,4 +87,12 @@ char *wpad_dns(const char *fqdn) {
     } while (true);
 
     return NULL;
-}
\ No newline at end of file
+}
+
+// Request WPAD script using DNS
+char *wpad_dns(const char *fqdn) {
+    trace_begin("wpad_dns");
+    char *script = wpad_dns_search(fqdn);
+    trace_end("wpad_dns");
+    return script;
+}